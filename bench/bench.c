@@ -0,0 +1,694 @@
+// Host benchmark for the WASM runtime and its host bindings
+//
+// Runs the firmware setup path (runtime.c) on linux with ESP-IDF stubbed, reporting
+// setup latency, host call throughput and optionally run time for applet binaries.
+// Interpreter correctness checks (checks.wat) run first and fail the bench on a mismatch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "wasm3.h"
+#include "m3_env.h"
+#include "m3_api_defs.h"
+
+#include "runtime.h"
+
+#include "bench_wasm.h"
+#include "checks_wasm.h"
+
+// Internal to runtime.c
+int wasm_run(WasmTask_t* wasmTask);
+int wasm_load(IM3Runtime runtime, const uint8_t* data, uint32_t len, IM3Module* module);
+int wasm_link(IM3Module module);
+
+extern bool bench_verbose;
+
+#define BENCH_SETUP_ITERATIONS  100
+#define BENCH_CALL_ITERATIONS   1000000
+#define BENCH_LINK_ITERATIONS   1000
+
+// Fixed heap churn, live allocations and operations
+#define BENCH_HEAP_SLOTS        64
+#define BENCH_HEAP_ITERATIONS   200000
+
+// An exported checks.wat function called with one argument, and its result
+typedef struct {
+    const char*     name;
+    const char*     arg;
+    uint32_t        expected;
+    const M3Result* trap;       // expected trap, NULL if the call returns
+} BenchCheck_t;
+
+// Expected values are the spec results (cross-checked with V8), the same for every interpreter configuration
+static const BenchCheck_t bench_checks[] = {
+    { "check_binop_i32", "100", 0x6b07d35f },
+    { "check_binop_i64", "100", 0xc7394a6d },
+    { "check_compare", "100", 0xe1ccbf42 },
+    { "check_branch_edges", "12345", 0xcadcf7f4 },
+    { "check_branch_edges", "-7", 0xa757cad1 },
+    { "check_load", "100", 0x3d8793a0 },
+    { "check_load_bounds", "65530", 0 },
+    { "check_load_bounds", "65531", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+
+    { "check_memory_copy", "0", 0x591a4e30 },
+    { "check_memory_copy", "3", 0x24a9afac },
+    { "check_memory_copy", "13", 0xef705454 },
+    { "check_memory_fill", "427", 0xf5b233a8 },
+    { "check_memory_fill", "-1", 0x9596e7a8 },
+    { "check_memory_init", "0", 0x398c046c },
+    { "check_memory_init", "18", 0xb4fb23ec },
+    { "check_memory_init", "19", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_data_drop", "0", 0 },
+    { "check_data_drop", "1", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_init_active", "0", 0xa733550a },
+    { "check_init_active", "1", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_copy_bounds", "65520", 0 },
+    { "check_copy_bounds", "65521", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_copy_bounds", "-1", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_copy_src_bounds", "65520", 0 },
+    { "check_copy_src_bounds", "65521", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_copy_src_bounds", "-8", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_copy_empty_bounds", "65536", 0 },
+    { "check_copy_empty_bounds", "65537", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_fill_bounds", "65520", 0 },
+    { "check_fill_bounds", "65521", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_fill_bounds", "-4", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_init_bounds", "22", 0x6cdc },
+    { "check_init_bounds", "23", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_init_bounds", "-1", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+    { "check_init_dst_bounds", "65532", 0 },
+    { "check_init_dst_bounds", "65533", 0, &m3Err_trapOutOfBoundsMemoryAccess },
+};
+
+// Dropped segments are instance state, so m3_ResetRuntime between these must restore them
+static const BenchCheck_t bench_reset_checks[][2] = {
+    { { "check_data_drop", "0", 0 }, { "check_memory_init", "0", 0x398c046c } },
+    { { "check_memory_init", "0", 0x398c046c }, { "check_memory_init", "0", 0x398c046c } },
+};
+
+static WasmTask_t bench_task;
+
+static double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void report_latency(const char* group, const char* name, double us) {
+    printf("%-6s %-20s %12.2f us\r\n", group, name, us);
+}
+
+static void report_rate(const char* group, const char* name, uint32_t ops, double us, double baseline_ns) {
+    double ns = us * 1e3 / ops - baseline_ns;
+    printf("%-6s %-20s %12.0f ops/s %10.1f ns/call\r\n", group, name, ops / (us / 1e6), ns);
+}
+
+// Send stdout to /dev/null while applets are writing to it
+static int quiet_stdout() {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    return saved;
+}
+
+static void restore_stdout(int saved) {
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+// Target for the single-import link benchmark, never called
+m3ApiRawFunction(bench_raw_stub)
+{
+    m3ApiReturnType  (uint32_t)
+    m3ApiReturn(0);
+}
+
+static void bench_task_init() {
+    strncpy(bench_task.name, "bench", TASK_NAME_MAX_LEN - 1);
+    bench_task.data = bench_wasm;
+    bench_task.data_len = bench_wasm_len;
+    bench_task.crc = 0xbe4c0001;
+}
+
+static int bench_setup(uint32_t iterations) {
+    double start;
+
+    // Full wasm_run with the module cache dropped each time
+    start = now_us();
+    for (uint32_t i=0; i<iterations; i++) {
+        WASM_cache_flush();
+        if (wasm_run(&bench_task) < 0) {
+            fprintf(stderr, "wasm_run failed\r\n");
+            return -1;
+        }
+    }
+    report_latency("setup", "run (cold)", (now_us() - start) / iterations);
+
+    // Full wasm_run re-using the cached module
+    start = now_us();
+    for (uint32_t i=0; i<iterations; i++) {
+        if (wasm_run(&bench_task) < 0) {
+            fprintf(stderr, "wasm_run failed\r\n");
+            return -1;
+        }
+    }
+    report_latency("setup", "run (cached)", (now_us() - start) / iterations);
+
+    WASM_cache_flush();
+
+    // Parse and load, then the host API link pass, each timed on its own
+    double load_us = 0, link_us = 0;
+    for (uint32_t i=0; i<iterations; i++) {
+        IM3Environment env = m3_NewEnvironment();
+        IM3Runtime runtime = m3_NewRuntime(env, 32 * 1024, NULL);
+        IM3Module module;
+
+        start = now_us();
+        m3_ParseModule(env, &module, bench_wasm, bench_wasm_len);
+        m3_LoadModule(runtime, module);
+        load_us += now_us() - start;
+
+        start = now_us();
+        if (wasm_link(module) < 0) {
+            fprintf(stderr, "wasm_link failed\r\n");
+            m3_FreeRuntime(runtime);
+            m3_FreeEnvironment(env);
+            return -1;
+        }
+        link_us += now_us() - start;
+
+        m3_FreeRuntime(runtime);
+        m3_FreeEnvironment(env);
+    }
+    report_latency("setup", "parse + load", load_us / iterations);
+    report_latency("setup", "link", link_us / iterations);
+
+    // A single m3_LinkRawFunction, re-binding one import of a loaded module
+    IM3Environment env = m3_NewEnvironment();
+    IM3Runtime runtime = m3_NewRuntime(env, 32 * 1024, NULL);
+    IM3Module module;
+    M3Result result = m3_ParseModule(env, &module, bench_wasm, bench_wasm_len);
+    if (result == m3Err_none) {
+        result = m3_LoadModule(runtime, module);
+    }
+
+    start = now_us();
+    for (uint32_t i=0; i<BENCH_LINK_ITERATIONS && result == m3Err_none; i++) {
+        result = m3_LinkRawFunction(module, "env", "log_write", "i(*i)", &bench_raw_stub);
+    }
+    double one_us = now_us() - start;
+
+    m3_FreeRuntime(runtime);
+    m3_FreeEnvironment(env);
+
+    if (result) {
+        fprintf(stderr, "LinkRawFunction: %s\r\n", result);
+        return -1;
+    }
+    report_latency("setup", "link (one import)", one_us / BENCH_LINK_ITERATIONS);
+
+    return 0;
+}
+
+static M3Result bench_checks_load(IM3Environment env, IM3Runtime runtime) {
+    IM3Module module;
+
+    M3Result result = m3_ParseModule(env, &module, checks_wasm, checks_wasm_len);
+    if (result) {
+        return result;
+    }
+
+    result = m3_LoadModule(runtime, module);
+    if (result) {
+        m3_FreeModule(module);
+        return result;
+    }
+
+    return m3_CompileModule(module);
+}
+
+static int bench_check_call(IM3Runtime runtime, const BenchCheck_t* check) {
+    IM3Function f;
+    M3Result result = m3_FindFunction(&f, runtime, check->name);
+    if (result) {
+        fprintf(stderr, "check %s: %s\r\n", check->name, result);
+        return -1;
+    }
+
+    const char* argv[2] = { check->arg, NULL };
+    uint32_t value = 0;
+
+    result = m3_CallWithArgs(f, 1, argv);
+    if (result == m3Err_none) {
+        value = *(uint32_t*) runtime->stack;
+    }
+
+    if (check->trap != NULL && result != *check->trap) {
+        fprintf(stderr, "check %s(%s): expected trap '%s', got '%s'\r\n", check->name, check->arg, *check->trap, result ? result : "none");
+        return -1;
+    } else if (check->trap == NULL && result) {
+        fprintf(stderr, "check %s(%s): %s\r\n", check->name, check->arg, result);
+        return -1;
+    } else if (check->trap == NULL && value != check->expected) {
+        fprintf(stderr, "check %s(%s): expected 0x%08x, got 0x%08x\r\n", check->name, check->arg, check->expected, value);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Runs the checks in one runtime, reset between them, or in a fresh runtime each for a single check.
+// A fresh runtime sees zeroed memory and unused data segments
+static int bench_check(const BenchCheck_t* checks, uint32_t count) {
+    IM3Environment env = m3_NewEnvironment();
+    IM3Runtime runtime = m3_NewRuntime(env, 64 * 1024, NULL);
+    int res = -1;
+
+    M3Result result = bench_checks_load(env, runtime);
+    if (result) {
+        fprintf(stderr, "check load: %s\r\n", result);
+        goto check_done;
+    }
+
+    for (uint32_t i=0; i<count; i++) {
+        if (i > 0 && (result = m3_ResetRuntime(runtime))) {
+            fprintf(stderr, "check ResetRuntime: %s\r\n", result);
+            goto check_done;
+        }
+        if (bench_check_call(runtime, &checks[i]) < 0) {
+            goto check_done;
+        }
+    }
+
+    res = 0;
+
+check_done:
+    m3_FreeRuntime(runtime);
+    m3_FreeEnvironment(env);
+
+    return res;
+}
+
+#if d_m3FixedHeap
+
+static bool bench_heap_consistent(const M3HeapInfo* base, uint32_t live, uint32_t failures) {
+    M3HeapInfo info;
+    m3_GetHeapInfo(&info);
+
+    return info.used <= info.size && info.peak >= info.used && info.largestFree <= info.size - info.used
+        && info.allocations == base->allocations + live && info.failures == base->failures + failures;
+}
+
+// Allocator accounting must hold through malloc / realloc / free churn, contents must survive a realloc and new
+// memory must be zeroed. Once everything is freed the heap must coalesce back to where it started
+static int bench_check_heap() {
+    uint8_t* ptrs[BENCH_HEAP_SLOTS] = { NULL };
+    size_t sizes[BENCH_HEAP_SLOTS] = { 0 };
+    uint32_t live = 0, failures = 0;
+    uint32_t seed = 0x2545f491;
+    int res = -1;
+
+    // Initialises the heap if nothing has allocated yet
+    void* p;
+    m3Malloc(&p, 1);
+    m3Free(p);
+
+    M3HeapInfo base;
+    m3_GetHeapInfo(&base);
+
+    for (uint32_t it=0; it<BENCH_HEAP_ITERATIONS; it++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+
+        uint32_t i = seed % BENCH_HEAP_SLOTS;
+        size_t size = (seed >> 8) % ((seed & 0x30) ? 512 : 32768);
+
+        for (size_t k=0; k<sizes[i]; k++) {
+            if (ptrs[i][k] != (uint8_t)(i + k)) {
+                fprintf(stderr, "check heap: allocation %u corrupted\r\n", i);
+                goto heap_done;
+            }
+        }
+
+        size_t zeroed = 0;
+        if (ptrs[i] == NULL) {
+            if (m3Malloc((void**) &ptrs[i], size) == m3Err_none) {
+                live++;
+            } else {
+                failures++;
+                size = 0;
+            }
+        } else if (seed & 0x40) {
+            m3Free(ptrs[i]);
+            ptrs[i] = NULL;
+            live--;
+            size = 0;
+        } else {
+            uint8_t* q = m3Realloc(ptrs[i], size, sizes[i]);
+            if (q != NULL) {
+                ptrs[i] = q;
+                zeroed = sizes[i];
+            } else {
+                failures++;
+                size = sizes[i];
+                zeroed = size;
+            }
+        }
+
+        for (size_t k=zeroed; k<size; k++) {
+            if (ptrs[i][k] != 0) {
+                fprintf(stderr, "check heap: allocation %u not zeroed\r\n", i);
+                goto heap_done;
+            }
+        }
+        for (size_t k=0; k<size; k++) {
+            ptrs[i][k] = (uint8_t)(i + k);
+        }
+        sizes[i] = size;
+
+        if (!bench_heap_consistent(&base, live, failures)) {
+            fprintf(stderr, "check heap: inconsistent heap info after %u operations\r\n", it);
+            goto heap_done;
+        }
+    }
+
+    res = 0;
+
+heap_done:
+    for (uint32_t i=0; i<BENCH_HEAP_SLOTS; i++) {
+        m3Free(ptrs[i]);
+    }
+
+    M3HeapInfo info;
+    m3_GetHeapInfo(&info);
+
+    if (res == 0 && (info.used != base.used || info.allocations != base.allocations || info.largestFree != base.largestFree)) {
+        fprintf(stderr, "check heap: %zu bytes in %u allocations left, largest free %zu (from %zu)\r\n",
+                info.used - base.used, info.allocations - base.allocations, info.largestFree, base.largestFree);
+        res = -1;
+    }
+
+    return res;
+}
+
+#endif
+
+static int bench_checks_run() {
+    uint32_t num_checks = sizeof(bench_checks) / sizeof(bench_checks[0]);
+    uint32_t num_reset = sizeof(bench_reset_checks) / sizeof(bench_reset_checks[0]);
+    uint32_t count = num_checks + num_reset;
+    uint32_t failed = 0;
+
+#if d_m3FixedHeap
+    M3HeapInfo before;
+    m3_GetHeapInfo(&before);
+#endif
+
+    for (uint32_t i=0; i<num_checks; i++) {
+        if (bench_check(&bench_checks[i], 1) < 0) {
+            failed++;
+        }
+    }
+
+    for (uint32_t i=0; i<num_reset; i++) {
+        if (bench_check(bench_reset_checks[i], 2) < 0) {
+            failed++;
+        }
+    }
+
+#if d_m3FixedHeap
+    // Freed runtimes must return everything but the pooled code pages
+    M3HeapInfo after;
+    m3_ReleaseCodePagePool();
+    m3_GetHeapInfo(&after);
+
+    count += 2;
+    if (after.used != before.used || after.allocations != before.allocations) {
+        fprintf(stderr, "check heap: runtimes leaked %zu bytes in %u allocations\r\n",
+                after.used - before.used, after.allocations - before.allocations);
+        failed++;
+    }
+    if (bench_check_heap() < 0) {
+        failed++;
+    }
+#endif
+
+    printf("%-6s %-20s %12u passed %u failed\r\n", "check", "interpreter", count - failed, failed);
+
+    return failed ? -1 : 0;
+}
+
+// Stopping a task traps it, which must leave its module cached for the next start
+static int bench_check_stop() {
+    uint32_t failed = 0;
+
+    WASM_cache_flush();
+
+    // Flagged as WASM_end_task would, main traps in its blocking host call
+    bench_task.arg_count = 1;
+    bench_task.cancel = true;
+    int res = wasm_run(&bench_task);
+    bench_task.cancel = false;
+    bench_task.arg_count = 0;
+
+    if (res >= 0) {
+        fprintf(stderr, "check stop: run was not stopped\r\n");
+        failed++;
+    }
+
+    // Only a start served from the cache can run without a valid binary
+    uint8_t* blank = calloc(1, bench_wasm_len);
+    bench_task.data = blank;
+    res = wasm_run(&bench_task);
+    bench_task.data = bench_wasm;
+    free(blank);
+
+    if (res < 0) {
+        fprintf(stderr, "check stop: next start was not served from the cache\r\n");
+        failed++;
+    }
+
+    WASM_cache_flush();
+
+    printf("%-6s %-20s %12u passed %u failed\r\n", "check", "stop (cached)", 2 - failed, failed);
+
+    return failed ? -1 : 0;
+}
+
+static int bench_call(IM3Runtime runtime, const char* name, uint32_t iterations, bool task, double* us) {
+    IM3Function f;
+    M3Result result = m3_FindFunction(&f, runtime, name);
+    if (result) {
+        fprintf(stderr, "FindFunction %s: %s\r\n", name, result);
+        return -1;
+    }
+
+    // The task handle is unused, arg_get finds the task through the runtime
+    char n[16];
+    snprintf(n, sizeof(n), "%u", iterations);
+    const char* argv[3] = { n, "0", NULL };
+
+    int saved = quiet_stdout();
+
+    double start = now_us();
+    result = m3_CallWithArgs(f, task ? 2 : 1, argv);
+    *us = now_us() - start;
+
+    restore_stdout(saved);
+
+    if (result) {
+        fprintf(stderr, "CallWithArgs %s: %s\r\n", name, result);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int bench_calls(uint32_t iterations) {
+    int res = -1;
+
+    IM3Environment env = m3_NewEnvironment();
+    IM3Runtime runtime = m3_NewRuntime(env, 32 * 1024, NULL);
+    IM3Module module;
+
+    if (wasm_load(runtime, bench_wasm, bench_wasm_len, &module) < 0) {
+        goto calls_done;
+    }
+    m3_CompileModule(module);
+
+    // Log output goes to the task log ring, as it does on device
+    m3_SetUserData(runtime, &bench_task);
+
+    strncpy(bench_task.args[0], "bench", TASK_MAX_ARGLEN);
+    bench_task.arg_count = 1;
+
+    double us, baseline_ns;
+    if (bench_call(runtime, "loop_empty", iterations, false, &us) < 0) {
+        goto calls_done;
+    }
+    baseline_ns = us * 1e3 / iterations;
+    report_rate("call", "loop baseline", iterations, us, 0);
+
+    if (bench_call(runtime, "loop_arg_get", iterations, true, &us) == 0) {
+        report_rate("call", "arg_get", iterations, us, baseline_ns);
+    }
+
+    if (bench_call(runtime, "loop_log_write", iterations, false, &us) == 0) {
+        report_rate("call", "log_write", iterations, us, baseline_ns);
+    }
+
+    if (bench_call(runtime, "loop_get_ticks", iterations, false, &us) == 0) {
+        report_rate("call", "get_ticks", iterations, us, baseline_ns);
+    }
+
+    res = 0;
+
+calls_done:
+    m3_FreeRuntime(runtime);
+    m3_FreeEnvironment(env);
+
+    return res;
+}
+
+// Run an applet or WASI command (such as the wasm3 test/benchmark suite) from a file
+static int bench_file(const char* file) {
+    int res = -1;
+
+    FILE* f = fopen(file, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open %s\r\n", file);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    uint32_t len = ftell(f);
+    rewind(f);
+
+    uint8_t* data = malloc(len);
+    if (data == NULL || fread(data, 1, len, f) != len) {
+        fprintf(stderr, "Failed to read %s\r\n", file);
+        fclose(f);
+        free(data);
+        return -1;
+    }
+    fclose(f);
+
+    double start = now_us();
+
+    IM3Environment env = m3_NewEnvironment();
+    IM3Runtime runtime = m3_NewRuntime(env, 64 * 1024, NULL);
+    IM3Module module;
+
+    if (wasm_load(runtime, data, len, &module) < 0) {
+        goto file_done;
+    }
+
+    M3Result result = m3_CompileModule(module);
+    if (result) {
+        fprintf(stderr, "CompileModule %s: %s\r\n", file, result);
+        goto file_done;
+    }
+
+    report_latency("setup", file, now_us() - start);
+
+    IM3Function func;
+    result = m3_FindFunction(&func, runtime, "_start");
+    if (result) {
+        result = m3_FindFunction(&func, runtime, "main");
+    }
+    if (result) {
+        fprintf(stderr, "No _start or main in %s\r\n", file);
+        goto file_done;
+    }
+
+    int saved = quiet_stdout();
+
+    start = now_us();
+    result = m3_CallWithArgs(func, 0, NULL);
+    double us = now_us() - start;
+
+    restore_stdout(saved);
+
+    if (result && result != m3Err_trapExit) {
+        fprintf(stderr, "Call %s: %s\r\n", file, result);
+        goto file_done;
+    }
+
+    report_latency("run", file, us);
+
+    res = 0;
+
+file_done:
+    m3_FreeRuntime(runtime);
+    m3_FreeEnvironment(env);
+    free(data);
+
+    return res;
+}
+
+int main(int argc, char** argv) {
+    int res = 0;
+    uint32_t iterations = BENCH_CALL_ITERATIONS;
+    bool checks_only = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "vcn:")) != -1) {
+        switch (opt) {
+        case 'v':
+            bench_verbose = true;
+            break;
+        case 'c':
+            checks_only = true;
+            break;
+        case 'n':
+            iterations = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-v] [-c (checks only)] [-n call iterations] [file.wasm ...]\r\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (bench_checks_run() < 0) {
+        return -1;
+    }
+
+    if (WASM_init() < 0) {
+        return -1;
+    }
+    bench_task_init();
+
+    // Needs the runtime's module cache
+    if (bench_check_stop() < 0) {
+        return -1;
+    }
+    if (checks_only) {
+        return 0;
+    }
+
+    if (bench_setup(BENCH_SETUP_ITERATIONS) < 0) {
+        res = -1;
+    }
+
+    if (bench_calls(iterations) < 0) {
+        res = -1;
+    }
+
+    for (int i=optind; i<argc; i++) {
+        if (bench_file(argv[i]) < 0) {
+            res = -1;
+        }
+    }
+
+    return res;
+}
@@ -0,0 +1,107 @@
+;; Microbenchmark applet for the runtime host bindings
+;; Regenerate bench_wasm.h with `wat2wasm bench.wat -o bench.wasm && xxd -i bench.wasm > bench_wasm.h`
+
+(module
+  (type $t0 (func (param i32 i32 i32 i32) (result i32)))
+  (type $t1 (func (param i32 i32) (result i32)))
+  (type $t2 (func (param i32) (result i32)))
+
+  (import "env" "arg_get" (func $arg_get (type $t0)))
+  (import "env" "log_write" (func $log_write (type $t1)))
+  (import "env" "get_ticks" (func $get_ticks (type $t2)))
+  (import "env" "sleep_us" (func $sleep_us (type $t2)))
+
+  (memory (export "memory") 1)
+  (data (i32.const 64) "bench\n")
+
+  ;; Applet entry point, used to measure setup latency through wasm_run.
+  ;; Given arguments it also makes a blocking host call, where a stopped task traps
+  (func (export "main") (type $t1)
+    block
+      local.get 0
+      i32.eqz
+      br_if 0
+      i32.const 0
+      call $sleep_us
+      drop
+    end
+    i32.const 0)
+
+  ;; Loop overhead baseline
+  (func (export "loop_empty") (type $t2)
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get 0)
+
+  ;; (iterations, task)
+  (func (export "loop_arg_get") (type $t1)
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        i32.const 32
+        i32.const 16
+        i32.store
+        local.get 1
+        i32.const 0
+        i32.const 0
+        i32.const 32
+        call $arg_get
+        drop
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get 0)
+
+  (func (export "loop_log_write") (type $t2)
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        i32.const 64
+        i32.const 6
+        call $log_write
+        drop
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get 0)
+
+  (func (export "loop_get_ticks") (type $t2)
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        i32.const 0
+        call $get_ticks
+        drop
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get 0)
+)
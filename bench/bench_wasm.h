@@ -0,0 +1,33 @@
+unsigned char bench_wasm[] = {
+  0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x14, 0x03, 0x60,
+  0x04, 0x7f, 0x7f, 0x7f, 0x7f, 0x01, 0x7f, 0x60, 0x02, 0x7f, 0x7f, 0x01,
+  0x7f, 0x60, 0x01, 0x7f, 0x01, 0x7f, 0x02, 0x3e, 0x04, 0x03, 0x65, 0x6e,
+  0x76, 0x07, 0x61, 0x72, 0x67, 0x5f, 0x67, 0x65, 0x74, 0x00, 0x00, 0x03,
+  0x65, 0x6e, 0x76, 0x09, 0x6c, 0x6f, 0x67, 0x5f, 0x77, 0x72, 0x69, 0x74,
+  0x65, 0x00, 0x01, 0x03, 0x65, 0x6e, 0x76, 0x09, 0x67, 0x65, 0x74, 0x5f,
+  0x74, 0x69, 0x63, 0x6b, 0x73, 0x00, 0x02, 0x03, 0x65, 0x6e, 0x76, 0x08,
+  0x73, 0x6c, 0x65, 0x65, 0x70, 0x5f, 0x75, 0x73, 0x00, 0x02, 0x03, 0x06,
+  0x05, 0x01, 0x02, 0x01, 0x02, 0x02, 0x05, 0x03, 0x01, 0x00, 0x01, 0x07,
+  0x4f, 0x06, 0x06, 0x6d, 0x65, 0x6d, 0x6f, 0x72, 0x79, 0x02, 0x00, 0x04,
+  0x6d, 0x61, 0x69, 0x6e, 0x00, 0x04, 0x0a, 0x6c, 0x6f, 0x6f, 0x70, 0x5f,
+  0x65, 0x6d, 0x70, 0x74, 0x79, 0x00, 0x05, 0x0c, 0x6c, 0x6f, 0x6f, 0x70,
+  0x5f, 0x61, 0x72, 0x67, 0x5f, 0x67, 0x65, 0x74, 0x00, 0x06, 0x0e, 0x6c,
+  0x6f, 0x6f, 0x70, 0x5f, 0x6c, 0x6f, 0x67, 0x5f, 0x77, 0x72, 0x69, 0x74,
+  0x65, 0x00, 0x07, 0x0e, 0x6c, 0x6f, 0x6f, 0x70, 0x5f, 0x67, 0x65, 0x74,
+  0x5f, 0x74, 0x69, 0x63, 0x6b, 0x73, 0x00, 0x08, 0x0a, 0x96, 0x01, 0x05,
+  0x11, 0x00, 0x02, 0x40, 0x20, 0x00, 0x45, 0x0d, 0x00, 0x41, 0x00, 0x10,
+  0x03, 0x1a, 0x0b, 0x41, 0x00, 0x0b, 0x18, 0x00, 0x02, 0x40, 0x03, 0x40,
+  0x20, 0x00, 0x45, 0x0d, 0x01, 0x20, 0x00, 0x41, 0x01, 0x6b, 0x21, 0x00,
+  0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x00, 0x0b, 0x2a, 0x00, 0x02, 0x40, 0x03,
+  0x40, 0x20, 0x00, 0x45, 0x0d, 0x01, 0x41, 0x20, 0x41, 0x10, 0x36, 0x02,
+  0x00, 0x20, 0x01, 0x41, 0x00, 0x41, 0x00, 0x41, 0x20, 0x10, 0x00, 0x1a,
+  0x20, 0x00, 0x41, 0x01, 0x6b, 0x21, 0x00, 0x0c, 0x00, 0x0b, 0x0b, 0x20,
+  0x00, 0x0b, 0x20, 0x00, 0x02, 0x40, 0x03, 0x40, 0x20, 0x00, 0x45, 0x0d,
+  0x01, 0x41, 0xc0, 0x00, 0x41, 0x06, 0x10, 0x01, 0x1a, 0x20, 0x00, 0x41,
+  0x01, 0x6b, 0x21, 0x00, 0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x00, 0x0b, 0x1d,
+  0x00, 0x02, 0x40, 0x03, 0x40, 0x20, 0x00, 0x45, 0x0d, 0x01, 0x41, 0x00,
+  0x10, 0x02, 0x1a, 0x20, 0x00, 0x41, 0x01, 0x6b, 0x21, 0x00, 0x0c, 0x00,
+  0x0b, 0x0b, 0x20, 0x00, 0x0b, 0x0b, 0x0d, 0x01, 0x00, 0x41, 0xc0, 0x00,
+  0x0b, 0x06, 0x62, 0x65, 0x6e, 0x63, 0x68, 0x0a
+};
+unsigned int bench_wasm_len = 356;
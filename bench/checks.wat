@@ -0,0 +1,622 @@
+;; Correctness checks for the interpreter, run by wasm-bench before benchmarking
+;; Regenerate checks_wasm.h with `wat2wasm checks.wat -o checks.wasm && xxd -i checks.wasm > checks_wasm.h`
+
+(module
+  (type $t0 (func (param i32) (result i32)))
+  (type $t1 (func (param i32 i32) (result i32)))
+
+  (memory (export "memory") 1)
+
+  ;; Segment 0 is active so is dropped once instantiated, segment 1 is passive (26 bytes)
+  (data (i32.const 1024) "active")
+  (data $passive "wasm3 passive segment\00\01\02\fe\ff")
+
+  (func $mix (type $t1)
+    local.get 0
+    i32.const 31
+    i32.mul
+    local.get 1
+    i32.xor
+  )
+
+  ;; (address, length) checksum of a memory range
+  (func $sum (type $t1)
+    (local $acc i32)
+    block
+      loop
+        local.get 1
+        i32.eqz
+        br_if 1
+        local.get $acc
+        local.get 0
+        i32.load8_u
+        call $mix
+        local.set $acc
+        local.get 0
+        i32.const 1
+        i32.add
+        local.set 0
+        local.get 1
+        i32.const 1
+        i32.sub
+        local.set 1
+        br 0
+      end
+    end
+    local.get $acc
+  )
+
+  ;; Superinstructions (m3_optimize.c), each fused form is used with the stack states that select its variants.
+  ;; The results are the same with d_m3EnableSuperInstructions=0
+
+  ;; (iterations) op; local.set with the operands in slots, the top in a register and the top - 1 in a register
+  (func (export "check_binop_i32") (type $t0)
+    (local $a i32) (local $b i32) (local $z i32)
+    i32.const 0x12345678
+    local.set $a
+    i32.const 0x9abcdef1
+    local.set $b
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        local.get $a  local.get $b  i32.add  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.add  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.add  local.set $b
+        local.get $a  local.get $b  i32.sub  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.sub  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.sub  local.set $b
+        local.get $a  local.get $b  i32.mul  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.mul  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.mul  local.set $b
+        local.get $a  local.get $b  i32.and  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.and  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.and  local.set $b
+        local.get $a  local.get $b  i32.or  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.or  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.or  local.set $b
+        local.get $a  local.get $b  i32.xor  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.xor  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.xor  local.set $b
+        local.get $a  local.get $b  i32.shl  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.shl  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.shl  local.set $b
+        local.get $a  local.get $b  i32.shr_s  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.shr_s  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.shr_s  local.set $b
+        local.get $a  local.get $b  i32.shr_u  local.set $b
+        local.get $a  local.get $b  local.get $z  i32.xor  i32.shr_u  local.set $a
+        local.get $a  local.get $z  i32.xor  local.get $b  i32.shr_u  local.set $b
+        local.get $a  i32.const 1664525  i32.mul  i32.const 1013904223  i32.add  local.set $a
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get $a
+    local.get $b
+    i32.xor
+  )
+
+  ;; (iterations) op; local.set with the operands in slots, the top in a register and the top - 1 in a register
+  (func (export "check_binop_i64") (type $t0)
+    (local $a i64) (local $b i64) (local $z i64)
+    i64.const 0x0123456789abcdef
+    local.set $a
+    i64.const 0xfedcba9876543210
+    local.set $b
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        local.get $a  local.get $b  i64.add  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.add  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.add  local.set $b
+        local.get $a  local.get $b  i64.sub  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.sub  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.sub  local.set $b
+        local.get $a  local.get $b  i64.mul  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.mul  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.mul  local.set $b
+        local.get $a  local.get $b  i64.and  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.and  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.and  local.set $b
+        local.get $a  local.get $b  i64.or  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.or  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.or  local.set $b
+        local.get $a  local.get $b  i64.xor  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.xor  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.xor  local.set $b
+        local.get $a  local.get $b  i64.shl  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.shl  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.shl  local.set $b
+        local.get $a  local.get $b  i64.shr_s  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.shr_s  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.shr_s  local.set $b
+        local.get $a  local.get $b  i64.shr_u  local.set $b
+        local.get $a  local.get $b  local.get $z  i64.xor  i64.shr_u  local.set $a
+        local.get $a  local.get $z  i64.xor  local.get $b  i64.shr_u  local.set $b
+        local.get $a  i64.const 6364136223846793005  i64.mul  i64.const 1442695040888963407  i64.add  local.set $a
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get $a
+    local.get $b
+    i64.xor
+    local.tee $a
+    local.get $a
+    i64.const 32
+    i64.shr_u
+    i64.xor
+    i32.wrap_i64
+  )
+
+  ;; (iterations) compare; br_if out of a block and continuing a loop, eqz; br_if
+  (func (export "check_compare") (type $t0)
+    (local $a i32) (local $b i32) (local $z i32) (local $acc i32) (local $k i32) (local $lim i32) (local $t i32) (local $w i64)
+    i32.const 0x7f3a9c01
+    local.set $a
+    i32.const 0x80c56ef3
+    local.set $b
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        block  local.get $a  local.get $b  i32.eq  br_if 0  local.get $acc  i32.const 1  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.eq  br_if 0  local.get $acc  i32.const 2  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.eq  br_if 0  local.get $acc  i32.const 3  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.ne  br_if 0  local.get $acc  i32.const 4  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.ne  br_if 0  local.get $acc  i32.const 5  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.ne  br_if 0  local.get $acc  i32.const 6  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.lt_s  br_if 0  local.get $acc  i32.const 7  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.lt_s  br_if 0  local.get $acc  i32.const 8  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.lt_s  br_if 0  local.get $acc  i32.const 9  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.lt_u  br_if 0  local.get $acc  i32.const 10  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.lt_u  br_if 0  local.get $acc  i32.const 11  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.lt_u  br_if 0  local.get $acc  i32.const 12  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.gt_s  br_if 0  local.get $acc  i32.const 13  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.gt_s  br_if 0  local.get $acc  i32.const 14  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.gt_s  br_if 0  local.get $acc  i32.const 15  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.gt_u  br_if 0  local.get $acc  i32.const 16  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.gt_u  br_if 0  local.get $acc  i32.const 17  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.gt_u  br_if 0  local.get $acc  i32.const 18  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.le_s  br_if 0  local.get $acc  i32.const 19  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.le_s  br_if 0  local.get $acc  i32.const 20  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.le_s  br_if 0  local.get $acc  i32.const 21  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.le_u  br_if 0  local.get $acc  i32.const 22  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.le_u  br_if 0  local.get $acc  i32.const 23  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.le_u  br_if 0  local.get $acc  i32.const 24  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.ge_s  br_if 0  local.get $acc  i32.const 25  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.ge_s  br_if 0  local.get $acc  i32.const 26  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.ge_s  br_if 0  local.get $acc  i32.const 27  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  i32.ge_u  br_if 0  local.get $acc  i32.const 28  i32.add  local.set $acc  end
+        block  local.get $a  local.get $b  local.get $z  i32.xor  i32.ge_u  br_if 0  local.get $acc  i32.const 29  i32.add  local.set $acc  end
+        block  local.get $a  local.get $z  i32.xor  local.get $b  i32.ge_u  br_if 0  local.get $acc  i32.const 30  i32.add  local.set $acc  end
+        local.get $a
+        i32.const 7
+        i32.and
+        i32.const 1
+        i32.add
+        local.set $lim
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.eq  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  local.get $z  i32.xor  i32.eq  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $z  i32.xor  local.get $lim  i32.eq  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.ne  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  local.get $z  i32.xor  i32.ne  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $z  i32.xor  local.get $lim  i32.ne  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.lt_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  local.get $z  i32.xor  i32.lt_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $z  i32.xor  local.get $lim  i32.lt_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.lt_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  local.get $z  i32.xor  i32.lt_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $z  i32.xor  local.get $lim  i32.lt_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $k  i32.gt_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $k  local.get $z  i32.xor  i32.gt_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $z  i32.xor  local.get $k  i32.gt_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $k  i32.gt_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $k  local.get $z  i32.xor  i32.gt_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $z  i32.xor  local.get $k  i32.gt_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.le_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  local.get $z  i32.xor  i32.le_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $z  i32.xor  local.get $lim  i32.le_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.le_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  local.get $z  i32.xor  i32.le_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $z  i32.xor  local.get $lim  i32.le_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $k  i32.ge_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $k  local.get $z  i32.xor  i32.ge_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $z  i32.xor  local.get $k  i32.ge_s  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $k  i32.ge_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $k  local.get $z  i32.xor  i32.ge_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $lim  local.get $z  i32.xor  local.get $k  i32.ge_u  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        block  local.get $a  i32.const 3  i32.and  i32.eqz  br_if 0  local.get $acc  i32.const 101  i32.add  local.set $acc  end
+        local.get $a  i32.const 3  i32.and  local.set $t
+        block  local.get $t  i32.eqz  br_if 0  local.get $acc  i32.const 102  i32.add  local.set $acc  end
+        block  local.get $a  i64.extend_i32_u  i64.const 3  i64.and  i64.eqz  br_if 0  local.get $acc  i32.const 103  i32.add  local.set $acc  end
+        local.get $a  i64.extend_i32_u  i64.const 3  i64.and  local.set $w
+        block  local.get $w  i64.eqz  br_if 0  local.get $acc  i32.const 104  i32.add  local.set $acc  end
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.ge_u  i32.eqz  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.ge_u  local.set $t  local.get $t  i32.eqz  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.ge_u  i64.extend_i32_u  i64.eqz  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        i32.const 0  local.set $k
+        loop  local.get $k  i32.const 1  i32.add  local.set $k  local.get $k  local.get $lim  i32.ge_u  i64.extend_i32_u  local.set $w  local.get $w  i64.eqz  br_if 0  end
+        local.get $acc  local.get $k  call $mix  local.set $acc
+        local.get $a  i32.const 1664525  i32.mul  i32.const 1013904223  i32.add  local.set $a
+        local.get $b  i32.const 22695477  i32.mul  i32.const 1  i32.add  local.set $b
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get $acc
+  )
+
+  ;; (value) br_if and local.set cases that must not be fused, or only partly
+  (func (export "check_branch_edges") (type $t0)
+    (local $a i32) (local $b i32) (local $acc i32) (local $k i32) (local $lim i32)
+    local.get 0
+    local.set $a
+    local.get 0
+    i32.const 0x5bd1e995
+    i32.mul
+    local.set $b
+    ;; br_if to a block with a result
+    local.get $acc
+    block (result i32)  i32.const 5  local.get $a  local.get $b  i32.lt_s  br_if 0  drop  i32.const 6  end
+    call $mix
+    local.set $acc
+    ;; br_if continuing a loop and leaving an outer block from a nested block
+    local.get $a
+    i32.const 15
+    i32.and
+    local.set $lim
+    block
+      loop
+        local.get $k  i32.const 1  i32.add  local.set $k
+        block
+          local.get $k  local.get $lim  i32.ge_s  br_if 2
+          local.get $k  i32.const 1  i32.and  i32.eqz  br_if 1
+          local.get $acc  local.get $k  call $mix  local.set $acc
+        end
+        br 0
+      end
+    end
+    ;; a constant operand
+    block  i32.const 0  i32.eqz  br_if 0  unreachable  end
+    ;; the local is still on the stack below the operands, in this scope, an enclosing block and before a loop
+    ;; (which copies it on entry, see PreserveArgsAndLocals)
+    local.get $a
+    local.get $a  local.get $b  i32.add  local.set $a
+    local.get $a
+    i32.sub
+    local.get $acc
+    call $mix
+    local.set $acc
+    local.get $b
+    block
+      local.get $a  local.get $b  i32.mul  local.set $b
+    end
+    local.get $b
+    i32.xor
+    local.get $acc
+    call $mix
+    local.set $acc
+    local.get $a
+    loop
+      local.get $a  local.get $b  i32.xor  local.set $a
+    end
+    local.get $a
+    i32.add
+    local.get $acc
+    call $mix
+    local.set $acc
+    ;; unreachable code, the stack is polymorphic
+    block
+      br 0
+      local.get $a  local.get $b  i32.add  local.set $a
+      local.get $a  local.get $b  i32.lt_u  br_if 0
+    end
+    local.get $acc
+    local.get $a
+    call $mix
+  )
+
+  ;; (iterations) load; local.set with the address in a slot and in a register
+  (func (export "check_load") (type $t0)
+    (local $p i32) (local $z i32) (local $acc i32) (local $t i32) (local $w i64)
+    i32.const 256
+    i64.const 0xf1e2d3c4b5a69788
+    i64.store
+    i32.const 264
+    i64.const 0x8070605040302010
+    i64.store
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        local.get 0
+        i32.const 7
+        i32.and
+        i32.const 256
+        i32.add
+        local.set $p
+        local.get $p  i32.load offset=0  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i32.load offset=0  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  i32.load8_s offset=1  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i32.load8_s offset=1  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  i32.load8_u offset=2  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i32.load8_u offset=2  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  i32.load16_s offset=0  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i32.load16_s offset=0  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  i32.load16_u offset=1  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i32.load16_u offset=1  local.set $t  local.get $acc  local.get $t  call $mix  local.set $acc
+        local.get $p  i64.load offset=2  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i64.load offset=2  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  i64.load8_s offset=0  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i64.load8_s offset=0  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  i64.load8_u offset=1  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i64.load8_u offset=1  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  i64.load16_s offset=2  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i64.load16_s offset=2  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  i64.load16_u offset=0  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i64.load16_u offset=0  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  i64.load32_s offset=1  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i64.load32_s offset=1  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  i64.load32_u offset=2  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        local.get $p  local.get $z  i32.xor  i64.load32_u offset=2  local.set $w  local.get $acc  local.get $w  local.get $w  i64.const 32  i64.shr_u  i64.xor  i32.wrap_i64  call $mix  local.set $acc
+        ;; the address local itself is the destination
+        local.get $p  i32.load8_u  local.set $p
+        local.get $acc  local.get $p  call $mix  local.set $acc
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get $acc
+  )
+
+  ;; (address) a fused load past the end of memory traps
+  (func (export "check_load_bounds") (type $t0)
+    (local $t i32)
+    local.get 0  i32.load offset=2  local.set $t
+    local.get $t
+  )
+;; Bulk memory (memory.copy, memory.fill, memory.init, data.drop)
+
+  ;; (shift) overlapping copies forwards and backwards, as if through a temporary buffer
+  (func (export "check_memory_copy") (type $t0)
+    (local $i i32)
+    block
+      loop
+        local.get $i
+        i32.const 80
+        i32.eq
+        br_if 1
+        local.get $i
+        i32.const 2048
+        i32.add
+        local.get $i
+        i32.const 7
+        i32.mul
+        i32.const 1
+        i32.add
+        i32.store8
+        local.get $i
+        i32.const 1
+        i32.add
+        local.set $i
+        br 0
+      end
+    end
+    i32.const 2048
+    local.get 0
+    i32.add
+    i32.const 2048
+    i32.const 32
+    memory.copy
+    i32.const 2048
+    i32.const 2048
+    local.get 0
+    i32.const 2
+    i32.mul
+    i32.add
+    i32.const 32
+    memory.copy
+    i32.const 2048
+    i32.const 2048
+    i32.const 0
+    memory.copy
+    i32.const 2048
+    i32.const 80
+    call $sum
+  )
+
+  ;; (value) only the low byte of the value is stored, an empty fill at the end of memory is allowed
+  (func (export "check_memory_fill") (type $t0)
+    i32.const 2051
+    local.get 0
+    i32.const 40
+    memory.fill
+    i32.const 65536
+    local.get 0
+    i32.const 0
+    memory.fill
+    i32.const 2048
+    i32.const 48
+    call $sum
+  )
+
+  ;; (offset) a passive segment can be copied in more than once
+  (func (export "check_memory_init") (type $t0)
+    i32.const 2048
+    local.get 0
+    i32.const 8
+    memory.init $passive
+    i32.const 2050
+    local.get 0
+    i32.const 8
+    memory.init $passive
+    i32.const 2048
+    i32.const 12
+    call $sum
+  )
+
+  ;; (length) after data.drop the segment is empty, dropping again is allowed
+  (func (export "check_data_drop") (type $t0)
+    data.drop $passive
+    data.drop $passive
+    i32.const 2048
+    i32.const 0
+    local.get 0
+    memory.init $passive
+    i32.const 2048
+    i32.const 4
+    call $sum
+  )
+
+  ;; (length) active segments are dropped once instantiated
+  (func (export "check_init_active") (type $t0)
+    i32.const 2048
+    i32.const 0
+    local.get 0
+    memory.init 0
+    i32.const 1024
+    i32.const 6
+    call $sum
+  )
+
+  ;; (destination) 16 bytes into the end of memory, the range must not wrap
+  (func (export "check_copy_bounds") (type $t0)
+    local.get 0
+    i32.const 0
+    i32.const 16
+    memory.copy
+    i32.const 0
+  )
+
+  ;; (source)
+  (func (export "check_copy_src_bounds") (type $t0)
+    i32.const 0
+    local.get 0
+    i32.const 16
+    memory.copy
+    i32.const 0
+  )
+
+  ;; (destination) an empty copy may start at the end of memory but not past it
+  (func (export "check_copy_empty_bounds") (type $t0)
+    local.get 0
+    i32.const 0
+    i32.const 0
+    memory.copy
+    i32.const 0
+  )
+
+  ;; (destination)
+  (func (export "check_fill_bounds") (type $t0)
+    local.get 0
+    i32.const 0xaa
+    i32.const 16
+    memory.fill
+    i32.const 0
+  )
+
+  ;; (source) 4 bytes from the passive segment
+  (func (export "check_init_bounds") (type $t0)
+    i32.const 2048
+    local.get 0
+    i32.const 4
+    memory.init $passive
+    i32.const 2048
+    i32.const 4
+    call $sum
+  )
+
+  ;; (destination)
+  (func (export "check_init_dst_bounds") (type $t0)
+    local.get 0
+    i32.const 0
+    i32.const 4
+    memory.init $passive
+    i32.const 0
+  )
+)
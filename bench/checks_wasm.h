@@ -0,0 +1,340 @@
+unsigned char checks_wasm[] = {
+  0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x0c, 0x02, 0x60,
+  0x01, 0x7f, 0x01, 0x7f, 0x60, 0x02, 0x7f, 0x7f, 0x01, 0x7f, 0x03, 0x14,
+  0x13, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x03, 0x01, 0x00,
+  0x01, 0x07, 0xdc, 0x02, 0x12, 0x06, 0x6d, 0x65, 0x6d, 0x6f, 0x72, 0x79,
+  0x02, 0x00, 0x0f, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x62, 0x69, 0x6e,
+  0x6f, 0x70, 0x5f, 0x69, 0x33, 0x32, 0x00, 0x02, 0x0f, 0x63, 0x68, 0x65,
+  0x63, 0x6b, 0x5f, 0x62, 0x69, 0x6e, 0x6f, 0x70, 0x5f, 0x69, 0x36, 0x34,
+  0x00, 0x03, 0x0d, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x63, 0x6f, 0x6d,
+  0x70, 0x61, 0x72, 0x65, 0x00, 0x04, 0x12, 0x63, 0x68, 0x65, 0x63, 0x6b,
+  0x5f, 0x62, 0x72, 0x61, 0x6e, 0x63, 0x68, 0x5f, 0x65, 0x64, 0x67, 0x65,
+  0x73, 0x00, 0x05, 0x0a, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x6c, 0x6f,
+  0x61, 0x64, 0x00, 0x06, 0x11, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x6c,
+  0x6f, 0x61, 0x64, 0x5f, 0x62, 0x6f, 0x75, 0x6e, 0x64, 0x73, 0x00, 0x07,
+  0x11, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x6d, 0x65, 0x6d, 0x6f, 0x72,
+  0x79, 0x5f, 0x63, 0x6f, 0x70, 0x79, 0x00, 0x08, 0x11, 0x63, 0x68, 0x65,
+  0x63, 0x6b, 0x5f, 0x6d, 0x65, 0x6d, 0x6f, 0x72, 0x79, 0x5f, 0x66, 0x69,
+  0x6c, 0x6c, 0x00, 0x09, 0x11, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x6d,
+  0x65, 0x6d, 0x6f, 0x72, 0x79, 0x5f, 0x69, 0x6e, 0x69, 0x74, 0x00, 0x0a,
+  0x0f, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x64, 0x61, 0x74, 0x61, 0x5f,
+  0x64, 0x72, 0x6f, 0x70, 0x00, 0x0b, 0x11, 0x63, 0x68, 0x65, 0x63, 0x6b,
+  0x5f, 0x69, 0x6e, 0x69, 0x74, 0x5f, 0x61, 0x63, 0x74, 0x69, 0x76, 0x65,
+  0x00, 0x0c, 0x11, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x63, 0x6f, 0x70,
+  0x79, 0x5f, 0x62, 0x6f, 0x75, 0x6e, 0x64, 0x73, 0x00, 0x0d, 0x15, 0x63,
+  0x68, 0x65, 0x63, 0x6b, 0x5f, 0x63, 0x6f, 0x70, 0x79, 0x5f, 0x73, 0x72,
+  0x63, 0x5f, 0x62, 0x6f, 0x75, 0x6e, 0x64, 0x73, 0x00, 0x0e, 0x17, 0x63,
+  0x68, 0x65, 0x63, 0x6b, 0x5f, 0x63, 0x6f, 0x70, 0x79, 0x5f, 0x65, 0x6d,
+  0x70, 0x74, 0x79, 0x5f, 0x62, 0x6f, 0x75, 0x6e, 0x64, 0x73, 0x00, 0x0f,
+  0x11, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x66, 0x69, 0x6c, 0x6c, 0x5f,
+  0x62, 0x6f, 0x75, 0x6e, 0x64, 0x73, 0x00, 0x10, 0x11, 0x63, 0x68, 0x65,
+  0x63, 0x6b, 0x5f, 0x69, 0x6e, 0x69, 0x74, 0x5f, 0x62, 0x6f, 0x75, 0x6e,
+  0x64, 0x73, 0x00, 0x11, 0x15, 0x63, 0x68, 0x65, 0x63, 0x6b, 0x5f, 0x69,
+  0x6e, 0x69, 0x74, 0x5f, 0x64, 0x73, 0x74, 0x5f, 0x62, 0x6f, 0x75, 0x6e,
+  0x64, 0x73, 0x00, 0x12, 0x0c, 0x01, 0x02, 0x0a, 0x82, 0x1c, 0x13, 0x0a,
+  0x00, 0x20, 0x00, 0x41, 0x1f, 0x6c, 0x20, 0x01, 0x73, 0x0b, 0x2c, 0x01,
+  0x01, 0x7f, 0x02, 0x40, 0x03, 0x40, 0x20, 0x01, 0x45, 0x0d, 0x01, 0x20,
+  0x02, 0x20, 0x00, 0x2d, 0x00, 0x00, 0x10, 0x00, 0x21, 0x02, 0x20, 0x00,
+  0x41, 0x01, 0x6a, 0x21, 0x00, 0x20, 0x01, 0x41, 0x01, 0x6b, 0x21, 0x01,
+  0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x02, 0x0b, 0xb1, 0x02, 0x01, 0x03, 0x7f,
+  0x41, 0xf8, 0xac, 0xd1, 0x91, 0x01, 0x21, 0x01, 0x41, 0xf1, 0xbd, 0xf3,
+  0xd5, 0x79, 0x21, 0x02, 0x02, 0x40, 0x03, 0x40, 0x20, 0x00, 0x45, 0x0d,
+  0x01, 0x20, 0x01, 0x20, 0x02, 0x6a, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02,
+  0x20, 0x03, 0x73, 0x6a, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20,
+  0x02, 0x6a, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x6b, 0x21, 0x02, 0x20,
+  0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x6b, 0x21, 0x01, 0x20, 0x01, 0x20,
+  0x03, 0x73, 0x20, 0x02, 0x6b, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x6c,
+  0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x6c, 0x21, 0x01,
+  0x20, 0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x6c, 0x21, 0x02, 0x20, 0x01,
+  0x20, 0x02, 0x71, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73,
+  0x71, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x71, 0x21,
+  0x02, 0x20, 0x01, 0x20, 0x02, 0x72, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02,
+  0x20, 0x03, 0x73, 0x72, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20,
+  0x02, 0x72, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x73, 0x21, 0x02, 0x20,
+  0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x73, 0x21, 0x01, 0x20, 0x01, 0x20,
+  0x03, 0x73, 0x20, 0x02, 0x73, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x74,
+  0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x74, 0x21, 0x01,
+  0x20, 0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x74, 0x21, 0x02, 0x20, 0x01,
+  0x20, 0x02, 0x75, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73,
+  0x75, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x75, 0x21,
+  0x02, 0x20, 0x01, 0x20, 0x02, 0x76, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02,
+  0x20, 0x03, 0x73, 0x76, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20,
+  0x02, 0x76, 0x21, 0x02, 0x20, 0x01, 0x41, 0x8d, 0xcc, 0xe5, 0x00, 0x6c,
+  0x41, 0xdf, 0xe6, 0xbb, 0xe3, 0x03, 0x6a, 0x21, 0x01, 0x20, 0x00, 0x41,
+  0x01, 0x6b, 0x21, 0x00, 0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x01, 0x20, 0x02,
+  0x73, 0x0b, 0xcc, 0x02, 0x01, 0x03, 0x7e, 0x42, 0xef, 0x9b, 0xaf, 0xcd,
+  0xf8, 0xac, 0xd1, 0x91, 0x01, 0x21, 0x01, 0x42, 0x90, 0xe4, 0xd0, 0xb2,
+  0x87, 0xd3, 0xae, 0xee, 0x7e, 0x21, 0x02, 0x02, 0x40, 0x03, 0x40, 0x20,
+  0x00, 0x45, 0x0d, 0x01, 0x20, 0x01, 0x20, 0x02, 0x7c, 0x21, 0x02, 0x20,
+  0x01, 0x20, 0x02, 0x20, 0x03, 0x85, 0x7c, 0x21, 0x01, 0x20, 0x01, 0x20,
+  0x03, 0x85, 0x20, 0x02, 0x7c, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x7d,
+  0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x85, 0x7d, 0x21, 0x01,
+  0x20, 0x01, 0x20, 0x03, 0x85, 0x20, 0x02, 0x7d, 0x21, 0x02, 0x20, 0x01,
+  0x20, 0x02, 0x7e, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x85,
+  0x7e, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x85, 0x20, 0x02, 0x7e, 0x21,
+  0x02, 0x20, 0x01, 0x20, 0x02, 0x83, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02,
+  0x20, 0x03, 0x85, 0x83, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x85, 0x20,
+  0x02, 0x83, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x84, 0x21, 0x02, 0x20,
+  0x01, 0x20, 0x02, 0x20, 0x03, 0x85, 0x84, 0x21, 0x01, 0x20, 0x01, 0x20,
+  0x03, 0x85, 0x20, 0x02, 0x84, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x85,
+  0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x85, 0x85, 0x21, 0x01,
+  0x20, 0x01, 0x20, 0x03, 0x85, 0x20, 0x02, 0x85, 0x21, 0x02, 0x20, 0x01,
+  0x20, 0x02, 0x86, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x85,
+  0x86, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x85, 0x20, 0x02, 0x86, 0x21,
+  0x02, 0x20, 0x01, 0x20, 0x02, 0x87, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02,
+  0x20, 0x03, 0x85, 0x87, 0x21, 0x01, 0x20, 0x01, 0x20, 0x03, 0x85, 0x20,
+  0x02, 0x87, 0x21, 0x02, 0x20, 0x01, 0x20, 0x02, 0x88, 0x21, 0x02, 0x20,
+  0x01, 0x20, 0x02, 0x20, 0x03, 0x85, 0x88, 0x21, 0x01, 0x20, 0x01, 0x20,
+  0x03, 0x85, 0x20, 0x02, 0x88, 0x21, 0x02, 0x20, 0x01, 0x42, 0xad, 0xfe,
+  0xd5, 0xe4, 0xd4, 0x85, 0xfd, 0xa8, 0xd8, 0x00, 0x7e, 0x42, 0xcf, 0x82,
+  0x9e, 0xbb, 0xef, 0xef, 0xde, 0x82, 0x14, 0x7c, 0x21, 0x01, 0x20, 0x00,
+  0x41, 0x01, 0x6b, 0x21, 0x00, 0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x01, 0x20,
+  0x02, 0x85, 0x22, 0x01, 0x20, 0x01, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x0b,
+  0x88, 0x0e, 0x02, 0x07, 0x7f, 0x01, 0x7e, 0x41, 0x81, 0xb8, 0xea, 0xf9,
+  0x07, 0x21, 0x01, 0x41, 0xf3, 0xdd, 0x95, 0x86, 0x78, 0x21, 0x02, 0x02,
+  0x40, 0x03, 0x40, 0x20, 0x00, 0x45, 0x0d, 0x01, 0x02, 0x40, 0x20, 0x01,
+  0x20, 0x02, 0x46, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x01, 0x6a, 0x21, 0x04,
+  0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x46, 0x0d,
+  0x00, 0x20, 0x04, 0x41, 0x02, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20,
+  0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x46, 0x0d, 0x00, 0x20, 0x04, 0x41,
+  0x03, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x47,
+  0x0d, 0x00, 0x20, 0x04, 0x41, 0x04, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40,
+  0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x47, 0x0d, 0x00, 0x20, 0x04,
+  0x41, 0x05, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x03,
+  0x73, 0x20, 0x02, 0x47, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x06, 0x6a, 0x21,
+  0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x48, 0x0d, 0x00, 0x20,
+  0x04, 0x41, 0x07, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20,
+  0x02, 0x20, 0x03, 0x73, 0x48, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x08, 0x6a,
+  0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20, 0x02,
+  0x48, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x09, 0x6a, 0x21, 0x04, 0x0b, 0x02,
+  0x40, 0x20, 0x01, 0x20, 0x02, 0x49, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x0a,
+  0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03,
+  0x73, 0x49, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x0b, 0x6a, 0x21, 0x04, 0x0b,
+  0x02, 0x40, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x49, 0x0d, 0x00,
+  0x20, 0x04, 0x41, 0x0c, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01,
+  0x20, 0x02, 0x4a, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x0d, 0x6a, 0x21, 0x04,
+  0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x4a, 0x0d,
+  0x00, 0x20, 0x04, 0x41, 0x0e, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20,
+  0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x4a, 0x0d, 0x00, 0x20, 0x04, 0x41,
+  0x0f, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x4b,
+  0x0d, 0x00, 0x20, 0x04, 0x41, 0x10, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40,
+  0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x4b, 0x0d, 0x00, 0x20, 0x04,
+  0x41, 0x11, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x03,
+  0x73, 0x20, 0x02, 0x4b, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x12, 0x6a, 0x21,
+  0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x4c, 0x0d, 0x00, 0x20,
+  0x04, 0x41, 0x13, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20,
+  0x02, 0x20, 0x03, 0x73, 0x4c, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x14, 0x6a,
+  0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20, 0x02,
+  0x4c, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x15, 0x6a, 0x21, 0x04, 0x0b, 0x02,
+  0x40, 0x20, 0x01, 0x20, 0x02, 0x4d, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x16,
+  0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03,
+  0x73, 0x4d, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x17, 0x6a, 0x21, 0x04, 0x0b,
+  0x02, 0x40, 0x20, 0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x4d, 0x0d, 0x00,
+  0x20, 0x04, 0x41, 0x18, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01,
+  0x20, 0x02, 0x4e, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x19, 0x6a, 0x21, 0x04,
+  0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x4e, 0x0d,
+  0x00, 0x20, 0x04, 0x41, 0x1a, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20,
+  0x01, 0x20, 0x03, 0x73, 0x20, 0x02, 0x4e, 0x0d, 0x00, 0x20, 0x04, 0x41,
+  0x1b, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x4f,
+  0x0d, 0x00, 0x20, 0x04, 0x41, 0x1c, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40,
+  0x20, 0x01, 0x20, 0x02, 0x20, 0x03, 0x73, 0x4f, 0x0d, 0x00, 0x20, 0x04,
+  0x41, 0x1d, 0x6a, 0x21, 0x04, 0x0b, 0x02, 0x40, 0x20, 0x01, 0x20, 0x03,
+  0x73, 0x20, 0x02, 0x4f, 0x0d, 0x00, 0x20, 0x04, 0x41, 0x1e, 0x6a, 0x21,
+  0x04, 0x0b, 0x20, 0x01, 0x41, 0x07, 0x71, 0x41, 0x01, 0x6a, 0x21, 0x06,
+  0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21,
+  0x05, 0x20, 0x05, 0x20, 0x06, 0x46, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20,
+  0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20,
+  0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x06, 0x20, 0x03,
+  0x73, 0x46, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21,
+  0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a,
+  0x21, 0x05, 0x20, 0x05, 0x20, 0x03, 0x73, 0x20, 0x06, 0x46, 0x0d, 0x00,
+  0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21,
+  0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05,
+  0x20, 0x06, 0x47, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00,
+  0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01,
+  0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x06, 0x20, 0x03, 0x73, 0x47, 0x0d,
+  0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00,
+  0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20,
+  0x05, 0x20, 0x03, 0x73, 0x20, 0x06, 0x47, 0x0d, 0x00, 0x0b, 0x20, 0x04,
+  0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40,
+  0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x06, 0x48,
+  0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41,
+  0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05,
+  0x20, 0x05, 0x20, 0x06, 0x20, 0x03, 0x73, 0x48, 0x0d, 0x00, 0x0b, 0x20,
+  0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03,
+  0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x03,
+  0x73, 0x20, 0x06, 0x48, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10,
+  0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41,
+  0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x06, 0x49, 0x0d, 0x00, 0x0b,
+  0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05,
+  0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20,
+  0x06, 0x20, 0x03, 0x73, 0x49, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05,
+  0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05,
+  0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x03, 0x73, 0x20, 0x06,
+  0x49, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04,
+  0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21,
+  0x05, 0x20, 0x06, 0x20, 0x05, 0x4a, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20,
+  0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20,
+  0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x06, 0x20, 0x05, 0x20, 0x03,
+  0x73, 0x4a, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21,
+  0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a,
+  0x21, 0x05, 0x20, 0x06, 0x20, 0x03, 0x73, 0x20, 0x05, 0x4a, 0x0d, 0x00,
+  0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21,
+  0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x06,
+  0x20, 0x05, 0x4b, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00,
+  0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01,
+  0x6a, 0x21, 0x05, 0x20, 0x06, 0x20, 0x05, 0x20, 0x03, 0x73, 0x4b, 0x0d,
+  0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00,
+  0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20,
+  0x06, 0x20, 0x03, 0x73, 0x20, 0x05, 0x4b, 0x0d, 0x00, 0x0b, 0x20, 0x04,
+  0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40,
+  0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x06, 0x4c,
+  0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41,
+  0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05,
+  0x20, 0x05, 0x20, 0x06, 0x20, 0x03, 0x73, 0x4c, 0x0d, 0x00, 0x0b, 0x20,
+  0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03,
+  0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x03,
+  0x73, 0x20, 0x06, 0x4c, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10,
+  0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41,
+  0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x06, 0x4d, 0x0d, 0x00, 0x0b,
+  0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05,
+  0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20,
+  0x06, 0x20, 0x03, 0x73, 0x4d, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05,
+  0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05,
+  0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x03, 0x73, 0x20, 0x06,
+  0x4d, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04,
+  0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21,
+  0x05, 0x20, 0x06, 0x20, 0x05, 0x4e, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20,
+  0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20,
+  0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x06, 0x20, 0x05, 0x20, 0x03,
+  0x73, 0x4e, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21,
+  0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a,
+  0x21, 0x05, 0x20, 0x06, 0x20, 0x03, 0x73, 0x20, 0x05, 0x4e, 0x0d, 0x00,
+  0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21,
+  0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x06,
+  0x20, 0x05, 0x4f, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00,
+  0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01,
+  0x6a, 0x21, 0x05, 0x20, 0x06, 0x20, 0x05, 0x20, 0x03, 0x73, 0x4f, 0x0d,
+  0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00,
+  0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20,
+  0x06, 0x20, 0x03, 0x73, 0x20, 0x05, 0x4f, 0x0d, 0x00, 0x0b, 0x20, 0x04,
+  0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x02, 0x40, 0x20, 0x01, 0x41, 0x03,
+  0x71, 0x45, 0x0d, 0x00, 0x20, 0x04, 0x41, 0xe5, 0x00, 0x6a, 0x21, 0x04,
+  0x0b, 0x20, 0x01, 0x41, 0x03, 0x71, 0x21, 0x07, 0x02, 0x40, 0x20, 0x07,
+  0x45, 0x0d, 0x00, 0x20, 0x04, 0x41, 0xe6, 0x00, 0x6a, 0x21, 0x04, 0x0b,
+  0x02, 0x40, 0x20, 0x01, 0xad, 0x42, 0x03, 0x83, 0x50, 0x0d, 0x00, 0x20,
+  0x04, 0x41, 0xe7, 0x00, 0x6a, 0x21, 0x04, 0x0b, 0x20, 0x01, 0xad, 0x42,
+  0x03, 0x83, 0x21, 0x08, 0x02, 0x40, 0x20, 0x08, 0x50, 0x0d, 0x00, 0x20,
+  0x04, 0x41, 0xe8, 0x00, 0x6a, 0x21, 0x04, 0x0b, 0x41, 0x00, 0x21, 0x05,
+  0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20,
+  0x06, 0x4f, 0x45, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00,
+  0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01,
+  0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x06, 0x4f, 0x21, 0x07, 0x20, 0x07,
+  0x45, 0x0d, 0x00, 0x0b, 0x20, 0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04,
+  0x41, 0x00, 0x21, 0x05, 0x03, 0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21,
+  0x05, 0x20, 0x05, 0x20, 0x06, 0x4f, 0xad, 0x50, 0x0d, 0x00, 0x0b, 0x20,
+  0x04, 0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x41, 0x00, 0x21, 0x05, 0x03,
+  0x40, 0x20, 0x05, 0x41, 0x01, 0x6a, 0x21, 0x05, 0x20, 0x05, 0x20, 0x06,
+  0x4f, 0xad, 0x21, 0x08, 0x20, 0x08, 0x50, 0x0d, 0x00, 0x0b, 0x20, 0x04,
+  0x20, 0x05, 0x10, 0x00, 0x21, 0x04, 0x20, 0x01, 0x41, 0x8d, 0xcc, 0xe5,
+  0x00, 0x6c, 0x41, 0xdf, 0xe6, 0xbb, 0xe3, 0x03, 0x6a, 0x21, 0x01, 0x20,
+  0x02, 0x41, 0xb5, 0x9c, 0xe9, 0x0a, 0x6c, 0x41, 0x01, 0x6a, 0x21, 0x02,
+  0x20, 0x00, 0x41, 0x01, 0x6b, 0x21, 0x00, 0x0c, 0x00, 0x0b, 0x0b, 0x20,
+  0x04, 0x0b, 0xb6, 0x01, 0x01, 0x05, 0x7f, 0x20, 0x00, 0x21, 0x01, 0x20,
+  0x00, 0x41, 0x95, 0xd3, 0xc7, 0xde, 0x05, 0x6c, 0x21, 0x02, 0x20, 0x03,
+  0x02, 0x7f, 0x41, 0x05, 0x20, 0x01, 0x20, 0x02, 0x48, 0x0d, 0x00, 0x1a,
+  0x41, 0x06, 0x0b, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x41, 0x0f, 0x71,
+  0x21, 0x05, 0x02, 0x40, 0x03, 0x40, 0x20, 0x04, 0x41, 0x01, 0x6a, 0x21,
+  0x04, 0x02, 0x40, 0x20, 0x04, 0x20, 0x05, 0x4e, 0x0d, 0x02, 0x20, 0x04,
+  0x41, 0x01, 0x71, 0x45, 0x0d, 0x01, 0x20, 0x03, 0x20, 0x04, 0x10, 0x00,
+  0x21, 0x03, 0x0b, 0x0c, 0x00, 0x0b, 0x0b, 0x02, 0x40, 0x41, 0x00, 0x45,
+  0x0d, 0x00, 0x00, 0x0b, 0x20, 0x01, 0x20, 0x01, 0x20, 0x02, 0x6a, 0x21,
+  0x01, 0x20, 0x01, 0x6b, 0x20, 0x03, 0x10, 0x00, 0x21, 0x03, 0x20, 0x02,
+  0x02, 0x40, 0x20, 0x01, 0x20, 0x02, 0x6c, 0x21, 0x02, 0x0b, 0x20, 0x02,
+  0x73, 0x20, 0x03, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x03, 0x40, 0x20,
+  0x01, 0x20, 0x02, 0x73, 0x21, 0x01, 0x0b, 0x20, 0x01, 0x6a, 0x20, 0x03,
+  0x10, 0x00, 0x21, 0x03, 0x02, 0x40, 0x0c, 0x00, 0x20, 0x01, 0x20, 0x02,
+  0x6a, 0x21, 0x01, 0x20, 0x01, 0x20, 0x02, 0x49, 0x0d, 0x00, 0x0b, 0x20,
+  0x03, 0x20, 0x01, 0x10, 0x00, 0x0b, 0xc5, 0x04, 0x02, 0x04, 0x7f, 0x01,
+  0x7e, 0x41, 0x80, 0x02, 0x42, 0x88, 0xaf, 0x9a, 0xad, 0xcb, 0xf8, 0xb4,
+  0xf1, 0x71, 0x37, 0x03, 0x00, 0x41, 0x88, 0x02, 0x42, 0x90, 0xc0, 0xc0,
+  0x81, 0x84, 0x8a, 0x98, 0xb8, 0x80, 0x7f, 0x37, 0x03, 0x00, 0x02, 0x40,
+  0x03, 0x40, 0x20, 0x00, 0x45, 0x0d, 0x01, 0x20, 0x00, 0x41, 0x07, 0x71,
+  0x41, 0x80, 0x02, 0x6a, 0x21, 0x01, 0x20, 0x01, 0x28, 0x02, 0x00, 0x21,
+  0x04, 0x20, 0x03, 0x20, 0x04, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x20,
+  0x02, 0x73, 0x28, 0x02, 0x00, 0x21, 0x04, 0x20, 0x03, 0x20, 0x04, 0x10,
+  0x00, 0x21, 0x03, 0x20, 0x01, 0x2c, 0x00, 0x01, 0x21, 0x04, 0x20, 0x03,
+  0x20, 0x04, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x20, 0x02, 0x73, 0x2c,
+  0x00, 0x01, 0x21, 0x04, 0x20, 0x03, 0x20, 0x04, 0x10, 0x00, 0x21, 0x03,
+  0x20, 0x01, 0x2d, 0x00, 0x02, 0x21, 0x04, 0x20, 0x03, 0x20, 0x04, 0x10,
+  0x00, 0x21, 0x03, 0x20, 0x01, 0x20, 0x02, 0x73, 0x2d, 0x00, 0x02, 0x21,
+  0x04, 0x20, 0x03, 0x20, 0x04, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x2e,
+  0x01, 0x00, 0x21, 0x04, 0x20, 0x03, 0x20, 0x04, 0x10, 0x00, 0x21, 0x03,
+  0x20, 0x01, 0x20, 0x02, 0x73, 0x2e, 0x01, 0x00, 0x21, 0x04, 0x20, 0x03,
+  0x20, 0x04, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x2f, 0x01, 0x01, 0x21,
+  0x04, 0x20, 0x03, 0x20, 0x04, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x20,
+  0x02, 0x73, 0x2f, 0x01, 0x01, 0x21, 0x04, 0x20, 0x03, 0x20, 0x04, 0x10,
+  0x00, 0x21, 0x03, 0x20, 0x01, 0x29, 0x03, 0x02, 0x21, 0x05, 0x20, 0x03,
+  0x20, 0x05, 0x20, 0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21,
+  0x03, 0x20, 0x01, 0x20, 0x02, 0x73, 0x29, 0x03, 0x02, 0x21, 0x05, 0x20,
+  0x03, 0x20, 0x05, 0x20, 0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00,
+  0x21, 0x03, 0x20, 0x01, 0x30, 0x00, 0x00, 0x21, 0x05, 0x20, 0x03, 0x20,
+  0x05, 0x20, 0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03,
+  0x20, 0x01, 0x20, 0x02, 0x73, 0x30, 0x00, 0x00, 0x21, 0x05, 0x20, 0x03,
+  0x20, 0x05, 0x20, 0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21,
+  0x03, 0x20, 0x01, 0x31, 0x00, 0x01, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05,
+  0x20, 0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20,
+  0x01, 0x20, 0x02, 0x73, 0x31, 0x00, 0x01, 0x21, 0x05, 0x20, 0x03, 0x20,
+  0x05, 0x20, 0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03,
+  0x20, 0x01, 0x32, 0x01, 0x02, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05, 0x20,
+  0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01,
+  0x20, 0x02, 0x73, 0x32, 0x01, 0x02, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05,
+  0x20, 0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20,
+  0x01, 0x33, 0x01, 0x00, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05, 0x20, 0x05,
+  0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x20,
+  0x02, 0x73, 0x33, 0x01, 0x00, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05, 0x20,
+  0x05, 0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01,
+  0x34, 0x02, 0x01, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05, 0x20, 0x05, 0x42,
+  0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x20, 0x02,
+  0x73, 0x34, 0x02, 0x01, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05, 0x20, 0x05,
+  0x42, 0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x35,
+  0x02, 0x02, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05, 0x20, 0x05, 0x42, 0x20,
+  0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x20, 0x02, 0x73,
+  0x35, 0x02, 0x02, 0x21, 0x05, 0x20, 0x03, 0x20, 0x05, 0x20, 0x05, 0x42,
+  0x20, 0x88, 0x85, 0xa7, 0x10, 0x00, 0x21, 0x03, 0x20, 0x01, 0x2d, 0x00,
+  0x00, 0x21, 0x01, 0x20, 0x03, 0x20, 0x01, 0x10, 0x00, 0x21, 0x03, 0x20,
+  0x00, 0x41, 0x01, 0x6b, 0x21, 0x00, 0x0c, 0x00, 0x0b, 0x0b, 0x20, 0x03,
+  0x0b, 0x0d, 0x01, 0x01, 0x7f, 0x20, 0x00, 0x28, 0x02, 0x02, 0x21, 0x01,
+  0x20, 0x01, 0x0b, 0x61, 0x01, 0x01, 0x7f, 0x02, 0x40, 0x03, 0x40, 0x20,
+  0x01, 0x41, 0xd0, 0x00, 0x46, 0x0d, 0x01, 0x20, 0x01, 0x41, 0x80, 0x10,
+  0x6a, 0x20, 0x01, 0x41, 0x07, 0x6c, 0x41, 0x01, 0x6a, 0x3a, 0x00, 0x00,
+  0x20, 0x01, 0x41, 0x01, 0x6a, 0x21, 0x01, 0x0c, 0x00, 0x0b, 0x0b, 0x41,
+  0x80, 0x10, 0x20, 0x00, 0x6a, 0x41, 0x80, 0x10, 0x41, 0x20, 0xfc, 0x0a,
+  0x00, 0x00, 0x41, 0x80, 0x10, 0x41, 0x80, 0x10, 0x20, 0x00, 0x41, 0x02,
+  0x6c, 0x6a, 0x41, 0x20, 0xfc, 0x0a, 0x00, 0x00, 0x41, 0x80, 0x10, 0x41,
+  0x80, 0x10, 0x41, 0x00, 0xfc, 0x0a, 0x00, 0x00, 0x41, 0x80, 0x10, 0x41,
+  0xd0, 0x00, 0x10, 0x01, 0x0b, 0x1e, 0x00, 0x41, 0x83, 0x10, 0x20, 0x00,
+  0x41, 0x28, 0xfc, 0x0b, 0x00, 0x41, 0x80, 0x80, 0x04, 0x20, 0x00, 0x41,
+  0x00, 0xfc, 0x0b, 0x00, 0x41, 0x80, 0x10, 0x41, 0x30, 0x10, 0x01, 0x0b,
+  0x1f, 0x00, 0x41, 0x80, 0x10, 0x20, 0x00, 0x41, 0x08, 0xfc, 0x08, 0x01,
+  0x00, 0x41, 0x82, 0x10, 0x20, 0x00, 0x41, 0x08, 0xfc, 0x08, 0x01, 0x00,
+  0x41, 0x80, 0x10, 0x41, 0x0c, 0x10, 0x01, 0x0b, 0x1a, 0x00, 0xfc, 0x09,
+  0x01, 0xfc, 0x09, 0x01, 0x41, 0x80, 0x10, 0x41, 0x00, 0x20, 0x00, 0xfc,
+  0x08, 0x01, 0x00, 0x41, 0x80, 0x10, 0x41, 0x04, 0x10, 0x01, 0x0b, 0x14,
+  0x00, 0x41, 0x80, 0x10, 0x41, 0x00, 0x20, 0x00, 0xfc, 0x08, 0x00, 0x00,
+  0x41, 0x80, 0x08, 0x41, 0x06, 0x10, 0x01, 0x0b, 0x0e, 0x00, 0x20, 0x00,
+  0x41, 0x00, 0x41, 0x10, 0xfc, 0x0a, 0x00, 0x00, 0x41, 0x00, 0x0b, 0x0e,
+  0x00, 0x41, 0x00, 0x20, 0x00, 0x41, 0x10, 0xfc, 0x0a, 0x00, 0x00, 0x41,
+  0x00, 0x0b, 0x0e, 0x00, 0x20, 0x00, 0x41, 0x00, 0x41, 0x00, 0xfc, 0x0a,
+  0x00, 0x00, 0x41, 0x00, 0x0b, 0x0e, 0x00, 0x20, 0x00, 0x41, 0xaa, 0x01,
+  0x41, 0x10, 0xfc, 0x0b, 0x00, 0x41, 0x00, 0x0b, 0x14, 0x00, 0x41, 0x80,
+  0x10, 0x20, 0x00, 0x41, 0x04, 0xfc, 0x08, 0x01, 0x00, 0x41, 0x80, 0x10,
+  0x41, 0x04, 0x10, 0x01, 0x0b, 0x0e, 0x00, 0x20, 0x00, 0x41, 0x00, 0x41,
+  0x04, 0xfc, 0x08, 0x01, 0x00, 0x41, 0x00, 0x0b, 0x0b, 0x29, 0x02, 0x00,
+  0x41, 0x80, 0x08, 0x0b, 0x06, 0x61, 0x63, 0x74, 0x69, 0x76, 0x65, 0x01,
+  0x1a, 0x77, 0x61, 0x73, 0x6d, 0x33, 0x20, 0x70, 0x61, 0x73, 0x73, 0x69,
+  0x76, 0x65, 0x20, 0x73, 0x65, 0x67, 0x6d, 0x65, 0x6e, 0x74, 0x00, 0x01,
+  0x02, 0xfe, 0xff
+};
+unsigned int checks_wasm_len = 4035;
@@ -0,0 +1,300 @@
+// Linux implementations of the ESP-IDF / FreeRTOS APIs used by the runtime
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "config_mgr.h"
+#include "event_mgr.h"
+#include "gpio_mgr.h"
+#include "i2c_mgr.h"
+#include "msg_mgr.h"
+#include "mqtt_mgr.h"
+#include "spi_mgr.h"
+#include "telemetry_mgr.h"
+
+bool bench_verbose = false;
+
+typedef struct {
+    pthread_t       thread;
+    TaskFunction_t  fn;
+    void            *params;
+} BenchTask_t;
+
+static void* bench_task_entry(void* ctx) {
+    BenchTask_t* t = (BenchTask_t*) ctx;
+    t->fn(t->params);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char * const name, const uint32_t stack,
+        void * const params, UBaseType_t priority, TaskHandle_t * const handle, const BaseType_t core) {
+    BenchTask_t* t = malloc(sizeof(BenchTask_t));
+    if (t == NULL) {
+        return pdFAIL;
+    }
+
+    t->fn = fn;
+    t->params = params;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack < PTHREAD_STACK_MIN ? PTHREAD_STACK_MIN : stack);
+
+    int res = pthread_create(&t->thread, &attr, bench_task_entry, t);
+    pthread_attr_destroy(&attr);
+    if (res != 0) {
+        free(t);
+        return pdFAIL;
+    }
+
+    pthread_detach(t->thread);
+
+    if (handle != NULL) {
+        *handle = t;
+    }
+
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    if (handle == NULL) {
+        pthread_exit(NULL);
+    }
+
+    pthread_cancel(((BenchTask_t*) handle)->thread);
+}
+
+void vTaskDelay(const TickType_t ticks) {
+    usleep(ticks * portTICK_PERIOD_MS * 1000);
+}
+
+// Host sleeps are not woken early
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+BaseType_t xPortGetCoreID(void) {
+    return 0;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    pthread_mutex_t* m = malloc(sizeof(pthread_mutex_t));
+    if (m != NULL) {
+        pthread_mutex_init(m, NULL);
+    }
+    return m;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    return pthread_mutex_lock((pthread_mutex_t*) sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    return pthread_mutex_unlock((pthread_mutex_t*) sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+// No configuration store on the host, every key is unset
+int CONFIG_MGR_get(const char* key, char* val, size_t val_len) {
+    return -1;
+}
+
+int CONFIG_MGR_set(const char* key, const char* val) {
+    return -1;
+}
+
+// No event dispatcher on the host, applets must export main
+int EVENT_MGR_init() {
+    return 0;
+}
+
+bool EVENT_MGR_is_event_applet(IM3Runtime runtime) {
+    return false;
+}
+
+int EVENT_MGR_attach(WasmTask_t* task, IM3Runtime runtime, EventRelease_t release) {
+    return -1;
+}
+
+int EVENT_MGR_detach(WasmTask_t* task) {
+    return -1;
+}
+
+bool EVENT_MGR_in_dispatcher() {
+    return false;
+}
+
+int EVENT_MGR_post_mqtt(WasmTask_t* task, const char* topic, const uint8_t* data, uint32_t len) {
+    return -1;
+}
+
+int EVENT_MGR_post_config(const char* key) {
+    return -1;
+}
+
+int EVENT_MGR_set_buffer(IM3Runtime runtime, uint32_t offset, uint32_t len) {
+    return -1;
+}
+
+int EVENT_MGR_timer_start(IM3Runtime runtime, uint32_t id, uint32_t period_ms, bool repeat) {
+    return -1;
+}
+
+int EVENT_MGR_timer_stop(IM3Runtime runtime, uint32_t id) {
+    return -1;
+}
+
+// No GPIO on the host
+int gpio_configure(uint32_t pin, uint32_t mode, uint32_t pull, uint32_t edge, const void *owner) {
+    return -1;
+}
+
+int gpio_write(uint32_t pin, uint32_t level, const void *owner) {
+    return -1;
+}
+
+int gpio_read(uint32_t pin) {
+    return -1;
+}
+
+int gpio_wait_event(const void *owner, GpioEvent_t *event, uint32_t timeout_ms) {
+    return -1;
+}
+
+uint32_t gpio_events_dropped(const void *owner) {
+    return 0;
+}
+
+void gpio_release_owner(const void *owner) {
+}
+
+// No I2C peripheral on the host
+int i2c_init(uint32_t port, uint32_t freq, uint32_t sda, uint32_t scl) {
+    return -1;
+}
+
+int i2c_deinit(uint32_t port) {
+    return -1;
+}
+
+int i2c_write(uint32_t port, uint32_t address, uint8_t *data_out, uint32_t length_out) {
+    return -1;
+}
+
+int i2c_read(uint32_t port, uint32_t address, uint8_t *data_in, uint32_t length_in) {
+    return -1;
+}
+
+int i2c_set_timeout(uint32_t port, uint32_t timeout_ms) {
+    return -1;
+}
+
+int i2c_write_read(uint32_t port, uint32_t address,
+                    uint8_t *data_out, uint32_t length_out,
+                    uint8_t *data_in, uint32_t length_in) {
+    return -1;
+}
+
+int i2c_transaction(uint32_t port, const I2cOp_t *ops, uint32_t count) {
+    return -1;
+}
+
+// No SPI peripheral on the host
+int spi_init(uint32_t port, int32_t sclk, int32_t mosi, int32_t miso) {
+    return -1;
+}
+
+int spi_deinit(uint32_t port) {
+    return -1;
+}
+
+int spi_device_add(uint32_t port, int32_t cs, uint32_t freq, uint32_t mode, const void *owner) {
+    return -1;
+}
+
+int spi_device_remove(uint32_t dev, const void *owner) {
+    return -1;
+}
+
+int spi_set_timeout(uint32_t dev, uint32_t timeout_ms, const void *owner) {
+    return -1;
+}
+
+int spi_transfer(uint32_t dev, const uint8_t *tx, uint8_t *rx, uint32_t len, const void *owner) {
+    return -1;
+}
+
+int spi_transfer_batch(uint32_t dev, const SpiOp_t *ops, uint32_t count, const void *owner) {
+    return -1;
+}
+
+int spi_wait(uint32_t dev, uint32_t timeout_ms, const void *owner) {
+    return -1;
+}
+
+int spi_pending(uint32_t dev, const void *owner) {
+    return -1;
+}
+
+int spi_wait_owner(const void *owner, uint32_t timeout_ms) {
+    return 0;
+}
+
+void spi_release_owner(const void *owner) {
+}
+
+// No telemetry uplink on the host
+int TELEMETRY_MGR_register(const char* name, uint32_t len) {
+    return -1;
+}
+
+int TELEMETRY_MGR_write(const TelemetrySample_t* sample) {
+    return -1;
+}
+
+int TELEMETRY_MGR_write_batch(const TelemetrySample_t* samples, uint32_t count) {
+    return 0;
+}
+
+// No MQTT client on the host
+int MQTT_MGR_publish_raw(const char* topic, const uint8_t* data, uint32_t len, int qos, bool retain) {
+    return -1;
+}
+
+int MSG_MGR_init() {
+    return 0;
+}
+
+int MSG_MGR_subscribe(WasmTask_t* task, const char* filter, uint32_t len, int qos, bool events) {
+    return -1;
+}
+
+int MSG_MGR_unsubscribe(WasmTask_t* task, const char* filter, uint32_t len) {
+    return -1;
+}
+
+int MSG_MGR_receive(WasmTask_t* task, uint8_t* buff, uint32_t len, uint32_t* topic_len, uint32_t timeout_ms) {
+    return -1;
+}
+
+uint32_t MSG_MGR_dropped(WasmTask_t* task) {
+    return 0;
+}
+
+void MSG_MGR_wake(WasmTask_t* task) {
+}
+
+void MSG_MGR_release(WasmTask_t* task) {
+}
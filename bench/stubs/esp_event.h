@@ -0,0 +1,10 @@
+#ifndef BENCH_ESP_EVENT_H
+#define BENCH_ESP_EVENT_H
+
+#include <stdint.h>
+
+typedef const char* esp_event_base_t;
+
+#define ESP_EVENT_DECLARE_BASE(id)  extern esp_event_base_t const id
+
+#endif
@@ -0,0 +1,16 @@
+
+#ifndef BENCH_ESP_LOG_H
+#define BENCH_ESP_LOG_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// Info logs are hidden unless the benchmark is run verbose
+extern bool bench_verbose;
+
+#define ESP_LOGE(tag, fmt, ...)     fprintf(stderr, "E (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...)     fprintf(stderr, "W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...)     do { if (bench_verbose) fprintf(stderr, "I (%s) " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, fmt, ...)     do { } while (0)
+
+#endif
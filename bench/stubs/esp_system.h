@@ -0,0 +1,14 @@
+
+#ifndef BENCH_ESP_SYSTEM_H
+#define BENCH_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK      0
+#define ESP_FAIL    -1
+
+#define ESP_ERR_TIMEOUT     0x107
+
+#endif
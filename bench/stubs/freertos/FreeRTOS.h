@@ -0,0 +1,25 @@
+
+#ifndef BENCH_FREERTOS_H
+#define BENCH_FREERTOS_H
+
+// Minimal FreeRTOS API for running the runtime on linux, see stubs.c
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t     BaseType_t;
+typedef uint32_t    UBaseType_t;
+typedef uint32_t    TickType_t;
+
+#define pdPASS                  1
+#define pdFAIL                  0
+#define pdTRUE                  1
+#define pdFALSE                 0
+
+#define portMAX_DELAY           0xFFFFFFFF
+#define portTICK_PERIOD_MS      1
+#define portNUM_PROCESSORS      2
+
+#define configMAX_PRIORITIES    25
+
+#endif
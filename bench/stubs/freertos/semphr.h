@@ -0,0 +1,15 @@
+
+#ifndef BENCH_SEMPHR_H
+#define BENCH_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#endif
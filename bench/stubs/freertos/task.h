@@ -0,0 +1,26 @@
+
+#ifndef BENCH_TASK_H
+#define BENCH_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskIDLE_PRIORITY        0
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char * const name, const uint32_t stack,
+        void * const params, UBaseType_t priority, TaskHandle_t * const handle, const BaseType_t core);
+
+void vTaskDelete(TaskHandle_t handle);
+
+void vTaskDelay(const TickType_t ticks);
+
+TickType_t xTaskGetTickCount(void);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle);
+
+BaseType_t xPortGetCoreID(void);
+
+#endif
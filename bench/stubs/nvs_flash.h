@@ -0,0 +1,8 @@
+#ifndef BENCH_NVS_FLASH_H
+#define BENCH_NVS_FLASH_H
+
+#include "esp_system.h"
+
+#define NVS_KEY_NAME_MAX_SIZE   16
+
+#endif
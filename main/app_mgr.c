@@ -1,5 +1,3 @@
-
-
 #include "app_mgr.h"
 
 #include "esp_log.h"
@@ -7,91 +5,241 @@
 #include "argtable3/argtable3.h"
 #include "esp_http_server.h"
 
+#include "freertos/semphr.h"
+
 #include "fs_mgr.h"
 #include "runtime.h"
+#include "wasm3.h"
 
 
 static const char* TAG = "APP_MGR";
 
-#define MAX_WASM_TASKS   4
+// Applet table, empty slots are NULL
+static WasmTask_t *tasks[APP_MGR_MAX_APPLETS] = { 0 };
+
+// Guards the applet table against concurrent console / HTTP access
+static SemaphoreHandle_t tasks_lock = NULL;
+
+#define APP_MGR_LOCK()      xSemaphoreTake(tasks_lock, portMAX_DELAY)
+#define APP_MGR_UNLOCK()    xSemaphoreGive(tasks_lock)
+
+// Set when the execute-in-place partition is available
+static bool xip_enabled = false;
+
+// Find the slot index for a named applet, -1 if not loaded
+static int app_mgr_find(const char* name) {
+    for (int i=0; i<APP_MGR_MAX_APPLETS; i++) {
+        if (tasks[i] != NULL && strncmp(tasks[i]->name, name, TASK_NAME_MAX_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-WasmTask_t *task = NULL;
+// Find a free slot index, -1 if the table is full
+static int app_mgr_free_slot() {
+    for (int i=0; i<APP_MGR_MAX_APPLETS; i++) {
+        if (tasks[i] == NULL) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static const char* app_mgr_state(const WasmTask_t* task) {
+    if (task == NULL) {
+        return "UNLOADED";
+    } else if (task->running) {
+        return "RUNNING";
+    } else {
+        return "STOPPED";
+    }
+}
 
 int APP_MGR_init() {
     ESP_LOGI(TAG, "Initialising Application Manager");
 
+    if (WASM_init() < 0) {
+        ESP_LOGE(TAG, "Error initialising WASM runtime");
+        return -1;
+    }
+
+    tasks_lock = xSemaphoreCreateMutex();
+    if (tasks_lock == NULL) {
+        ESP_LOGE(TAG, "Error allocating applet table lock");
+        return -1;
+    }
+
+    // Execute-in-place is optional, applets are loaded to RAM without it
+    xip_enabled = (XIP_MGR_init() == 0);
 
     return 0;
 }
 
 int APP_MGR_status() {
-    if (task == NULL) {
+    int count = 0;
+
+    APP_MGR_LOCK();
+
+    for (int i=0; i<APP_MGR_MAX_APPLETS; i++) {
+        WasmTask_t *task = tasks[i];
+        if (task == NULL) {
+            continue;
+        }
+
+        if (task->running) {
+            ESP_LOGI(TAG, "[%d] Running task: %s (priority: %d core: %d xip: %d)", i, task->name, task->priority, task->core, task->mapping != NULL);
+        } else {
+            ESP_LOGI(TAG, "[%d] Loaded task: %s (not running, xip: %d)", i, task->name, task->mapping != NULL);
+        }
+        count ++;
+    }
+
+    APP_MGR_UNLOCK();
+
+    if (count == 0) {
         ESP_LOGI(TAG, "No task loaded");
-        return 0;
     }
 
-    if (task->running) {
-        ESP_LOGI(TAG, "Running task: %s\r\n", task->name);
-    } else {
-        ESP_LOGI(TAG, "Loaded task: %s (not running)\r\n", task->name);
+    // Only reported when wasm3 is built with a fixed heap
+    M3HeapInfo heap;
+    m3_GetHeapInfo(&heap);
+    if (heap.size > 0) {
+        ESP_LOGI(TAG, "Runtime heap: %d of %d bytes used (peak: %d largest free: %d failed: %d)",
+                heap.used, heap.size, heap.peak, heap.largestFree, heap.failures);
     }
-    
+
     return 0;
 }
 
-int APP_MGR_load(char* name, char* file) {
+int APP_MGR_load(char* name, char* file, bool xip) {
     int res;
 
-    ESP_LOGI(TAG, "Loading task: %s from file: %s", name, file);
+    ESP_LOGI(TAG, "Loading task: %s from file: %s (xip: %d)", name, file, xip);
+
+    if (xip && !xip_enabled) {
+        ESP_LOGI(TAG, "Execute-in-place not available");
+        return -5;
+    }
+
+    APP_MGR_LOCK();
 
-    if (task != NULL) {
-        ESP_LOGI(TAG, "Task already loaded, first unload existing task");
+    if (app_mgr_find(name) >= 0) {
+        ESP_LOGI(TAG, "Task %s already loaded, first unload existing task", name);
+        APP_MGR_UNLOCK();
         return -1;
     }
 
-    task = malloc(sizeof(WasmTask_t));
+    int slot = app_mgr_free_slot();
+    if (slot < 0) {
+        ESP_LOGI(TAG, "No free task slots (max: %d)", APP_MGR_MAX_APPLETS);
+        APP_MGR_UNLOCK();
+        return -4;
+    }
+
+    WasmTask_t *task = malloc(sizeof(WasmTask_t));
     if (task == NULL) {
         ESP_LOGI(TAG, "Error allocating memory for task");
+        APP_MGR_UNLOCK();
         return -2;
     }
 
     memset(task, 0, sizeof(WasmTask_t));
 
     // Set task name
-    strncpy(task->name, name, TASK_NAME_MAX_LEN);
+    strncpy(task->name, name, TASK_NAME_MAX_LEN - 1);
+
+    // Set default scheduling
+    task->priority = APP_MGR_DEFAULT_PRIORITY;
+    task->core = APP_MGR_DEFAULT_CORE;
+
+    if (xip) {
+        // Install to the partition slot matching the table slot and map it in place,
+        // cached modules may still map the previous binary so drop them first
+        const uint8_t* data;
+        if (WASM_cache_flush_xip(slot) < 0) {
+            ESP_LOGI(TAG, "Partition slot %d still in use", slot);
+            free(task);
+            APP_MGR_UNLOCK();
+            return -6;
+        }
 
-    // Load task into memory
-    uint8_t* buff;
-    res = FS_MGR_read(file, &buff, &task->data_len);
-    if (res < 0) {
-        ESP_LOGI(TAG, "Error %d loading file %s", res, file);
-        return -3;
+        res = XIP_MGR_install(slot, file);
+        if (res == 0) {
+            res = XIP_MGR_map(slot, &data, &task->data_len, &task->crc, &task->mapping);
+        }
+        if (res < 0) {
+            ESP_LOGI(TAG, "Error %d installing file %s", res, file);
+            free(task);
+            APP_MGR_UNLOCK();
+            return -3;
+        }
+        task->data = (uint8_t*) data;
+        task->xip_slot = slot;
+
+    } else {
+        // Load task into memory
+        uint8_t* buff;
+        res = FS_MGR_read(file, (char**) &buff, &task->data_len, &task->crc);
+        if (res < 0) {
+            ESP_LOGI(TAG, "Error %d loading file %s", res, file);
+            free(task);
+            APP_MGR_UNLOCK();
+            return -3;
+        }
+        task->data = buff;
     }
-    task->data = buff;
 
-    ESP_LOGI(TAG, "Task %s loaded", task->name);
+    tasks[slot] = task;
+
+    APP_MGR_UNLOCK();
+
+    ESP_LOGI(TAG, "Task %s loaded (slot: %d)", task->name, slot);
 
     return 0;
 }
 
-int APP_MGR_start(uint32_t argc, char** argv) {
-    if (task == NULL) {
-        ESP_LOGI(TAG, "No task loaded");
+int APP_MGR_start(char* name, uint32_t priority, int32_t core, uint32_t argc, char** argv) {
+    APP_MGR_LOCK();
+
+    int slot = app_mgr_find(name);
+    if (slot < 0) {
+        ESP_LOGI(TAG, "Task %s not loaded", name);
+        APP_MGR_UNLOCK();
         return -1;
     }
 
+    WasmTask_t *task = tasks[slot];
+
     if (task->running) {
         ESP_LOGI(TAG, "Task %s already running", task->name);
+        APP_MGR_UNLOCK();
         return -2;
     }
 
+    // Validate scheduling parameters
+    if (priority >= configMAX_PRIORITIES || (core != tskNO_AFFINITY && (core < 0 || core >= portNUM_PROCESSORS))) {
+        ESP_LOGI(TAG, "Invalid priority %d or core %d for task %s", priority, core, task->name);
+        APP_MGR_UNLOCK();
+        return -4;
+    }
+
+    if (argc > TASK_MAX_ARGS - 1) {
+        ESP_LOGI(TAG, "Too many arguments (%d, max: %d)", argc, TASK_MAX_ARGS - 1);
+        APP_MGR_UNLOCK();
+        return -5;
+    }
+
+    task->priority = priority;
+    task->core = core;
+
     // Set first argument to task name
     strncpy(task->args[0], task->name, TASK_MAX_ARGLEN);
     task->arg_count = 1;
 
     // Copy following elements
     for (uint32_t i=0; i<argc; i++) {
-        printf("Loading arg %d value: '%s'\r\n", argc, argv[i]);
+        printf("Loading arg %d value: '%s'\r\n", i, argv[i]);
 
         strncpy(task->args[i+1], argv[i], TASK_MAX_ARGLEN);
         task->arg_count += 1;
@@ -99,26 +247,36 @@ int APP_MGR_start(uint32_t argc, char** argv) {
 
     // Launch task
     int res = WASM_launch_task(task);
+
+    APP_MGR_UNLOCK();
+
     if (res < 0) {
-        ESP_LOGI(TAG, "Error %d launching task %s", res, task->name);
+        ESP_LOGI(TAG, "Error %d launching task %s", res, name);
         return -3;
     }
 
     return 0;
 }
 
-int APP_MGR_stop() {
+int APP_MGR_stop(char* name) {
     int res;
 
-    ESP_LOGI(TAG, "Stopping task");
+    ESP_LOGI(TAG, "Stopping task: %s", name);
 
-    if (task == NULL) {
-        ESP_LOGI(TAG, "Task not loaded");
+    APP_MGR_LOCK();
+
+    int slot = app_mgr_find(name);
+    if (slot < 0) {
+        ESP_LOGI(TAG, "Task %s not loaded", name);
+        APP_MGR_UNLOCK();
         return -1;
     }
 
+    WasmTask_t *task = tasks[slot];
+
     if (!task->running) {
         ESP_LOGI(TAG, "Task %s not running", task->name);
+        APP_MGR_UNLOCK();
         return -2;
     }
 
@@ -128,34 +286,87 @@ int APP_MGR_stop() {
         ESP_LOGI(TAG, "Error %d stopping task %s", res, task->name);
     }
 
-    return 0;
+    APP_MGR_UNLOCK();
+
+    return (res < 0) ? -3 : 0;
 }
 
-int APP_MGR_unload() {
+int APP_MGR_unload(char* name) {
 
-    ESP_LOGI(TAG, "Unloading task");
+    ESP_LOGI(TAG, "Unloading task: %s", name);
 
-    if (task == NULL) {
-        ESP_LOGI(TAG, "Task not loaded");
+    APP_MGR_LOCK();
+
+    int slot = app_mgr_find(name);
+    if (slot < 0) {
+        ESP_LOGI(TAG, "Task %s not loaded", name);
+        APP_MGR_UNLOCK();
         return -1;
     }
 
+    WasmTask_t *task = tasks[slot];
+
     if (task->running) {
         ESP_LOGI(TAG, "Task %s running, stop task before unloading", task->name);
+        APP_MGR_UNLOCK();
         return -2;
     }
 
     // De-allocate memory
-    free(task->data);
+    if (task->mapping != NULL) {
+        XIP_MGR_unmap(task->mapping);
+    } else {
+        free(task->data);
+    }
     free(task);
 
-    task = NULL;
+    tasks[slot] = NULL;
+
+    APP_MGR_UNLOCK();
 
     ESP_LOGI(TAG, "Task unloaded");
 
     return 0;
 }
 
+int APP_MGR_profile(char* name, bool reset, WasmWriter_t writer, void* ctx) {
+    APP_MGR_LOCK();
+
+    int slot = app_mgr_find(name);
+    if (slot < 0) {
+        ESP_LOGI(TAG, "Task %s not loaded", name);
+        APP_MGR_UNLOCK();
+        return -1;
+    }
+
+    int res = WASM_profile(tasks[slot], reset, writer, ctx);
+
+    APP_MGR_UNLOCK();
+
+    if (res < 0) {
+        ESP_LOGI(TAG, "No profile for task %s, start the task first", name);
+        return -2;
+    }
+
+    return 0;
+}
+
+int APP_MGR_logs(char* name, uint32_t* cursor, char* buff, uint32_t len) {
+    APP_MGR_LOCK();
+
+    int slot = app_mgr_find(name);
+    if (slot < 0) {
+        APP_MGR_UNLOCK();
+        return -1;
+    }
+
+    int res = WASM_log_read(tasks[slot], cursor, buff, len);
+
+    APP_MGR_UNLOCK();
+
+    return res;
+}
+
 // App Status command for CLI
 static int task_status_cmd(int argc, char **argv) {
     APP_MGR_status();
@@ -163,12 +374,34 @@ static int task_status_cmd(int argc, char **argv) {
     return 0;
 }
 
-static struct {;
+static struct {
     struct arg_str *name;
     struct arg_str *file;
+    struct arg_int *priority;
+    struct arg_int *core;
+    struct arg_lit *xip;
     struct arg_end *end;
 } load_args;
 
+static struct {
+    struct arg_str *name;
+    struct arg_int *priority;
+    struct arg_int *core;
+    struct arg_str *args;
+    struct arg_end *end;
+} start_args;
+
+static struct {
+    struct arg_str *name;
+    struct arg_end *end;
+} name_args;
+
+static struct {
+    struct arg_str *name;
+    struct arg_lit *reset;
+    struct arg_end *end;
+} profile_args;
+
 
 // App load command for CLI
 static int task_load_command(int argc, char **argv) {
@@ -178,7 +411,7 @@ static int task_load_command(int argc, char **argv) {
         return 1;
     }
 
-    int res = APP_MGR_load((char*) load_args.name->sval[0], (char*) load_args.file->sval[0]);
+    int res = APP_MGR_load((char*) load_args.name->sval[0], (char*) load_args.file->sval[0], load_args.xip->count > 0);
     if (res < 0) {
         ESP_LOGI(TAG, "Error %d loading task", res);
         return res;
@@ -196,15 +429,19 @@ static int task_launch_command(int argc, char **argv) {
         return 1;
     }
 
-    res = APP_MGR_load((char*) load_args.name->sval[0], (char*) load_args.file->sval[0]);
+    char* name = (char*) load_args.name->sval[0];
+    uint32_t priority = load_args.priority->count ? load_args.priority->ival[0] : APP_MGR_DEFAULT_PRIORITY;
+    int32_t core = load_args.core->count ? load_args.core->ival[0] : APP_MGR_DEFAULT_CORE;
+
+    res = APP_MGR_load(name, (char*) load_args.file->sval[0], load_args.xip->count > 0);
     if (res < 0) {
         ESP_LOGI(TAG, "Error %d loading task", res);
         return res;
     }
 
-    res = APP_MGR_start(0, NULL);
+    res = APP_MGR_start(name, priority, core, 0, NULL);
     if (res < 0) {
-        ESP_LOGI(TAG, "Error %d loading task", res);
+        ESP_LOGI(TAG, "Error %d starting task", res);
         return res;
     }
 
@@ -212,21 +449,73 @@ static int task_launch_command(int argc, char **argv) {
 }
 
 static int task_start_command(int argc, char **argv) {
-    return APP_MGR_start(argc-1, &argv[1]);
+    int nerrors = arg_parse(argc, argv, (void **) &start_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, start_args.end, argv[0]);
+        return 1;
+    }
+
+    uint32_t priority = start_args.priority->count ? start_args.priority->ival[0] : APP_MGR_DEFAULT_PRIORITY;
+    int32_t core = start_args.core->count ? start_args.core->ival[0] : APP_MGR_DEFAULT_CORE;
+
+    return APP_MGR_start((char*) start_args.name->sval[0], priority, core,
+            start_args.args->count, (char**) start_args.args->sval);
 }
 
 static int task_stop_command(int argc, char **argv) {
-    return APP_MGR_stop();
+    int nerrors = arg_parse(argc, argv, (void **) &name_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, name_args.end, argv[0]);
+        return 1;
+    }
+
+    return APP_MGR_stop((char*) name_args.name->sval[0]);
 }
 
 static int task_unload_command(int argc, char **argv) {
-    return APP_MGR_unload();
+    int nerrors = arg_parse(argc, argv, (void **) &name_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, name_args.end, argv[0]);
+        return 1;
+    }
+
+    return APP_MGR_unload((char*) name_args.name->sval[0]);
+}
+
+static int task_profile_write(void* ctx, const char* buff, size_t len) {
+    return fwrite(buff, 1, len, stdout);
+}
+
+static int task_profile_command(int argc, char **argv) {
+    int nerrors = arg_parse(argc, argv, (void **) &profile_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, profile_args.end, argv[0]);
+        return 1;
+    }
+
+    return APP_MGR_profile((char*) profile_args.name->sval[0], profile_args.reset->count > 0, task_profile_write, NULL);
 }
 
 void APP_MGR_register_commands() {
-    load_args.name = arg_str0(NULL, NULL, "<name>", "Name of task to launch");
+    load_args.name = arg_str1(NULL, NULL, "<name>", "Name of task to launch");
     load_args.file = arg_str1(NULL, NULL, "<file>", "File to load task from");
-    load_args.end = arg_end(2);
+    load_args.priority = arg_int0("p", "priority", "<prio>", "FreeRTOS task priority (launch only)");
+    load_args.core = arg_int0("c", "core", "<core>", "Core to pin task to, -1 for any (launch only)");
+    load_args.xip = arg_lit0("x", "xip", "Execute in place from the applet partition");
+    load_args.end = arg_end(5);
+
+    start_args.name = arg_str1(NULL, NULL, "<name>", "Name of task to start");
+    start_args.priority = arg_int0("p", "priority", "<prio>", "FreeRTOS task priority");
+    start_args.core = arg_int0("c", "core", "<core>", "Core to pin task to, -1 for any");
+    start_args.args = arg_strn(NULL, NULL, "<arg>", 0, TASK_MAX_ARGS - 1, "Arguments passed to the task");
+    start_args.end = arg_end(4);
+
+    name_args.name = arg_str1(NULL, NULL, "<name>", "Name of task");
+    name_args.end = arg_end(1);
+
+    profile_args.name = arg_str1(NULL, NULL, "<name>", "Name of task");
+    profile_args.reset = arg_lit0("r", "reset", "Reset counters after reporting");
+    profile_args.end = arg_end(2);
 
     const esp_console_cmd_t task_status = {
         .command = "task-status",
@@ -254,26 +543,34 @@ void APP_MGR_register_commands() {
 
     const esp_console_cmd_t task_start = {
         .command = "task-start",
-        .help = "Start the loaded task",
+        .help = "Start a loaded task",
         .hint = NULL,
         .func = &task_start_command,
-        .argtable = NULL,
+        .argtable = &start_args,
     };
 
     const esp_console_cmd_t task_stop = {
         .command = "task-stop",
-        .help = "Stop the running task",
+        .help = "Stop a running task",
         .hint = NULL,
         .func = &task_stop_command,
-        .argtable = NULL,
+        .argtable = &name_args,
     };
 
     const esp_console_cmd_t task_unload = {
         .command = "task-unload",
-        .help = "Stop the running task",
+        .help = "Unload a stopped task",
         .hint = NULL,
         .func = &task_unload_command,
-        .argtable = NULL,
+        .argtable = &name_args,
+    };
+
+    const esp_console_cmd_t task_profile = {
+        .command = "task-profile",
+        .help = "Report function call counts and time (and operation counts if enabled) for a task",
+        .hint = NULL,
+        .func = &task_profile_command,
+        .argtable = &profile_args,
     };
 
     ESP_ERROR_CHECK( esp_console_cmd_register(&task_status) );
@@ -282,20 +579,52 @@ void APP_MGR_register_commands() {
     ESP_ERROR_CHECK( esp_console_cmd_register(&task_start) );
     ESP_ERROR_CHECK( esp_console_cmd_register(&task_stop) );
     ESP_ERROR_CHECK( esp_console_cmd_register(&task_unload) );
+    ESP_ERROR_CHECK( esp_console_cmd_register(&task_profile) );
 }
 
 esp_err_t app_status_handler(httpd_req_t *req) {
+    char name[TASK_NAME_MAX_LEN] = {0};
 
     ESP_LOGI(TAG, "Get status");
 
-    if (task == NULL) {
-        httpd_resp_send_err(req, 200, "UNLOADED");
-    } else if (task->running) {
-        httpd_resp_send_err(req, 200, "RUNNING");
+    // Fetch optional applet name
+    size_t buf_len = httpd_req_get_url_query_len(req) + 1;
+    if (buf_len > 1) {
+        char* buf = malloc(buf_len);
+        if (buf != NULL && httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+            httpd_query_key_value(buf, "name", name, sizeof(name));
+        }
+        free(buf);
+    }
+
+    APP_MGR_LOCK();
+
+    if (name[0] != 0) {
+        // Report the state of a single applet
+        int slot = app_mgr_find(name);
+        const char* state = app_mgr_state(slot < 0 ? NULL : tasks[slot]);
+
+        httpd_resp_send(req, state, strlen(state));
+
     } else {
-        httpd_resp_send_err(req, 200, "STOPPED");
+        // List all loaded applets, one per line
+        char resp[APP_MGR_MAX_APPLETS * (TASK_NAME_MAX_LEN + 32)] = {0};
+        int len = 0;
+
+        for (int i=0; i<APP_MGR_MAX_APPLETS; i++) {
+            if (tasks[i] == NULL) {
+                continue;
+            }
+
+            len += snprintf(resp + len, sizeof(resp) - len, "%s %s %d %d\r\n",
+                    tasks[i]->name, app_mgr_state(tasks[i]), tasks[i]->priority, tasks[i]->core);
+        }
+
+        httpd_resp_send(req, resp, len);
     }
 
+    APP_MGR_UNLOCK();
+
     return ESP_OK;
 }
 
@@ -329,23 +658,45 @@ esp_err_t app_cmd_handler(httpd_req_t *req) {
     char file[64] = {0};
     httpd_query_key_value(buf, "file", file, sizeof(file));
 
+    // Optional scheduling parameters
+    char param[16] = {0};
+    uint32_t priority = APP_MGR_DEFAULT_PRIORITY;
+    if (httpd_query_key_value(buf, "prio", param, sizeof(param)) == ESP_OK) {
+        priority = strtoul(param, NULL, 10);
+    }
+
+    int32_t core = APP_MGR_DEFAULT_CORE;
+    if (httpd_query_key_value(buf, "core", param, sizeof(param)) == ESP_OK) {
+        core = strtol(param, NULL, 10);
+    }
+
+    bool xip = false;
+    if (httpd_query_key_value(buf, "xip", param, sizeof(param)) == ESP_OK) {
+        xip = strtoul(param, NULL, 10) != 0;
+    }
+
+
+    if (name[0] == 0) {
+        httpd_resp_send_err(req, 400, "name query param required");
+        free(buf);
+        return ESP_OK;
 
-    if (strcmp(cmd, "load") == 0) {
-        if (file[0] == 0 || name[0] == 0 ) {
+    } else if (strcmp(cmd, "load") == 0) {
+        if (file[0] == 0) {
             httpd_resp_send_err(req, 500, "file and name query params required");
             res = -100;
         } else {
-            res = APP_MGR_load(name, file);
+            res = APP_MGR_load(name, file, xip);
         }
 
     } else if (strcmp(cmd, "unload") == 0 ){
-        res = APP_MGR_unload();
+        res = APP_MGR_unload(name);
 
     } else if (strcmp(cmd, "start") == 0 ){
-        res = APP_MGR_start(0, NULL);
+        res = APP_MGR_start(name, priority, core, 0, NULL);
 
     } else if (strcmp(cmd, "stop") == 0 ){
-        res = APP_MGR_stop();
+        res = APP_MGR_stop(name);
 
     } else {
         httpd_resp_send_err(req, 400, "Unrecognized command");
@@ -367,6 +718,124 @@ esp_err_t app_cmd_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+static int app_profile_write(void* ctx, const char* buff, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t*) ctx, buff, len) == ESP_OK ? 0 : -1;
+}
+
+esp_err_t app_profile_handler(httpd_req_t *req) {
+    char name[TASK_NAME_MAX_LEN] = {0};
+    char reset[4] = {0};
+
+    size_t buf_len = httpd_req_get_url_query_len(req) + 1;
+    if (buf_len > 1) {
+        char* buf = malloc(buf_len);
+        if (buf != NULL && httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+            httpd_query_key_value(buf, "name", name, sizeof(name));
+            httpd_query_key_value(buf, "reset", reset, sizeof(reset));
+        }
+        free(buf);
+    }
+
+    if (name[0] == 0) {
+        httpd_resp_send_err(req, 400, "name query param required");
+        return ESP_OK;
+    }
+
+    // Streamed as chunks, an empty chunk ends the response
+    int res = APP_MGR_profile(name, strtoul(reset, NULL, 10) != 0, app_profile_write, req);
+    if (res < 0) {
+        char m[32];
+        snprintf(m, sizeof(m), "ERROR: %d\r\n", res);
+        httpd_resp_send_chunk(req, m, strlen(m));
+    }
+
+    httpd_resp_send_chunk(req, NULL, 0);
+
+    return ESP_OK;
+}
+
+// Stream buffered log output, waiting up to `wait` ms for more. The X-Log-Cursor header
+// gives the cursor of the first byte, pass the cursor plus the bytes received as `from`
+// on the next request to tail the log without gaps or repeats.
+esp_err_t app_logs_handler(httpd_req_t *req) {
+    char name[TASK_NAME_MAX_LEN] = {0};
+    char param[16] = {0};
+    uint32_t cursor = 0;
+    uint32_t wait_ms = 0;
+
+    size_t buf_len = httpd_req_get_url_query_len(req) + 1;
+    if (buf_len > 1) {
+        char* buf = malloc(buf_len);
+        if (buf != NULL && httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+            httpd_query_key_value(buf, "name", name, sizeof(name));
+            if (httpd_query_key_value(buf, "from", param, sizeof(param)) == ESP_OK) {
+                cursor = strtoul(param, NULL, 10);
+            }
+            if (httpd_query_key_value(buf, "wait", param, sizeof(param)) == ESP_OK) {
+                wait_ms = strtoul(param, NULL, 10);
+            }
+        }
+        free(buf);
+    }
+
+    if (name[0] == 0) {
+        httpd_resp_send_err(req, 400, "name query param required");
+        return ESP_OK;
+    }
+
+    if (wait_ms > APP_MGR_LOG_WAIT_MAX_MS) {
+        wait_ms = APP_MGR_LOG_WAIT_MAX_MS;
+    }
+
+    char chunk[512];
+    char start[16] = {0};
+    uint32_t sent = 0;
+    TickType_t deadline = xTaskGetTickCount() + wait_ms / portTICK_PERIOD_MS;
+
+    httpd_resp_set_type(req, "text/plain");
+
+    // The single http worker is held throughout, so time and bytes are bounded whether or not
+    // output arrives, and the request returns as soon as it has drained what is there
+    while (sent < APP_MGR_LOG_MAX_BYTES) {
+        // The applet is looked up each time as it may be unloaded while waiting
+        uint32_t max = APP_MGR_LOG_MAX_BYTES - sent;
+        int len = APP_MGR_logs(name, &cursor, chunk, (max < sizeof(chunk)) ? max : sizeof(chunk));
+        if (len < 0 && start[0] == 0) {
+            httpd_resp_send_err(req, 404, "Task not loaded");
+            return ESP_OK;
+        } else if (len < 0) {
+            break;
+        }
+
+        // Headers go out with the first chunk
+        if (start[0] == 0) {
+            snprintf(start, sizeof(start), "%u", cursor - len);
+            httpd_resp_set_hdr(req, "X-Log-Cursor", start);
+        }
+
+        if (len > 0) {
+            if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            sent += len;
+        } else if (sent > 0) {
+            break;
+        }
+
+        if ((int32_t) (deadline - xTaskGetTickCount()) <= 0) {
+            break;
+        }
+
+        if (len == 0) {
+            vTaskDelay(APP_MGR_LOG_POLL_MS / portTICK_PERIOD_MS);
+        }
+    }
+
+    httpd_resp_send_chunk(req, NULL, 0);
+
+    return ESP_OK;
+}
+
 httpd_uri_t app_uri_get_status = {
     .uri      = "/app/status",
     .method   = HTTP_GET,
@@ -381,7 +850,23 @@ httpd_uri_t app_uri_get_cmd = {
     .user_ctx = NULL
 };
 
+httpd_uri_t app_uri_get_profile = {
+    .uri      = "/app/profile",
+    .method   = HTTP_GET,
+    .handler  = app_profile_handler,
+    .user_ctx = NULL
+};
+
+httpd_uri_t app_uri_get_logs = {
+    .uri      = "/app/logs",
+    .method   = HTTP_GET,
+    .handler  = app_logs_handler,
+    .user_ctx = NULL
+};
+
 void APP_MGR_register_http(httpd_handle_t server) {
     httpd_register_uri_handler(server, &app_uri_get_status);
+    httpd_register_uri_handler(server, &app_uri_get_profile);
+    httpd_register_uri_handler(server, &app_uri_get_logs);
     httpd_register_uri_handler(server, &app_uri_get_cmd);
 }
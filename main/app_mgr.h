@@ -2,18 +2,54 @@
 #ifndef APP_MGR_H
 #define APP_MGR_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
 #include "esp_http_server.h"
 
+#include "runtime.h"
+
+// Maximum number of concurrently loaded applets
+#define APP_MGR_MAX_APPLETS         4
+
+// Longest an /app/logs request holds the http worker, how often it checks for new output
+// and the most it sends, clients continue from the returned cursor
+#define APP_MGR_LOG_WAIT_MAX_MS     1000
+#define APP_MGR_LOG_POLL_MS         100
+#define APP_MGR_LOG_MAX_BYTES       (2 * WASM_LOG_SIZE)
+
+// Default scheduling for applets (lowest priority, either core)
+#define APP_MGR_DEFAULT_PRIORITY    tskIDLE_PRIORITY
+#define APP_MGR_DEFAULT_CORE        tskNO_AFFINITY
+
 // Initialise application manager
 int APP_MGR_init();
 
-int APP_MGR_load(char* name, char* file);
+// Print the status of all loaded applets
+int APP_MGR_status();
+
+// Load an applet from a file into a free slot
+// With xip set the applet is installed to flash and run from there rather than RAM
+int APP_MGR_load(char* name, char* file, bool xip);
+
+// Start a loaded applet with the provided priority and core (-1 for any core)
+int APP_MGR_start(char* name, uint32_t priority, int32_t core, uint32_t argc, char** argv);
+
+// Stop a running applet
+int APP_MGR_stop(char* name);
 
-int APP_MGR_start(uint32_t argc, char** argv);
+// Unload a stopped applet and free its slot
+int APP_MGR_unload(char* name);
 
-int APP_MGR_stop();
+// Write the execution profile of an applet, optionally resetting the counters
+int APP_MGR_profile(char* name, bool reset, WasmWriter_t writer, void* ctx);
 
-int APP_MGR_unload();
+// Read buffered log output of an applet from a cursor, see WASM_log_read
+// Returns the number of bytes read, or -1 if the applet is not loaded
+int APP_MGR_logs(char* name, uint32_t* cursor, char* buff, uint32_t len);
 
 // Bind application manager console commands
 void APP_MGR_register_commands();
@@ -3,12 +3,15 @@
 #include "fs_mgr.h"
 
 #include <dirent.h>
+#include <sys/param.h>
 
 #include "esp_log.h"
 #include "esp_http_server.h"
 #include "esp_spiffs.h"
 #include "rom/crc.h"
 
+#include "wasm3.h"
+
 static const char* TAG = "FS_MGR";
 
 int FS_MGR_init() {
@@ -73,8 +76,8 @@ int FS_MGR_write(char* name, char* data, uint32_t data_len) {
 }
 
 // Read from a file, buff will be malloc'd internally and must be
-// freed by the caller
-int FS_MGR_read(char* name, char** buff, uint32_t *len) {
+// freed by the caller. crc is optional and may be NULL
+int FS_MGR_read(char* name, char** buff, uint32_t *len, uint32_t *crc) {
     uint32_t res;
 
     ESP_LOGI(TAG, "Reading file %s", name);
@@ -104,8 +107,12 @@ int FS_MGR_read(char* name, char** buff, uint32_t *len) {
         ESP_LOGE(TAG, "Read res: %d len: %d", res, *len);
     }
 
-    uint32_t crc = crc32_le(0, (uint8_t*) *buff, *len);
-    ESP_LOGI(TAG, "Read file (CRC: 0x%08x)", crc);
+    uint32_t file_crc = crc32_le(0, (uint8_t*) *buff, *len);
+    ESP_LOGI(TAG, "Read file (CRC: 0x%08x)", file_crc);
+
+    if (crc != NULL) {
+        *crc = file_crc;
+    }
 
     // Close file
     fclose(f);
@@ -196,7 +203,7 @@ esp_err_t file_get_handler(httpd_req_t *req)
         char* data;
         uint32_t len;
 
-        if (FS_MGR_read(name_buff, &data, &len) < 0) {
+        if (FS_MGR_read(name_buff, &data, &len, NULL) < 0) {
             httpd_resp_send_err(req, 500, "Error reading file");
             return ESP_OK;
         }
@@ -223,15 +230,25 @@ esp_err_t file_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Receive buffer for streamed uploads
+#define FS_MGR_RECV_CHUNK       1024
+
+// Largest wasm section that is buffered and fully parsed during upload,
+// larger sections only have their framing checked
+#define FS_MGR_WASM_SECTION_MAX 2048
+
+static bool is_wasm_file(const char* name) {
+    size_t len = strlen(name);
+    return len > 5 && strcmp(name + len - 5, ".wasm") == 0;
+}
+
 esp_err_t file_post_handler(httpd_req_t *req)
 {
     char file_name[32];
-
-    // Check content length is sane
-    if (req->content_len > (100 * 1024)) {
-        httpd_resp_send_err(req, 400, "Content length exceeds maximum");
-        return ESP_OK;
-    }
+    char tmp_name[40];
+    IM3StreamValidator validator = NULL;
+    M3Result result = m3Err_none;
+    FILE* f = NULL;
 
     bool has_name = get_query_param(req, "file", file_name, sizeof(file_name));
     if (!has_name) {
@@ -239,35 +256,97 @@ esp_err_t file_post_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
+    // Check there is space for the file
+    size_t total = 0, used = 0;
+    if (esp_spiffs_info(NULL, &total, &used) == ESP_OK && req->content_len > (total - used)) {
+        httpd_resp_send_err(req, 400, "Content length exceeds free space");
+        return ESP_OK;
+    }
+
     ESP_LOGI(TAG, "Receiving file %s with content length %d", file_name, req->content_len);
 
-    // Allocate space for recieving object
-    char* content = malloc(req->content_len);
-    if (content == NULL) {
+    // Allocate space for receiving chunks
+    char* chunk = malloc(FS_MGR_RECV_CHUNK);
+    if (chunk == NULL) {
         httpd_resp_send_err(req, 500, "Error allocating receive buffer");
         return ESP_OK;
     }
-    memset(content, 0xFF, req->content_len);
-    
-    // Receive data
+
+    // Validate wasm binaries as they arrive
+    if (is_wasm_file(file_name)) {
+        validator = m3_NewStreamValidator(FS_MGR_WASM_SECTION_MAX);
+        if (validator == NULL) {
+            httpd_resp_send_err(req, 500, "Error allocating validator");
+            goto post_done;
+        }
+    }
+
+    // Stream to a temporary file so a failed upload leaves any existing file intact
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", file_name);
+
+    f = fopen(tmp_name, "w");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open file %s for writing", tmp_name);
+        httpd_resp_send_err(req, 500, "Error opening file");
+        goto post_done;
+    }
+
+    // Receive and write data
+    uint32_t crc = 0;
     uint32_t c = 0;
     while (c < req->content_len) {
-        int ret = httpd_req_recv(req, content + c, req->content_len - c);
+        int ret = httpd_req_recv(req, chunk, MIN(req->content_len - c, FS_MGR_RECV_CHUNK));
 
-        if (ret < 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        } else if (ret < 0) {
             ESP_LOGI(TAG, "HTTP receive error: %d", ret);
             httpd_resp_send_err(req, 500, "Receive error");
+            goto post_done;
+        }
 
+        if (validator != NULL) {
+            result = m3_ValidateStream(validator, (uint8_t*) chunk, ret);
+            if (result) {
+                ESP_LOGI(TAG, "Invalid wasm at offset %d: %s", c, result);
+                httpd_resp_send_err(req, 400, result);
+                goto post_done;
+            }
+        }
+
+        if (fwrite(chunk, 1, ret, f) != ret) {
+            ESP_LOGE(TAG, "Failed writing file %s", tmp_name);
+            httpd_resp_send_err(req, 500, "Write error");
             goto post_done;
         }
 
+        crc = crc32_le(crc, (uint8_t*) chunk, ret);
         c += ret;
     }
 
-    
+    if (validator != NULL) {
+        result = m3_FinishStreamValidator(validator);
+        validator = NULL;
 
-    // Write data to FS
-    FS_MGR_write(file_name, content, req->content_len);
+        if (result) {
+            ESP_LOGI(TAG, "Invalid wasm: %s", result);
+            httpd_resp_send_err(req, 400, result);
+            goto post_done;
+        }
+    }
+
+    fclose(f);
+    f = NULL;
+
+    // Replace existing file
+    remove(file_name);
+    if (rename(tmp_name, file_name) != 0) {
+        ESP_LOGE(TAG, "Failed to rename %s to %s", tmp_name, file_name);
+        httpd_resp_send_err(req, 500, "Error renaming file");
+        goto post_done;
+    }
+
+    ESP_LOGI(TAG, "File written (%d bytes, crc: %08x)", c, crc);
 
     // Respond with OK
     const char resp[] = "OK\r\n";
@@ -275,8 +354,18 @@ esp_err_t file_post_handler(httpd_req_t *req)
 
 post_done:
 
+    if (f != NULL) {
+        // Upload failed, discard partial file
+        fclose(f);
+        remove(tmp_name);
+    }
+
+    if (validator != NULL) {
+        m3_FinishStreamValidator(validator);
+    }
+
     // Free data storage
-    free(content);
+    free(chunk);
 
     return ESP_OK;
 }
@@ -11,8 +11,9 @@ int FS_MGR_init();
 int FS_MGR_write(char* name, char* data, uint32_t data_len);
 
 // Read a file from the file system
-// This allocates data into buff that must be freed when done
-int FS_MGR_read(char* name, char** buff, uint32_t *len);
+// This allocates data into buff that must be freed when done,
+// and optionally returns the CRC32 of the file contents
+int FS_MGR_read(char* name, char** buff, uint32_t *len, uint32_t *crc);
 
 // List files in the file system
 int FS_MGR_list(char* dir_name, char* buff, uint32_t buff_len, bool format);
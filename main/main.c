@@ -17,6 +17,7 @@
 
 #include "wifi_mgr.h"
 #include "mqtt_mgr.h"
+#include "telemetry_mgr.h"
 #include "fs_mgr.h"
 #include "app_mgr.h"
 #include "console.h"
@@ -68,6 +69,11 @@ void app_main(void)
     FS_MGR_init();
     FS_MGR_register_http(server);
 
+    // Offline messages are queued on the filesystem
+    MQTT_MGR_init();
+    MQTT_MGR_register_commands();
+    TELEMETRY_MGR_init();
+
     APP_MGR_init();
     APP_MGR_register_commands();
     APP_MGR_register_http(server);
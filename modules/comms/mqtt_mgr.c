@@ -9,12 +9,15 @@
 #include "argtable3/argtable3.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_wifi.h"
 #include "tcpip_adapter.h"
 #include "esp_event.h"
 #include "mqtt_client.h"
 #include "esp_tls.h"
 
+#include "mqtt_queue.h"
+
 #define TAG "MQTT"
 #define JOIN_TIMEOUT_MS (10000)
 
@@ -28,6 +31,34 @@ typedef enum {
 
 volatile static mqtt_status_e mqtt_status = MQTT_DISCONNECTED;
 
+esp_mqtt_client_handle_t client = NULL;
+
+typedef struct {
+    char        topic[MQTT_MGR_TOPIC_LEN];
+    int         qos;
+    uint32_t    refs;
+} MqttSub_t;
+
+static MqttSub_t subs[MQTT_MGR_MAX_SUBS];
+static SemaphoreHandle_t sub_lock = NULL;
+
+static volatile MqttMessageHook_t message_hook = NULL;
+
+static TaskHandle_t queue_task = NULL;
+
+// Subscriptions are not kept by the broker across clean sessions
+static void mqtt_resubscribe() {
+    xSemaphoreTake(sub_lock, portMAX_DELAY);
+
+    for (int i=0; i<MQTT_MGR_MAX_SUBS; i++) {
+        if (subs[i].refs > 0) {
+            esp_mqtt_client_subscribe(client, subs[i].topic, subs[i].qos);
+        }
+    }
+
+    xSemaphoreGive(sub_lock);
+}
+
 static void mqtt_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
 	esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t) event_data;
 	//esp_mqtt_client_handle_t client = event->client;
@@ -38,11 +69,19 @@ static void mqtt_event_handler(void* arg, esp_event_base_t event_base, int32_t e
             mqtt_status = MQTT_CONNECTED;
             xEventGroupSetBits(mqtt_event_group, CONNECTED_BIT);
 
+            mqtt_resubscribe();
+
+            // Start sending anything queued while disconnected
+            if (queue_task != NULL) {
+                xTaskNotifyGive(queue_task);
+            }
+
 			break;
 
 		case MQTT_EVENT_DISCONNECTED:
 			ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
-            mqtt_status = MQTT_CONNECTED;
+            mqtt_status = MQTT_DISCONNECTED;
+            xEventGroupClearBits(mqtt_event_group, CONNECTED_BIT);
 
 			break;
 
@@ -54,11 +93,24 @@ static void mqtt_event_handler(void* arg, esp_event_base_t event_base, int32_t e
 	        ESP_LOGI(TAG, "Last mbedtls failure: 0x%x", mbedtls_err);
 			break;
 
-        case MQTT_EVENT_DATA:
-            ESP_LOGI(TAG, "MQTT_EVENT_DATA");
-            printf("TOPIC=%.*s\r\n", event->topic_len, event->topic);
-            printf("DATA=%.*s\r\n", event->data_len, event->data);
+        case MQTT_EVENT_DATA: {
+            ESP_LOGD(TAG, "MQTT_EVENT_DATA");
+
+            // Messages larger than the client buffer arrive in pieces, these are not reassembled
+            if (event->current_data_offset != 0 || event->data_len != event->total_data_len) {
+                if (event->current_data_offset == 0) {
+                    ESP_LOGI(TAG, "Ignoring fragmented message on %.*s (%d bytes)", event->topic_len, event->topic, event->total_data_len);
+                }
+                break;
+            }
+
+            MqttMessageHook_t hook = message_hook;
+            if (hook == NULL || !hook(event->topic, event->topic_len, (const uint8_t*) event->data, event->data_len)) {
+                printf("TOPIC=%.*s\r\n", event->topic_len, event->topic);
+                printf("DATA=%.*s\r\n", event->data_len, event->data);
+            }
             break;
+        }
 
 		default:
 			// Unhandled
@@ -66,8 +118,6 @@ static void mqtt_event_handler(void* arg, esp_event_base_t event_base, int32_t e
 	}
 }
 
-esp_mqtt_client_handle_t client;
-
 void mqtt_connect(const char* url, const char* client_id, const char* username, const char* password, const char* server_cert,
 				const char* client_cert_pem, const char* client_key_pem) {
 
@@ -94,6 +144,196 @@ void mqtt_connect(const char* url, const char* client_id, const char* username,
     xEventGroupWaitBits(mqtt_event_group, CONNECTED_BIT, false, true, configTICK_RATE_HZ * 3);
 }
 
+// Send a queued message, skipping the queue
+static int mqtt_send(const char* topic, const uint8_t* data, uint32_t len, int qos, bool retain) {
+    if (!MQTT_MGR_connected()) {
+        return -1;
+    }
+
+    return esp_mqtt_client_publish(client, topic, (const char*) data, len, qos, retain);
+}
+
+static void mqtt_queue_task(void* arg) {
+    while (true) {
+        // Woken on connect, otherwise paces draining a backlog
+        ulTaskNotifyTake(pdTRUE, MQTT_MGR_DRAIN_INTERVAL_MS / portTICK_RATE_MS);
+
+        if (MQTT_MGR_connected()) {
+            MQTT_QUEUE_drain(mqtt_send, MQTT_MGR_DRAIN_BATCH);
+        } else {
+            MQTT_QUEUE_sync(false);
+        }
+
+        uint32_t dropped = MQTT_QUEUE_dropped();
+        if (dropped > 0) {
+            ESP_LOGI(TAG, "Dropped %d queued bytes", dropped);
+        }
+    }
+}
+
+int MQTT_MGR_init() {
+    if (sub_lock == NULL) {
+        sub_lock = xSemaphoreCreateMutex();
+    }
+    if (sub_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate subscription lock");
+        return -1;
+    }
+
+    memset(subs, 0, sizeof(subs));
+
+    // Without flash the queue still stages messages in RAM
+    if (MQTT_QUEUE_init() == -1) {
+        return -2;
+    }
+
+    if (queue_task == NULL) {
+        BaseType_t res = xTaskCreate(mqtt_queue_task, "mqtt_queue", MQTT_MGR_QUEUE_STACK_SIZE, NULL,
+                MQTT_MGR_QUEUE_PRIORITY, &queue_task);
+        if (res != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start queue task");
+            queue_task = NULL;
+            return -3;
+        }
+    }
+
+    return 0;
+}
+
+int MQTT_MGR_subscribe(char* topic, int qos) {
+    if (sub_lock == NULL || strlen(topic) >= MQTT_MGR_TOPIC_LEN) {
+        return -1;
+    }
+
+    xSemaphoreTake(sub_lock, portMAX_DELAY);
+
+    MqttSub_t* sub = NULL;
+    MqttSub_t* free_sub = NULL;
+    for (int i=0; i<MQTT_MGR_MAX_SUBS; i++) {
+        if (subs[i].refs > 0 && strcmp(subs[i].topic, topic) == 0) {
+            sub = &subs[i];
+            break;
+        }
+        if (subs[i].refs == 0 && free_sub == NULL) {
+            free_sub = &subs[i];
+        }
+    }
+
+    int res = 0;
+    bool subscribe = false;
+    if (sub != NULL) {
+        sub->refs += 1;
+    } else if (free_sub != NULL) {
+        strcpy(free_sub->topic, topic);
+        free_sub->qos = qos;
+        free_sub->refs = 1;
+        subscribe = true;
+    } else {
+        res = -2;
+    }
+
+    xSemaphoreGive(sub_lock);
+
+    // The client lock is held while events are handled (see mqtt_resubscribe), so the
+    // client is only called without the subscription lock. Otherwise subscribed on connect.
+    if (subscribe && MQTT_MGR_connected() && esp_mqtt_client_subscribe(client, topic, qos) < 0) {
+        ESP_LOGE(TAG, "Failed to subscribe to: %s", topic);
+    }
+
+    return res;
+}
+
+int MQTT_MGR_unsubscribe(char* topic) {
+    if (sub_lock == NULL) {
+        return -1;
+    }
+
+    xSemaphoreTake(sub_lock, portMAX_DELAY);
+
+    int res = -2;
+    bool unsubscribe = false;
+    for (int i=0; i<MQTT_MGR_MAX_SUBS; i++) {
+        if (subs[i].refs == 0 || strcmp(subs[i].topic, topic) != 0) {
+            continue;
+        }
+
+        subs[i].refs -= 1;
+        unsubscribe = (subs[i].refs == 0);
+
+        res = 0;
+        break;
+    }
+
+    xSemaphoreGive(sub_lock);
+
+    if (unsubscribe && MQTT_MGR_connected()) {
+        esp_mqtt_client_unsubscribe(client, topic);
+    }
+
+    return res;
+}
+
+void MQTT_MGR_set_message_hook(MqttMessageHook_t hook) {
+    message_hook = hook;
+}
+
+bool MQTT_MGR_topic_match(const char* filter, const char* topic, uint32_t topic_len) {
+    uint32_t i = 0;
+
+    while (*filter != 0) {
+        if (*filter == '#') {
+            return true;
+        }
+
+        if (*filter == '+') {
+            // Single level, up to the next separator
+            while (i < topic_len && topic[i] != '/') {
+                i++;
+            }
+            filter++;
+            continue;
+        }
+
+        if (i >= topic_len || *filter != topic[i]) {
+            // "a/#" also matches "a"
+            return i == topic_len && filter[0] == '/' && filter[1] == '#' && filter[2] == 0;
+        }
+
+        filter++;
+        i++;
+    }
+
+    return i == topic_len;
+}
+
+int MQTT_MGR_publish(char* topic, char* data, int qos) {
+    return MQTT_MGR_publish_raw(topic, (const uint8_t*) data, strlen(data), qos, false);
+}
+
+int MQTT_MGR_publish_raw(const char* topic, const uint8_t* data, uint32_t len, int qos, bool retain) {
+    // Nothing is queued until a broker has been configured
+    if (client == NULL) {
+        return -1;
+    }
+
+    // Queue behind older messages to keep them in order
+    if (mqtt_status != MQTT_CONNECTED || !MQTT_QUEUE_empty()) {
+        return MQTT_QUEUE_push(topic, data, len, qos, retain) < 0 ? -2 : 0;
+    }
+
+    int msg_id = esp_mqtt_client_publish(client, topic, (const char*) data, len, qos, retain);
+    if (msg_id < 0) {
+        ESP_LOGI(TAG, "Failed to publish to: %s, queueing", topic);
+        return MQTT_QUEUE_push(topic, data, len, qos, retain) < 0 ? -2 : 0;
+    }
+
+    return msg_id;
+}
+
+bool MQTT_MGR_connected() {
+    return client != NULL && mqtt_status == MQTT_CONNECTED;
+}
+
 static int mqtt_status_cmd(int argc, char **argv) {
     switch (mqtt_status) {
         case MQTT_CONNECTED:
@@ -103,6 +343,8 @@ static int mqtt_status_cmd(int argc, char **argv) {
             printf("MQTT disconnected\r\n");
             break;
     }
+
+    printf("Queued: %d bytes\r\n", MQTT_QUEUE_pending());
     return ESP_OK;
 }
 
@@ -187,7 +429,7 @@ static int mqtt_stop_cmd(int argc, char **argv) {
 	return ESP_OK;
 }
 
-void register_mqtt_cmds(void)
+void MQTT_MGR_register_commands()
 {
     
     const esp_console_cmd_t mqtt_status = {
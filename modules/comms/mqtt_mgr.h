@@ -2,15 +2,50 @@
 #ifndef MQTT_MGR_H
 #define MQTT_MGR_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+// Broker subscriptions, shared by matching topics and restored on reconnect
+#define MQTT_MGR_MAX_SUBS   16
+#define MQTT_MGR_TOPIC_LEN  64
+
+// Queued messages are sent in batches once connected, limiting the rate at which
+// a backlog is pushed to the broker
+#define MQTT_MGR_DRAIN_BATCH        32
+#define MQTT_MGR_DRAIN_INTERVAL_MS  100
+
+#define MQTT_MGR_QUEUE_STACK_SIZE   (4 * 1024)
+#define MQTT_MGR_QUEUE_PRIORITY     4
+
+// Called from the MQTT task with each complete incoming message, topics are not NUL terminated.
+// Returns true if the message was delivered, otherwise it is printed to the console.
+typedef bool (*MqttMessageHook_t)(const char* topic, uint32_t topic_len, const uint8_t* data, uint32_t len);
+
 // Initialise the MQTT manager
 int MQTT_MGR_init();
 
 // Publish data using the MQTT connection
 int MQTT_MGR_publish(char* topic, char* data, int qos);
 
-// Subscribe to incoming MQTT data
+// Publish binary data, returns the message id or a negative error.
+// Messages are queued (returning 0) while disconnected or while older messages are queued.
+int MQTT_MGR_publish_raw(const char* topic, const uint8_t* data, uint32_t len, int qos, bool retain);
+
+// Check whether the client is connected to a broker
+bool MQTT_MGR_connected();
+
+// Subscribe to incoming MQTT data, subscriptions are reference counted
 int MQTT_MGR_subscribe(char* topic, int qos);
 
+// Drop a reference to a subscription, unsubscribing once there are none left
+int MQTT_MGR_unsubscribe(char* topic);
+
+// Deliver incoming messages to a hook (NULL to remove)
+void MQTT_MGR_set_message_hook(MqttMessageHook_t hook);
+
+// Match a topic against a subscription filter, with + and # wildcards
+bool MQTT_MGR_topic_match(const char* filter, const char* topic, uint32_t topic_len);
+
 // Register MQTT CLI commands
 void MQTT_MGR_register_commands();
 
@@ -0,0 +1,432 @@
+#include "mqtt_queue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "rom/crc.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define TAG "MQTT_QUEUE"
+
+#define MQTT_QUEUE_MAGIC    0x514d
+
+// Record header, followed by the topic and payload
+typedef struct {
+    uint16_t    magic;
+    uint8_t     qos;
+    uint8_t     retain;
+    uint16_t    topic_len;
+    uint16_t    reserved;
+    uint32_t    data_len;
+    // Over the topic and payload, catches records torn by a reset mid-write
+    uint32_t    crc;
+} MqttRecord_t;
+
+static SemaphoreHandle_t queue_lock = NULL;
+
+// Segments on flash, numbered first to last, reads start at read_offset in the first
+static uint32_t seg_first;
+static uint32_t seg_last;
+static uint32_t seg_count;
+static uint32_t seg_last_size;
+static uint32_t read_offset;
+static FILE* read_file = NULL;
+
+// Staged messages, read from staged_head and appended at staged_len. The generation
+// changes whenever staged messages move so a drain in progress can tell.
+static uint8_t staged[MQTT_QUEUE_BUFFER_SIZE];
+static uint32_t staged_head;
+static uint32_t staged_len;
+static uint32_t staged_gen;
+static TickType_t staged_since;
+
+static uint32_t queued_bytes;
+static uint32_t dropped_bytes;
+
+// Message being sent, only used by the draining task
+static uint8_t send_buff[sizeof(MqttRecord_t) + MQTT_QUEUE_MAX_MSG];
+static char send_topic[MQTT_QUEUE_MAX_MSG + 1];
+
+
+static void queue_path(char* path, size_t len, uint32_t seg) {
+    snprintf(path, len, MQTT_QUEUE_PATH_FMT, seg);
+}
+
+static uint32_t queue_file_size(uint32_t seg) {
+    char path[32];
+    queue_path(path, sizeof(path), seg);
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+    return st.st_size;
+}
+
+// Remove the oldest segment, must be called with the lock held
+static void queue_remove_first() {
+    char path[32];
+    queue_path(path, sizeof(path), seg_first);
+
+    if (read_file != NULL) {
+        fclose(read_file);
+        read_file = NULL;
+    }
+
+    uint32_t size = queue_file_size(seg_first);
+    uint32_t unread = (size > read_offset) ? size - read_offset : 0;
+    queued_bytes = (queued_bytes > unread) ? queued_bytes - unread : 0;
+
+    remove(path);
+
+    seg_first += 1;
+    seg_count -= 1;
+    read_offset = 0;
+
+    if (seg_count == 0) {
+        seg_last_size = 0;
+    }
+}
+
+// Move staged messages to the end of the newest segment, must be called with the lock held
+static int queue_write() {
+    uint32_t len = staged_len - staged_head;
+    if (len == 0) {
+        return 0;
+    }
+
+    if (seg_count == 0 || seg_last_size + len > MQTT_QUEUE_SEGMENT_SIZE) {
+        seg_last = (seg_count == 0) ? seg_first : seg_last + 1;
+        seg_last_size = 0;
+        seg_count += 1;
+    }
+
+    // Make room by dropping the oldest messages
+    while (seg_count > MQTT_QUEUE_SEGMENTS) {
+        uint32_t before = queued_bytes;
+        queue_remove_first();
+        dropped_bytes += before - queued_bytes;
+
+        ESP_LOGI(TAG, "Queue full, dropped %d bytes", before - queued_bytes);
+    }
+
+    char path[32];
+    queue_path(path, sizeof(path), seg_last);
+
+    FILE* f = fopen(path, "ab");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return -1;
+    }
+
+    size_t written = fwrite(staged + staged_head, 1, len, f);
+    fclose(f);
+
+    seg_last_size += written;
+    if (written != len) {
+        ESP_LOGE(TAG, "Short write to %s (%d of %d bytes)", path, written, len);
+
+        // Records written whole stay here, the rest are written again to a new segment. The torn
+        // record left behind is skipped when read back, and counted until then.
+        uint32_t whole = 0;
+        while (whole + sizeof(MqttRecord_t) <= written) {
+            MqttRecord_t r;
+            memcpy(&r, staged + staged_head + whole, sizeof(r));
+
+            uint32_t size = sizeof(r) + r.topic_len + r.data_len;
+            if (whole + size > written) {
+                break;
+            }
+            whole += size;
+        }
+
+        staged_head += whole;
+        staged_gen += 1;
+        queued_bytes += written - whole;
+        seg_last_size = MQTT_QUEUE_SEGMENT_SIZE;
+
+        return -2;
+    }
+
+    staged_head = 0;
+    staged_len = 0;
+    staged_gen += 1;
+
+    return 0;
+}
+
+int MQTT_QUEUE_init() {
+    if (queue_lock == NULL) {
+        queue_lock = xSemaphoreCreateMutex();
+    }
+    if (queue_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate queue lock");
+        return -1;
+    }
+
+    // Pick up segments left from before a reset
+    DIR* dir = opendir(MQTT_QUEUE_DIR);
+    if (dir == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", MQTT_QUEUE_DIR);
+        return -2;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        uint32_t seg;
+        char ext;
+        if (sscanf(entry->d_name, "mq%08x.%c", &seg, &ext) != 2 || ext != 'q') {
+            continue;
+        }
+
+        if (seg_count == 0 || seg < seg_first) {
+            seg_first = seg;
+        }
+        if (seg_count == 0 || seg > seg_last) {
+            seg_last = seg;
+        }
+        seg_count += 1;
+    }
+
+    closedir(dir);
+
+    if (seg_count > 0) {
+        // Any gaps are skipped when read
+        seg_count = seg_last - seg_first + 1;
+        seg_last_size = queue_file_size(seg_last);
+
+        for (uint32_t seg=seg_first; seg<=seg_last; seg++) {
+            queued_bytes += queue_file_size(seg);
+        }
+
+        ESP_LOGI(TAG, "Found %d queued bytes in %d segments", queued_bytes, seg_count);
+    }
+
+    return 0;
+}
+
+int MQTT_QUEUE_push(const char* topic, const uint8_t* data, uint32_t len, int qos, bool retain) {
+    uint32_t topic_len = strlen(topic);
+    if (queue_lock == NULL || topic_len + len > MQTT_QUEUE_MAX_MSG) {
+        return -1;
+    }
+
+    MqttRecord_t r = {
+        .magic = MQTT_QUEUE_MAGIC,
+        .qos = qos,
+        .retain = retain,
+        .topic_len = topic_len,
+        .data_len = len,
+    };
+    r.crc = crc32_le(0, (const uint8_t*) topic, topic_len);
+    r.crc = crc32_le(r.crc, data, len);
+
+    uint32_t size = sizeof(r) + topic_len + len;
+
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+
+    int res = 0;
+    if (staged_len + size > MQTT_QUEUE_BUFFER_SIZE) {
+        res = queue_write();
+    }
+
+    if (res == 0) {
+        if (staged_head == staged_len) {
+            staged_since = xTaskGetTickCount();
+        }
+
+        memcpy(staged + staged_len, &r, sizeof(r));
+        memcpy(staged + staged_len + sizeof(r), topic, topic_len);
+        memcpy(staged + staged_len + sizeof(r) + topic_len, data, len);
+        staged_len += size;
+
+        queued_bytes += size;
+    }
+
+    xSemaphoreGive(queue_lock);
+
+    return res;
+}
+
+// Check a record, returns its size or 0 if it is incomplete or invalid
+static uint32_t queue_check(const uint8_t* buff, uint32_t available) {
+    MqttRecord_t r;
+    if (available < sizeof(r)) {
+        return 0;
+    }
+    memcpy(&r, buff, sizeof(r));
+
+    uint32_t len = r.topic_len + r.data_len;
+    if (r.magic != MQTT_QUEUE_MAGIC || len > MQTT_QUEUE_MAX_MSG || sizeof(r) + len > available) {
+        return 0;
+    }
+
+    if (crc32_le(0, buff + sizeof(r), len) != r.crc) {
+        return 0;
+    }
+
+    return sizeof(r) + len;
+}
+
+// Find where the next record may start after an invalid one, the first magic past its start.
+// Without one everything read is skipped but a byte, which may start a magic split by the read.
+static uint32_t queue_resync(const uint8_t* buff, uint32_t available) {
+    const uint16_t magic = MQTT_QUEUE_MAGIC;
+
+    for (uint32_t i=1; i + sizeof(magic) <= available; i++) {
+        if (memcmp(buff + i, &magic, sizeof(magic)) == 0) {
+            return i;
+        }
+    }
+
+    return (available > 1) ? available - 1 : 1;
+}
+
+// Fetch the oldest message into the send buffer, must be called with the lock held.
+// Returns the record size, 0 if the queue is empty.
+static uint32_t queue_next(bool* from_flash, uint32_t* pos) {
+    while (seg_count > 0) {
+        if (read_file == NULL) {
+            char path[32];
+            queue_path(path, sizeof(path), seg_first);
+            read_file = fopen(path, "rb");
+        }
+
+        size_t n = 0;
+        if (read_file != NULL && fseek(read_file, read_offset, SEEK_SET) == 0) {
+            n = fread(send_buff, 1, sizeof(send_buff), read_file);
+        }
+
+        uint32_t size = queue_check(send_buff, n);
+        if (size > 0) {
+            *from_flash = true;
+            *pos = read_offset;
+            return size;
+        }
+
+        if (n == 0) {
+            // End of the segment
+            queue_remove_first();
+            continue;
+        }
+
+        // A torn or corrupt record only costs itself, the records after it are still read
+        uint32_t skip = queue_resync(send_buff, n);
+        ESP_LOGI(TAG, "Skipping %d invalid bytes in segment %d at %d", skip, seg_first, read_offset);
+
+        read_offset += skip;
+        queued_bytes = (queued_bytes > skip) ? queued_bytes - skip : 0;
+    }
+
+    if (staged_head < staged_len) {
+        uint32_t size = queue_check(staged + staged_head, staged_len - staged_head);
+        memcpy(send_buff, staged + staged_head, size);
+
+        *from_flash = false;
+        *pos = staged_head;
+        return size;
+    }
+
+    return 0;
+}
+
+int MQTT_QUEUE_drain(MqttQueueSend_t send, uint32_t max) {
+    if (queue_lock == NULL) {
+        return -1;
+    }
+
+    uint32_t sent = 0;
+
+    while (sent < max) {
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+
+        bool from_flash;
+        uint32_t pos;
+        uint32_t size = queue_next(&from_flash, &pos);
+        uint32_t seg = seg_first;
+        uint32_t gen = staged_gen;
+
+        xSemaphoreGive(queue_lock);
+
+        if (size == 0) {
+            break;
+        }
+
+        // Sent without the lock so publishers are not held up by the network
+        MqttRecord_t r;
+        memcpy(&r, send_buff, sizeof(r));
+
+        memcpy(send_topic, send_buff + sizeof(r), r.topic_len);
+        send_topic[r.topic_len] = 0;
+
+        int res = send(send_topic, send_buff + sizeof(r) + r.topic_len, r.data_len, r.qos, r.retain);
+
+        if (res < 0) {
+            break;
+        }
+
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+
+        // Only consume the message if it has not moved while it was sent
+        if (from_flash && seg_count > 0 && seg_first == seg && read_offset == pos) {
+            read_offset += size;
+            queued_bytes -= size;
+        } else if (!from_flash && staged_gen == gen && staged_head == pos) {
+            staged_head += size;
+            queued_bytes -= size;
+            if (staged_head == staged_len) {
+                staged_head = 0;
+                staged_len = 0;
+                staged_gen += 1;
+            }
+        }
+
+        xSemaphoreGive(queue_lock);
+
+        sent += 1;
+    }
+
+    return sent;
+}
+
+int MQTT_QUEUE_sync(bool force) {
+    if (queue_lock == NULL) {
+        return -1;
+    }
+
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+
+    int res = 0;
+    TickType_t age = xTaskGetTickCount() - staged_since;
+    if (staged_head < staged_len && (force || age >= MQTT_QUEUE_SYNC_MS / portTICK_RATE_MS)) {
+        res = queue_write();
+    }
+
+    xSemaphoreGive(queue_lock);
+
+    return res;
+}
+
+bool MQTT_QUEUE_empty() {
+    return seg_count == 0 && staged_head == staged_len;
+}
+
+uint32_t MQTT_QUEUE_pending() {
+    return queued_bytes;
+}
+
+uint32_t MQTT_QUEUE_dropped() {
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    uint32_t dropped = dropped_bytes;
+    dropped_bytes = 0;
+    xSemaphoreGive(queue_lock);
+
+    return dropped;
+}
+
@@ -0,0 +1,48 @@
+#ifndef MQTT_QUEUE_H
+#define MQTT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Queued messages are appended to numbered segment files, the oldest segment is
+// dropped once the limit is reached so flash use (and wear) is bounded
+#define MQTT_QUEUE_PATH_FMT     "/spiffs/mq%08x.q"
+#define MQTT_QUEUE_DIR          "/spiffs"
+#define MQTT_QUEUE_SEGMENT_SIZE (16 * 1024)
+#define MQTT_QUEUE_SEGMENTS     8
+
+// Messages are staged in RAM and written to flash a buffer at a time, or once the
+// oldest staged message is this old
+#define MQTT_QUEUE_BUFFER_SIZE  4096
+#define MQTT_QUEUE_SYNC_MS      10000
+
+// Largest queued topic and payload, producers check they fit (the largest is the
+// telemetry name table)
+#define MQTT_QUEUE_MAX_MSG      2560
+
+// Send a queued message, returns a negative error to stop draining
+typedef int (*MqttQueueSend_t)(const char* topic, const uint8_t* data, uint32_t len, int qos, bool retain);
+
+// Initialise the queue, picking up any segments left on flash
+int MQTT_QUEUE_init();
+
+// Append a message to the queue
+int MQTT_QUEUE_push(const char* topic, const uint8_t* data, uint32_t len, int qos, bool retain);
+
+// Send up to max messages, oldest first, returns the number sent. Messages are removed
+// once sent, a message may be sent again if the device resets while draining.
+int MQTT_QUEUE_drain(MqttQueueSend_t send, uint32_t max);
+
+// Write staged messages to flash if they are due (or force)
+int MQTT_QUEUE_sync(bool force);
+
+bool MQTT_QUEUE_empty();
+
+// Bytes queued in RAM and on flash
+uint32_t MQTT_QUEUE_pending();
+
+// Bytes of queued messages lost to the queue limit since the last call
+uint32_t MQTT_QUEUE_dropped();
+
+#endif
+
@@ -0,0 +1,313 @@
+#include "telemetry_mgr.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "mqtt_mgr.h"
+#include "mqtt_queue.h"
+
+#define TAG "TELEMETRY"
+
+#define TELEMETRY_MGR_DATA_TOPIC    TELEMETRY_MGR_TOPIC "/%s/data"
+#define TELEMETRY_MGR_NAMES_TOPIC   TELEMETRY_MGR_TOPIC "/%s/names"
+
+// Largest encoding of a single sample (id, dt, value)
+#define TELEMETRY_SAMPLE_MAX        (3 + 9 + 9)
+
+// Largest name table, a map header then an id and string per name
+#define TELEMETRY_NAMES_FRAME_MAX   (3 + TELEMETRY_MGR_MAX_NAMES * (3 + 2 + TELEMETRY_MGR_NAME_LEN))
+
+// Frames are queued while the broker is unreachable, so must fit a queue message
+#if TELEMETRY_MGR_FRAME_MAX + TELEMETRY_MGR_TOPIC_LEN > MQTT_QUEUE_MAX_MSG || TELEMETRY_NAMES_FRAME_MAX + TELEMETRY_MGR_TOPIC_LEN > MQTT_QUEUE_MAX_MSG
+#error "Telemetry frames must fit in MQTT_QUEUE_MAX_MSG"
+#endif
+
+// Producers (applet tasks on either core) copy samples in under the spinlock, the
+// uplink task is the only consumer and only advances the tail once a frame is sent,
+// so samples stay buffered until the MQTT manager accepts (or queues) a frame.
+static TelemetrySample_t samples[TELEMETRY_MGR_BUFFER_LEN];
+static uint32_t sample_head;
+static uint32_t sample_tail;
+static uint32_t sample_dropped;
+static portMUX_TYPE sample_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Names are registered once and never removed, so ids stay valid across applet runs
+static char names[TELEMETRY_MGR_MAX_NAMES][TELEMETRY_MGR_NAME_LEN];
+static uint32_t name_count;
+static bool names_changed;
+static SemaphoreHandle_t name_lock = NULL;
+
+static TaskHandle_t telemetry_task_handle = NULL;
+
+// Topics carry the node so devices sharing a broker can be told apart
+static char data_topic[TELEMETRY_MGR_TOPIC_LEN];
+static char names_topic[TELEMETRY_MGR_TOPIC_LEN];
+
+static uint8_t frame[TELEMETRY_MGR_FRAME_MAX];
+static uint8_t name_frame[TELEMETRY_NAMES_FRAME_MAX];
+
+
+// CBOR item header, major type and argument in the shortest form
+static uint32_t cbor_head(uint8_t* p, uint8_t major, uint64_t v) {
+    major <<= 5;
+
+    if (v < 24) {
+        p[0] = major | v;
+        return 1;
+    }
+
+    uint32_t n = (v <= 0xff) ? 1 : (v <= 0xffff) ? 2 : (v <= 0xffffffff) ? 4 : 8;
+    p[0] = major | ((n == 1) ? 24 : (n == 2) ? 25 : (n == 4) ? 26 : 27);
+
+    for (uint32_t i=0; i<n; i++) {
+        p[n - i] = v >> (i * 8);
+    }
+
+    return n + 1;
+}
+
+static uint32_t cbor_int(uint8_t* p, int64_t v) {
+    if (v < 0) {
+        return cbor_head(p, 1, (uint64_t) (-1 - v));
+    }
+    return cbor_head(p, 0, v);
+}
+
+// Floats are sent as single precision where that is lossless
+static uint32_t cbor_float(uint8_t* p, double v) {
+    float f = (float) v;
+
+    if ((double) f == v) {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        p[0] = 0xfa;
+        for (uint32_t i=0; i<4; i++) {
+            p[4 - i] = bits >> (i * 8);
+        }
+        return 5;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    p[0] = 0xfb;
+    for (uint32_t i=0; i<8; i++) {
+        p[8 - i] = bits >> (i * 8);
+    }
+    return 9;
+}
+
+// Encode pending samples into a frame without consuming them, returns the number encoded
+static uint32_t telemetry_encode(uint32_t* len) {
+    uint32_t tail = sample_tail;
+    uint32_t head = __atomic_load_n(&sample_head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return 0;
+    }
+
+    uint32_t n = 0;
+    int64_t prev = samples[tail & (TELEMETRY_MGR_BUFFER_LEN - 1)].time_us;
+
+    uint8_t* p = frame;
+    *p++ = 0x9f;
+    p += cbor_int(p, prev);
+
+    while (tail + n != head && (p - frame) + TELEMETRY_SAMPLE_MAX + 1 <= TELEMETRY_MGR_FRAME_MAX) {
+        const TelemetrySample_t* s = &samples[(tail + n) & (TELEMETRY_MGR_BUFFER_LEN - 1)];
+
+        p += cbor_head(p, 0, s->id);
+        p += cbor_int(p, (int64_t) ((uint64_t) s->time_us - (uint64_t) prev));
+        if (s->type == TELEMETRY_TYPE_FLOAT) {
+            p += cbor_float(p, s->value.f);
+        } else {
+            p += cbor_int(p, s->value.i);
+        }
+
+        prev = s->time_us;
+        n += 1;
+    }
+
+    *p++ = 0xff;
+    *len = p - frame;
+
+    return n;
+}
+
+static int telemetry_publish_names() {
+    xSemaphoreTake(name_lock, portMAX_DELAY);
+
+    uint8_t* p = name_frame;
+    p += cbor_head(p, 5, name_count);
+
+    for (uint32_t i=0; i<name_count; i++) {
+        uint32_t len = strlen(names[i]);
+        p += cbor_head(p, 0, i);
+        p += cbor_head(p, 3, len);
+        memcpy(p, names[i], len);
+        p += len;
+    }
+
+    names_changed = false;
+
+    xSemaphoreGive(name_lock);
+
+    int res = MQTT_MGR_publish_raw(names_topic, name_frame, p - name_frame, 1, true);
+    if (res < 0) {
+        names_changed = true;
+    }
+
+    return res;
+}
+
+// Send one frame, returns the number of samples sent or a negative error
+static int telemetry_flush() {
+    // Names go first so the receiver can map every id in the frame
+    if (names_changed && telemetry_publish_names() < 0) {
+        return -1;
+    }
+
+    uint32_t len = 0;
+    uint32_t n = telemetry_encode(&len);
+    if (n == 0) {
+        return 0;
+    }
+
+    if (MQTT_MGR_publish_raw(data_topic, frame, len, 0, false) < 0) {
+        return -2;
+    }
+
+    __atomic_store_n(&sample_tail, sample_tail + n, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+static void telemetry_task(void* arg) {
+    while (true) {
+        // Woken early once enough samples are pending
+        ulTaskNotifyTake(pdTRUE, TELEMETRY_MGR_FLUSH_MS / portTICK_RATE_MS);
+
+        // Frames are queued by the MQTT manager while disconnected
+        while (telemetry_flush() > 0) {}
+
+        uint32_t dropped = TELEMETRY_MGR_dropped();
+        if (dropped > 0) {
+            ESP_LOGI(TAG, "Dropped %d samples", dropped);
+        }
+    }
+}
+
+int TELEMETRY_MGR_init() {
+    if (name_lock == NULL) {
+        name_lock = xSemaphoreCreateMutex();
+    }
+    if (name_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create name lock");
+        return -1;
+    }
+
+    uint8_t mac[6];
+    if (esp_read_mac(mac, ESP_MAC_WIFI_STA) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read MAC address");
+        return -3;
+    }
+
+    char node[13];
+    snprintf(node, sizeof(node), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    snprintf(data_topic, sizeof(data_topic), TELEMETRY_MGR_DATA_TOPIC, node);
+    snprintf(names_topic, sizeof(names_topic), TELEMETRY_MGR_NAMES_TOPIC, node);
+
+    if (telemetry_task_handle == NULL) {
+        BaseType_t res = xTaskCreate(telemetry_task, "telemetry", TELEMETRY_MGR_STACK_SIZE, NULL,
+                TELEMETRY_MGR_PRIORITY, &telemetry_task_handle);
+        if (res != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start uplink task");
+            telemetry_task_handle = NULL;
+            return -2;
+        }
+    }
+
+    return 0;
+}
+
+int TELEMETRY_MGR_register(const char* name, uint32_t len) {
+    if (name_lock == NULL) {
+        return -1;
+    }
+
+    if (len == 0 || len >= TELEMETRY_MGR_NAME_LEN || memchr(name, 0, len) != NULL) {
+        return -2;
+    }
+
+    xSemaphoreTake(name_lock, portMAX_DELAY);
+
+    int id = -3;
+    for (uint32_t i=0; i<name_count; i++) {
+        if (strncmp(names[i], name, len) == 0 && names[i][len] == 0) {
+            id = i;
+            break;
+        }
+    }
+
+    if (id < 0 && name_count < TELEMETRY_MGR_MAX_NAMES) {
+        id = name_count;
+        memcpy(names[id], name, len);
+        names[id][len] = 0;
+
+        name_count += 1;
+        names_changed = true;
+    }
+
+    xSemaphoreGive(name_lock);
+
+    return id;
+}
+
+int TELEMETRY_MGR_write(const TelemetrySample_t* sample) {
+    return (TELEMETRY_MGR_write_batch(sample, 1) == 1) ? 0 : -1;
+}
+
+int TELEMETRY_MGR_write_batch(const TelemetrySample_t* in, uint32_t count) {
+    portENTER_CRITICAL(&sample_mux);
+
+    uint32_t head = sample_head;
+    uint32_t pending = head - __atomic_load_n(&sample_tail, __ATOMIC_ACQUIRE);
+
+    uint32_t n = TELEMETRY_MGR_BUFFER_LEN - pending;
+    if (count < n) {
+        n = count;
+    }
+
+    for (uint32_t i=0; i<n; i++) {
+        samples[(head + i) & (TELEMETRY_MGR_BUFFER_LEN - 1)] = in[i];
+    }
+
+    __atomic_store_n(&sample_head, head + n, __ATOMIC_RELEASE);
+    sample_dropped += count - n;
+
+    portEXIT_CRITICAL(&sample_mux);
+
+    // Wake the uplink once when the flush threshold is crossed
+    if (pending < TELEMETRY_MGR_FLUSH_SAMPLES && pending + n >= TELEMETRY_MGR_FLUSH_SAMPLES
+            && telemetry_task_handle != NULL) {
+        xTaskNotifyGive(telemetry_task_handle);
+    }
+
+    return n;
+}
+
+uint32_t TELEMETRY_MGR_dropped() {
+    portENTER_CRITICAL(&sample_mux);
+    uint32_t dropped = sample_dropped;
+    sample_dropped = 0;
+    portEXIT_CRITICAL(&sample_mux);
+
+    return dropped;
+}
+
@@ -0,0 +1,64 @@
+#ifndef TELEMETRY_MGR_H
+#define TELEMETRY_MGR_H
+
+#include <stdint.h>
+
+// Samples buffered between uplinks, must be a power of two
+#define TELEMETRY_MGR_BUFFER_LEN    512
+
+// Named values, ids are indices into this table
+#define TELEMETRY_MGR_MAX_NAMES     64
+#define TELEMETRY_MGR_NAME_LEN      32
+
+// Largest encoded frame, and the pending samples that trigger an early flush
+#define TELEMETRY_MGR_FRAME_MAX     1024
+#define TELEMETRY_MGR_FLUSH_SAMPLES 128
+
+// Maximum time a sample waits before being sent
+#define TELEMETRY_MGR_FLUSH_MS      1000
+
+#define TELEMETRY_MGR_STACK_SIZE    (4 * 1024)
+#define TELEMETRY_MGR_PRIORITY      4
+
+// Frames are published to <topic>/<node>/data, and the id to name table (retained) to
+// <topic>/<node>/names, where node is the station MAC address as 12 lowercase hex digits
+//
+//   data:  CBOR indefinite array [ base_time_us, id, dt_us, value, id, dt_us, value, ... ]
+//          where each dt_us is relative to the previous sample (or base_time_us)
+//   names: CBOR map { id: name, ... }
+#define TELEMETRY_MGR_TOPIC         "telemetry"
+
+// Longest topic published, including the terminator
+#define TELEMETRY_MGR_TOPIC_LEN     64
+
+// Sample value types
+#define TELEMETRY_TYPE_INT          0
+#define TELEMETRY_TYPE_FLOAT        1
+
+typedef struct {
+    int64_t     time_us;
+    union {
+        int64_t i;
+        double  f;
+    } value;
+    uint16_t    id;
+    uint8_t     type;
+} TelemetrySample_t;
+
+// Initialise the sample buffer and start the uplink task
+int TELEMETRY_MGR_init();
+
+// Fetch the id for a name, registering it if required
+int TELEMETRY_MGR_register(const char* name, uint32_t len);
+
+// Queue a sample, returns a negative error if the buffer is full
+int TELEMETRY_MGR_write(const TelemetrySample_t* sample);
+
+// Queue a set of samples, returns the number queued
+int TELEMETRY_MGR_write_batch(const TelemetrySample_t* samples, uint32_t count);
+
+// Samples lost to a full buffer since the last call
+uint32_t TELEMETRY_MGR_dropped();
+
+#endif
+
@@ -110,6 +110,25 @@ static int cfg_list_cmd(int argc, char **argv) {
     return 0;
 }
 
+static int cfg_begin_cmd(int argc, char **argv) {
+    CONFIG_MGR_begin();
+
+    printf("Started config batch, changes are committed on cfg-done\n");
+
+    return 0;
+}
+
+static int cfg_done_cmd(int argc, char **argv) {
+    int res = CONFIG_MGR_done();
+    if (res != ESP_OK) {
+        return 1;
+    }
+
+    printf("Committed config batch\n");
+
+    return 0;
+}
+
 
 void CONFIG_MGR_register_commands() {
     cfg_set_args.key = arg_str1(NULL, NULL, "<key>", "Configuration key");
@@ -160,9 +179,27 @@ void CONFIG_MGR_register_commands() {
         .argtable = &cfg_list_args,
     };
 
+    const esp_console_cmd_t cfg_begin = {
+        .command = "cfg-begin",
+        .help = "Start a batch of configuration changes",
+        .hint = NULL,
+        .func = &cfg_begin_cmd,
+        .argtable = NULL,
+    };
+
+    const esp_console_cmd_t cfg_done = {
+        .command = "cfg-done",
+        .help = "Commit a batch of configuration changes",
+        .hint = NULL,
+        .func = &cfg_done_cmd,
+        .argtable = NULL,
+    };
+
     ESP_ERROR_CHECK( esp_console_cmd_register(&cfg_set));
     ESP_ERROR_CHECK( esp_console_cmd_register(&cfg_get));
     ESP_ERROR_CHECK( esp_console_cmd_register(&cfg_clear));
     ESP_ERROR_CHECK( esp_console_cmd_register(&cfg_list));
+    ESP_ERROR_CHECK( esp_console_cmd_register(&cfg_begin));
+    ESP_ERROR_CHECK( esp_console_cmd_register(&cfg_done));
 }
 
@@ -1,33 +1,226 @@
 
 #include "config_mgr.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 
 
 #include "esp_log.h"
 #include "nvs_flash.h"
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
 
 #define TAG "CFG_MGR"
 
 
 ESP_EVENT_DEFINE_BASE(CONFIG_MGR_EVENT_BASE);
 
+// Cached configuration value, an empty key marks an unused slot
+typedef struct {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    char* val;      // NULL once cleared, until the clear is committed
+    bool dirty;     // Changed since the last commit
+} config_entry_t;
+
 
 static nvs_handle_t handle = 0;
 
-static void config_mgr_event_handler(void *arg, esp_event_base_t event_base,
-        int32_t event_id, void *event_data) {
+// Open addressed (linear probing) cache of every stored value, reads never touch
+// NVS and writes are held here until the outermost batch is done
+static config_entry_t entries[CONFIG_MGR_TABLE_SIZE];
+static uint32_t entry_count;
+static uint32_t batch_depth;
+static SemaphoreHandle_t config_lock = NULL;
 
-    // TODO: handle config set events
+// Batch of CONFIG_MGR_EVENT_SET events, only touched from the event loop task
+static bool event_batch;
 
 
+// FNV-1a, keys are short so this is cheaper than comparing against every entry
+static uint32_t config_hash(const char* key) {
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h = (h ^ (uint8_t) *key++) * 16777619u;
+    }
+    return h & (CONFIG_MGR_TABLE_SIZE - 1);
+}
 
+// Find a key, or the slot it would occupy if insert is set. Must be called with the lock held.
+static config_entry_t* config_find(const char* key, bool insert) {
+    uint32_t i = config_hash(key);
+
+    while (entries[i].key[0] != 0) {
+        if (strcmp(entries[i].key, key) == 0) {
+            return &entries[i];
+        }
+        i = (i + 1) & (CONFIG_MGR_TABLE_SIZE - 1);
+    }
+
+    if (!insert || entry_count >= CONFIG_MGR_MAX_KEYS) {
+        return NULL;
+    }
+
+    strcpy(entries[i].key, key);
+    entries[i].val = NULL;
+    entries[i].dirty = false;
+    entry_count += 1;
+
+    return &entries[i];
+}
+
+// Remove a slot, shifting back any later entries in the same probe run so lookups still find them
+static void config_remove(uint32_t i) {
+    free(entries[i].val);
+
+    uint32_t j = i;
+    while (true) {
+        j = (j + 1) & (CONFIG_MGR_TABLE_SIZE - 1);
+        if (entries[j].key[0] == 0) {
+            break;
+        }
+
+        // Entries whose home slot lies (cyclically) between the gap and themselves stay put
+        uint32_t k = config_hash(entries[j].key);
+        if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) {
+            continue;
+        }
+
+        entries[i] = entries[j];
+        i = j;
+    }
+
+    memset(&entries[i], 0, sizeof(config_entry_t));
+    entry_count -= 1;
+}
+
+static int config_check_key(const char* key) {
+    size_t len = strlen(key);
+    if (len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    return ESP_OK;
+}
+
+// Update the cache, must be called with the lock held and a batch open
+static int config_update(const char* key, const char* val) {
+    config_entry_t* e = config_find(key, val != NULL);
+    if (e == NULL) {
+        return (val != NULL) ? ESP_ERR_NO_MEM : ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    if (val == NULL) {
+        if (e->val == NULL) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        free(e->val);
+        e->val = NULL;
+        e->dirty = true;
+        return ESP_OK;
+    }
+
+    // Rewriting the same value costs nothing
+    if (e->val != NULL && strcmp(e->val, val) == 0) {
+        return ESP_OK;
+    }
+
+    char* v = strdup(val);
+    if (v == NULL) {
+        // Drop a slot that was only just claimed
+        if (e->val == NULL && !e->dirty) {
+            config_remove(e - entries);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+
+    free(e->val);
+    e->val = v;
+    e->dirty = true;
+
+    return ESP_OK;
+}
+
+// Load stored values into the cache
+static int config_load() {
+    nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, CONFIG_MGR_PARTITION, NVS_TYPE_STR);
+
+    while (it != NULL) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        it = nvs_entry_next(it);
+
+        size_t len = 0;
+        if (nvs_get_str(handle, info.key, NULL, &len) != ESP_OK) {
+            continue;
+        }
+
+        char* val = malloc(len);
+        if (val == NULL || nvs_get_str(handle, info.key, val, &len) != ESP_OK) {
+            free(val);
+            continue;
+        }
+
+        config_entry_t* e = config_find(info.key, true);
+        if (e == NULL) {
+            ESP_LOGE(TAG, "Config cache full, ignoring key '%s'", info.key);
+            free(val);
+            continue;
+        }
+
+        e->val = val;
+    }
+
+    return entry_count;
+}
+
+static void config_mgr_event_handler(void *arg, esp_event_base_t event_base,
+        int32_t event_id, void *event_data) {
+
+    switch (event_id) {
+        case CONFIG_MGR_EVENT_SET: {
+            config_manager_update_t update;
+            memcpy(&update, event_data, sizeof(update));
+            update.key[CONFIG_MGR_MAX_KEY - 1] = 0;
+            update.val[CONFIG_MGR_MAX_VAL - 1] = 0;
+
+            // Updates are held until the sender is done
+            if (!event_batch && CONFIG_MGR_begin() == ESP_OK) {
+                event_batch = true;
+            }
+
+            CONFIG_MGR_set(update.key, update.val);
+            break;
+        }
+
+        case CONFIG_MGR_EVENT_DONE:
+            if (event_batch) {
+                event_batch = false;
+                CONFIG_MGR_done();
+            }
+            break;
+
+        default:
+            break;
+    }
 }
 
 // Initialise config manager
 int CONFIG_MGR_init() {
     ESP_LOGI(TAG, "Initialising configuration manager");
+
+    if (config_lock == NULL) {
+        config_lock = xSemaphoreCreateMutex();
+    }
+    if (config_lock == NULL) {
+        ESP_LOGE(TAG, "Error allocating config lock");
+        return ESP_ERR_NO_MEM;
+    }
     
     // Open NVS
     int res = nvs_open(CONFIG_MGR_PARTITION, NVS_READWRITE, &handle);
@@ -36,90 +229,200 @@ int CONFIG_MGR_init() {
         return res;
     }
 
+    int count = config_load();
+    ESP_LOGI(TAG, "Loaded %d configuration values", count);
+
     // Register event handler
     ESP_ERROR_CHECK(esp_event_handler_register(CONFIG_MGR_EVENT_BASE, ESP_EVENT_ANY_ID, &config_mgr_event_handler, NULL));
 
     return ESP_OK;
 }
 
+int CONFIG_MGR_begin() {
+    if (config_lock == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    batch_depth += 1;
+    xSemaphoreGive(config_lock);
+
+    return ESP_OK;
+}
+
 // Set a configuration value
 int CONFIG_MGR_set(const char* key, const char* val) {
-    // Set string in store
-    int res = nvs_set_str(handle, key, val);
+    int res = config_check_key(key);
     if (res != ESP_OK) {
-        ESP_LOGE(TAG, "Error setting config: %d", res);
         return res;
     }
+    if (strlen(val) >= CONFIG_MGR_MAX_VAL) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
 
-    // Emit update event for consuming modules
-    config_manager_update_t update = { 0 };
-    strncpy(update.key, key, CONFIG_MGR_MAX_KEY);
-    strncpy(update.val, val, CONFIG_MGR_MAX_VAL);
-    esp_event_post(CONFIG_MGR_EVENT_BASE, CONFIG_MGR_EVENT_CHANGED, &update, sizeof(update),  100 * portTICK_PERIOD_MS);
-
-    // Commit changes
-    res = nvs_commit(handle);
+    // Outside a batch each set is committed on its own
+    res = CONFIG_MGR_begin();
     if (res != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing config to NVS: %d", res);
         return res;
     }
 
-    return ESP_OK;
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    res = config_update(key, val);
+    xSemaphoreGive(config_lock);
+
+    if (res != ESP_OK) {
+        ESP_LOGE(TAG, "Error setting config: %d", res);
+    }
+
+    int done = CONFIG_MGR_done();
+
+    return (res != ESP_OK) ? res : done;
 }
 
 // Clear a configuration value
 int CONFIG_MGR_clear(const char* key) {
-    int res = nvs_erase_key(handle, key);
+    int res = config_check_key(key);
     if (res != ESP_OK) {
-        ESP_LOGE(TAG, "Error erasing config: %d", res);
         return res;
     }
 
-    // Emit update event for consuming modules
-    config_manager_update_t update = { 0 };
-    strncpy(update.key, key, CONFIG_MGR_MAX_KEY);
-    esp_event_post(CONFIG_MGR_EVENT_BASE, CONFIG_MGR_EVENT_CHANGED, &update, sizeof(update),  100 * portTICK_PERIOD_MS);
+    res = CONFIG_MGR_begin();
+    if (res != ESP_OK) {
+        return res;
+    }
 
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    res = config_update(key, NULL);
+    xSemaphoreGive(config_lock);
 
-    // Commit changes
-    res = nvs_commit(handle);
     if (res != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing config to NVS: %d", res);
-        return res;
+        ESP_LOGE(TAG, "Error erasing config: %d", res);
     }
 
-    return ESP_OK;
+    int done = CONFIG_MGR_done();
+
+    return (res != ESP_OK) ? res : done;
 }
 
 int CONFIG_MGR_done() {
+    if (config_lock == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
 
-    // Post done event
-    esp_event_post(CONFIG_MGR_EVENT_BASE, CONFIG_MGR_EVENT_DONE, NULL, 0,  100 * portTICK_PERIOD_MS);
+    config_manager_changes_t changes = { 0 };
+    int res = ESP_OK;
 
-    return ESP_OK;
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+
+    if (batch_depth > 0) {
+        batch_depth -= 1;
+    }
+    if (batch_depth > 0) {
+        goto done_unlock;
+    }
+
+    // Write out every change, anything that fails stays dirty for the next commit
+    for (uint32_t i=0; i<CONFIG_MGR_TABLE_SIZE; i++) {
+        config_entry_t* e = &entries[i];
+        if (e->key[0] == 0 || !e->dirty) {
+            continue;
+        }
+
+        if (e->val != NULL) {
+            res = nvs_set_str(handle, e->key, e->val);
+        } else {
+            res = nvs_erase_key(handle, e->key);
+            if (res == ESP_ERR_NVS_NOT_FOUND) {
+                res = ESP_OK;
+            }
+        }
+
+        if (res != ESP_OK) {
+            ESP_LOGE(TAG, "Error writing config '%s': %d", e->key, res);
+            break;
+        }
+
+        e->dirty = false;
+
+        if (changes.count < CONFIG_MGR_MAX_CHANGES) {
+            strcpy(changes.keys[changes.count], e->key);
+        }
+        changes.count += 1;
+    }
+
+    if (changes.count == 0) {
+        goto done_unlock;
+    }
+
+    // Commit changes
+    int commit = nvs_commit(handle);
+    if (commit != ESP_OK) {
+        ESP_LOGE(TAG, "Error committing config to NVS: %d", commit);
+        res = commit;
+    }
+
+    // Committed clears no longer need a slot, re-checking each index as entries shift back
+    for (uint32_t i=0; i<CONFIG_MGR_TABLE_SIZE; i++) {
+        while (entries[i].key[0] != 0 && entries[i].val == NULL && !entries[i].dirty) {
+            config_remove(i);
+        }
+    }
+
+done_unlock:
+    xSemaphoreGive(config_lock);
+
+    // Emit a single update event for consuming modules
+    if (changes.count > 0) {
+        esp_event_post(CONFIG_MGR_EVENT_BASE, CONFIG_MGR_EVENT_CHANGED, &changes, sizeof(changes),  100 * portTICK_PERIOD_MS);
+    }
+
+    return res;
 }
 
 // Fetch a configuration value
 int CONFIG_MGR_get(const char* key, char* val, size_t val_len) {
-    return nvs_get_str(handle, key, val, &val_len);
+    if (config_lock == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+
+    int res = ESP_OK;
+
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+
+    config_entry_t* e = config_find(key, false);
+    if (e == NULL || e->val == NULL) {
+        res = ESP_ERR_NVS_NOT_FOUND;
+    } else if (strlen(e->val) + 1 > val_len) {
+        res = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        strcpy(val, e->val);
+    }
+
+    xSemaphoreGive(config_lock);
+
+    return res;
 }
 
 int CONFIG_MGR_list() {
+    if (config_lock == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+
     printf("Configuraton values:\n");
 
-    nvs_iterator_t it = nvs_entry_find("nvs", NULL, NVS_TYPE_STR);
-    
-    while (it != NULL) {
-        nvs_entry_info_t info;
-        nvs_entry_info(it, &info);
+    xSemaphoreTake(config_lock, portMAX_DELAY);
 
-        char buff[CONFIG_MGR_MAX_VAL] = { 0 };
-        CONFIG_MGR_get(info.key, buff, sizeof(buff));
+    for (uint32_t i=0; i<CONFIG_MGR_TABLE_SIZE; i++) {
+        config_entry_t* e = &entries[i];
+        if (e->key[0] == 0 || e->val == NULL) {
+            continue;
+        }
 
-        printf("key: '%s', val: '%s' \n", info.key, buff);
+        printf("key: '%s', val: '%s'%s\n", e->key, e->val, e->dirty ? " (pending)" : "");
+    }
 
-        it = nvs_entry_next(it);
-    };
+    xSemaphoreGive(config_lock);
 
     return 0;
 }
+
@@ -1,4 +1,3 @@
-
 #ifndef CONFIG_MANAGER_H
 #define CONFIG_MANAGER_H
 
@@ -12,14 +11,15 @@
 ESP_EVENT_DECLARE_BASE(CONFIG_MGR_EVENT_BASE);
 
 // Configuration manager events
-enum {
-    // Issue a configuration update to the config manager
+typedef enum {
+    // Issue a configuration update to the config manager (config_manager_update_t),
+    // updates are batched until CONFIG_MGR_EVENT_DONE
     CONFIG_MGR_EVENT_SET,
 
-    // Receive a configuration change from the config manager
+    // Receive a committed set of configuration changes from the config manager (config_manager_changes_t)
     CONFIG_MGR_EVENT_CHANGED,
 
-    // Indicate a set of configuration changes is complete
+    // Indicate a set of configuration updates is complete
     CONFIG_MGR_EVENT_DONE,
 } config_mgr_event_e;
 
@@ -29,6 +29,13 @@ enum {
 
 #define CONFIG_MGR_PARTITION  "cfg"
 
+// Cached keys, the table is sized to keep the load factor under 3/4
+#define CONFIG_MGR_MAX_KEYS     48
+#define CONFIG_MGR_TABLE_SIZE   64
+
+// Keys listed in a change event, larger batches set count past this
+#define CONFIG_MGR_MAX_CHANGES  16
+
 
 // Connect object
 typedef struct {
@@ -36,25 +43,35 @@ typedef struct {
     char val[CONFIG_MGR_MAX_VAL];   // Configuration value
 } config_manager_update_t;
 
+// Change object, posted once per commit
+typedef struct {
+    uint32_t count;                                         // Keys changed or cleared
+    char keys[CONFIG_MGR_MAX_CHANGES][NVS_KEY_NAME_MAX_SIZE]; // The first (up to) CONFIG_MGR_MAX_CHANGES keys
+} config_manager_changes_t;
+
 
-// Initialise config manager
+// Initialise config manager, loading stored values into the cache
 int CONFIG_MGR_init();
 
 // Register config manager CLI commands
 void CONFIG_MGR_register_commands();
 
 
+// Start a batch of changes, sets and clears are held in RAM until the matching
+// CONFIG_MGR_done. Batches may nest, changes are committed when the outermost ends.
+int CONFIG_MGR_begin();
+
 // Set a configuration value
 int CONFIG_MGR_set(const char* key, const char* val);
 
 // Clear a configuration key
 int CONFIG_MGR_clear(const char* key);
 
-// Emit end-of-configuration signal
-// (allows re-configuration of multiple fields)
+// End a batch, writing changes to NVS with a single commit and posting
+// a single CONFIG_MGR_EVENT_CHANGED (allows re-configuration of multiple fields)
 int CONFIG_MGR_done();
 
-// Fetch a configuration value
+// Fetch a configuration value (from the cache)
 int CONFIG_MGR_get(const char* key, char* val, size_t val_len);
 
 // List configuration values (to the terminal)
@@ -0,0 +1,507 @@
+#include "event_mgr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "m3_env.h"
+
+#include "gpio_mgr.h"
+
+#define TAG "EVENT_MGR"
+
+// Internal event, runs init on the dispatcher stack
+#define EVENT_ATTACH    EVENT_HANDLERS
+
+static const char* event_handler_names[EVENT_HANDLERS] = {
+    "on_timer",
+    "on_gpio",
+    "on_mqtt_message",
+    "on_config_changed",
+};
+
+typedef struct {
+    uint32_t    type;
+
+    // Target applet, NULL for every applet with a handler
+    WasmTask_t  *task;
+
+    union {
+        uint32_t    timer_id;
+        GpioEvent_t gpio;
+
+        // Heap copy of the topic / key followed by the payload, freed after dispatch
+        struct {
+            char        *data;
+            uint32_t    name_len;
+            uint32_t    data_len;
+        } msg;
+    } u;
+} Event_t;
+
+typedef struct {
+    esp_timer_handle_t  handle;
+    WasmTask_t          *task;
+    uint32_t            id;
+} EventTimer_t;
+
+typedef struct {
+    WasmTask_t          *task;
+    IM3Runtime          runtime;
+    EventRelease_t      release;
+
+    // Set once init has been dispatched, events are not delivered before then
+    bool                ready;
+
+    IM3Function         init;
+    IM3Function         handlers[EVENT_HANDLERS];
+
+    // Linear memory offset for topics, payloads and keys
+    uint32_t            buffer;
+    uint32_t            buffer_len;
+
+    EventTimer_t        timers[EVENT_MGR_MAX_TIMERS];
+} EventApplet_t;
+
+static EventApplet_t applets[EVENT_MGR_MAX_APPLETS];
+
+static QueueHandle_t event_queue = NULL;
+static TaskHandle_t event_task = NULL;
+
+// Held by the dispatcher while a handler runs, recursive as host calls from
+// handlers (timer_start etc.) look up the applet again
+static SemaphoreHandle_t event_lock = NULL;
+
+static uint32_t event_dropped = 0;
+
+
+// Takes edges on pins owned by an applet with an on_gpio handler, others are left to gpio_wait_event
+static bool IRAM_ATTR event_gpio_hook(const void *owner, const GpioEvent_t *event, bool *woken) {
+    bool listening = false;
+    for (int i=0; i<EVENT_MGR_MAX_APPLETS && !listening; i++) {
+        listening = (applets[i].task == owner && applets[i].handlers[EVENT_GPIO] != NULL);
+    }
+    if (!listening) {
+        return false;
+    }
+
+    Event_t e = { .type = EVENT_GPIO, .task = (WasmTask_t*) owner, .u.gpio = *event };
+
+    BaseType_t higher = pdFALSE;
+    if (xQueueSendFromISR(event_queue, &e, &higher) != pdTRUE) {
+        event_dropped += 1;
+    }
+
+    *woken = (higher == pdTRUE);
+    return true;
+}
+
+static void event_timer_cb(void* arg) {
+    EventTimer_t* timer = (EventTimer_t*) arg;
+
+    // Cleared when the applet is removed, NULL would target every applet
+    WasmTask_t* task = timer->task;
+    if (task == NULL) {
+        return;
+    }
+
+    Event_t e = { .type = EVENT_TIMER, .task = task, .u.timer_id = timer->id };
+
+    if (xQueueSend(event_queue, &e, 0) != pdTRUE) {
+        event_dropped += 1;
+    }
+}
+
+static void event_free(Event_t* e) {
+    if (e->type == EVENT_MQTT_MESSAGE || e->type == EVENT_CONFIG_CHANGED) {
+        free(e->u.msg.data);
+    }
+}
+
+// Find the applet for a task or runtime, must be called with the lock held
+static EventApplet_t* event_find(WasmTask_t* task, IM3Runtime runtime) {
+    for (int i=0; i<EVENT_MGR_MAX_APPLETS; i++) {
+        if (applets[i].task != NULL && (applets[i].task == task || applets[i].runtime == runtime)) {
+            return &applets[i];
+        }
+    }
+    return NULL;
+}
+
+// Stop timers and clear the slot, must be called with the lock held
+static void event_remove(EventApplet_t* a, bool valid) {
+    for (int i=0; i<EVENT_MGR_MAX_TIMERS; i++) {
+        a->timers[i].task = NULL;
+        if (a->timers[i].handle != NULL) {
+            esp_timer_stop(a->timers[i].handle);
+            esp_timer_delete(a->timers[i].handle);
+        }
+    }
+
+    WasmTask_t* task = a->task;
+    IM3Runtime runtime = a->runtime;
+    EventRelease_t release = a->release;
+
+    memset(a, 0, sizeof(EventApplet_t));
+
+    release(task, runtime, valid);
+}
+
+// Copy a name and payload into the applet buffer, returns the buffer offset or 0 if it doesn't fit
+static uint32_t event_copy(EventApplet_t* a, const Event_t* e) {
+    uint32_t len = e->u.msg.name_len + e->u.msg.data_len;
+
+    uint32_t mem_len = 0;
+    uint8_t* mem = (uint8_t*) m3_GetMemory(a->runtime, &mem_len, 0);
+
+    if (a->buffer == 0 || len > a->buffer_len || (uint64_t) a->buffer + a->buffer_len > mem_len) {
+        return 0;
+    }
+
+    memcpy(mem + a->buffer, e->u.msg.data, len);
+
+    return a->buffer;
+}
+
+static void event_dispatch(EventApplet_t* a, const Event_t* e) {
+    IM3Function f;
+    uint64_t args[4];
+    uint32_t argc = 0;
+
+    if (e->type == EVENT_ATTACH) {
+        f = a->init;
+        args[argc++] = a->task->arg_count;
+        // Task handle, unused as arg_get finds the task itself
+        args[argc++] = 0;
+        a->ready = true;
+
+    } else if (a->ready) {
+        f = a->handlers[e->type];
+
+    } else {
+        return;
+    }
+
+    if (f == NULL) {
+        return;
+    }
+
+    switch (e->type) {
+        case EVENT_TIMER:
+            args[argc++] = e->u.timer_id;
+            break;
+        case EVENT_GPIO:
+            args[argc++] = e->u.gpio.pin;
+            args[argc++] = e->u.gpio.level;
+            args[argc++] = e->u.gpio.time_us;
+            break;
+        case EVENT_MQTT_MESSAGE:
+        case EVENT_CONFIG_CHANGED: {
+            uint32_t offset = event_copy(a, e);
+            if (offset == 0) {
+                ESP_LOGI(TAG, "No room for %d byte event in %s buffer", e->u.msg.name_len + e->u.msg.data_len, a->task->name);
+                return;
+            }
+
+            args[argc++] = offset;
+            args[argc++] = e->u.msg.name_len;
+            if (e->type == EVENT_MQTT_MESSAGE) {
+                args[argc++] = offset + e->u.msg.name_len;
+                args[argc++] = e->u.msg.data_len;
+            }
+            break;
+        }
+    }
+
+    // Stopping the applet flags its task, which m3_Yield finds here to trap the handler
+    vTaskSetThreadLocalStoragePointer(NULL, WASM_TLS_INDEX, a->task);
+    M3Result result = m3_CallWithValues(f, argc, args);
+    vTaskSetThreadLocalStoragePointer(NULL, WASM_TLS_INDEX, NULL);
+
+    if (result == m3Err_none) {
+        return;
+    }
+
+    // The applet state can't be trusted after a trap, exiting or being stopped is a clean stop
+    bool exited = (result == m3Err_trapExit) || __atomic_load_n(&a->task->cancel, __ATOMIC_ACQUIRE);
+    if (!exited) {
+        ESP_LOGI(TAG, "Applet %s %s: %s", a->task->name,
+                e->type == EVENT_ATTACH ? "init" : event_handler_names[e->type], result);
+    }
+
+    event_remove(a, exited);
+}
+
+static void event_dispatcher(void* pvParameters) {
+    Event_t e;
+
+    while (true) {
+        if (xQueueReceive(event_queue, &e, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        xSemaphoreTakeRecursive(event_lock, portMAX_DELAY);
+
+        for (int i=0; i<EVENT_MGR_MAX_APPLETS; i++) {
+            EventApplet_t* a = &applets[i];
+            if (a->task == NULL || (e.task != NULL && e.task != a->task)) {
+                continue;
+            }
+
+            event_dispatch(a, &e);
+        }
+
+        xSemaphoreGiveRecursive(event_lock);
+
+        event_free(&e);
+
+        if (event_dropped) {
+            ESP_LOGI(TAG, "Dropped %d events", event_dropped);
+            event_dropped = 0;
+        }
+    }
+}
+
+int EVENT_MGR_init() {
+    event_lock = xSemaphoreCreateRecursiveMutex();
+    event_queue = xQueueCreate(EVENT_MGR_QUEUE_LEN, sizeof(Event_t));
+    if (event_lock == NULL || event_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate event queue");
+        return -1;
+    }
+
+    memset(applets, 0, sizeof(applets));
+
+    BaseType_t res = xTaskCreatePinnedToCore(event_dispatcher, "wasm_events", EVENT_MGR_STACK_SIZE, NULL,
+            EVENT_MGR_PRIORITY, &event_task, tskNO_AFFINITY);
+    if (res != pdPASS) {
+        ESP_LOGE(TAG, "Failed to launch event dispatcher");
+        return -2;
+    }
+
+    gpio_set_event_hook(event_gpio_hook);
+
+    return 0;
+}
+
+bool EVENT_MGR_is_event_applet(IM3Runtime runtime) {
+    IM3Function f;
+
+    for (int i=0; i<EVENT_HANDLERS; i++) {
+        if (m3_FindFunction(&f, runtime, event_handler_names[i]) == m3Err_none) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Look up an optional export, checking it takes the expected arguments
+static IM3Function event_bind(IM3Runtime runtime, const char* name, uint32_t argc) {
+    IM3Function f;
+
+    if (m3_FindFunction(&f, runtime, name) != m3Err_none) {
+        return NULL;
+    }
+
+    if (f->funcType->numArgs != argc) {
+        ESP_LOGI(TAG, "Ignoring %s, expected %d arguments", name, argc);
+        return NULL;
+    }
+
+    return f;
+}
+
+int EVENT_MGR_attach(WasmTask_t* task, IM3Runtime runtime, EventRelease_t release) {
+    static const uint32_t handler_args[EVENT_HANDLERS] = { 1, 3, 4, 2 };
+
+    int res = -1;
+
+    xSemaphoreTakeRecursive(event_lock, portMAX_DELAY);
+
+    EventApplet_t* a = NULL;
+    for (int i=0; i<EVENT_MGR_MAX_APPLETS; i++) {
+        if (applets[i].task == NULL) {
+            a = &applets[i];
+            break;
+        }
+    }
+
+    if (a == NULL) {
+        ESP_LOGI(TAG, "No free event applet slot for %s", task->name);
+        goto attach_done;
+    }
+
+    a->init = event_bind(runtime, "init", 2);
+    for (int i=0; i<EVENT_HANDLERS; i++) {
+        a->handlers[i] = event_bind(runtime, event_handler_names[i], handler_args[i]);
+    }
+
+    a->task = task;
+    a->runtime = runtime;
+    a->release = release;
+    a->ready = false;
+
+    res = 0;
+
+attach_done:
+    xSemaphoreGiveRecursive(event_lock);
+
+    if (res < 0) {
+        return res;
+    }
+
+    // Sent without the lock as the dispatcher may need it to drain a full queue
+    Event_t e = { .type = EVENT_ATTACH, .task = task };
+    xQueueSend(event_queue, &e, portMAX_DELAY);
+
+    return 0;
+}
+
+int EVENT_MGR_detach(WasmTask_t* task) {
+    if (xSemaphoreTakeRecursive(event_lock, EVENT_MGR_DETACH_TIMEOUT_MS / portTICK_PERIOD_MS) != pdTRUE) {
+        ESP_LOGI(TAG, "Timeout waiting for %s handler to return", task->name);
+        return -2;
+    }
+
+    EventApplet_t* a = event_find(task, NULL);
+    if (a != NULL) {
+        event_remove(a, true);
+    }
+
+    xSemaphoreGiveRecursive(event_lock);
+
+    return a != NULL ? 0 : -1;
+}
+
+bool EVENT_MGR_in_dispatcher() {
+    return event_task != NULL && xTaskGetCurrentTaskHandle() == event_task;
+}
+
+static int event_post_msg(WasmTask_t* task, uint32_t type, const char* name, const uint8_t* data, uint32_t len) {
+    uint32_t name_len = strlen(name);
+
+    Event_t e = { .type = type, .task = task };
+    e.u.msg.data = malloc(name_len + len);
+    if (e.u.msg.data == NULL) {
+        return -1;
+    }
+
+    memcpy(e.u.msg.data, name, name_len);
+    if (len > 0) {
+        memcpy(e.u.msg.data + name_len, data, len);
+    }
+    e.u.msg.name_len = name_len;
+    e.u.msg.data_len = len;
+
+    if (xQueueSend(event_queue, &e, 0) != pdTRUE) {
+        free(e.u.msg.data);
+        event_dropped += 1;
+        return -2;
+    }
+
+    return 0;
+}
+
+int EVENT_MGR_post_mqtt(WasmTask_t* task, const char* topic, const uint8_t* data, uint32_t len) {
+    return event_post_msg(task, EVENT_MQTT_MESSAGE, topic, data, len);
+}
+
+int EVENT_MGR_post_config(const char* key) {
+    return event_post_msg(NULL, EVENT_CONFIG_CHANGED, key, NULL, 0);
+}
+
+int EVENT_MGR_set_buffer(IM3Runtime runtime, uint32_t offset, uint32_t len) {
+    int res = -1;
+
+    xSemaphoreTakeRecursive(event_lock, portMAX_DELAY);
+
+    EventApplet_t* a = event_find(NULL, runtime);
+    if (a != NULL) {
+        a->buffer = offset;
+        a->buffer_len = len;
+        res = 0;
+    }
+
+    xSemaphoreGiveRecursive(event_lock);
+
+    return res;
+}
+
+int EVENT_MGR_timer_start(IM3Runtime runtime, uint32_t id, uint32_t period_ms, bool repeat) {
+    if (id >= EVENT_MGR_MAX_TIMERS || period_ms == 0) {
+        return -1;
+    }
+
+    int res = -2;
+
+    xSemaphoreTakeRecursive(event_lock, portMAX_DELAY);
+
+    EventApplet_t* a = event_find(NULL, runtime);
+    if (a == NULL) {
+        goto start_done;
+    }
+
+    EventTimer_t* t = &a->timers[id];
+    if (t->handle == NULL) {
+        esp_timer_create_args_t args = {
+            .callback = event_timer_cb,
+            .arg = t,
+            .name = "wasm_timer",
+        };
+
+        t->id = id;
+
+        if (esp_timer_create(&args, &t->handle) != ESP_OK) {
+            t->handle = NULL;
+            res = -3;
+            goto start_done;
+        }
+    } else {
+        // Restarting replaces the previous period
+        esp_timer_stop(t->handle);
+    }
+
+    t->task = a->task;
+
+    uint64_t period_us = (uint64_t) period_ms * 1000;
+    esp_err_t err = repeat ? esp_timer_start_periodic(t->handle, period_us) : esp_timer_start_once(t->handle, period_us);
+    res = (err == ESP_OK) ? 0 : -4;
+
+start_done:
+    xSemaphoreGiveRecursive(event_lock);
+
+    return res;
+}
+
+int EVENT_MGR_timer_stop(IM3Runtime runtime, uint32_t id) {
+    if (id >= EVENT_MGR_MAX_TIMERS) {
+        return -1;
+    }
+
+    int res = -2;
+
+    xSemaphoreTakeRecursive(event_lock, portMAX_DELAY);
+
+    EventApplet_t* a = event_find(NULL, runtime);
+    if (a != NULL) {
+        if (a->timers[id].handle != NULL) {
+            esp_timer_stop(a->timers[id].handle);
+        }
+        res = 0;
+    }
+
+    xSemaphoreGiveRecursive(event_lock);
+
+    return res;
+}
+
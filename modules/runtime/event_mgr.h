@@ -0,0 +1,76 @@
+#ifndef EVENT_MGR_H
+#define EVENT_MGR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "wasm3.h"
+
+#include "runtime.h"
+
+// Event applets attached to the dispatcher at once
+#define EVENT_MGR_MAX_APPLETS       4
+
+// Timers per event applet
+#define EVENT_MGR_MAX_TIMERS        4
+
+// Pending events across all applets
+#define EVENT_MGR_QUEUE_LEN         32
+
+// Dispatcher task, handlers for every event applet run on this stack
+#define EVENT_MGR_STACK_SIZE        (40 * 1024)
+#define EVENT_MGR_PRIORITY          5
+
+// Time allowed for a running handler to return when an applet is stopped
+#define EVENT_MGR_DETACH_TIMEOUT_MS 5000
+
+// Exported handlers, an applet without `main` that exports any of these is run by the dispatcher
+//
+//   init(argc: i32, task: i32)                                  called once when attached
+//   on_timer(id: i32)                                           see timer_start
+//   on_gpio(pin: i32, level: i32, time_us: i64)                 see gpio_configure
+//   on_mqtt_message(topic: *u8, topic_len: i32, data: *u8, data_len: i32)
+//   on_config_changed(key: *u8, key_len: i32)
+//
+// Topics, payloads and keys are copied into the buffer registered with event_buffer.
+// Blocking host calls fail in handlers, which share the dispatcher task.
+typedef enum {
+    EVENT_TIMER = 0,
+    EVENT_GPIO,
+    EVENT_MQTT_MESSAGE,
+    EVENT_CONFIG_CHANGED,
+    EVENT_HANDLERS,
+} EventType_t;
+
+// Called when an applet leaves the dispatcher, valid is false if a handler trapped
+typedef void (*EventRelease_t)(WasmTask_t* task, IM3Runtime runtime, bool valid);
+
+int EVENT_MGR_init();
+
+// Check whether a loaded module uses the event model
+bool EVENT_MGR_is_event_applet(IM3Runtime runtime);
+
+// Hand a loaded runtime to the dispatcher, init is called from the dispatcher task
+int EVENT_MGR_attach(WasmTask_t* task, IM3Runtime runtime, EventRelease_t release);
+
+// Remove an applet from the dispatcher, waiting for a running handler to return.
+// Returns -2 if the handler is still running after EVENT_MGR_DETACH_TIMEOUT_MS.
+int EVENT_MGR_detach(WasmTask_t* task);
+
+// Whether the caller is the dispatcher task, where host functions must not block
+bool EVENT_MGR_in_dispatcher();
+
+// Post events to all attached applets with a matching handler (or a single task)
+int EVENT_MGR_post_mqtt(WasmTask_t* task, const char* topic, const uint8_t* data, uint32_t len);
+
+int EVENT_MGR_post_config(const char* key);
+
+// Host API, the applet is found from the calling runtime
+int EVENT_MGR_set_buffer(IM3Runtime runtime, uint32_t offset, uint32_t len);
+
+int EVENT_MGR_timer_start(IM3Runtime runtime, uint32_t id, uint32_t period_ms, bool repeat);
+
+int EVENT_MGR_timer_stop(IM3Runtime runtime, uint32_t id);
+
+#endif
+
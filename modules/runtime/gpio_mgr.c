@@ -0,0 +1,329 @@
+#include "gpio_mgr.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "driver/gpio.h"
+
+#define TAG "GPIO_MGR"
+
+// Edge events for one owner. Events are pushed by the ISR (the only producer, interrupts are
+// serviced on the core that installed the ISR service) and popped by the owner's task (the only
+// consumer), so the ring itself needs no critical section. The semaphore only wakes the waiter.
+typedef struct {
+    const void          *owner;
+    GpioEvent_t         events[GPIO_MGR_EVENT_QUEUE_LEN];
+    uint32_t            head;
+    uint32_t            tail;
+    uint32_t            dropped;
+    SemaphoreHandle_t   signal;
+} GpioQueue_t;
+
+static GpioQueue_t queues[GPIO_MGR_OWNERS];
+
+// Owner of each configured pin, and the queue its edges go to
+static const void *pin_owners[GPIO_NUM_MAX];
+static uint8_t pin_queues[GPIO_NUM_MAX];
+
+// Serialises changes to the pin and queue tables
+static SemaphoreHandle_t gpio_lock = NULL;
+
+static bool isr_installed = false;
+
+static volatile GpioEventHook_t event_hook = NULL;
+
+
+static void IRAM_ATTR gpio_isr(void* arg) {
+    uint32_t pin = (uintptr_t) arg;
+    GpioQueue_t *q = &queues[pin_queues[pin]];
+
+    GpioEvent_t event = { .pin = pin, .level = gpio_get_level(pin), .time_us = esp_timer_get_time() };
+
+    BaseType_t woken = pdFALSE;
+
+    // Hook consumers never drain the ring, so events they take aren't queued
+    bool hook_woken = false;
+    GpioEventHook_t hook = event_hook;
+    if (hook != NULL && hook(q->owner, &event, &hook_woken)) {
+        woken = hook_woken;
+    } else {
+        uint32_t head = q->head;
+        uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+
+        if (head - tail >= GPIO_MGR_EVENT_QUEUE_LEN) {
+            __atomic_fetch_add(&q->dropped, 1, __ATOMIC_RELAXED);
+        } else {
+            q->events[head & (GPIO_MGR_EVENT_QUEUE_LEN - 1)] = event;
+            __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+
+            xSemaphoreGiveFromISR(q->signal, &woken);
+        }
+    }
+
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static esp_err_t gpio_take_lock() {
+    if (gpio_lock == NULL) {
+        gpio_lock = xSemaphoreCreateMutex();
+        if (gpio_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(gpio_lock, portMAX_DELAY);
+
+    return ESP_OK;
+}
+
+// Find (or claim) the event queue of an owner, must be called with the lock held
+static GpioQueue_t* gpio_get_queue(const void *owner, bool claim) {
+    GpioQueue_t *slot = NULL;
+
+    for (int i=0; i<GPIO_MGR_OWNERS; i++) {
+        if (queues[i].owner == owner) {
+            return &queues[i];
+        }
+        if (queues[i].owner == NULL && slot == NULL) {
+            slot = &queues[i];
+        }
+    }
+
+    if (!claim || slot == NULL) {
+        return NULL;
+    }
+
+    if (slot->signal == NULL && (slot->signal = xSemaphoreCreateBinary()) == NULL) {
+        return NULL;
+    }
+
+    // Left over signals are harmless, the waiter always re-checks the ring
+    slot->head = 0;
+    slot->tail = 0;
+    slot->dropped = 0;
+    slot->owner = owner;
+
+    return slot;
+}
+
+static esp_err_t gpio_init_events() {
+    if (isr_installed) {
+        return ESP_OK;
+    }
+
+    esp_err_t res = gpio_install_isr_service(0);
+    isr_installed = (res == ESP_OK);
+
+    return res;
+}
+
+int gpio_configure(uint32_t pin, uint32_t mode, uint32_t pull, uint32_t edge, const void *owner) {
+    if (owner == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!GPIO_IS_VALID_GPIO(pin)) {
+        ESP_LOGE(TAG, "Invalid pin: %d", pin);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gpio_config_t conf;
+    memset(&conf, 0, sizeof(conf));
+
+    conf.pin_bit_mask = 1ULL << pin;
+    conf.pull_up_en = (pull & GPIO_MGR_PULL_UP) ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE;
+    conf.pull_down_en = (pull & GPIO_MGR_PULL_DOWN) ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE;
+
+    switch (mode) {
+        case GPIO_MGR_MODE_DISABLE:
+            conf.mode = GPIO_MODE_DISABLE;
+            break;
+        case GPIO_MGR_MODE_INPUT:
+            conf.mode = GPIO_MODE_INPUT;
+            break;
+        case GPIO_MGR_MODE_OUTPUT:
+            // Input is kept enabled so outputs can be read back
+            conf.mode = GPIO_MODE_INPUT_OUTPUT;
+            break;
+        case GPIO_MGR_MODE_OUTPUT_OD:
+            conf.mode = GPIO_MODE_INPUT_OUTPUT_OD;
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    if (mode >= GPIO_MGR_MODE_OUTPUT && !GPIO_IS_VALID_OUTPUT_GPIO(pin)) {
+        ESP_LOGE(TAG, "Pin %d is input only", pin);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    switch (edge) {
+        case GPIO_MGR_EDGE_NONE:
+            conf.intr_type = GPIO_INTR_DISABLE;
+            break;
+        case GPIO_MGR_EDGE_RISING:
+            conf.intr_type = GPIO_INTR_POSEDGE;
+            break;
+        case GPIO_MGR_EDGE_FALLING:
+            conf.intr_type = GPIO_INTR_NEGEDGE;
+            break;
+        case GPIO_MGR_EDGE_ANY:
+            conf.intr_type = GPIO_INTR_ANYEDGE;
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t res = gpio_take_lock();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    // Pins belong to the first owner to configure them until it disables or releases them
+    GpioQueue_t *q = NULL;
+    if (pin_owners[pin] != NULL && pin_owners[pin] != owner) {
+        ESP_LOGE(TAG, "Pin %d is in use", pin);
+        res = ESP_ERR_INVALID_STATE;
+    } else if (edge != GPIO_MGR_EDGE_NONE) {
+        q = gpio_get_queue(owner, true);
+        res = (q != NULL) ? gpio_init_events() : ESP_ERR_NO_MEM;
+    }
+
+    // Detach any previous handler before reconfiguring
+    if (res == ESP_OK && isr_installed) {
+        gpio_isr_handler_remove(pin);
+    }
+
+    if (res == ESP_OK) {
+        res = gpio_config(&conf);
+    }
+
+    if (res == ESP_OK) {
+        pin_owners[pin] = (mode != GPIO_MGR_MODE_DISABLE) ? owner : NULL;
+    }
+
+    if (res == ESP_OK && q != NULL) {
+        pin_queues[pin] = q - queues;
+        res = gpio_isr_handler_add(pin, gpio_isr, (void*) (uintptr_t) pin);
+    }
+
+    xSemaphoreGive(gpio_lock);
+
+    return res;
+}
+
+int gpio_write(uint32_t pin, uint32_t level, const void *owner) {
+    if (!GPIO_IS_VALID_OUTPUT_GPIO(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (pin_owners[pin] != owner) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return gpio_set_level(pin, level ? 1 : 0);
+}
+
+int gpio_read(uint32_t pin) {
+    if (!GPIO_IS_VALID_GPIO(pin)) {
+        return -ESP_ERR_INVALID_ARG;
+    }
+
+    return gpio_get_level(pin);
+}
+
+int gpio_wait_event(const void *owner, GpioEvent_t *event, uint32_t timeout_ms) {
+    // Only the owner's task pops its queue, and the queue is only released once it stops
+    GpioQueue_t *q = NULL;
+    if (owner != NULL && gpio_take_lock() == ESP_OK) {
+        q = gpio_get_queue(owner, false);
+        xSemaphoreGive(gpio_lock);
+    }
+
+    if (q == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Round up so short timeouts still wait for at least a tick
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = ((uint64_t) timeout_ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS;
+
+    esp_err_t res = ESP_ERR_TIMEOUT;
+
+    while (true) {
+        uint32_t tail = q->tail;
+        uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+
+        if (head != tail) {
+            *event = q->events[tail & (GPIO_MGR_EVENT_QUEUE_LEN - 1)];
+            __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+            res = ESP_OK;
+            break;
+        }
+
+        // Sleep until the ISR signals, the signal may be stale so the ring is always re-checked
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            break;
+        }
+        if (xSemaphoreTake(q->signal, timeout - elapsed) != pdTRUE) {
+            break;
+        }
+    }
+
+    return res;
+}
+
+void gpio_set_event_hook(GpioEventHook_t hook) {
+    event_hook = hook;
+}
+
+uint32_t gpio_events_dropped(const void *owner) {
+    uint32_t dropped = 0;
+
+    if (owner != NULL && gpio_take_lock() == ESP_OK) {
+        GpioQueue_t *q = gpio_get_queue(owner, false);
+        if (q != NULL) {
+            dropped = __atomic_exchange_n(&q->dropped, 0, __ATOMIC_RELAXED);
+        }
+        xSemaphoreGive(gpio_lock);
+    }
+
+    return dropped;
+}
+
+void gpio_release_owner(const void *owner) {
+    if (owner == NULL || gpio_take_lock() != ESP_OK) {
+        return;
+    }
+
+    // Interrupts are stopped before the queue is released, levels are left as they are
+    for (uint32_t pin=0; pin<GPIO_NUM_MAX; pin++) {
+        if (pin_owners[pin] != owner) {
+            continue;
+        }
+
+        if (isr_installed) {
+            gpio_isr_handler_remove(pin);
+        }
+        gpio_set_intr_type(pin, GPIO_INTR_DISABLE);
+        pin_owners[pin] = NULL;
+    }
+
+    GpioQueue_t *q = gpio_get_queue(owner, false);
+    if (q != NULL) {
+        q->owner = NULL;
+    }
+
+    xSemaphoreGive(gpio_lock);
+}
+
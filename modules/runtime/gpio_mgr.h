@@ -2,7 +2,64 @@
 #ifndef GPIO_MGR_H
 #define GPIO_MGR_H
 
+#include <stdint.h>
+#include <stdbool.h>
 
+// Pending edge events per owner, must be a power of two
+#define GPIO_MGR_EVENT_QUEUE_LEN    32
 
+// Owners (applet tasks) with edge events configured at once
+#define GPIO_MGR_OWNERS             4
+
+// Pin modes
+#define GPIO_MGR_MODE_DISABLE       0
+#define GPIO_MGR_MODE_INPUT         1
+#define GPIO_MGR_MODE_OUTPUT        2
+#define GPIO_MGR_MODE_OUTPUT_OD     3
+
+// Pull flags
+#define GPIO_MGR_PULL_UP            0x01
+#define GPIO_MGR_PULL_DOWN          0x02
+
+// Edge interrupts
+#define GPIO_MGR_EDGE_NONE          0
+#define GPIO_MGR_EDGE_RISING        1
+#define GPIO_MGR_EDGE_FALLING       2
+#define GPIO_MGR_EDGE_ANY           3
+
+// Edge event, captured in the ISR
+typedef struct {
+    uint32_t    pin;
+    uint32_t    level;
+    int64_t     time_us;
+} GpioEvent_t;
+
+// Called from the ISR with each captured event and the owner of its pin, must be in IRAM.
+// Returns true if it took the event, which is then not queued for gpio_wait_event, and sets
+// woken if a higher priority task was woken.
+typedef bool (*GpioEventHook_t)(const void *owner, const GpioEvent_t *event, bool *woken);
+
+// Configure a pin for an owner (the applet task), fails if another owner holds the pin.
+// Disabling a pin releases it.
+int gpio_configure(uint32_t pin, uint32_t mode, uint32_t pull, uint32_t edge, const void *owner);
+
+int gpio_write(uint32_t pin, uint32_t level, const void *owner);
+
+// Returns the pin level or a negative error
+int gpio_read(uint32_t pin);
+
+// Wait for the next edge event on any of the owner's pins, returns ESP_ERR_TIMEOUT if none
+// arrives in time
+int gpio_wait_event(const void *owner, GpioEvent_t *event, uint32_t timeout_ms);
+
+// Offer events to a hook before queueing them (NULL to remove)
+void gpio_set_event_hook(GpioEventHook_t hook);
+
+// Events lost to the owner's full queue since the last call
+uint32_t gpio_events_dropped(const void *owner);
+
+// Release all of an owner's pins and its event queue once it stops
+void gpio_release_owner(const void *owner);
 
 #endif
+
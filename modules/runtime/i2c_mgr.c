@@ -1,10 +1,14 @@
-
-//#include "i2c_mgr.h"
+#include "i2c_mgr.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
 #include "esp_log.h"
 #include "esp_console.h"
+#include "esp_idf_version.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #include "driver/i2c.h"
 
@@ -17,6 +21,26 @@
 #define ACK_VAL 0x0                 /*!< I2C ack value */
 #define NACK_VAL 0x1                /*!< I2C nack value */
 
+// IDF 4.4+ can build command links in a caller provided buffer, so each port keeps one
+// and transactions don't touch the heap. Older IDFs allocate a link per transaction.
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
+#define I2C_STATIC_LINK     1
+#define I2C_LINK_SIZE       I2C_LINK_RECOMMENDED_SIZE(I2C_MGR_MAX_OPS)
+#else
+#define I2C_STATIC_LINK     0
+#endif
+
+typedef struct {
+    bool                installed;
+    uint32_t            timeout_ms;
+    SemaphoreHandle_t   lock;
+#if I2C_STATIC_LINK
+    uint8_t             link[I2C_LINK_SIZE];
+#endif
+} I2cPort_t;
+
+static I2cPort_t ports[I2C_MGR_PORTS];
+
 
 static esp_err_t i2c_get_port(uint32_t port, i2c_port_t *i2c_port) {
     switch (port) {
@@ -34,38 +58,41 @@ static esp_err_t i2c_get_port(uint32_t port, i2c_port_t *i2c_port) {
     return ESP_OK;
 }
 
-// TODO: track which I2C is used / unused, return errors on attempted duplication (but allow reconfiguration?)
-static bool driver_installed[2] = {false, false};
-
 int i2c_init(uint32_t port, uint32_t freq, uint32_t sda, uint32_t scl) {
     int res = 0;
-    
+
     i2c_config_t conf;
-    
+
     i2c_port_t i2c_port;
     if( i2c_get_port(port, &i2c_port) != ESP_OK ) {
         return ESP_FAIL;
     }
-    
+
     conf.mode = I2C_MODE_MASTER;
     conf.sda_io_num = sda;
     conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
     conf.scl_io_num = scl;
     conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
     conf.master.clk_speed = freq;
-    
+
     // Configure port
     i2c_param_config(port, &conf);
 
-    // Install driver
-    // TODO: do not attempt to reinstall driver if already installed..?
-    if (driver_installed[port] == false) {
+    // Serialises use of the port command link
+    if (ports[port].lock == NULL) {
+        ports[port].lock = xSemaphoreCreateMutex();
+        if (ports[port].lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Install driver, re-initialising only changes the configuration
+    if (ports[port].installed == false) {
         res = i2c_driver_install(i2c_port, conf.mode, 0, 0, 0);
 
-        driver_installed[port] = true;
+        ports[port].installed = (res == ESP_OK);
     }
 
-
     return res;
 }
 
@@ -76,95 +103,141 @@ int i2c_deinit(uint32_t port) {
         return ESP_FAIL;
     }
 
-    i2c_driver_delete(i2c_port);
+    if (ports[port].installed) {
+        i2c_driver_delete(i2c_port);
+        ports[port].installed = false;
+    }
 
     return ESP_OK;
 }
 
-int i2c_write(uint32_t port, uint32_t address, uint8_t *data_out, uint32_t length_out) {
-
+int i2c_set_timeout(uint32_t port, uint32_t timeout_ms) {
     i2c_port_t i2c_port;
+
     if( i2c_get_port(port, &i2c_port) != ESP_OK ) {
         return ESP_FAIL;
     }
 
-    // Create a link handle
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    ports[port].timeout_ms = timeout_ms;
 
-    // Build command
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, address | I2C_MASTER_WRITE, ACK_CHECK_DIS);
-    i2c_master_write(cmd, data_out, length_out, ACK_CHECK_EN);
-    i2c_master_stop(cmd);
-    
-    // Execute command
-    esp_err_t ret = i2c_master_cmd_begin(i2c_port, cmd, 1000 / portTICK_RATE_MS);
+    return ESP_OK;
+}
 
-    // Remove link
-    i2c_cmd_link_delete(cmd);
+// Append a segment to a command link
+static esp_err_t i2c_build_op(i2c_cmd_handle_t cmd, const I2cOp_t *op) {
+    esp_err_t err;
+    bool read = (op->flags & I2C_OP_READ) != 0;
 
-    return ret;
-}
+    err = i2c_master_start(cmd);
+    if (err == ESP_OK) {
+        err = i2c_master_write_byte(cmd, op->address | (read ? READ_BIT : WRITE_BIT), ACK_CHECK_DIS);
+    }
 
-int i2c_read(uint32_t port, uint32_t address, uint8_t *data_in, uint32_t length_in) {
-    if (length_in == 0) {
-        return ESP_OK;
+    if (err != ESP_OK || op->len == 0) {
+        return err;
+    }
+
+    if (!read) {
+        return i2c_master_write(cmd, op->data, op->len, ACK_CHECK_EN);
     }
 
+    // NACK the last byte read
+    if (op->len > 1) {
+        err = i2c_master_read(cmd, op->data, op->len - 1, ACK_VAL);
+    }
+    if (err == ESP_OK) {
+        err = i2c_master_read_byte(cmd, op->data + op->len - 1, NACK_VAL);
+    }
+
+    return err;
+}
+
+int i2c_transaction(uint32_t port, const I2cOp_t *ops, uint32_t count) {
     i2c_port_t i2c_port;
     if( i2c_get_port(port, &i2c_port) != ESP_OK ) {
         return ESP_FAIL;
     }
 
-    // Create link handle
+    if (!ports[port].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (count == 0 || count > I2C_MGR_MAX_OPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint32_t i=0; i<count; i++) {
+        if ((ops[i].flags & I2C_OP_READ) && ops[i].len == 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    // Round up so short timeouts still wait for at least a tick
+    uint32_t timeout_ms = ports[port].timeout_ms ? ports[port].timeout_ms : I2C_MGR_DEFAULT_TIMEOUT_MS;
+    TickType_t timeout = ((uint64_t) timeout_ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS;
+
+    xSemaphoreTake(ports[port].lock, portMAX_DELAY);
+
+#if I2C_STATIC_LINK
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(ports[port].link, sizeof(ports[port].link));
+#else
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+#endif
 
     // Build command
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, address | I2C_MASTER_READ, ACK_CHECK_DIS);
-    if (length_in > 1) {
-        i2c_master_read(cmd, data_in, length_in - 1, ACK_VAL);
+    esp_err_t ret = (cmd != NULL) ? ESP_OK : ESP_ERR_NO_MEM;
+    for (uint32_t i=0; i<count && ret == ESP_OK; i++) {
+        ret = i2c_build_op(cmd, &ops[i]);
+    }
+    if (ret == ESP_OK) {
+        ret = i2c_master_stop(cmd);
     }
-    i2c_master_read_byte(cmd, data_in + length_in - 1, NACK_VAL);
-    i2c_master_stop(cmd);
 
     // Execute command
-    esp_err_t ret = i2c_master_cmd_begin(i2c_port, cmd, 1000 / portTICK_RATE_MS);
+    if (ret == ESP_OK) {
+        ret = i2c_master_cmd_begin(i2c_port, cmd, timeout);
+    }
+
+    // Release link
+    if (cmd != NULL) {
+#if I2C_STATIC_LINK
+        i2c_cmd_link_delete_static(cmd);
+#else
+        i2c_cmd_link_delete(cmd);
+#endif
+    }
+
+    xSemaphoreGive(ports[port].lock);
 
-    // Remove link and return
-    i2c_cmd_link_delete(cmd);
     return ret;
 }
 
-int i2c_write_read(uint32_t port, uint32_t address,
-        uint8_t *data_out, uint32_t length_out,
-        uint8_t *data_in, uint32_t length_in) {
-        
-
-    i2c_port_t i2c_port;
-    if( i2c_get_port(port, &i2c_port) != ESP_OK ) {
-        return ESP_FAIL;
-    }
+int i2c_write(uint32_t port, uint32_t address, uint8_t *data_out, uint32_t length_out) {
+    I2cOp_t op = { .address = address, .flags = I2C_OP_WRITE, .data = data_out, .len = length_out };
 
-    // Create link handle
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    return i2c_transaction(port, &op, 1);
+}
 
-    // Build command
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, address | I2C_MASTER_READ, ACK_CHECK_DIS);
-    i2c_master_write(cmd, data_out, length_out, ACK_CHECK_EN);
-    if (length_in > 1) {
-        i2c_master_read(cmd, data_in, length_in - 1, ACK_VAL);
+int i2c_read(uint32_t port, uint32_t address, uint8_t *data_in, uint32_t length_in) {
+    if (length_in == 0) {
+        return ESP_OK;
     }
-    i2c_master_read_byte(cmd, data_in + length_in - 1, NACK_VAL);
-    i2c_master_stop(cmd);
 
-    // Execute command
-    esp_err_t ret = i2c_master_cmd_begin(i2c_port, cmd, 1000 / portTICK_RATE_MS);
+    I2cOp_t op = { .address = address, .flags = I2C_OP_READ, .data = data_in, .len = length_in };
 
-    // Remove link and return
-    i2c_cmd_link_delete(cmd);
-    return ret;
+    return i2c_transaction(port, &op, 1);
 }
 
+int i2c_write_read(uint32_t port, uint32_t address,
+        uint8_t *data_out, uint32_t length_out,
+        uint8_t *data_in, uint32_t length_in) {
+
+    // Write then read after a repeated start
+    I2cOp_t ops[2] = {
+        { .address = address, .flags = I2C_OP_WRITE, .data = data_out, .len = length_out },
+        { .address = address, .flags = I2C_OP_READ, .data = data_in, .len = length_in },
+    };
+
+    return i2c_transaction(port, ops, length_in > 0 ? 2 : 1);
+}
 
@@ -1,19 +1,42 @@
-
 #ifndef I2C_MGR_H
 #define I2C_MGR_H
 
 #include <stdint.h>
 
+#define I2C_MGR_PORTS               2
+#define I2C_MGR_DEFAULT_TIMEOUT_MS  1000
+
+// Maximum segments in a single transaction
+#define I2C_MGR_MAX_OPS             8
+
+// Transaction segment flags
+#define I2C_OP_WRITE                0x00
+#define I2C_OP_READ                 0x01
+
+// Transaction segment, each is sent with a (repeated) start and the address
+typedef struct {
+    uint32_t    address;
+    uint32_t    flags;
+    uint8_t     *data;
+    uint32_t    len;
+} I2cOp_t;
+
 int i2c_init(uint32_t port, uint32_t freq, uint32_t sda, uint32_t scl);
 
 int i2c_deinit(uint32_t port);
 
+int i2c_set_timeout(uint32_t port, uint32_t timeout_ms);
+
 int i2c_write(uint32_t port, uint32_t address, uint8_t *data_out, uint32_t length_out);
 
 int i2c_read(uint32_t port, uint32_t address, uint8_t *data_in, uint32_t length_in);
 
-int i2c_write_read(int port, int address,
-                    uint8_t *data_out, int length_out,
-                    uint8_t *data_in, int length_in);
+int i2c_write_read(uint32_t port, uint32_t address,
+                    uint8_t *data_out, uint32_t length_out,
+                    uint8_t *data_in, uint32_t length_in);
+
+// Execute a list of segments as a single transaction, terminated by one stop
+int i2c_transaction(uint32_t port, const I2cOp_t *ops, uint32_t count);
 
 #endif
+
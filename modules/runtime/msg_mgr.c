@@ -0,0 +1,404 @@
+#include "msg_mgr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "mqtt_mgr.h"
+#include "event_mgr.h"
+#include "config_mgr.h"
+
+#define TAG "MSG_MGR"
+
+typedef struct {
+    uint32_t    topic_len;
+    uint32_t    data_len;
+} MsgHeader_t;
+
+typedef struct {
+    WasmTask_t          *task;
+
+    // Event applets are posted messages rather than queueing them
+    bool                events;
+
+    // Topic filters, empty if unused
+    char                subs[MSG_MGR_MAX_SUBS][MSG_MGR_TOPIC_LEN];
+
+    // Messages are written by the MQTT task (with the lock held) and read without
+    // locking by the applet, the signal only wakes a waiting applet
+    uint8_t             *ring;
+    uint32_t            head;
+    uint32_t            tail;
+    uint32_t            dropped;
+    SemaphoreHandle_t   signal;
+} MsgApplet_t;
+
+static MsgApplet_t applets[MSG_MGR_MAX_APPLETS];
+
+// Serialises subscription changes against delivery
+static SemaphoreHandle_t msg_lock = NULL;
+
+
+static void msg_ring_write(MsgApplet_t* a, uint32_t pos, const void* data, uint32_t len) {
+    uint32_t offset = pos & (MSG_MGR_QUEUE_SIZE - 1);
+    uint32_t n = (len < MSG_MGR_QUEUE_SIZE - offset) ? len : MSG_MGR_QUEUE_SIZE - offset;
+
+    memcpy(a->ring + offset, data, n);
+    memcpy(a->ring, (const uint8_t*) data + n, len - n);
+}
+
+static void msg_ring_read(MsgApplet_t* a, uint32_t pos, void* data, uint32_t len) {
+    uint32_t offset = pos & (MSG_MGR_QUEUE_SIZE - 1);
+    uint32_t n = (len < MSG_MGR_QUEUE_SIZE - offset) ? len : MSG_MGR_QUEUE_SIZE - offset;
+
+    memcpy(data, a->ring + offset, n);
+    memcpy((uint8_t*) data + n, a->ring, len - n);
+}
+
+static bool msg_local(const char* topic) {
+    return topic[0] == '$';
+}
+
+static bool msg_matches(MsgApplet_t* a, const char* topic, uint32_t topic_len) {
+    for (int i=0; i<MSG_MGR_MAX_SUBS; i++) {
+        // As with MQTT, wildcards at the start of a filter don't match local topics
+        if (msg_local(topic) && (a->subs[i][0] == '#' || a->subs[i][0] == '+')) {
+            continue;
+        }
+        if (a->subs[i][0] != 0 && MQTT_MGR_topic_match(a->subs[i], topic, topic_len)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Copy a message straight from the client buffer to each subscribed applet
+static bool msg_deliver(const char* topic, uint32_t topic_len, const uint8_t* data, uint32_t len) {
+    bool delivered = false;
+
+    xSemaphoreTake(msg_lock, portMAX_DELAY);
+
+    for (int i=0; i<MSG_MGR_MAX_APPLETS; i++) {
+        MsgApplet_t* a = &applets[i];
+        if (a->task == NULL || !msg_matches(a, topic, topic_len)) {
+            continue;
+        }
+
+        delivered = true;
+
+        if (a->events) {
+            char name[MSG_MGR_TOPIC_LEN];
+            if (topic_len >= sizeof(name)) {
+                __atomic_fetch_add(&a->dropped, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+            memcpy(name, topic, topic_len);
+            name[topic_len] = 0;
+
+            if (EVENT_MGR_post_mqtt(a->task, name, data, len) < 0) {
+                __atomic_fetch_add(&a->dropped, 1, __ATOMIC_RELAXED);
+            }
+            continue;
+        }
+
+        MsgHeader_t header = { .topic_len = topic_len, .data_len = len };
+        uint32_t size = sizeof(header) + topic_len + len;
+
+        uint32_t head = a->head;
+        uint32_t used = head - __atomic_load_n(&a->tail, __ATOMIC_ACQUIRE);
+
+        // Slow applets lose new messages rather than stalling the client
+        if (size > MSG_MGR_QUEUE_SIZE - used) {
+            __atomic_fetch_add(&a->dropped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        msg_ring_write(a, head, &header, sizeof(header));
+        msg_ring_write(a, head + sizeof(header), topic, topic_len);
+        msg_ring_write(a, head + sizeof(header) + topic_len, data, len);
+
+        __atomic_store_n(&a->head, head + size, __ATOMIC_RELEASE);
+
+        xSemaphoreGive(a->signal);
+    }
+
+    xSemaphoreGive(msg_lock);
+
+    return delivered;
+}
+
+// Forward committed configuration changes, to event applets as on_config_changed and to
+// subscribers of MSG_MGR_CONFIG_TOPIC with the new value (empty once cleared)
+static void msg_config_changed(void *arg, esp_event_base_t event_base,
+        int32_t event_id, void *event_data) {
+    const config_manager_changes_t* changes = (const config_manager_changes_t*) event_data;
+
+    char topic[MSG_MGR_TOPIC_LEN];
+    char val[CONFIG_MGR_MAX_VAL];
+
+    uint32_t count = (changes->count < CONFIG_MGR_MAX_CHANGES) ? changes->count : CONFIG_MGR_MAX_CHANGES;
+
+    for (uint32_t i=0; i<count; i++) {
+        const char* key = changes->keys[i];
+
+        EVENT_MGR_post_config(key);
+
+        if (CONFIG_MGR_get(key, val, sizeof(val)) != ESP_OK) {
+            val[0] = 0;
+        }
+
+        int len = snprintf(topic, sizeof(topic), MSG_MGR_CONFIG_TOPIC "/%s", key);
+        msg_deliver(topic, len, (const uint8_t*) val, strlen(val));
+    }
+
+    // Keys past those listed are unknown, an empty key says to re-read everything
+    if (changes->count > CONFIG_MGR_MAX_CHANGES) {
+        EVENT_MGR_post_config("");
+        msg_deliver(MSG_MGR_CONFIG_TOPIC, strlen(MSG_MGR_CONFIG_TOPIC), (const uint8_t*) "", 0);
+    }
+}
+
+int MSG_MGR_init() {
+    msg_lock = xSemaphoreCreateMutex();
+    if (msg_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate message lock");
+        return -1;
+    }
+
+    memset(applets, 0, sizeof(applets));
+
+    MQTT_MGR_set_message_hook(msg_deliver);
+
+    int res = esp_event_handler_register(CONFIG_MGR_EVENT_BASE, CONFIG_MGR_EVENT_CHANGED, &msg_config_changed, NULL);
+    if (res != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register config handler: %d", res);
+        return -2;
+    }
+
+    return 0;
+}
+
+// Copy a filter or topic from wasm memory, returns false if it is empty or too long
+static bool msg_topic(char* topic, const char* src, uint32_t len) {
+    if (len == 0 || len >= MSG_MGR_TOPIC_LEN || memchr(src, 0, len) != NULL) {
+        return false;
+    }
+
+    memcpy(topic, src, len);
+    topic[len] = 0;
+
+    return true;
+}
+
+int MSG_MGR_subscribe(WasmTask_t* task, const char* filter, uint32_t len, int qos, bool events) {
+    char topic[MSG_MGR_TOPIC_LEN];
+    if (msg_lock == NULL || !msg_topic(topic, filter, len)) {
+        return -1;
+    }
+
+    int res = 0;
+    int sub = -1;
+    bool subscribe = false;
+
+    xSemaphoreTake(msg_lock, portMAX_DELAY);
+
+    MsgApplet_t* a = task->msg;
+    for (int i=0; i<MSG_MGR_MAX_APPLETS && a == NULL; i++) {
+        if (applets[i].task == NULL) {
+            a = &applets[i];
+        }
+    }
+
+    if (a == NULL) {
+        res = -2;
+        goto subscribe_done;
+    }
+
+    if (a->task == NULL) {
+        // Signals are kept when a slot is released
+        if (!events && a->signal == NULL && (a->signal = xSemaphoreCreateBinary()) == NULL) {
+            res = -3;
+            goto subscribe_done;
+        }
+        if (!events && (a->ring = malloc(MSG_MGR_QUEUE_SIZE)) == NULL) {
+            res = -3;
+            goto subscribe_done;
+        }
+
+        a->task = task;
+        a->events = events;
+        a->head = 0;
+        a->tail = 0;
+        a->dropped = 0;
+        memset(a->subs, 0, sizeof(a->subs));
+
+        task->msg = a;
+    }
+
+    for (int i=0; i<MSG_MGR_MAX_SUBS; i++) {
+        if (strcmp(a->subs[i], topic) == 0) {
+            // Already subscribed
+            goto subscribe_done;
+        }
+        if (a->subs[i][0] == 0 && sub < 0) {
+            sub = i;
+        }
+    }
+
+    if (sub < 0) {
+        res = -4;
+        goto subscribe_done;
+    }
+
+    strcpy(a->subs[sub], topic);
+    subscribe = true;
+
+subscribe_done:
+    xSemaphoreGive(msg_lock);
+
+    // Outside the lock as the client holds its own lock while delivering messages
+    if (subscribe && !msg_local(topic) && MQTT_MGR_subscribe(topic, qos) < 0) {
+        xSemaphoreTake(msg_lock, portMAX_DELAY);
+        a->subs[sub][0] = 0;
+        xSemaphoreGive(msg_lock);
+
+        res = -5;
+    }
+
+    return res;
+}
+
+int MSG_MGR_unsubscribe(WasmTask_t* task, const char* filter, uint32_t len) {
+    char topic[MSG_MGR_TOPIC_LEN];
+    if (msg_lock == NULL || !msg_topic(topic, filter, len)) {
+        return -1;
+    }
+
+    int res = -2;
+
+    xSemaphoreTake(msg_lock, portMAX_DELAY);
+
+    MsgApplet_t* a = task->msg;
+    for (int i=0; a != NULL && i<MSG_MGR_MAX_SUBS; i++) {
+        if (strcmp(a->subs[i], topic) == 0) {
+            a->subs[i][0] = 0;
+            res = 0;
+            break;
+        }
+    }
+
+    xSemaphoreGive(msg_lock);
+
+    if (res == 0 && !msg_local(topic)) {
+        MQTT_MGR_unsubscribe(topic);
+    }
+
+    return res;
+}
+
+int MSG_MGR_receive(WasmTask_t* task, uint8_t* buff, uint32_t len, uint32_t* topic_len, uint32_t timeout_ms) {
+    MsgApplet_t* a = task->msg;
+    if (a == NULL || a->ring == NULL) {
+        return -1;
+    }
+
+    // Round up so short timeouts still wait for at least a tick
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = ((uint64_t) timeout_ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS;
+
+    while (true) {
+        // Ending the task wakes it through the signal
+        if (__atomic_load_n(&task->cancel, __ATOMIC_ACQUIRE)) {
+            return 0;
+        }
+
+        uint32_t tail = a->tail;
+        uint32_t head = __atomic_load_n(&a->head, __ATOMIC_ACQUIRE);
+
+        if (head != tail) {
+            MsgHeader_t header;
+            msg_ring_read(a, tail, &header, sizeof(header));
+
+            uint32_t size = header.topic_len + header.data_len;
+
+            // Messages that don't fit are dropped so they can't block the queue, the applet
+            // learns the size it needed and can grow its buffer
+            if (size > len) {
+                __atomic_store_n(&a->tail, tail + sizeof(header) + size, __ATOMIC_RELEASE);
+                __atomic_fetch_add(&a->dropped, 1, __ATOMIC_RELAXED);
+
+                *topic_len = size;
+                return -2;
+            }
+
+            msg_ring_read(a, tail + sizeof(header), buff, size);
+            __atomic_store_n(&a->tail, tail + sizeof(header) + size, __ATOMIC_RELEASE);
+
+            *topic_len = header.topic_len;
+            return size;
+        }
+
+        // The signal may be stale so the ring is always re-checked
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout || xSemaphoreTake(a->signal, timeout - elapsed) != pdTRUE) {
+            return 0;
+        }
+    }
+}
+
+uint32_t MSG_MGR_dropped(WasmTask_t* task) {
+    MsgApplet_t* a = task->msg;
+    if (a == NULL) {
+        return 0;
+    }
+
+    return __atomic_exchange_n(&a->dropped, 0, __ATOMIC_RELAXED);
+}
+
+void MSG_MGR_wake(WasmTask_t* task) {
+    if (msg_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(msg_lock, portMAX_DELAY);
+
+    MsgApplet_t* a = task->msg;
+    if (a != NULL && a->signal != NULL) {
+        xSemaphoreGive(a->signal);
+    }
+
+    xSemaphoreGive(msg_lock);
+}
+
+void MSG_MGR_release(WasmTask_t* task) {
+    if (msg_lock == NULL || task->msg == NULL) {
+        return;
+    }
+
+    char subs[MSG_MGR_MAX_SUBS][MSG_MGR_TOPIC_LEN];
+
+    xSemaphoreTake(msg_lock, portMAX_DELAY);
+
+    MsgApplet_t* a = task->msg;
+    memcpy(subs, a->subs, sizeof(subs));
+
+    free(a->ring);
+    a->ring = NULL;
+    a->task = NULL;
+    task->msg = NULL;
+
+    xSemaphoreGive(msg_lock);
+
+    for (int i=0; i<MSG_MGR_MAX_SUBS; i++) {
+        if (subs[i][0] != 0 && !msg_local(subs[i])) {
+            MQTT_MGR_unsubscribe(subs[i]);
+        }
+    }
+}
+
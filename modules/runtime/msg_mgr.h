@@ -0,0 +1,49 @@
+#ifndef MSG_MGR_H
+#define MSG_MGR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "runtime.h"
+
+// Applets with subscriptions at once
+#define MSG_MGR_MAX_APPLETS     4
+
+// MQTT subscriptions per applet
+#define MSG_MGR_MAX_SUBS        4
+
+// Received message bytes queued per applet (topic, payload and an 8 byte header each), must be a power of two
+#define MSG_MGR_QUEUE_SIZE      4096
+
+// Topic filters and published topics, including the terminator
+#define MSG_MGR_TOPIC_LEN       64
+
+// Topics starting with '$' are local to the device and never subscribed on the broker.
+// Configuration changes are delivered on MSG_MGR_CONFIG_TOPIC "/<key>" with the new value.
+#define MSG_MGR_CONFIG_TOPIC    "$config"
+
+// Per applet message routing for the MQTT host API. Messages matching an applet's
+// subscriptions are queued for mqtt_receive, or posted to on_mqtt_message for event applets.
+int MSG_MGR_init();
+
+// Subscribe a task to a topic filter
+int MSG_MGR_subscribe(WasmTask_t* task, const char* filter, uint32_t len, int qos, bool events);
+
+int MSG_MGR_unsubscribe(WasmTask_t* task, const char* filter, uint32_t len);
+
+// Wait for the next queued message, copying the topic and then the payload into buff.
+// Returns the bytes copied, 0 on timeout, -1 if there is no queue or -2 if the next
+// message does not fit (it is dropped and counted, with topic_len set to the size needed).
+int MSG_MGR_receive(WasmTask_t* task, uint8_t* buff, uint32_t len, uint32_t* topic_len, uint32_t timeout_ms);
+
+// Messages dropped for a task (full queue or too big for the buffer) since the last call
+uint32_t MSG_MGR_dropped(WasmTask_t* task);
+
+// Wake a task waiting in MSG_MGR_receive, used when ending it
+void MSG_MGR_wake(WasmTask_t* task);
+
+// Drop a task's subscriptions and queue once it has stopped
+void MSG_MGR_release(WasmTask_t* task);
+
+#endif
+
@@ -7,249 +7,1867 @@
 #include <unistd.h>
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #include "esp_system.h"
 #include "esp_log.h"
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_ota_ops.h"
+#endif
+
+#include "wasm3.h"
+#include "m3_env.h"
+#include "m3_api_defs.h"
+#include "m3_api_wasi.h"
+#include "m3_env.h"
+#include "m3_exception.h"
+#include "m3_info.h"
+#include "extra/wasi_core.h"
+
+#include "m3_api_esp_wasi.h"
+
+#include "config_mgr.h"
+#include "event_mgr.h"
+#include "gpio_mgr.h"
+#include "i2c_mgr.h"
+#include "msg_mgr.h"
+#include "spi_mgr.h"
+#include "mqtt_mgr.h"
+#include "telemetry_mgr.h"
+
+
+#define TAG "WASM"
+
+// Seems we need quite a lot of stack for this task...
+#define STACK_SIZE  (40 * 1024)
+
+// wasm_run result for applets handed to the event dispatcher, which keeps them loaded
+#define WASM_RUN_EVENTS     1
+
+// Tasks that can sleep on a timer at once, others fall back to tick delays
+#define WASM_SLEEP_SLOTS    8
+
+// How long WASM_end_task waits for a task to stop, and the slice blocking host calls wait in
+#define WASM_END_TIMEOUT_MS     2000
+#define WASM_END_POLL_MS        100
+
+// Samples converted per telemetry call in value_write_batch
+#define WASM_TELEMETRY_CHUNK    16
+
+// Function names kept in a profile snapshot, longer names are truncated
+#define WASM_PROFILE_NAME_LEN   48
+
+void vWasmTask( void * pvParameters );
+int wasm_run(WasmTask_t* wasmTask);
+int wasm_load(IM3Runtime runtime, const uint8_t* data, uint32_t len, IM3Module* module);
+
+// Module cache entry, keeps a parsed module and its compiled code alive between runs
+typedef struct {
+    uint32_t        crc;
+    uint32_t        data_len;
+
+    // Copy of the WASM binary, the parsed module references this
+    // For execute-in-place tasks this is the entry's own mapping of the slot
+    uint8_t         *data;
+    uint32_t        xip_slot;
+    XipMapping_t    mapping;
+
+    IM3Environment  env;
+    IM3Runtime      runtime;
+
+    bool            loaded;
+    bool            in_use;
+    TickType_t      last_used;
+} WasmCacheEntry_t;
+
+static WasmCacheEntry_t wasm_cache[WASM_CACHE_SIZE];
+static SemaphoreHandle_t wasm_cache_lock = NULL;
+
+// Guards task runtime pointers so profile readers never see a freed runtime
+static SemaphoreHandle_t wasm_runtime_lock = NULL;
+
+// Tasks are ended by trapping at their next call or host call, never deleted mid-execution
+// as they may hold any lock. Tasks waiting to stop are counted to keep m3_Yield cheap.
+static const char wasm_trap_ended[] = "[trap] task ended";
+static uint32_t wasm_ending = 0;
+
+static bool wasm_task_ending(WasmTask_t* task) {
+    return task != NULL && __atomic_load_n(&task->cancel, __ATOMIC_ACQUIRE);
+}
+
+// Set or clear a task's stop flag, must be called with the runtime lock held
+static void wasm_set_cancel(WasmTask_t* task, bool cancel) {
+    if (task->cancel == cancel) {
+        return;
+    }
+
+    __atomic_store_n(&task->cancel, cancel, __ATOMIC_RELEASE);
+    if (cancel) {
+        __atomic_add_fetch(&wasm_ending, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_sub_fetch(&wasm_ending, 1, __ATOMIC_RELAXED);
+    }
+}
+
+#ifdef ESP_PLATFORM
+
+#if configNUM_THREAD_LOCAL_STORAGE_POINTERS <= WASM_TLS_INDEX
+#error "CONFIG_FREERTOS_THREAD_LOCAL_STORAGE_POINTERS must be greater than WASM_TLS_INDEX"
+#endif
+
+// Called on every wasm and host function call
+M3Result m3_Yield() {
+    if (__atomic_load_n(&wasm_ending, __ATOMIC_RELAXED) == 0) {
+        return m3Err_none;
+    }
+
+    WasmTask_t* task = pvTaskGetThreadLocalStoragePointer(NULL, WASM_TLS_INDEX);
+    return wasm_task_ending(task) ? wasm_trap_ended : m3Err_none;
+}
+
+// Tasks sleeping on a one-shot timer. Timers are created once and never freed, and
+// tasks are removed (waiting out any wake in flight) before they exit.
+typedef struct {
+    esp_timer_handle_t  timer;
+    TaskHandle_t        task;
+    bool                waking;
+} WasmSleeper_t;
+
+static WasmSleeper_t wasm_sleepers[WASM_SLEEP_SLOTS];
+static portMUX_TYPE wasm_sleep_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t wasm_time_us() {
+    return esp_timer_get_time();
+}
+
+// Runtimes on different tasks share the wasm3 fixed heap (when enabled), allocations are
+// constant time so a critical section is cheaper than a mutex
+static portMUX_TYPE wasm_heap_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void m3_HeapLock() {
+    portENTER_CRITICAL(&wasm_heap_mux);
+}
+
+void m3_HeapUnlock() {
+    portEXIT_CRITICAL(&wasm_heap_mux);
+}
+
+#if WASM_MEMORY_PSRAM
+void* m3_LinearMemoryRealloc(void* ptr, size_t new_size, size_t old_size) {
+    void* mem = heap_caps_realloc(ptr, new_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (mem == NULL) {
+        mem = heap_caps_realloc(ptr, new_size, MALLOC_CAP_8BIT);
+    }
+
+    if (mem != NULL && new_size > old_size) {
+        memset((uint8_t*) mem + old_size, 0, new_size - old_size);
+    }
+
+    return mem;
+}
+
+void m3_LinearMemoryFree(void* ptr) {
+    heap_caps_free(ptr);
+}
+#endif
+
+static void wasm_sleep_wake(void* arg) {
+    WasmSleeper_t* s = (WasmSleeper_t*) arg;
+
+    // Notify outside the critical section, waking holds off the sleeper's exit until it lands
+    portENTER_CRITICAL(&wasm_sleep_mux);
+    TaskHandle_t task = s->task;
+    s->waking = (task != NULL);
+    portEXIT_CRITICAL(&wasm_sleep_mux);
+
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+
+        portENTER_CRITICAL(&wasm_sleep_mux);
+        s->waking = false;
+        portEXIT_CRITICAL(&wasm_sleep_mux);
+    }
+}
+
+static int wasm_sleep_init() {
+    for (int i=0; i<WASM_SLEEP_SLOTS; i++) {
+        esp_timer_create_args_t args = {
+            .callback = wasm_sleep_wake,
+            .arg = &wasm_sleepers[i],
+            .name = "wasm_sleep",
+        };
+
+        if (esp_timer_create(&args, &wasm_sleepers[i].timer) != ESP_OK) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Drop a task from the sleepers before it exits
+static void wasm_sleep_cancel(TaskHandle_t task) {
+    for (int i=0; i<WASM_SLEEP_SLOTS; i++) {
+        WasmSleeper_t* s = &wasm_sleepers[i];
+
+        portENTER_CRITICAL(&wasm_sleep_mux);
+        bool match = (s->task == task);
+        if (match) {
+            s->task = NULL;
+        }
+        portEXIT_CRITICAL(&wasm_sleep_mux);
+
+        if (!match) {
+            continue;
+        }
+
+        esp_timer_stop(s->timer);
+
+        // A callback that already took the handle is only a notify away from done
+        bool waking = true;
+        while (waking) {
+            portENTER_CRITICAL(&wasm_sleep_mux);
+            waking = s->waking;
+            portEXIT_CRITICAL(&wasm_sleep_mux);
+
+            if (waking) {
+                taskYIELD();
+            }
+        }
+    }
+}
+
+// Sleep until a deadline on the monotonic clock, with microsecond resolution.
+// Ending the task wakes it early.
+static void wasm_sleep_until(WasmTask_t* task, int64_t deadline) {
+    int64_t remaining = deadline - esp_timer_get_time();
+    if (remaining <= 0) {
+        return;
+    }
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    WasmSleeper_t* s = NULL;
+
+    portENTER_CRITICAL(&wasm_sleep_mux);
+    for (int i=0; i<WASM_SLEEP_SLOTS; i++) {
+        if (wasm_sleepers[i].task == NULL && !wasm_sleepers[i].waking) {
+            s = &wasm_sleepers[i];
+            s->task = self;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&wasm_sleep_mux);
+
+    // Ticks are rounded up, never waking before the deadline
+    TickType_t ticks = (remaining + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000);
+
+    // WASM_end_task notifies after flagging the task, so check once stale notifications are cleared
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    if (!wasm_task_ending(task)) {
+        if (s != NULL) {
+            esp_timer_start_once(s->timer, remaining);
+
+            // Bounded a tick past the deadline in case the wake-up is lost
+            ulTaskNotifyTake(pdTRUE, ticks + 1);
+        } else {
+            // No timer free, fall back to whole ticks
+            ulTaskNotifyTake(pdTRUE, ticks);
+        }
+    }
+
+    if (s != NULL) {
+        wasm_sleep_cancel(self);
+    }
+}
+
+#else
+
+static int64_t wasm_time_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int wasm_sleep_init() {
+    return 0;
+}
+
+static void wasm_sleep_until(WasmTask_t* task, int64_t deadline) {
+    struct timespec ts = { .tv_sec = deadline / 1000000, .tv_nsec = (deadline % 1000000) * 1000 };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+    }
+}
+
+#endif
+
+int WASM_init() {
+    wasm_cache_lock = xSemaphoreCreateMutex();
+    if (wasm_cache_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate module cache lock");
+        return -1;
+    }
+
+    wasm_runtime_lock = xSemaphoreCreateMutex();
+    if (wasm_runtime_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate runtime lock");
+        return -1;
+    }
+
+    memset(wasm_cache, 0, sizeof(wasm_cache));
+
+    if (wasm_sleep_init() < 0) {
+        ESP_LOGE(TAG, "Failed to allocate sleep timers");
+        return -1;
+    }
+
+    if (EVENT_MGR_init() < 0) {
+        return -1;
+    }
+
+    if (MSG_MGR_init() < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Free a cache entry and everything it owns, must be called with the cache locked
+static void wasm_cache_free(WasmCacheEntry_t* entry) {
+    if (entry->runtime != NULL) {
+        m3_FreeRuntime(entry->runtime);
+    }
+    if (entry->env != NULL) {
+        m3_FreeEnvironment(entry->env);
+    }
+    if (entry->mapping != NULL) {
+        XIP_MGR_unmap(entry->mapping);
+    } else {
+        free(entry->data);
+    }
+
+    memset(entry, 0, sizeof(WasmCacheEntry_t));
+}
+
+// Acquire a cache entry for a task, NULL if the task should run uncached.
+// If the returned entry is loaded the module can be reset and run, otherwise
+// the entry holds a copy of the task binary for the module to be parsed from.
+static WasmCacheEntry_t* wasm_cache_acquire(const WasmTask_t* task) {
+    WasmCacheEntry_t* entry = NULL;
+
+    xSemaphoreTake(wasm_cache_lock, portMAX_DELAY);
+
+    // Look for a loaded module with the same binary. Mapped entries are only shared by tasks
+    // executing from the same slot, as reinstalling a slot erases what they read from.
+    for (int i=0; i<WASM_CACHE_SIZE; i++) {
+        bool mapped = (wasm_cache[i].mapping != NULL);
+        if (wasm_cache[i].loaded && wasm_cache[i].crc == task->crc && wasm_cache[i].data_len == task->data_len
+                && mapped == (task->mapping != NULL) && (!mapped || wasm_cache[i].xip_slot == task->xip_slot)) {
+            entry = &wasm_cache[i];
+            break;
+        }
+    }
+
+    if (entry != NULL) {
+        // Modules can only be run by one task at a time
+        if (entry->in_use) {
+            entry = NULL;
+        } else {
+            entry->in_use = true;
+        }
+        goto done;
+    }
+
+    // Otherwise claim an empty or the least recently used idle slot
+    for (int i=0; i<WASM_CACHE_SIZE; i++) {
+        WasmCacheEntry_t* e = &wasm_cache[i];
+        if (e->in_use) {
+            continue;
+        }
+
+        if (entry == NULL || (entry->loaded && !e->loaded)
+                || (entry->loaded && e->loaded && e->last_used < entry->last_used)) {
+            entry = e;
+        }
+    }
+
+    if (entry == NULL) {
+        goto done;
+    }
+
+    wasm_cache_free(entry);
+
+    if (task->mapping != NULL) {
+        // Execute-in-place binaries are mapped again rather than copied to RAM
+        const uint8_t* data;
+        uint32_t len;
+        if (XIP_MGR_map(task->xip_slot, &data, &len, NULL, &entry->mapping) < 0) {
+            ESP_LOGI(TAG, "Failed to map module cache data, running uncached");
+            entry = NULL;
+            goto done;
+        }
+        entry->data = (uint8_t*) data;
+        entry->xip_slot = task->xip_slot;
+
+    } else {
+        entry->data = malloc(task->data_len);
+        if (entry->data == NULL) {
+            ESP_LOGI(TAG, "Failed to allocate module cache data, running uncached");
+            entry = NULL;
+            goto done;
+        }
+
+        memcpy(entry->data, task->data, task->data_len);
+    }
+    entry->crc = task->crc;
+    entry->data_len = task->data_len;
+    entry->in_use = true;
+
+done:
+    xSemaphoreGive(wasm_cache_lock);
+
+    return entry;
+}
+
+// Return a cache entry, if the entry is not valid it is freed
+static void wasm_cache_release(WasmCacheEntry_t* entry, bool valid) {
+    xSemaphoreTake(wasm_cache_lock, portMAX_DELAY);
+
+    if (valid && entry->loaded) {
+        // Linear memory is dropped while idle and re-initialised on the next run
+        m3_ReleaseRuntimeMemory(entry->runtime);
+        entry->last_used = xTaskGetTickCount();
+        entry->in_use = false;
+    } else {
+        wasm_cache_free(entry);
+    }
+
+    xSemaphoreGive(wasm_cache_lock);
+}
+
+#if WASM_COMPILED_IMAGES
+
+// FNV-1a, for image paths and the host build id
+static uint32_t wasm_hash(uint32_t hash, const void* data, uint32_t len) {
+    const uint8_t* p = data;
+    for (uint32_t i=0; i<len; i++) {
+        hash = (hash ^ p[i]) * 16777619;
+    }
+    return hash;
+}
+
+static void wasm_image_path(char* path, uint32_t len, const char* name) {
+    snprintf(path, len, WASM_IMAGE_PATH_FMT, wasm_hash(2166136261, name, strlen(name)));
+}
+
+static M3Result wasm_image_write(void* context, const void* data, uint32_t len) {
+    if (fwrite(data, 1, len, (FILE*) context) != len) {
+        return "compiled image write failed";
+    }
+    return m3Err_none;
+}
+
+// Save the compiled module for an applet, prefixed with the binary CRC it was compiled from
+static int wasm_image_save(IM3Module module, const char* name, uint32_t crc) {
+    char path[32];
+    wasm_image_path(path, sizeof(path), name);
+
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        ESP_LOGI(TAG, "Failed to open compiled image %s", path);
+        return -1;
+    }
+
+    M3Result result = wasm_image_write(f, &crc, sizeof(crc));
+    if (result == m3Err_none) {
+        result = m3_SaveCompiledImage(module, wasm_image_write, f);
+    }
+
+    fclose(f);
+
+    if (result) {
+        ESP_LOGI(TAG, "SaveCompiledImage: %s", result);
+        remove(path);
+        return -2;
+    }
+
+    ESP_LOGI(TAG, "Saved compiled image %s", path);
+
+    return 0;
+}
+
+// Restore a previously saved compiled module, stale images (such as from an older binary) are removed
+static int wasm_image_load(IM3Module module, const char* name, uint32_t crc) {
+    char path[32];
+    wasm_image_path(path, sizeof(path), name);
+
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+
+    fseek(f, 0L, SEEK_END);
+    uint32_t len = ftell(f);
+    rewind(f);
+
+    uint8_t* image = malloc(len);
+    if (image == NULL) {
+        ESP_LOGI(TAG, "Failed to allocate %d bytes for compiled image", len);
+        fclose(f);
+        return -2;
+    }
+
+    uint32_t res = fread(image, 1, len, f);
+    fclose(f);
+
+    M3Result result = m3Err_none;
+    if (res != len || len < sizeof(crc)) {
+        result = "compiled image read failed";
+    } else if (memcmp(image, &crc, sizeof(crc)) != 0) {
+        result = "compiled image is for another binary";
+    } else {
+        result = m3_LoadCompiledImage(module, image + sizeof(crc), len - sizeof(crc));
+    }
+
+    free(image);
+
+    if (result) {
+        ESP_LOGI(TAG, "LoadCompiledImage %s: %s", path, result);
+        remove(path);
+        return -3;
+    }
+
+    ESP_LOGI(TAG, "Loaded compiled image %s", path);
+
+    return 0;
+}
+
+#endif
+
+int WASM_cache_flush() {
+    int count = 0;
+
+    xSemaphoreTake(wasm_cache_lock, portMAX_DELAY);
+
+    for (int i=0; i<WASM_CACHE_SIZE; i++) {
+        if (wasm_cache[i].loaded && !wasm_cache[i].in_use) {
+            wasm_cache_free(&wasm_cache[i]);
+            count ++;
+        }
+    }
+
+    xSemaphoreGive(wasm_cache_lock);
+
+    return count;
+}
+
+int WASM_cache_flush_xip(uint32_t xip_slot) {
+    int res = 0;
+
+    xSemaphoreTake(wasm_cache_lock, portMAX_DELAY);
+
+    for (int i=0; i<WASM_CACHE_SIZE; i++) {
+        WasmCacheEntry_t* e = &wasm_cache[i];
+        if (e->mapping == NULL || e->xip_slot != xip_slot) {
+            continue;
+        }
+
+        if (e->in_use) {
+            res = -1;
+        } else {
+            wasm_cache_free(e);
+        }
+    }
+
+    xSemaphoreGive(wasm_cache_lock);
+
+    return res;
+}
+
+// Queued SPI transfers point into linear memory, so they are completed before it is moved
+M3Result m3_LinearMemoryMoving(IM3Runtime runtime) {
+    WasmTask_t* task = m3_GetUserData(runtime);
+    if (task != NULL && spi_wait_owner(task, SPI_MGR_DEFAULT_TIMEOUT_MS) != ESP_OK) {
+        return "SPI transfers pending";
+    }
+
+    return m3Err_none;
+}
+
+static void wasm_set_runtime(WasmTask_t* task, IM3Runtime runtime) {
+    xSemaphoreTake(wasm_runtime_lock, portMAX_DELAY);
+
+    // Host functions find their task through the runtime
+    if (runtime != NULL) {
+        m3_SetUserData(runtime, task);
+    } else if (task->runtime != NULL) {
+        m3_SetUserData(task->runtime, NULL);
+    }
+
+    task->runtime = runtime;
+    xSemaphoreGive(wasm_runtime_lock);
+}
+
+static void wasm_log_append(WasmTask_t* task, const char* buff, uint32_t len) {
+    // Only the newest WASM_LOG_SIZE bytes can be kept
+    uint32_t head = task->log_head;
+    if (len > WASM_LOG_SIZE) {
+        head += len - WASM_LOG_SIZE;
+        buff += len - WASM_LOG_SIZE;
+        len = WASM_LOG_SIZE;
+    }
+
+    __atomic_store_n(&task->log_reserved, head + len, __ATOMIC_RELEASE);
+
+    // Order the reservation before the copy below, a release store alone only orders what precedes it
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    uint32_t offset = head & (WASM_LOG_SIZE - 1);
+    uint32_t first = (len < WASM_LOG_SIZE - offset) ? len : WASM_LOG_SIZE - offset;
+    memcpy(task->log + offset, buff, first);
+    memcpy(task->log, buff + first, len - first);
+
+    __atomic_store_n(&task->log_head, head + len, __ATOMIC_RELEASE);
+}
+
+uint32_t WASM_log_read(WasmTask_t* task, uint32_t* cursor, char* buff, uint32_t len) {
+    uint32_t head = __atomic_load_n(&task->log_head, __ATOMIC_ACQUIRE);
+
+    // Skip anything already overwritten
+    uint32_t start = *cursor;
+    if (head - start > WASM_LOG_SIZE) {
+        start = head - WASM_LOG_SIZE;
+    }
+
+    uint32_t n = head - start;
+    if (n > len) {
+        n = len;
+    }
+
+    uint32_t offset = start & (WASM_LOG_SIZE - 1);
+    uint32_t first = (n < WASM_LOG_SIZE - offset) ? n : WASM_LOG_SIZE - offset;
+    memcpy(buff, task->log + offset, first);
+    memcpy(buff + first, task->log, n - first);
+
+    // Drop the front of the copy if the writer reserved over it while copying, the fence
+    // keeps the copy from being reordered past the re-check
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint32_t reserved = __atomic_load_n(&task->log_reserved, __ATOMIC_ACQUIRE);
+    if (reserved - start > WASM_LOG_SIZE) {
+        uint32_t skip = reserved - WASM_LOG_SIZE - start;
+        if (skip > n) {
+            skip = n;
+        }
+
+        memmove(buff, buff + skip, n - skip);
+        start += skip;
+        n -= skip;
+    }
+
+    *cursor = start + n;
+
+    return n;
+}
+
+typedef struct {
+    WasmWriter_t    writer;
+    void            *ctx;
+    const char      *kind;
+} WasmProfileCtx_t;
+
+static void wasm_profile_write(void* ctx, const char* name, uint64_t count, uint64_t time) {
+    WasmProfileCtx_t* p = (WasmProfileCtx_t*) ctx;
+    char line[96];
+
+    int len = snprintf(line, sizeof(line), "%s %s %llu %llu\r\n", p->kind, name,
+            (unsigned long long) count, (unsigned long long) time);
+    if (len >= sizeof(line)) {
+        len = sizeof(line) - 1;
+    }
+
+    p->writer(p->ctx, line, len);
+}
+
+// Function counters copied out under the runtime lock, so the writer runs without it
+typedef struct {
+    char        name[WASM_PROFILE_NAME_LEN];
+    uint64_t    count;
+    uint64_t    time;
+} WasmProfileEntry_t;
+
+typedef struct {
+    WasmProfileEntry_t  *entries;
+    uint32_t            count;
+    uint32_t            size;
+} WasmProfileSnapshot_t;
+
+static void wasm_profile_snapshot(void* ctx, const char* name, uint64_t count, uint64_t time) {
+    WasmProfileSnapshot_t* snap = (WasmProfileSnapshot_t*) ctx;
+
+    if (snap->count == snap->size) {
+        uint32_t size = snap->size ? snap->size * 2 : 16;
+        WasmProfileEntry_t* entries = realloc(snap->entries, size * sizeof(WasmProfileEntry_t));
+        if (entries == NULL) {
+            return;
+        }
+
+        snap->entries = entries;
+        snap->size = size;
+    }
+
+    WasmProfileEntry_t* e = &snap->entries[snap->count++];
+    strncpy(e->name, name ? name : "?", sizeof(e->name) - 1);
+    e->name[sizeof(e->name) - 1] = 0;
+    e->count = count;
+    e->time = time;
+}
+
+int WASM_profile(WasmTask_t* wasmTask, bool reset, WasmWriter_t writer, void* ctx) {
+    WasmProfileCtx_t p = { .writer = writer, .ctx = ctx };
+    WasmProfileSnapshot_t snap = { 0 };
+    int res = 0;
+
+    // Functions are profiled per runtime, use the running task if there is one
+    xSemaphoreTake(wasm_runtime_lock, portMAX_DELAY);
+
+    if (wasmTask->runtime != NULL) {
+        m3_GetFunctionProfile(wasmTask->runtime, wasm_profile_snapshot, &snap, reset);
+        xSemaphoreGive(wasm_runtime_lock);
+
+    } else {
+        xSemaphoreGive(wasm_runtime_lock);
+
+        // Otherwise fall back to an idle cached module from a previous run
+        xSemaphoreTake(wasm_cache_lock, portMAX_DELAY);
+
+        res = -1;
+        for (int i=0; i<WASM_CACHE_SIZE; i++) {
+            WasmCacheEntry_t* e = &wasm_cache[i];
+            if (e->loaded && !e->in_use && e->crc == wasmTask->crc && e->data_len == wasmTask->data_len) {
+                m3_GetFunctionProfile(e->runtime, wasm_profile_snapshot, &snap, reset);
+                res = 0;
+                break;
+            }
+        }
+
+        xSemaphoreGive(wasm_cache_lock);
+    }
+
+    // The writer may block on the network, so only write once the locks are released
+    char header[64];
+    int len = snprintf(header, sizeof(header), "# kind name count %s\r\n", WASM_PROFILE_TIME_UNIT);
+    writer(ctx, header, len);
+
+    p.kind = "fn";
+    for (uint32_t i=0; i<snap.count; i++) {
+        wasm_profile_write(&p, snap.entries[i].name, snap.entries[i].count, snap.entries[i].time);
+    }
+    free(snap.entries);
+
+    // Operation counts are shared by all runtimes
+    p.kind = "op";
+    m3_GetOpProfile(wasm_profile_write, &p, reset);
+
+    return res;
+}
+
+int WASM_launch_task(WasmTask_t* wasmTask) {
+    // Mark as running before launch so the task can not be started twice
+    wasmTask->running = true;
+    wasmTask->cancel = false;
+
+    // Launch task with the requested priority and core affinity
+    BaseType_t res = xTaskCreatePinnedToCore( vWasmTask, wasmTask->name, STACK_SIZE, wasmTask,
+            wasmTask->priority, &wasmTask->handle, wasmTask->core );
+    if (res != pdPASS) {
+        ESP_LOGI(TAG, "Failed to launch WASM task: %s", wasmTask->name);
+        wasmTask->running = false;
+        wasmTask->handle = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Stop an applet on the event dispatcher, flagging it first so a running handler traps at
+// its next call rather than holding up the detach
+static int wasm_end_events(WasmTask_t* wasmTask) {
+    xSemaphoreTake(wasm_runtime_lock, portMAX_DELAY);
+    wasm_set_cancel(wasmTask, true);
+    xSemaphoreGive(wasm_runtime_lock);
+
+    if (EVENT_MGR_detach(wasmTask) == -2) {
+        // Loops without calls never reach a check, the flag is cleared once the handler
+        // traps and the dispatcher releases the applet (see wasm_event_release)
+        ESP_LOGI(TAG, "WASM task %s has not stopped", wasmTask->name);
+        return -2;
+    }
+
+    // Gone, whether detached here or released by the dispatcher after trapping
+    xSemaphoreTake(wasm_runtime_lock, portMAX_DELAY);
+    wasm_set_cancel(wasmTask, false);
+    xSemaphoreGive(wasm_runtime_lock);
+
+    if (wasmTask->running) {
+        ESP_LOGI(TAG, "Failed to end WASM task %s", wasmTask->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+int WASM_end_task(WasmTask_t* wasmTask) {
+    // Event applets stay running without a task of their own (see wasm_event_release)
+    if (wasmTask->running && wasmTask->handle == NULL) {
+        return wasm_end_events(wasmTask);
+    }
+
+    if (wasmTask->handle == NULL) {
+        ESP_LOGI(TAG, "Failed to end WASM task %s", wasmTask->name);
+        return -1;
+    }
+
+    // Flag the task to trap at its next call and wake it from any wait, the handle is
+    // only cleared (under the lock) as the task exits so the notify can't outlive it
+    xSemaphoreTake(wasm_runtime_lock, portMAX_DELAY);
+    if (wasmTask->handle != NULL) {
+        wasm_set_cancel(wasmTask, true);
+        xTaskNotifyGive(wasmTask->handle);
+    }
+    xSemaphoreGive(wasm_runtime_lock);
+
+    MSG_MGR_wake(wasmTask);
+
+    // The task releases its runtime, cache entry and messages on the way out
+    TickType_t start = xTaskGetTickCount();
+    while (__atomic_load_n(&wasmTask->handle, __ATOMIC_ACQUIRE) != NULL) {
+        if (xTaskGetTickCount() - start >= WASM_END_TIMEOUT_MS / portTICK_PERIOD_MS) {
+            // Loops without calls never reach a check, the task stops at its next call
+            ESP_LOGI(TAG, "WASM task %s has not stopped", wasmTask->name);
+            return -2;
+        }
+
+        vTaskDelay(1);
+    }
+
+    // The task may have attached to the dispatcher before it saw the flag
+    if (wasmTask->running) {
+        return wasm_end_events(wasmTask);
+    }
+
+    return 0;
+}
+
+// WASM fetch arguments function
+m3ApiRawFunction(m3_arg_get)
+{
+    // Load arguments
+    m3ApiReturnType  (uint32_t)
+
+    // ptr is the task handle passed to main, kept for compatibility but not trusted
+    m3ApiGetArg      (uint32_t, ptr)
+    m3ApiGetArg      (uint32_t, index)
+
+    m3ApiGetArg      (uint32_t, buff_offset)
+    m3ApiGetArg      (uint32_t, buff_len_offset)
+
+    // Check args are valid
+    WasmTask_t* task = (runtime != NULL) ? m3_GetUserData(runtime) : NULL;
+    if (task == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    if ((uint64_t) buff_len_offset + sizeof(uint32_t) > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t buff_len;
+    memcpy(&buff_len, m3ApiOffsetToPtr(buff_len_offset), sizeof(buff_len));
+
+    if ((uint64_t) buff_offset + buff_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+    if (index >= task->arg_count) { m3ApiReturn(__WASI_EINVAL); }
+
+    // Copy the argument and return its length (capped at the buffer size)
+    strncpy((char*) m3ApiOffsetToPtr(buff_offset), task->args[index], buff_len);
+    buff_len = strnlen(task->args[index], buff_len);
+    memcpy(m3ApiOffsetToPtr(buff_len_offset), &buff_len, sizeof(buff_len));
+
+    m3ApiReturn(__WASI_ESUCCESS);
+}
+
+// WASM logging function
+m3ApiRawFunction(m3_log_write)
+{
+    // Load arguments
+    m3ApiReturnType  (uint32_t)
+    m3ApiGetArg      (uint32_t, buff_offset)
+    m3ApiGetArg      (uint32_t, buff_len)
+
+    // Check args are valid
+    if (runtime == NULL ) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    if ((uint64_t) buff_offset + buff_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    char* buff = m3ApiOffsetToPtr(buff_offset);
+
+    // Buffer in the task log ring where there is one, rather than blocking on the console
+    WasmTask_t* task = m3_GetUserData(runtime);
+    if (task != NULL) {
+        wasm_log_append(task, buff, buff_len);
+    }
+
+    if (task == NULL || WASM_LOG_STDOUT) {
+        fwrite(buff, 1, buff_len, stdout);
+    }
+
+    m3ApiReturn(__WASI_ESUCCESS);
+}
+
+// Legacy named integer sample, prefer value_register and the id based writes
+m3ApiRawFunction(m3_value_write)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, name_offset)
+    m3ApiGetArg      (uint32_t, name_len)
+    m3ApiGetArg      (int32_t, value)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    if ((uint64_t) name_offset + name_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t id = TELEMETRY_MGR_register(m3ApiOffsetToPtr(name_offset), name_len);
+    if (id < 0) { m3ApiReturn(id); }
+
+    TelemetrySample_t sample = {
+        .time_us = wasm_time_us(),
+        .value.i = value,
+        .id = id,
+        .type = TELEMETRY_TYPE_INT,
+    };
+
+    m3ApiReturn(TELEMETRY_MGR_write(&sample));
+}
+
+// Fetch the id for a telemetry name, registering it if required
+m3ApiRawFunction(m3_value_register)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, name_offset)
+    m3ApiGetArg      (uint32_t, name_len)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    if ((uint64_t) name_offset + name_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = TELEMETRY_MGR_register(m3ApiOffsetToPtr(name_offset), name_len);
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_value_write_int)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, id)
+    m3ApiGetArg      (int64_t, value)
+
+    // Check args are valid
+    if (runtime == NULL || id >= TELEMETRY_MGR_MAX_NAMES) { m3ApiReturn(__WASI_EINVAL); }
+
+    TelemetrySample_t sample = {
+        .time_us = wasm_time_us(),
+        .value.i = value,
+        .id = id,
+        .type = TELEMETRY_TYPE_INT,
+    };
+
+    m3ApiReturn(TELEMETRY_MGR_write(&sample));
+}
+
+m3ApiRawFunction(m3_value_write_float)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, id)
+    m3ApiGetArg      (double, value)
+
+    // Check args are valid
+    if (runtime == NULL || id >= TELEMETRY_MGR_MAX_NAMES) { m3ApiReturn(__WASI_EINVAL); }
+
+    TelemetrySample_t sample = {
+        .time_us = wasm_time_us(),
+        .value.f = value,
+        .id = id,
+        .type = TELEMETRY_TYPE_FLOAT,
+    };
+
+    m3ApiReturn(TELEMETRY_MGR_write(&sample));
+}
+
+// Telemetry sample as laid out in wasm memory, a zero time is replaced with the current time
+typedef struct {
+    uint32_t id;
+    uint32_t type;
+    int64_t  time_us;
+    uint64_t value;
+} WasmTelemetrySample_t;
+
+// Queue a set of samples with one call, returns the number queued
+m3ApiRawFunction(m3_value_write_batch)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, samples_offset)
+    m3ApiGetArg      (uint32_t, samples_count)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    if ((uint64_t) samples_offset + (uint64_t) samples_count * sizeof(WasmTelemetrySample_t) > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    int64_t now = wasm_time_us();
+
+    // Converted in chunks to bound the time spent in the telemetry critical section
+    TelemetrySample_t chunk[WASM_TELEMETRY_CHUNK];
+    int32_t queued = 0;
+
+    for (uint32_t i=0; i<samples_count; i+=WASM_TELEMETRY_CHUNK) {
+        uint32_t n = samples_count - i;
+        if (n > WASM_TELEMETRY_CHUNK) {
+            n = WASM_TELEMETRY_CHUNK;
+        }
+
+        for (uint32_t j=0; j<n; j++) {
+            WasmTelemetrySample_t s;
+            memcpy(&s, m3ApiOffsetToPtr(samples_offset + (i + j) * sizeof(WasmTelemetrySample_t)), sizeof(s));
+
+            if (s.id >= TELEMETRY_MGR_MAX_NAMES || s.type > TELEMETRY_TYPE_FLOAT) { m3ApiReturn(__WASI_EINVAL); }
+
+            chunk[j].time_us = s.time_us ? s.time_us : now;
+            chunk[j].value.i = s.value;
+            chunk[j].id = s.id;
+            chunk[j].type = s.type;
+        }
+
+        int32_t res = TELEMETRY_MGR_write_batch(chunk, n);
+        queued += res;
+
+        // Stop once the buffer is full
+        if ((uint32_t) res < n) {
+            break;
+        }
+    }
+
+    m3ApiReturn(queued);
+}
+
+// WASM logging function
+m3ApiRawFunction(m3_delay_ms)
+{
+    // Load arguments
+    m3ApiReturnType  (uint32_t)
+    m3ApiGetArg      (uint32_t, delay_ms)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    // Handlers share the dispatcher, sleeping in one would stall every event applet
+    if (EVENT_MGR_in_dispatcher()) { m3ApiReturn(__WASI_ENOTSUP); }
+
+    WasmTask_t* task = m3_GetUserData(runtime);
+
+    // Sleep to the microsecond rather than rounding down to whole ticks
+    wasm_sleep_until(task, wasm_time_us() + (int64_t) delay_ms * 1000);
+    if (wasm_task_ending(task)) { m3ApiTrap(wasm_trap_ended); }
+
+    m3ApiReturn(__WASI_ESUCCESS);
+}
+
+// Monotonic time since boot in microseconds
+m3ApiRawFunction(m3_time_us)
+{
+    m3ApiReturnType  (int64_t)
+
+    m3ApiReturn(wasm_time_us());
+}
+
+m3ApiRawFunction(m3_sleep_us)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, sleep_us)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+    if (EVENT_MGR_in_dispatcher()) { m3ApiReturn(__WASI_ENOTSUP); }
+
+    WasmTask_t* task = m3_GetUserData(runtime);
+    wasm_sleep_until(task, wasm_time_us() + sleep_us);
+    if (wasm_task_ending(task)) { m3ApiTrap(wasm_trap_ended); }
+
+    m3ApiReturn(__WASI_ESUCCESS);
+}
+
+// Sleep until an absolute time_us deadline, so periodic loops don't accumulate drift
+m3ApiRawFunction(m3_sleep_until)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (int64_t, deadline_us)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+    if (EVENT_MGR_in_dispatcher()) { m3ApiReturn(__WASI_ENOTSUP); }
+
+    WasmTask_t* task = m3_GetUserData(runtime);
+    wasm_sleep_until(task, deadline_us);
+    if (wasm_task_ending(task)) { m3ApiTrap(wasm_trap_ended); }
+
+    m3ApiReturn(__WASI_ESUCCESS);
+}
+
+// WASM logging function
+m3ApiRawFunction(m3_get_tick)
+{
+    // Load arguments
+    m3ApiReturnType  (uint32_t)
+    m3ApiGetArgMem   (uint32_t*, ticks)
+
+    // Check args are valid
+    if (runtime == NULL || ticks == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    // Monotonic, unlike the wall clock this doesn't jump when SNTP syncs
+    *ticks = (uint32_t) (wasm_time_us() / 1000);
+
+    m3ApiReturn(__WASI_ESUCCESS);
+}
+
+m3ApiRawFunction(m3_i2c_init)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, i2c_port)
+    m3ApiGetArg      (uint32_t, freq)
+    m3ApiGetArg      (uint32_t, sda)
+    m3ApiGetArg      (uint32_t, scl)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    //ESP_LOGI(TAG, "I2C init port: %d freq: %d sda: %d scl: %d\r\n", i2c_port, freq, sda, scl);
+
+    int32_t res = i2c_init(i2c_port, freq, sda, scl);
+
+    m3ApiReturn(res);
+}
+
+
+m3ApiRawFunction(m3_i2c_deinit)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, i2c_port)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    //ESP_LOGI(TAG, "I2C deinit port: %d\r\n", i2c_port);
+
+    int32_t res = i2c_deinit(i2c_port);
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_i2c_write)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, i2c_port)
+    m3ApiGetArg      (uint32_t, address)
+    m3ApiGetArgMem   (uint8_t*, data_out)
+    m3ApiGetArg      (uint32_t, data_out_len)
+
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    //ESP_LOGI(TAG, "I2C write port: %d addr: 0x%x, %p %d bytes\r\n", i2c_port, address, data_out, data_out_len);
+
+    int32_t res = i2c_write(i2c_port, address, data_out, data_out_len);
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_i2c_read)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, i2c_port)
+    m3ApiGetArg      (uint32_t, address)
+    m3ApiGetArgMem   (uint8_t*, data_in)
+    m3ApiGetArg      (uint32_t, data_in_len)
+
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    //ESP_LOGI(TAG, "I2C read port: %d addr: 0x%x, %p %d bytes\r\n", i2c_port, address, data_in, data_in_len);
+
+    int32_t res = i2c_read(i2c_port, address, data_in, data_in_len);
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_i2c_write_read)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, i2c_port)
+    m3ApiGetArg      (uint32_t, address)
+    m3ApiGetArgMem   (uint8_t*, data_out)
+    m3ApiGetArg      (uint32_t, data_out_len)
+    m3ApiGetArgMem   (uint8_t*, data_in)
+    m3ApiGetArg      (uint32_t, data_in_len)
+
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    //ESP_LOGI(TAG, "I2C write_read port: %d addr: %x, out: %p %d bytes, in: %p %d bytes\r\n", i2c_port, address, data_out, data_out_len, data_in, data_in_len);
+
+    int32_t res = i2c_write_read(i2c_port, address, data_out, data_out_len, data_in, data_in_len);
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_i2c_set_timeout)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, i2c_port)
+    m3ApiGetArg      (uint32_t, timeout_ms)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = i2c_set_timeout(i2c_port, timeout_ms);
+
+    m3ApiReturn(res);
+}
+
+// Transaction segment as laid out in wasm memory, data is an offset into linear memory
+typedef struct {
+    uint32_t address;
+    uint32_t flags;
+    uint32_t data;
+    uint32_t len;
+} WasmI2cOp_t;
+
+m3ApiRawFunction(m3_i2c_transaction)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, i2c_port)
+    m3ApiGetArg      (uint32_t, ops_offset)
+    m3ApiGetArg      (uint32_t, ops_count)
+
+    // Check args are valid
+    if (runtime == NULL || ops_count == 0 || ops_count > I2C_MGR_MAX_OPS) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    if ((uint64_t) ops_offset + ops_count * sizeof(WasmI2cOp_t) > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    // Segments point straight into linear memory, nothing is copied
+    I2cOp_t ops[I2C_MGR_MAX_OPS];
+    for (uint32_t i=0; i<ops_count; i++) {
+        WasmI2cOp_t op;
+        memcpy(&op, m3ApiOffsetToPtr(ops_offset + i * sizeof(WasmI2cOp_t)), sizeof(op));
+
+        if ((uint64_t) op.data + op.len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+        ops[i].address = op.address;
+        ops[i].flags = op.flags;
+        ops[i].data = m3ApiOffsetToPtr(op.data);
+        ops[i].len = op.len;
+    }
+
+    int32_t res = i2c_transaction(i2c_port, ops, ops_count);
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_spi_init)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, spi_port)
+    m3ApiGetArg      (int32_t, sclk)
+    m3ApiGetArg      (int32_t, mosi)
+    m3ApiGetArg      (int32_t, miso)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = spi_init(spi_port, sclk, mosi, miso);
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_spi_deinit)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, spi_port)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = spi_deinit(spi_port);
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_spi_device_add)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, spi_port)
+    m3ApiGetArg      (int32_t, cs)
+    m3ApiGetArg      (uint32_t, freq)
+    m3ApiGetArg      (uint32_t, mode)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    // Devices belong to the task, and are removed when it stops
+    int32_t res = spi_device_add(spi_port, cs, freq, mode, m3_GetUserData(runtime));
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_spi_device_remove)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, dev)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = spi_device_remove(dev, m3_GetUserData(runtime));
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_spi_set_timeout)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, dev)
+    m3ApiGetArg      (uint32_t, timeout_ms)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = spi_set_timeout(dev, timeout_ms, m3_GetUserData(runtime));
+
+    m3ApiReturn(res);
+}
+
+// Resolve an optional buffer in linear memory, offset 0 is used for no buffer
+static bool spi_get_buffer(void* mem, uint32_t mem_len, uint32_t offset, uint32_t len, uint8_t** buff) {
+    if (offset == 0) {
+        *buff = NULL;
+        return true;
+    }
+
+    if ((uint64_t) offset + len > mem_len) {
+        return false;
+    }
+
+    *buff = (uint8_t*) mem + offset;
+    return true;
+}
+
+m3ApiRawFunction(m3_spi_transfer)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, dev)
+    m3ApiGetArg      (uint32_t, tx_offset)
+    m3ApiGetArg      (uint32_t, rx_offset)
+    m3ApiGetArg      (uint32_t, len)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    uint8_t *tx, *rx;
+    if (!spi_get_buffer(_mem, mem_len, tx_offset, len, &tx) || !spi_get_buffer(_mem, mem_len, rx_offset, len, &rx)) {
+        m3ApiReturn(__WASI_EINVAL);
+    }
+
+    int32_t res = spi_transfer(dev, tx, rx, len, m3_GetUserData(runtime));
+
+    m3ApiReturn(res);
+}
+
+// Transfer segment as laid out in wasm memory, tx and rx are offsets into linear memory (or 0)
+typedef struct {
+    uint32_t tx;
+    uint32_t rx;
+    uint32_t len;
+} WasmSpiOp_t;
+
+m3ApiRawFunction(m3_spi_transfer_batch)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, dev)
+    m3ApiGetArg      (uint32_t, ops_offset)
+    m3ApiGetArg      (uint32_t, ops_count)
+
+    // Check args are valid
+    if (runtime == NULL || ops_count == 0 || ops_count > SPI_MGR_QUEUE_SIZE) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    if ((uint64_t) ops_offset + ops_count * sizeof(WasmSpiOp_t) > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    // Transfers DMA straight to / from linear memory, growing it first waits for them (see m3_LinearMemoryMoving)
+    SpiOp_t ops[SPI_MGR_QUEUE_SIZE];
+    for (uint32_t i=0; i<ops_count; i++) {
+        WasmSpiOp_t op;
+        memcpy(&op, m3ApiOffsetToPtr(ops_offset + i * sizeof(WasmSpiOp_t)), sizeof(op));
+
+        uint8_t *tx, *rx;
+        if (!spi_get_buffer(_mem, mem_len, op.tx, op.len, &tx) || !spi_get_buffer(_mem, mem_len, op.rx, op.len, &rx)) {
+            m3ApiReturn(__WASI_EINVAL);
+        }
+
+        ops[i].tx = tx;
+        ops[i].rx = rx;
+        ops[i].len = op.len;
+    }
+
+    int32_t res = spi_transfer_batch(dev, ops, ops_count, m3_GetUserData(runtime));
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_spi_wait)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, dev)
+    m3ApiGetArg      (uint32_t, timeout_ms)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = spi_wait(dev, timeout_ms, m3_GetUserData(runtime));
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_spi_pending)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, dev)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = spi_pending(dev, m3_GetUserData(runtime));
+
+    m3ApiReturn(res);
+}
+
+m3ApiRawFunction(m3_gpio_configure)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, pin)
+    m3ApiGetArg      (uint32_t, mode)
+    m3ApiGetArg      (uint32_t, pull)
+    m3ApiGetArg      (uint32_t, edge)
 
-#include "wasm3.h"
-#include "m3_env.h"
-#include "m3_api_defs.h"
-#include "m3_api_wasi.h"
-#include "m3_env.h"
-#include "m3_exception.h"
-#include "m3_info.h"
-#include "extra/wasi_core.h"
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
 
-#include "m3_api_esp_wasi.h"
+    // Pins belong to the task, and are released when it stops
+    int32_t res = gpio_configure(pin, mode, pull, edge, m3_GetUserData(runtime));
 
-#include "i2c_mgr.h"
+    m3ApiReturn(res);
+}
 
+m3ApiRawFunction(m3_gpio_write)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, pin)
+    m3ApiGetArg      (uint32_t, level)
 
-#define TAG "WASM"
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
 
-// Seems we need quite a lot of stack for this task...
-#define STACK_SIZE  (40 * 1024)
+    int32_t res = gpio_write(pin, level, m3_GetUserData(runtime));
 
-void vWasmTask( void * pvParameters );
-int wasm_run(WasmTask_t* wasmTask);
+    m3ApiReturn(res);
+}
 
-int WASM_launch_task(const WasmTask_t* wasmTask) {
-    // Launch task
-    xTaskCreate( vWasmTask, wasmTask->name, STACK_SIZE, wasmTask, tskIDLE_PRIORITY, &wasmTask->handle );
-    if (wasmTask->handle == NULL) {
-        ESP_LOGI(TAG, "Failed to launch WASM task: %s", wasmTask->name);
-        return -1;
-    }
+m3ApiRawFunction(m3_gpio_read)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, pin)
 
-    return 0;
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = gpio_read(pin);
+
+    m3ApiReturn(res);
 }
 
-int WASM_end_task(const WasmTask_t* wasmTask) {
-    if (wasmTask->handle == NULL) {
-        ESP_LOGI(TAG, "Failed to end WASM task %s", wasmTask->name);
-        return -1;
+// Edge event as laid out in wasm memory
+typedef struct {
+    uint32_t pin;
+    uint32_t level;
+    uint64_t time_us;
+} WasmGpioEvent_t;
+
+m3ApiRawFunction(m3_gpio_wait_event)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, event_offset)
+    m3ApiGetArg      (uint32_t, timeout_ms)
+
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
+
+    if ((uint64_t) event_offset + sizeof(WasmGpioEvent_t) > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    // Handlers may poll, but not block the dispatcher
+    if (timeout_ms > 0 && EVENT_MGR_in_dispatcher()) { m3ApiReturn(__WASI_ENOTSUP); }
+
+    // Waited in slices so a long timeout doesn't hold up ending the task
+    WasmTask_t* task = m3_GetUserData(runtime);
+    GpioEvent_t event;
+    int32_t res;
+
+    while (true) {
+        uint32_t wait = (timeout_ms < WASM_END_POLL_MS) ? timeout_ms : WASM_END_POLL_MS;
+        res = gpio_wait_event(task, &event, wait);
+        timeout_ms -= wait;
+
+        if (wasm_task_ending(task)) { m3ApiTrap(wasm_trap_ended); }
+        if (res != ESP_ERR_TIMEOUT || timeout_ms == 0) {
+            break;
+        }
     }
 
-    if (wasmTask->running) {
-        vTaskDelete(wasmTask->handle);
+    if (res == 0) {
+        WasmGpioEvent_t e = { .pin = event.pin, .level = event.level, .time_us = event.time_us };
+        memcpy(m3ApiOffsetToPtr(event_offset), &e, sizeof(e));
     }
 
-    return 0;
+    m3ApiReturn(res);
 }
 
-// WASM fetch arguments function
-m3ApiRawFunction(m3_arg_get)
+m3ApiRawFunction(m3_gpio_events_dropped)
 {
     // Load arguments
-    m3ApiReturnType  (uint32_t)
+    m3ApiReturnType  (int32_t)
 
-    m3ApiGetArg      (uint32_t, ptr)
-    m3ApiGetArg      (uint32_t, index)
+    // Check args are valid
+    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    m3ApiReturn(gpio_events_dropped(m3_GetUserData(runtime)));
+}
 
-    m3ApiGetArgMem   (uint8_t*, buff)
-    m3ApiGetArgMem   (uint8_t*, buff_len)
+// Publish to an MQTT topic, returns the message id or a negative error
+m3ApiRawFunction(m3_mqtt_publish)
+{
+    // Load arguments
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, topic_offset)
+    m3ApiGetArg      (uint32_t, topic_len)
+    m3ApiGetArg      (uint32_t, data_offset)
+    m3ApiGetArg      (uint32_t, data_len)
+    m3ApiGetArg      (uint32_t, qos)
+    m3ApiGetArg      (uint32_t, retain)
 
     // Check args are valid
-    if (runtime == NULL || buff == NULL || buff_len == NULL) { m3ApiReturn(__WASI_EINVAL); }
+    if (runtime == NULL || topic_len == 0 || topic_len >= MSG_MGR_TOPIC_LEN || qos > 2) { m3ApiReturn(__WASI_EINVAL); }
 
-    WasmTask_t* task = (char**) ptr;
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
 
-    //ESP_LOGI(TAG, "m3_arg_get addr: 0x%08x task: %p i: %x v: %s max: %d\r\n", ptr, task, index, task->args[index], buff_len[0]);
+    if ((uint64_t) topic_offset + topic_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+    if ((uint64_t) data_offset + data_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
 
-    int32_t res = strncpy((char*) buff, task->args[index], buff_len[0]);
-    buff_len[0] = res;
+    // The client takes a terminated topic, the payload is sent from linear memory
+    char topic[MSG_MGR_TOPIC_LEN];
+    memcpy(topic, m3ApiOffsetToPtr(topic_offset), topic_len);
+    topic[topic_len] = 0;
 
-    m3ApiReturn(__WASI_ESUCCESS);
+    int32_t res = MQTT_MGR_publish_raw(topic, m3ApiOffsetToPtr(data_offset), data_len, qos, retain != 0);
+
+    m3ApiReturn(res);
 }
 
-// WASM logging function
-m3ApiRawFunction(m3_log_write)
+m3ApiRawFunction(m3_mqtt_subscribe)
 {
     // Load arguments
-    m3ApiReturnType  (uint32_t)
-    m3ApiGetArg      (uint32_t, buff_offset)
-    m3ApiGetArg      (uint32_t, buff_len)
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, filter_offset)
+    m3ApiGetArg      (uint32_t, filter_len)
+    m3ApiGetArg      (uint32_t, qos)
 
     // Check args are valid
-    if (runtime == NULL ) { m3ApiReturn(__WASI_EINVAL); }
+    WasmTask_t* task = (runtime != NULL) ? m3_GetUserData(runtime) : NULL;
+    if (task == NULL || qos > 2) { m3ApiReturn(__WASI_EINVAL); }
 
-    char* buff = m3ApiOffsetToPtr(buff_offset);
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
 
-    //buff[buff_len-1] = '\0';
-    fwrite(buff, 1, buff_len, stdout);
+    if ((uint64_t) filter_offset + filter_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
 
-    m3ApiReturn(__WASI_ESUCCESS);
+    // Event applets receive messages through on_mqtt_message
+    bool events = EVENT_MGR_is_event_applet(runtime);
+
+    int32_t res = MSG_MGR_subscribe(task, m3ApiOffsetToPtr(filter_offset), filter_len, qos, events);
+
+    m3ApiReturn(res);
 }
 
-m3ApiRawFunction(m3_value_write)
+m3ApiRawFunction(m3_mqtt_unsubscribe)
 {
     // Load arguments
-    m3ApiReturnType  (uint32_t)
-    m3ApiGetArgMem   (uint8_t*, name)
-    m3ApiGetArg      (uint32_t, name_len)
-    m3ApiGetArg      (uint32_t, value)
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, filter_offset)
+    m3ApiGetArg      (uint32_t, filter_len)
 
     // Check args are valid
-    if (runtime == NULL ) { m3ApiReturn(__WASI_EINVAL); }
+    WasmTask_t* task = (runtime != NULL) ? m3_GetUserData(runtime) : NULL;
+    if (task == NULL) { m3ApiReturn(__WASI_EINVAL); }
 
-    char buff[32];
-    strncpy(buff, (char*)name, name_len);
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
 
-    printf("Data: %s value: %d\r\n", buff, value);
+    if ((uint64_t) filter_offset + filter_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
 
-    m3ApiReturn(__WASI_ESUCCESS);
+    int32_t res = MSG_MGR_unsubscribe(task, m3ApiOffsetToPtr(filter_offset), filter_len);
+
+    m3ApiReturn(res);
 }
 
-// WASM logging function
-m3ApiRawFunction(m3_delay_ms)
+// Wait for the next message matching a subscription, the topic then payload are copied
+// into buff and the topic length written to topic_len. Returns the bytes copied, 0 on timeout.
+m3ApiRawFunction(m3_mqtt_receive)
 {
     // Load arguments
-    m3ApiReturnType  (uint32_t)
-    m3ApiGetArg      (uint32_t, delay_ms)
+    m3ApiReturnType  (int32_t)
+    m3ApiGetArg      (uint32_t, buff_offset)
+    m3ApiGetArg      (uint32_t, buff_len)
+    m3ApiGetArg      (uint32_t, topic_len_offset)
+    m3ApiGetArg      (uint32_t, timeout_ms)
 
     // Check args are valid
-    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+    WasmTask_t* task = (runtime != NULL) ? m3_GetUserData(runtime) : NULL;
+    if (task == NULL) { m3ApiReturn(__WASI_EINVAL); }
 
-    // Call delay to yeild this thread
-    vTaskDelay(delay_ms / portTICK_PERIOD_MS);
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
 
-    m3ApiReturn(__WASI_ESUCCESS);
+    if ((uint64_t) buff_offset + buff_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+    if ((uint64_t) topic_len_offset + sizeof(uint32_t) > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    // Handlers may poll, but not block the dispatcher
+    if (timeout_ms > 0 && EVENT_MGR_in_dispatcher()) { m3ApiReturn(__WASI_ENOTSUP); }
+
+    uint32_t topic_len = 0;
+    int32_t res = MSG_MGR_receive(task, m3ApiOffsetToPtr(buff_offset), buff_len, &topic_len, timeout_ms);
+    if (wasm_task_ending(task)) { m3ApiTrap(wasm_trap_ended); }
+
+    // Set to the size needed when a message was too big for buff
+    if (res > 0 || res == -2) {
+        memcpy(m3ApiOffsetToPtr(topic_len_offset), &topic_len, sizeof(topic_len));
+    }
+
+    m3ApiReturn(res);
 }
 
-// WASM logging function
-m3ApiRawFunction(m3_get_tick)
+// Messages dropped for this applet (full queue or too big for the buffer) since the last call
+m3ApiRawFunction(m3_mqtt_dropped)
 {
-    // Load arguments
     m3ApiReturnType  (uint32_t)
-    m3ApiGetArg      (uint32_t*, ticks_ms_offset)
 
-    // Check args are valid
-    if (runtime == NULL || ticks_ms_offset == NULL) { m3ApiReturn(__WASI_EINVAL); }
+    WasmTask_t* task = (runtime != NULL) ? m3_GetUserData(runtime) : NULL;
+    if (task == NULL) { m3ApiReturn(0); }
 
-    // Fetch tick counter
-    uint32_t* ticks = (uint32_t*) m3ApiOffsetToPtr(ticks_ms_offset);
-    
-    struct timeval tv_now;
-    gettimeofday(&tv_now, NULL);
-    *ticks = (int32_t)tv_now.tv_sec * 1000L + (int32_t)tv_now.tv_usec / 1000;
+    m3ApiReturn(MSG_MGR_dropped(task));
+}
 
-    m3ApiReturn(__WASI_ESUCCESS);
+// Copy a key from wasm memory, returns false if it is empty or too long
+static bool wasm_config_key(char* key, const char* src, uint32_t len) {
+    if (len == 0 || len >= NVS_KEY_NAME_MAX_SIZE || memchr(src, 0, len) != NULL) {
+        return false;
+    }
+
+    memcpy(key, src, len);
+    key[len] = 0;
+
+    return true;
 }
 
-m3ApiRawFunction(m3_i2c_init)
+// Read a configuration value (without a terminator) into buff, returns the value length,
+// -1 if the key is not set or -2 if buff is too small
+m3ApiRawFunction(m3_config_get)
 {
     // Load arguments
     m3ApiReturnType  (int32_t)
-    m3ApiGetArg      (uint32_t, i2c_port)
-    m3ApiGetArg      (uint32_t, freq)
-    m3ApiGetArg      (uint32_t, sda)
-    m3ApiGetArg      (uint32_t, scl)
+    m3ApiGetArg      (uint32_t, key_offset)
+    m3ApiGetArg      (uint32_t, key_len)
+    m3ApiGetArg      (uint32_t, buff_offset)
+    m3ApiGetArg      (uint32_t, buff_len)
 
     // Check args are valid
     if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
 
-    //ESP_LOGI(TAG, "I2C init port: %d freq: %d sda: %d scl: %d\r\n", i2c_port, freq, sda, scl);
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
 
-    int32_t res = i2c_init(i2c_port, freq, sda, scl);
+    if ((uint64_t) key_offset + key_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+    if ((uint64_t) buff_offset + buff_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
 
-    m3ApiReturn(res);
-}
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    if (!wasm_config_key(key, m3ApiOffsetToPtr(key_offset), key_len)) { m3ApiReturn(__WASI_EINVAL); }
 
+    // Served from the config cache, flash is not touched
+    char val[CONFIG_MGR_MAX_VAL];
+    if (CONFIG_MGR_get(key, val, sizeof(val)) != ESP_OK) {
+        m3ApiReturn(-1);
+    }
 
-m3ApiRawFunction(m3_i2c_deinit)
+    uint32_t len = strlen(val);
+    if (len > buff_len) {
+        m3ApiReturn(-2);
+    }
+
+    memcpy(m3ApiOffsetToPtr(buff_offset), val, len);
+
+    m3ApiReturn(len);
+}
+
+// Set a configuration value, committed to flash and posted to subscribers as any other change
+m3ApiRawFunction(m3_config_set)
 {
     // Load arguments
     m3ApiReturnType  (int32_t)
-    m3ApiGetArg      (uint32_t, i2c_port)
+    m3ApiGetArg      (uint32_t, key_offset)
+    m3ApiGetArg      (uint32_t, key_len)
+    m3ApiGetArg      (uint32_t, val_offset)
+    m3ApiGetArg      (uint32_t, val_len)
 
     // Check args are valid
-    if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
+    if (runtime == NULL || val_len >= CONFIG_MGR_MAX_VAL) { m3ApiReturn(__WASI_EINVAL); }
 
-    //ESP_LOGI(TAG, "I2C deinit port: %d\r\n", i2c_port);
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
 
-    int32_t res = i2c_deinit(i2c_port);
+    if ((uint64_t) key_offset + key_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+    if ((uint64_t) val_offset + val_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    if (!wasm_config_key(key, m3ApiOffsetToPtr(key_offset), key_len)) { m3ApiReturn(__WASI_EINVAL); }
+
+    char val[CONFIG_MGR_MAX_VAL];
+    memcpy(val, m3ApiOffsetToPtr(val_offset), val_len);
+    val[val_len] = 0;
+
+    if (memchr(val, 0, val_len) != NULL) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = (CONFIG_MGR_set(key, val) == ESP_OK) ? 0 : -1;
 
     m3ApiReturn(res);
 }
 
-m3ApiRawFunction(m3_i2c_write)
+m3ApiRawFunction(m3_event_buffer)
 {
     // Load arguments
     m3ApiReturnType  (int32_t)
-    m3ApiGetArg      (uint32_t, i2c_port)
-    m3ApiGetArg      (uint32_t, address)
-    m3ApiGetArgMem   (uint8_t*, data_out)
-    m3ApiGetArg      (uint32_t, data_out_len)
-
+    m3ApiGetArg      (uint32_t, buff_offset)
+    m3ApiGetArg      (uint32_t, buff_len)
 
     // Check args are valid
     if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
 
-    //ESP_LOGI(TAG, "I2C write port: %d addr: 0x%x, %p %d bytes\r\n", i2c_port, address, data_out, data_out_len);
+    uint32_t mem_len = 0;
+    m3_GetMemory(runtime, &mem_len, 0);
 
-    int32_t res = i2c_write(i2c_port, address, data_out, data_out_len);
+    if (buff_offset == 0 || (uint64_t) buff_offset + buff_len > mem_len) { m3ApiReturn(__WASI_EINVAL); }
+
+    int32_t res = EVENT_MGR_set_buffer(runtime, buff_offset, buff_len);
 
     m3ApiReturn(res);
 }
 
-m3ApiRawFunction(m3_i2c_read)
+m3ApiRawFunction(m3_timer_start)
 {
     // Load arguments
     m3ApiReturnType  (int32_t)
-    m3ApiGetArg      (uint32_t, i2c_port)
-    m3ApiGetArg      (uint32_t, address)
-    m3ApiGetArgMem   (uint8_t*, data_in)
-    m3ApiGetArg      (uint32_t, data_in_len)
-
+    m3ApiGetArg      (uint32_t, id)
+    m3ApiGetArg      (uint32_t, period_ms)
+    m3ApiGetArg      (uint32_t, repeat)
 
     // Check args are valid
     if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
 
-    //ESP_LOGI(TAG, "I2C read port: %d addr: 0x%x, %p %d bytes\r\n", i2c_port, address, data_in, data_in_len);
-
-    int32_t res = i2c_read(i2c_port, address, data_in, data_in_len);
+    int32_t res = EVENT_MGR_timer_start(runtime, id, period_ms, repeat != 0);
 
     m3ApiReturn(res);
 }
 
-m3ApiRawFunction(m3_i2c_write_read)
+m3ApiRawFunction(m3_timer_stop)
 {
     // Load arguments
     m3ApiReturnType  (int32_t)
-    m3ApiGetArg      (uint32_t, i2c_port)
-    m3ApiGetArg      (uint32_t, address)
-    m3ApiGetArgMem   (uint8_t*, data_out)
-    m3ApiGetArg      (uint32_t, data_out_len)
-    m3ApiGetArgMem   (uint8_t*, data_in)
-    m3ApiGetArg      (uint32_t, data_in_len)
-
+    m3ApiGetArg      (uint32_t, id)
 
     // Check args are valid
     if (runtime == NULL) { m3ApiReturn(__WASI_EINVAL); }
 
-    //ESP_LOGI(TAG, "I2C write_read port: %d addr: %x, out: %p %d bytes, in: %p %d bytes\r\n", i2c_port, address, data_out, data_out_len, data_in, data_in_len);
-
-    int32_t res = i2c_write_read(i2c_port, address, data_out, data_out_len, data_in, data_in_len);
+    int32_t res = EVENT_MGR_timer_stop(runtime, id);
 
     m3ApiReturn(res);
 }
@@ -258,35 +1876,212 @@ m3ApiRawFunction(m3_i2c_write_read)
 void vWasmTask( void * pvParameters ) {
     WasmTask_t* wasmTask = (WasmTask_t*) pvParameters;
 
-    ESP_LOGI(TAG, "Running WASM task: %s\r\n", wasmTask->name);
+#ifdef ESP_PLATFORM
+    vTaskSetThreadLocalStoragePointer(NULL, WASM_TLS_INDEX, wasmTask);
+#endif
 
-    wasmTask->running = true;
+    ESP_LOGI(TAG, "Running WASM task: %s (core: %d)\r\n", wasmTask->name, xPortGetCoreID());
 
     int32_t res = wasm_run(wasmTask);
 
     ESP_LOGI(TAG, "Finished WASM task: %s (result: %d)\r\n", wasmTask->name, res);
 
-    wasmTask->running = false;
+    // Event applets keep running on the dispatcher after this task exits
+    if (res != WASM_RUN_EVENTS) {
+        MSG_MGR_release(wasmTask);
+    }
+
+    // Once the handle is cleared WASM_end_task no longer notifies this task, and once it
+    // is no longer running the task may be unloaded so it is not touched after this
+    xSemaphoreTake(wasm_runtime_lock, portMAX_DELAY);
+    wasm_set_cancel(wasmTask, false);
+    if (res != WASM_RUN_EVENTS) {
+        wasmTask->running = false;
+    }
+    __atomic_store_n(&wasmTask->handle, NULL, __ATOMIC_RELEASE);
+    xSemaphoreGive(wasm_runtime_lock);
 
     vTaskDelete(NULL);
 }
 
 
+// Host API, resolved against the module's imports in one pass by wasm_load
+static const M3RawFunctionLink wasm_links[] = {
+    { "env", "arg_get", "i(ii**)", &m3_arg_get },
+    { "env", "log_write", "i(*i)", &m3_log_write },
+    { "env", "value_write", "i(*ii)", &m3_value_write },
+    { "env", "value_register", "i(*i)", &m3_value_register },
+    { "env", "value_write_int", "i(iI)", &m3_value_write_int },
+    { "env", "value_write_float", "i(iF)", &m3_value_write_float },
+    { "env", "value_write_batch", "i(*i)", &m3_value_write_batch },
+
+    { "env", "delay_ms", "i(i)", &m3_delay_ms },
+    { "env", "get_ticks", "i(*)", &m3_get_tick },
+    { "env", "time_us", "I()", &m3_time_us },
+    { "env", "sleep_us", "i(i)", &m3_sleep_us },
+    { "env", "sleep_until", "i(I)", &m3_sleep_until },
+
+    { "env", "i2c_init", "i(iiii)", &m3_i2c_init },
+    { "env", "i2c_deinit", "i(i)", &m3_i2c_deinit },
+    { "env", "i2c_write", "i(ii*i)", &m3_i2c_write },
+    { "env", "i2c_read", "i(ii*i)", &m3_i2c_read },
+    { "env", "i2c_write_read", "i(ii*i*i)", &m3_i2c_write_read },
+    { "env", "i2c_set_timeout", "i(ii)", &m3_i2c_set_timeout },
+    { "env", "i2c_transaction", "i(i*i)", &m3_i2c_transaction },
+
+    { "env", "spi_init", "i(iiii)", &m3_spi_init },
+    { "env", "spi_deinit", "i(i)", &m3_spi_deinit },
+    { "env", "spi_device_add", "i(iiii)", &m3_spi_device_add },
+    { "env", "spi_device_remove", "i(i)", &m3_spi_device_remove },
+    { "env", "spi_set_timeout", "i(ii)", &m3_spi_set_timeout },
+    { "env", "spi_transfer", "i(i**i)", &m3_spi_transfer },
+    { "env", "spi_transfer_batch", "i(i*i)", &m3_spi_transfer_batch },
+    { "env", "spi_wait", "i(ii)", &m3_spi_wait },
+    { "env", "spi_pending", "i(i)", &m3_spi_pending },
+
+    { "env", "gpio_configure", "i(iiii)", &m3_gpio_configure },
+    { "env", "gpio_write", "i(ii)", &m3_gpio_write },
+    { "env", "gpio_read", "i(i)", &m3_gpio_read },
+    { "env", "gpio_wait_event", "i(*i)", &m3_gpio_wait_event },
+    { "env", "gpio_events_dropped", "i()", &m3_gpio_events_dropped },
+
+    { "env", "mqtt_publish", "i(*i*iii)", &m3_mqtt_publish },
+    { "env", "mqtt_subscribe", "i(*ii)", &m3_mqtt_subscribe },
+    { "env", "mqtt_unsubscribe", "i(*i)", &m3_mqtt_unsubscribe },
+    { "env", "mqtt_receive", "i(*i*i)", &m3_mqtt_receive },
+    { "env", "mqtt_dropped", "i()", &m3_mqtt_dropped },
+
+    { "env", "config_get", "i(*i*i)", &m3_config_get },
+    { "env", "config_set", "i(*i*i)", &m3_config_set },
+
+    { "env", "event_buffer", "i(*i)", &m3_event_buffer },
+    { "env", "timer_start", "i(iii)", &m3_timer_start },
+    { "env", "timer_stop", "i(i)", &m3_timer_stop },
+};
+
+#if WASM_COMPILED_IMAGES
+
+// Compiled images hold operation pointers, so are only restored by the firmware build that saved them
+void m3_GetImageBuildId(uint8_t id[32]) {
+#ifdef ESP_PLATFORM
+    memcpy(id, esp_ota_get_app_description()->app_elf_sha256, 32);
+#else
+    // No ELF hash on host builds, the host API table stands in for it
+    uint32_t hash = wasm_hash(2166136261, wasm_links, sizeof(wasm_links));
+    memset(id, 0, 32);
+    memcpy(id, &hash, sizeof(hash));
+#endif
+}
+
+#endif
+
+// Bind WASI and the host API to a loaded module's imports
+int wasm_link(IM3Module module) {
+    M3Result result = m3_LinkEspWASI(module);
+    if (result == m3Err_none) {
+        result = m3_LinkRawFunctions(module, wasm_links, sizeof(wasm_links) / sizeof(wasm_links[0]));
+    }
+    if (result) {
+        ESP_LOGI(TAG, "Link: %s", result);
+        return -5;
+    }
+
+    return 0;
+}
+
+// Parse and load a module into the runtime and bind the host API
+int wasm_load(IM3Runtime runtime, const uint8_t* data, uint32_t len, IM3Module* module) {
+    M3Result result = m3_ParseModule (runtime->environment, module, data, len);
+    if (result) {
+        ESP_LOGI(TAG, "ParseModule: %s", result);
+
+        // Only unloaded modules should be manually freed
+        m3_FreeModule(*module);
+
+        return -3;
+    }
+
+    result = m3_LoadModule (runtime, *module);
+    if (result) {
+        ESP_LOGI(TAG, "LoadModule: %s", result);
+        return -4;
+    }
+
+    return wasm_link(*module);
+}
+
+
+// Release an event applet once the dispatcher is done with it
+static void wasm_event_release(WasmTask_t* task, IM3Runtime runtime, bool valid) {
+    wasm_set_runtime(task, NULL);
+    MSG_MGR_release(task);
+
+    // Before the runtime and its memory can be reused or freed
+    spi_release_owner(task);
+    gpio_release_owner(task);
+
+    if (task->cache != NULL) {
+        wasm_cache_release(task->cache, valid);
+        task->cache = NULL;
+    } else {
+        IM3Environment env = runtime->environment;
+        m3_FreeRuntime(runtime);
+        m3_FreeEnvironment(env);
+    }
+
+    // Completes a stop that timed out waiting for a handler to trap
+    xSemaphoreTake(wasm_runtime_lock, portMAX_DELAY);
+    wasm_set_cancel(task, false);
+    task->running = false;
+    xSemaphoreGive(wasm_runtime_lock);
+}
+
 int wasm_run(WasmTask_t* task) {
     int wasm_res = 0;
+    bool stopped = false;
 
     M3Result result;
 
-    ESP_LOGI(TAG, "Loading WebAssembly (mod: %s, p: %p, %d bytes)...\n", task->name, (void*)task->data, task->data_len);
-    IM3Environment env = m3_NewEnvironment ();
-        if (env == NULL) {
+    IM3Environment env = NULL;
+    IM3Runtime runtime = NULL;
+    const uint8_t* data = task->data;
+
+    // Re-use a cached module where available
+    WasmCacheEntry_t* entry = wasm_cache_acquire(task);
+    task->cache = entry;
+
+    if (entry != NULL && entry->loaded) {
+        ESP_LOGI(TAG, "Using cached WebAssembly (mod: %s, crc: 0x%08x)\n", task->name, task->crc);
+        runtime = entry->runtime;
+
+        // Start functions may call host functions during the reset
+        m3_SetUserData(runtime, task);
+
+        result = m3_ResetRuntime (runtime);
+        if (result) {
+            ESP_LOGI(TAG, "ResetRuntime: %s", result);
+            wasm_res = -8;
+
+            goto teardown_start;
+        }
+
+        goto run;
+
+    } else if (entry != NULL) {
+        // Parse from the cache copy so the module outlives the task binary
+        data = entry->data;
+    }
+
+    ESP_LOGI(TAG, "Loading WebAssembly (mod: %s, p: %p, %d bytes)...\n", task->name, (void*)data, task->data_len);
+    env = m3_NewEnvironment ();
+    if (env == NULL) {
         ESP_LOGI(TAG, "NewEnvironment failed");
         wasm_res = -1;
 
-        goto teardown_env;
+        goto teardown_start;
     }
 
-    IM3Runtime runtime = m3_NewRuntime (env, 32 * 1024, NULL);
+    runtime = m3_NewRuntime (env, 32 * 1024, NULL);
     if (runtime == NULL) {
         ESP_LOGI(TAG, "NewRuntime failed");
         wasm_res = -2;
@@ -294,53 +2089,60 @@ int wasm_run(WasmTask_t* task) {
         goto teardown_start;
     }
 
-    IM3Module module;
-    result = m3_ParseModule (env, &module, task->data, task->data_len);
-    if (result) {
-        ESP_LOGI(TAG, "ParseModule: %s", result);
-        wasm_res = -3;
-
-        // Only unloaded modules should be manually freed
-        m3_FreeModule(module);
+    m3_SetUserData(runtime, task);
 
-        goto teardown_start;
+    // Cache entries own the environment and runtime from here on
+    if (entry != NULL) {
+        entry->env = env;
+        entry->runtime = runtime;
     }
 
-    result = m3_LoadModule (runtime, module);
-    if (result) {
-        ESP_LOGI(TAG, "LoadModule: %s", result);
-        wasm_res = -4;
-
+    IM3Module module;
+    wasm_res = wasm_load(runtime, data, task->data_len, &module);
+    if (wasm_res < 0) {
         goto teardown_start;
     }
-#if 0
-    result = m3_LinkEspWASI (runtime->modules);
-    if (result) {
-        ESP_LOGI(TAG, "LinkEspWASI: %s", result);
-        return -5;
-    }
-    
+
+#if WASM_EAGER_COMPILE
+    // Compile up front so calls don't stall on first use, using a saved image where available
+    bool compiled = false;
+#if WASM_COMPILED_IMAGES
+    compiled = wasm_image_load(module, task->name, task->crc) == 0;
+#endif
+    if (!compiled) {
+        result = m3_CompileModule (module);
+        if (result) {
+            // Not fatal, anything left is compiled on first call
+            ESP_LOGI(TAG, "CompileModule: %s", result);
+        } else {
+#if WASM_COMPILED_IMAGES
+            wasm_image_save(module, task->name, task->crc);
 #endif
-    m3_LinkEspWASI(module);
-
-    const char* idk = "env";
-    m3_LinkRawFunction (module, idk, "arg_get", "i(ii**)", &m3_arg_get);
-
-    m3_LinkRawFunction (module, idk, "log_write", "i(*i)", &m3_log_write);
-    m3_LinkRawFunction (module, idk, "value_write", "i(*ii)", &m3_log_write);
-#if 1
-    m3_LinkRawFunction (module, idk, "delay_ms", "i(i)", &m3_delay_ms);
-    m3_LinkRawFunction (module, idk, "get_ticks", "i(*)", &m3_get_tick);
-
-    m3_LinkRawFunction (module, idk, "i2c_init", "i(iiii)", &m3_i2c_init);
-    m3_LinkRawFunction (module, idk, "i2c_deinit", "i(i)", &m3_i2c_deinit);
-    m3_LinkRawFunction (module, idk, "i2c_write", "i(ii*i)", &m3_i2c_write);
-    m3_LinkRawFunction (module, idk, "i2c_read", "i(ii*i)", &m3_i2c_read);
-    m3_LinkRawFunction (module, idk, "i2c_write_read", "i(ii*i*i)", &m3_i2c_write_read);
+        }
+    }
 #endif
 
+    if (entry != NULL) {
+        entry->loaded = true;
+    }
+
+run:
+    wasm_set_runtime(task, runtime);
+
     IM3Function f;
     result = m3_FindFunction (&f, runtime, "main");
+    if (result && EVENT_MGR_is_event_applet(runtime)) {
+        // Event applets stay loaded and are run by the dispatcher, freeing this task and its stack
+        if (EVENT_MGR_attach(task, runtime, wasm_event_release) < 0) {
+            wasm_res = -9;
+
+            goto teardown_start;
+        }
+
+        ESP_LOGI(TAG, "Attached %s to event dispatcher", task->name);
+
+        return WASM_RUN_EVENTS;
+    }
     if (result) {
         ESP_LOGI(TAG, "FindFunction: %s", result);
         wasm_res = -6;
@@ -348,17 +2150,18 @@ int wasm_run(WasmTask_t* task) {
         goto teardown_start;
     }
 
-    // We convert the arg count and a task pointer to strings
-    // to pass into the runtime which then converts them to integers...
+    // We convert the arg count to a string to pass into the runtime which then converts it to an integer...
     // See https://github.com/wasm3/wasm3/issues/41#issuecomment-582394114
+    // The task handle argument is kept for existing applets, arg_get finds the task itself
     char m_count[16];
     snprintf(m_count, sizeof(m_count), "%d", task->arg_count);
 
-    char m_addr[16];
-    snprintf(m_addr, sizeof(m_addr), "%d", (uint32_t)task);
-
-    const char* i_argv[3] = { m_count, m_addr, NULL };
+    const char* i_argv[3] = { m_count, "0", NULL };
     result = m3_CallWithArgs (f, 2, i_argv);
+    if (result == wasm_trap_ended) {
+        // Stopped, which leaves nothing behind that m3_ResetRuntime doesn't rebuild
+        stopped = true;
+    }
     if (result) {
         ESP_LOGI(TAG, "CallWithArgs: %s", result);
         wasm_res = -7;
@@ -370,9 +2173,21 @@ int wasm_run(WasmTask_t* task) {
     //wasm_res = *(int32_t*)(runtime->stack); 
 
 teardown_start:
-    m3_FreeRuntime(runtime);
+    wasm_set_runtime(task, NULL);
+
+    // Before the runtime and its memory can be reused or freed
+    spi_release_owner(task);
+    gpio_release_owner(task);
 
-teardown_env:
+    if (entry != NULL) {
+        // Keep modules that ran to completion or were stopped cached, drop anything that failed
+        task->cache = NULL;
+        wasm_cache_release(entry, wasm_res == 0 || stopped);
+
+        return wasm_res;
+    }
+
+    m3_FreeRuntime(runtime);
     m3_FreeEnvironment(env);
     
     return wasm_res;
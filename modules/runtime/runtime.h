@@ -4,16 +4,57 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "xip_mgr.h"
 
 
 #define TASK_NAME_MAX_LEN   32
 #define TASK_MAX_ARGS       6
 #define TASK_MAX_ARGLEN     16
 
+// Number of parsed / compiled modules kept alive between runs (0 to disable)
+#define WASM_CACHE_SIZE     2
+
+// Compile all functions when a module is loaded rather than on first call
+#define WASM_EAGER_COMPILE      1
+
+// Save compiled modules to flash and restore them on later loads (requires WASM_EAGER_COMPILE)
+// Images are kept per applet name (hashed into the path), so a new binary replaces the old image
+#define WASM_COMPILED_IMAGES    1
+#define WASM_IMAGE_PATH_FMT     "/spiffs/%08x.m3c"
+
+// Place applet linear memory in PSRAM when it's available, the wasm stack and compiled code stay in
+// internal RAM. Memory falls back to internal RAM if PSRAM is exhausted.
+#ifdef CONFIG_ESP32_SPIRAM_SUPPORT
+#define WASM_MEMORY_PSRAM       1
+#else
+#define WASM_MEMORY_PSRAM       0
+#endif
+
+// Unit of profiled function time, see d_m3EnableFunctionProfiling
+#ifdef ESP_PLATFORM
+#define WASM_PROFILE_TIME_UNIT  "cycles"
+#else
+#define WASM_PROFILE_TIME_UNIT  "ns"
+#endif
+
+// Per-task log ring size in bytes, must be a power of two
+#define WASM_LOG_SIZE           2048
+
+// Also write applet logs to stdout, this blocks the applet on the console UART
+#define WASM_LOG_STDOUT         0
+
+// Thread local storage slot holding the WasmTask_t running on a task (applet or dispatcher),
+// for m3_Yield
+#define WASM_TLS_INDEX          1
+
+// Output callback for profile dumps
+typedef int (*WasmWriter_t)(void* ctx, const char* buff, size_t len);
+
 typedef struct  {
     // Task name
     char        name[TASK_NAME_MAX_LEN];
@@ -21,6 +62,11 @@ typedef struct  {
     // WASM binary data
     uint8_t     *data;
     uint32_t    data_len;
+    uint32_t    crc;
+
+    // Execute-in-place slot and mapping, NULL mapping if data is heap allocated
+    uint32_t     xip_slot;
+    XipMapping_t mapping;
 
     // Arguments to be passed to the runtime
     char     args[TASK_MAX_ARGS][TASK_MAX_ARGLEN];
@@ -29,12 +75,52 @@ typedef struct  {
     // Thread handle for running task
     TaskHandle_t handle;
 
+    // FreeRTOS priority and core affinity (tskNO_AFFINITY for either core)
+    UBaseType_t priority;
+    BaseType_t  core;
+
     bool        running;
 
+    // Set by WASM_end_task, the task traps at its next call (or blocking host call) and exits
+    bool        cancel;
+
+    // Module cache entry in use by the running task (if any)
+    void        *cache;
+
+    // Runtime in use by the running task (if any), for profiling
+    void        *runtime;
+
+    // MQTT subscriptions and received messages (if any), see msg_mgr.h
+    void        *msg;
+
+    // Log output, written without locking by the task and read with WASM_log_read.
+    // Bytes are reserved before they are written, and the head published after.
+    char        log[WASM_LOG_SIZE];
+    uint32_t    log_reserved;
+    uint32_t    log_head;
+
 } WasmTask_t;
 
-int WASM_launch_task(const WasmTask_t* wasmInfo); 
+// Initialise the WASM runtime and module cache
+int WASM_init();
+
+int WASM_launch_task(WasmTask_t* wasmInfo); 
+
+int WASM_end_task(WasmTask_t* wasmInfo);
+
+// Drop all idle cached modules, returns the number of entries freed
+int WASM_cache_flush();
+
+// Drop idle cached modules mapping an execute-in-place slot, returns -1 if a running
+// module still maps it (and the slot must not be erased)
+int WASM_cache_flush_xip(uint32_t xip_slot);
+
+// Read buffered log output from a cursor (0 for the oldest available), advancing it past
+// the returned bytes. Output that was overwritten before it was read is skipped.
+uint32_t WASM_log_read(WasmTask_t* wasmInfo, uint32_t* cursor, char* buff, uint32_t len);
 
-int WASM_end_task(const WasmTask_t* wasmInfo);
+// Write per-function and per-operation profiles for a running or cached task,
+// optionally resetting the counters. Returns -1 if the task has no runtime.
+int WASM_profile(WasmTask_t* wasmInfo, bool reset, WasmWriter_t writer, void* ctx);
 
 #endif
@@ -0,0 +1,424 @@
+#include "spi_mgr.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_idf_version.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "driver/spi_master.h"
+
+#define TAG "SPI_MGR"
+
+// IDF 4.3+ picks a free DMA channel, older IDFs tie one channel to each bus
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+#define SPI_DMA_CHANNEL(_port)  SPI_DMA_CH_AUTO
+#else
+#define SPI_DMA_CHANNEL(_port)  ((_port) + 1)
+#endif
+
+typedef struct {
+    bool                used;
+    uint32_t            port;
+    const void          *owner;
+    uint32_t            timeout_ms;
+    spi_device_handle_t handle;
+    SemaphoreHandle_t   lock;
+
+    // Queued transactions must outlive the call that queued them, they are used as a
+    // ring and completed by the driver in the order they were queued
+    spi_transaction_t   trans[SPI_MGR_QUEUE_SIZE];
+    uint32_t            head;
+    uint32_t            pending;
+} SpiDevice_t;
+
+static bool ports[SPI_MGR_PORTS];
+static SpiDevice_t devices[SPI_MGR_DEVICES];
+
+// Serialises changes to the port and device tables
+static SemaphoreHandle_t spi_lock = NULL;
+
+
+static esp_err_t spi_get_port(uint32_t port, spi_host_device_t *host) {
+    switch (port) {
+        case 0:
+            *host = SPI2_HOST;
+            break;
+        case 1:
+            *host = SPI3_HOST;
+            break;
+        default:
+            ESP_LOGE(TAG, "Invalid port number: %d", port);
+            return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+// Devices are only usable by the owner that added them
+static SpiDevice_t* spi_get_device(uint32_t dev, const void *owner) {
+    if (dev >= SPI_MGR_DEVICES || !devices[dev].used || owner == NULL || devices[dev].owner != owner) {
+        ESP_LOGE(TAG, "Invalid device: %d", dev);
+        return NULL;
+    }
+
+    return &devices[dev];
+}
+
+static esp_err_t spi_take_lock() {
+    if (spi_lock == NULL) {
+        spi_lock = xSemaphoreCreateMutex();
+        if (spi_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(spi_lock, portMAX_DELAY);
+
+    return ESP_OK;
+}
+
+int spi_init(uint32_t port, int32_t sclk, int32_t mosi, int32_t miso) {
+    spi_host_device_t host;
+    if( spi_get_port(port, &host) != ESP_OK ) {
+        return ESP_FAIL;
+    }
+
+    spi_bus_config_t conf;
+    memset(&conf, 0, sizeof(conf));
+
+    conf.sclk_io_num = sclk;
+    conf.mosi_io_num = mosi;
+    conf.miso_io_num = miso;
+    conf.quadwp_io_num = -1;
+    conf.quadhd_io_num = -1;
+    conf.max_transfer_sz = SPI_MGR_MAX_TRANSFER;
+
+    esp_err_t res = spi_take_lock();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    // Buses can only be re-configured once all devices are removed
+    if (ports[port]) {
+        res = ESP_ERR_INVALID_STATE;
+    } else {
+        res = spi_bus_initialize(host, &conf, SPI_DMA_CHANNEL(port));
+        ports[port] = (res == ESP_OK);
+    }
+
+    xSemaphoreGive(spi_lock);
+
+    return res;
+}
+
+int spi_deinit(uint32_t port) {
+    spi_host_device_t host;
+    if( spi_get_port(port, &host) != ESP_OK ) {
+        return ESP_FAIL;
+    }
+
+    esp_err_t res = spi_take_lock();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    if (ports[port]) {
+        res = spi_bus_free(host);
+        ports[port] = (res != ESP_OK);
+    }
+
+    xSemaphoreGive(spi_lock);
+
+    return res;
+}
+
+int spi_device_add(uint32_t port, int32_t cs, uint32_t freq, uint32_t mode, const void *owner) {
+    spi_host_device_t host;
+    if( spi_get_port(port, &host) != ESP_OK ) {
+        return ESP_FAIL;
+    }
+
+    if (mode > 3 || owner == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    spi_device_interface_config_t conf;
+    memset(&conf, 0, sizeof(conf));
+
+    conf.mode = mode;
+    conf.clock_speed_hz = freq;
+    conf.spics_io_num = cs;
+    conf.queue_size = SPI_MGR_QUEUE_SIZE;
+
+    esp_err_t res = spi_take_lock();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    // Find a free device slot
+    int dev = -1;
+    for (int i=0; i<SPI_MGR_DEVICES && ports[port]; i++) {
+        if (!devices[i].used) {
+            dev = i;
+            break;
+        }
+    }
+
+    if (!ports[port]) {
+        res = ESP_ERR_INVALID_STATE;
+    } else if (dev < 0) {
+        res = ESP_ERR_NO_MEM;
+    } else if (devices[dev].lock == NULL && (devices[dev].lock = xSemaphoreCreateMutex()) == NULL) {
+        res = ESP_ERR_NO_MEM;
+    } else {
+        res = spi_bus_add_device(host, &conf, &devices[dev].handle);
+    }
+
+    if (res == ESP_OK) {
+        devices[dev].used = true;
+        devices[dev].port = port;
+        devices[dev].owner = owner;
+        devices[dev].timeout_ms = 0;
+        devices[dev].head = 0;
+        devices[dev].pending = 0;
+    }
+
+    xSemaphoreGive(spi_lock);
+
+    if (res != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add device on port %d (cs: %d): %d", port, cs, res);
+        return res < 0 ? res : -res;
+    }
+
+    return dev;
+}
+
+// Round up so short timeouts still wait for at least a tick
+static TickType_t spi_ticks(uint32_t timeout_ms) {
+    return ((uint64_t) timeout_ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS;
+}
+
+// Collect up to count completed transactions, oldest first
+static esp_err_t spi_reap(SpiDevice_t *d, uint32_t count, TickType_t timeout) {
+    while (count > 0 && d->pending > 0) {
+        spi_transaction_t *t;
+
+        esp_err_t res = spi_device_get_trans_result(d->handle, &t, timeout);
+        if (res != ESP_OK) {
+            return res;
+        }
+
+        d->head = (d->head + 1) % SPI_MGR_QUEUE_SIZE;
+        d->pending -= 1;
+        count -= 1;
+    }
+
+    return ESP_OK;
+}
+
+static uint32_t spi_get_timeout(SpiDevice_t *d) {
+    return d->timeout_ms ? d->timeout_ms : SPI_MGR_DEFAULT_TIMEOUT_MS;
+}
+
+// Remove a device with the table lock held
+static esp_err_t spi_remove(SpiDevice_t *d, TickType_t timeout) {
+    // The driver refuses to remove devices with transactions in flight
+    xSemaphoreTake(d->lock, portMAX_DELAY);
+
+    esp_err_t res = spi_reap(d, SPI_MGR_QUEUE_SIZE, timeout);
+    if (res == ESP_OK) {
+        res = spi_bus_remove_device(d->handle);
+    }
+    if (res == ESP_OK) {
+        d->used = false;
+        d->owner = NULL;
+        d->handle = NULL;
+    }
+
+    xSemaphoreGive(d->lock);
+
+    return res;
+}
+
+int spi_device_remove(uint32_t dev, const void *owner) {
+    esp_err_t res = spi_take_lock();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    SpiDevice_t *d = spi_get_device(dev, owner);
+    if (d == NULL) {
+        res = ESP_FAIL;
+    } else {
+        res = spi_remove(d, spi_ticks(spi_get_timeout(d)));
+    }
+
+    xSemaphoreGive(spi_lock);
+
+    return res;
+}
+
+int spi_set_timeout(uint32_t dev, uint32_t timeout_ms, const void *owner) {
+    SpiDevice_t *d = spi_get_device(dev, owner);
+    if (d == NULL) {
+        return ESP_FAIL;
+    }
+
+    d->timeout_ms = timeout_ms;
+
+    return ESP_OK;
+}
+
+int spi_transfer(uint32_t dev, const uint8_t *tx, uint8_t *rx, uint32_t len, const void *owner) {
+    SpiDevice_t *d = spi_get_device(dev, owner);
+    if (d == NULL) {
+        return ESP_FAIL;
+    }
+
+    if (len == 0) {
+        return ESP_OK;
+    }
+
+    if (len > SPI_MGR_MAX_TRANSFER) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    spi_transaction_t t;
+    memset(&t, 0, sizeof(t));
+
+    t.length = len * 8;
+    t.tx_buffer = tx;
+    t.rx_buffer = rx;
+
+    xSemaphoreTake(d->lock, portMAX_DELAY);
+
+    // Results are returned in order, so drain the queue before a blocking transfer
+    esp_err_t res = spi_reap(d, SPI_MGR_QUEUE_SIZE, spi_ticks(spi_get_timeout(d)));
+    if (res == ESP_OK) {
+        res = spi_device_transmit(d->handle, &t);
+    }
+
+    xSemaphoreGive(d->lock);
+
+    return res;
+}
+
+int spi_transfer_batch(uint32_t dev, const SpiOp_t *ops, uint32_t count, const void *owner) {
+    SpiDevice_t *d = spi_get_device(dev, owner);
+    if (d == NULL) {
+        return ESP_FAIL;
+    }
+
+    if (count == 0 || count > SPI_MGR_QUEUE_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint32_t i=0; i<count; i++) {
+        if (ops[i].len == 0 || ops[i].len > SPI_MGR_MAX_TRANSFER) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    uint32_t timeout_ms = spi_get_timeout(d);
+
+    xSemaphoreTake(d->lock, portMAX_DELAY);
+
+    // Make room by waiting for the oldest transfers
+    esp_err_t res = ESP_OK;
+    uint32_t available = SPI_MGR_QUEUE_SIZE - d->pending;
+    if (count > available) {
+        res = spi_reap(d, count - available, spi_ticks(timeout_ms));
+    }
+
+    for (uint32_t i=0; i<count && res == ESP_OK; i++) {
+        spi_transaction_t *t = &d->trans[(d->head + d->pending) % SPI_MGR_QUEUE_SIZE];
+        memset(t, 0, sizeof(*t));
+
+        t->length = ops[i].len * 8;
+        t->tx_buffer = ops[i].tx;
+        t->rx_buffer = ops[i].rx;
+
+        res = spi_device_queue_trans(d->handle, t, spi_ticks(timeout_ms));
+        if (res == ESP_OK) {
+            d->pending += 1;
+        }
+    }
+
+    xSemaphoreGive(d->lock);
+
+    return res;
+}
+
+int spi_wait(uint32_t dev, uint32_t timeout_ms, const void *owner) {
+    SpiDevice_t *d = spi_get_device(dev, owner);
+    if (d == NULL) {
+        return ESP_FAIL;
+    }
+
+    xSemaphoreTake(d->lock, portMAX_DELAY);
+
+    esp_err_t res = spi_reap(d, SPI_MGR_QUEUE_SIZE, spi_ticks(timeout_ms));
+
+    xSemaphoreGive(d->lock);
+
+    return res;
+}
+
+int spi_pending(uint32_t dev, const void *owner) {
+    SpiDevice_t *d = spi_get_device(dev, owner);
+    if (d == NULL) {
+        return ESP_FAIL;
+    }
+
+    return d->pending;
+}
+
+int spi_wait_owner(const void *owner, uint32_t timeout_ms) {
+    esp_err_t res = spi_take_lock();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    for (int i=0; i<SPI_MGR_DEVICES && res == ESP_OK; i++) {
+        SpiDevice_t *d = &devices[i];
+        if (!d->used || d->owner != owner) {
+            continue;
+        }
+
+        xSemaphoreTake(d->lock, portMAX_DELAY);
+        res = spi_reap(d, SPI_MGR_QUEUE_SIZE, spi_ticks(timeout_ms));
+        xSemaphoreGive(d->lock);
+    }
+
+    xSemaphoreGive(spi_lock);
+
+    return res;
+}
+
+void spi_release_owner(const void *owner) {
+    if (owner == NULL || spi_take_lock() != ESP_OK) {
+        return;
+    }
+
+    for (int i=0; i<SPI_MGR_DEVICES; i++) {
+        SpiDevice_t *d = &devices[i];
+        if (!d->used || d->owner != owner) {
+            continue;
+        }
+
+        // The owner's memory is freed once this returns, so wait for its transfers however
+        // long they take rather than leave DMA running into it
+        esp_err_t res = spi_remove(d, portMAX_DELAY);
+        if (res != ESP_OK) {
+            // Nothing is queued any more, but the driver kept the device, so orphan it
+            ESP_LOGE(TAG, "Failed to release device %d: %d", i, res);
+            d->owner = NULL;
+        }
+    }
+
+    xSemaphoreGive(spi_lock);
+}
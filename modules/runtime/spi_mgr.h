@@ -0,0 +1,65 @@
+#ifndef SPI_MGR_H
+#define SPI_MGR_H
+
+#include <stdint.h>
+
+#define SPI_MGR_PORTS               2
+#define SPI_MGR_DEVICES             4
+#define SPI_MGR_DEFAULT_TIMEOUT_MS  1000
+
+// Largest single transfer, sizes the DMA descriptor list allocated by the bus
+#define SPI_MGR_MAX_TRANSFER        (32 * 1024)
+
+// Transfers that may be queued on a device at once
+#define SPI_MGR_QUEUE_SIZE          8
+
+// Transfer segment, tx and / or rx may be NULL for half-duplex use
+//
+// Buffers are handed to the DMA engine directly when they are in internal RAM and
+// word aligned (with len a multiple of 4 for rx), otherwise the driver bounces them
+// through a temporary DMA-capable buffer.
+typedef struct {
+    const uint8_t   *tx;
+    uint8_t         *rx;
+    uint32_t        len;
+} SpiOp_t;
+
+// Initialise a bus (0: SPI2 / HSPI, 1: SPI3 / VSPI) with DMA, pins may be -1 if unused
+int spi_init(uint32_t port, int32_t sclk, int32_t mosi, int32_t miso);
+
+int spi_deinit(uint32_t port);
+
+// Attach a device to an initialised bus for an owner (the applet task), returns a device
+// index or a negative error
+int spi_device_add(uint32_t port, int32_t cs, uint32_t freq, uint32_t mode, const void *owner);
+
+// Device functions fail unless owner is the one the device was added for
+
+// Detach a device, waiting for any queued transfers first
+int spi_device_remove(uint32_t dev, const void *owner);
+
+int spi_set_timeout(uint32_t dev, uint32_t timeout_ms, const void *owner);
+
+// Blocking full-duplex transfer
+int spi_transfer(uint32_t dev, const uint8_t *tx, uint8_t *rx, uint32_t len, const void *owner);
+
+// Queue a list of transfers and return immediately, buffers must stay valid until
+// spi_wait returns. Blocks only if the device queue is full.
+int spi_transfer_batch(uint32_t dev, const SpiOp_t *ops, uint32_t count, const void *owner);
+
+// Wait for all queued transfers on a device to complete
+int spi_wait(uint32_t dev, uint32_t timeout_ms, const void *owner);
+
+// Number of transfers still queued on a device, or a negative error
+int spi_pending(uint32_t dev, const void *owner);
+
+// Wait for the queued transfers on all of an owner's devices, before the buffers they
+// point into are moved
+int spi_wait_owner(const void *owner, uint32_t timeout_ms);
+
+// Remove all of an owner's devices once it stops, waiting for queued transfers however
+// long they take
+void spi_release_owner(const void *owner);
+
+#endif
+
@@ -0,0 +1,304 @@
+#include "xip_mgr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "esp_log.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#include "rom/crc.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#define TAG "XIP_MGR"
+
+// Slots start with a header sector, the binary follows
+#define XIP_SECTOR_SIZE     4096
+#define XIP_SLOT_ALIGN      (64 * 1024)
+#define XIP_MAGIC           0x41505058
+
+#define XIP_CHUNK_SIZE      1024
+
+typedef struct {
+    uint32_t magic;
+    uint32_t len;
+    uint32_t crc;
+    uint32_t reserved;
+} XipHeader_t;
+
+static uint32_t slot_size = 0;
+
+
+#ifdef ESP_PLATFORM
+
+static const esp_partition_t* partition = NULL;
+
+static int xip_open(uint32_t* size) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, XIP_MGR_PARTITION_LABEL);
+    if (partition == NULL) {
+        return -1;
+    }
+
+    *size = partition->size;
+    return 0;
+}
+
+static int xip_erase(uint32_t offset, uint32_t len) {
+    return esp_partition_erase_range(partition, offset, len) == ESP_OK ? 0 : -1;
+}
+
+static int xip_write(uint32_t offset, const void* data, uint32_t len) {
+    return esp_partition_write(partition, offset, data, len) == ESP_OK ? 0 : -1;
+}
+
+static int xip_read(uint32_t offset, void* data, uint32_t len) {
+    return esp_partition_read(partition, offset, data, len) == ESP_OK ? 0 : -1;
+}
+
+static int xip_mmap(uint32_t offset, uint32_t len, const uint8_t** data, XipMapping_t* mapping) {
+    spi_flash_mmap_handle_t handle;
+
+    esp_err_t err = esp_partition_mmap(partition, offset, len, SPI_FLASH_MMAP_DATA, (const void**) data, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map partition (%s)", esp_err_to_name(err));
+        return -1;
+    }
+
+    // Handles are small integers, offset so a valid mapping is never NULL
+    *mapping = (XipMapping_t) (handle + 1);
+
+    return 0;
+}
+
+static void xip_munmap(XipMapping_t mapping) {
+    spi_flash_munmap((spi_flash_mmap_handle_t) mapping - 1);
+}
+
+static uint32_t xip_crc32(uint32_t crc, const uint8_t* data, uint32_t len) {
+    return crc32_le(crc, data, len);
+}
+
+#else
+
+static int host_fd = -1;
+
+typedef struct {
+    void*   base;
+    size_t  len;
+} XipHostMapping_t;
+
+static int xip_open(uint32_t* size) {
+    host_fd = open(XIP_MGR_HOST_FILE, O_RDWR | O_CREAT, 0644);
+    if (host_fd < 0) {
+        return -1;
+    }
+
+    // Size the backing file like a freshly erased partition
+    off_t end = lseek(host_fd, 0, SEEK_END);
+    if (end < XIP_MGR_HOST_SIZE) {
+        uint8_t erased[XIP_SECTOR_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+
+        for (off_t o = end; o < XIP_MGR_HOST_SIZE; o += sizeof(erased)) {
+            pwrite(host_fd, erased, sizeof(erased), o);
+        }
+    }
+
+    *size = XIP_MGR_HOST_SIZE;
+    return 0;
+}
+
+static int xip_erase(uint32_t offset, uint32_t len) {
+    uint8_t erased[XIP_SECTOR_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+
+    for (uint32_t o = 0; o < len; o += sizeof(erased)) {
+        if (pwrite(host_fd, erased, sizeof(erased), offset + o) != sizeof(erased)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int xip_write(uint32_t offset, const void* data, uint32_t len) {
+    return pwrite(host_fd, data, len, offset) == len ? 0 : -1;
+}
+
+static int xip_read(uint32_t offset, void* data, uint32_t len) {
+    return pread(host_fd, data, len, offset) == len ? 0 : -1;
+}
+
+static int xip_mmap(uint32_t offset, uint32_t len, const uint8_t** data, XipMapping_t* mapping) {
+    // mmap offsets must be page aligned, as with the flash MMU
+    long page = sysconf(_SC_PAGESIZE);
+    uint32_t aligned = offset & ~(page - 1);
+
+    XipHostMapping_t* m = malloc(sizeof(XipHostMapping_t));
+    if (m == NULL) {
+        return -1;
+    }
+
+    m->len = len + (offset - aligned);
+    m->base = mmap(NULL, m->len, PROT_READ, MAP_SHARED, host_fd, aligned);
+    if (m->base == MAP_FAILED) {
+        ESP_LOGE(TAG, "Failed to map %s", XIP_MGR_HOST_FILE);
+        free(m);
+        return -1;
+    }
+
+    *data = (const uint8_t*) m->base + (offset - aligned);
+    *mapping = m;
+
+    return 0;
+}
+
+static void xip_munmap(XipMapping_t mapping) {
+    XipHostMapping_t* m = (XipHostMapping_t*) mapping;
+
+    munmap(m->base, m->len);
+    free(m);
+}
+
+static uint32_t xip_crc32(uint32_t crc, const uint8_t* data, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i=0; i<len; i++) {
+        crc ^= data[i];
+        for (int b=0; b<8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+#endif
+
+
+int XIP_MGR_init() {
+    uint32_t size;
+
+    ESP_LOGI(TAG, "Initialising XIP Manager");
+
+    if (xip_open(&size) < 0) {
+        ESP_LOGI(TAG, "No %s partition, execute-in-place disabled", XIP_MGR_PARTITION_LABEL);
+        return -1;
+    }
+
+    slot_size = (size / XIP_MGR_SLOTS) & ~(XIP_SLOT_ALIGN - 1);
+    if (slot_size <= XIP_SECTOR_SIZE) {
+        ESP_LOGE(TAG, "Partition too small for %d slots (%d bytes)", XIP_MGR_SLOTS, size);
+        slot_size = 0;
+        return -2;
+    }
+
+    ESP_LOGI(TAG, "Applet partition: %d slots of %d bytes", XIP_MGR_SLOTS, slot_size);
+
+    return 0;
+}
+
+int XIP_MGR_install(uint32_t slot, const char* file) {
+    int res = 0;
+
+    if (slot_size == 0 || slot >= XIP_MGR_SLOTS) {
+        return -1;
+    }
+
+    FILE* f = fopen(file, "r");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open file %s", file);
+        return -2;
+    }
+
+    uint8_t* chunk = malloc(XIP_CHUNK_SIZE);
+    if (chunk == NULL) {
+        fclose(f);
+        return -3;
+    }
+
+    // Compute the file CRC to check whether the slot is up to date
+    XipHeader_t header = { .magic = XIP_MAGIC, .len = 0, .crc = 0 };
+    size_t n;
+    while ((n = fread(chunk, 1, XIP_CHUNK_SIZE, f)) > 0) {
+        header.crc = xip_crc32(header.crc, chunk, n);
+        header.len += n;
+    }
+
+    XipHeader_t current;
+    if (xip_read(slot * slot_size, &current, sizeof(current)) == 0 && memcmp(&current, &header, sizeof(header)) == 0) {
+        ESP_LOGI(TAG, "Slot %d already holds %s (crc: %08x)", slot, file, header.crc);
+        goto install_done;
+    }
+
+    if (header.len > slot_size - XIP_SECTOR_SIZE) {
+        ESP_LOGE(TAG, "File %s too large for slot (%d bytes, max %d)", file, header.len, slot_size - XIP_SECTOR_SIZE);
+        res = -4;
+        goto install_done;
+    }
+
+    // Erase the header and enough sectors for the binary
+    uint32_t erase_len = (XIP_SECTOR_SIZE + header.len + XIP_SECTOR_SIZE - 1) & ~(XIP_SECTOR_SIZE - 1);
+    if (xip_erase(slot * slot_size, erase_len) < 0) {
+        ESP_LOGE(TAG, "Failed to erase slot %d", slot);
+        res = -5;
+        goto install_done;
+    }
+
+    // Copy the binary, the header is written last so partial installs are invalid
+    rewind(f);
+    uint32_t offset = slot * slot_size + XIP_SECTOR_SIZE;
+    while ((n = fread(chunk, 1, XIP_CHUNK_SIZE, f)) > 0) {
+        if (xip_write(offset, chunk, n) < 0) {
+            ESP_LOGE(TAG, "Failed to write slot %d", slot);
+            res = -6;
+            goto install_done;
+        }
+        offset += n;
+    }
+
+    if (xip_write(slot * slot_size, &header, sizeof(header)) < 0) {
+        res = -6;
+        goto install_done;
+    }
+
+    ESP_LOGI(TAG, "Installed %s to slot %d (%d bytes, crc: %08x)", file, slot, header.len, header.crc);
+
+install_done:
+    free(chunk);
+    fclose(f);
+
+    return res;
+}
+
+int XIP_MGR_map(uint32_t slot, const uint8_t** data, uint32_t* len, uint32_t* crc, XipMapping_t* mapping) {
+    if (slot_size == 0 || slot >= XIP_MGR_SLOTS) {
+        return -1;
+    }
+
+    XipHeader_t header;
+    if (xip_read(slot * slot_size, &header, sizeof(header)) < 0 || header.magic != XIP_MAGIC) {
+        ESP_LOGE(TAG, "No applet installed in slot %d", slot);
+        return -2;
+    }
+
+    if (xip_mmap(slot * slot_size + XIP_SECTOR_SIZE, header.len, data, mapping) < 0) {
+        return -3;
+    }
+
+    *len = header.len;
+    if (crc != NULL) {
+        *crc = header.crc;
+    }
+
+    return 0;
+}
+
+void XIP_MGR_unmap(XipMapping_t mapping) {
+    if (mapping != NULL) {
+        xip_munmap(mapping);
+    }
+}
@@ -0,0 +1,33 @@
+
+#ifndef XIP_MGR_H
+#define XIP_MGR_H
+
+#include <stdint.h>
+
+// Raw data partition applets are installed to for execute-in-place loading
+#define XIP_MGR_PARTITION_LABEL     "applets"
+
+// On linux a file stands in for the partition
+#define XIP_MGR_HOST_FILE           "applets.bin"
+#define XIP_MGR_HOST_SIZE           (1024 * 1024)
+
+// Number of applet slots in the partition, one per application manager slot
+#define XIP_MGR_SLOTS               4
+
+// Handle for a mapped applet
+typedef void* XipMapping_t;
+
+// Initialise execute-in-place storage, fails if the partition is missing
+int XIP_MGR_init();
+
+// Install a file into an applet slot
+// This is skipped if the slot already holds the same binary
+int XIP_MGR_install(uint32_t slot, const char* file);
+
+// Map the applet in a slot into the address space without copying it into RAM
+int XIP_MGR_map(uint32_t slot, const uint8_t** data, uint32_t* len, uint32_t* crc, XipMapping_t* mapping);
+
+// Release a mapped applet
+void XIP_MGR_unmap(XipMapping_t mapping);
+
+#endif
@@ -26,6 +26,10 @@ typedef uint32_t __wasi_size_t;
 #include <fcntl.h>
 #include <unistd.h>
 
+#if defined(__FreeBSD__) || defined(__linux__)
+#include <sys/random.h>
+#endif
+
 struct wasi_iovec
 {
     __wasi_size_t iov_base;
@@ -434,52 +438,42 @@ m3ApiRawFunction(m3_wasi_unstable_proc_exit)
 }
 
 
-static
-M3Result SuppressLookupFailure(M3Result i_result)
-{
-    if (i_result == m3Err_functionLookupFailed)
-        return m3Err_none;
-    else
-        return i_result;
-}
-
+static const char wasi [] = "wasi_unstable";
 
-M3Result  m3_LinkEspWASI  (IM3Module module)
+// TODO: Preopen dirs
+static const M3RawFunctionLink esp_wasi_links [] =
 {
-    M3Result result = m3Err_none;
-
-    const char* wasi  = "wasi_unstable";
-
-    // TODO: Preopen dirs
+    { wasi, "args_sizes_get",       "i(**)",   &m3_wasi_unstable_args_sizes_get },
+    { wasi, "environ_sizes_get",    "i(**)",   &m3_wasi_unstable_environ_sizes_get },
+    { wasi, "args_get",             "i(**)",   &m3_wasi_unstable_args_get },
+    { wasi, "environ_get",          "i(**)",   &m3_wasi_unstable_environ_get },
 
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "args_sizes_get",       "i(**)",   &m3_wasi_unstable_args_sizes_get)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "environ_sizes_get",    "i(**)",   &m3_wasi_unstable_environ_sizes_get)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "args_get",             "i(**)",   &m3_wasi_unstable_args_get)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "environ_get",          "i(**)",   &m3_wasi_unstable_environ_get)));
+    { wasi, "fd_prestat_dir_name",  "i(i*i)",  &m3_wasi_unstable_fd_prestat_dir_name },
+    { wasi, "fd_prestat_get",       "i(i*)",   &m3_wasi_unstable_fd_prestat_get },
 
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "fd_prestat_dir_name",  "i(i*i)",  &m3_wasi_unstable_fd_prestat_dir_name)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "fd_prestat_get",       "i(i*)",   &m3_wasi_unstable_fd_prestat_get)));
+    { wasi, "path_open",            "i(ii*iiiii*)",  &m3_wasi_unstable_path_open },
 
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "path_open",            "i(ii*iiiii*)",  &m3_wasi_unstable_path_open)));
+    { wasi, "fd_fdstat_get",        "i(i*)",   &m3_wasi_unstable_fd_fdstat_get },
+    { wasi, "fd_write",             "i(iii*)", &m3_wasi_unstable_fd_write },
+    { wasi, "fd_read",              "i(iii*)", &m3_wasi_unstable_fd_read },
+    { wasi, "fd_seek",              "i(iii*)", &m3_wasi_unstable_fd_seek },
+    { wasi, "fd_datasync",          "i(i)",    &m3_wasi_unstable_fd_datasync },
+    { wasi, "fd_close",             "i(i)",    &m3_wasi_unstable_fd_close },
 
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "fd_fdstat_get",        "i(i*)",   &m3_wasi_unstable_fd_fdstat_get)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "fd_write",             "i(iii*)", &m3_wasi_unstable_fd_write)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "fd_read",              "i(iii*)", &m3_wasi_unstable_fd_read)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "fd_seek",              "i(iii*)", &m3_wasi_unstable_fd_seek)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "fd_datasync",          "i(i)",    &m3_wasi_unstable_fd_datasync)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "fd_close",             "i(i)",    &m3_wasi_unstable_fd_close)));
+//  { wasi, "sock_send",            "i()",  &... },
+//  { wasi, "sock_recv",            "i()",  &... },
 
-//_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "sock_send",            "i()",  &...)));
-//_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "sock_recv",            "i()",  &...)));
+    { wasi, "random_get",           "i(*i)",   &m3_wasi_unstable_random_get },
 
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "random_get",           "i(*i)",   &m3_wasi_unstable_random_get)));
+    { wasi, "clock_res_get",        "i(i*)",   &m3_wasi_unstable_clock_res_get },
+    { wasi, "clock_time_get",       "i(ii*)",  &m3_wasi_unstable_clock_time_get },
+    { wasi, "proc_exit",            "i(i)",    &m3_wasi_unstable_proc_exit },
+};
 
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "clock_res_get",        "i(i*)",   &m3_wasi_unstable_clock_res_get)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "clock_time_get",       "i(ii*)",  &m3_wasi_unstable_clock_time_get)));
-_   (SuppressLookupFailure (m3_LinkRawFunction (module, wasi, "proc_exit",            "i(i)",    &m3_wasi_unstable_proc_exit)));
 
-_catch:
-    return result;
+M3Result  m3_LinkEspWASI  (IM3Module module)
+{
+    return m3_LinkRawFunctions (module, esp_wasi_links, sizeof (esp_wasi_links) / sizeof (esp_wasi_links [0]));
 }
 
 #endif // ESP32
@@ -92,19 +92,16 @@ M3Result  FindAndLinkFunction      (IM3Module       io_module,
     M3Result result = m3Err_functionLookupFailed;
 
     bool wildcardModule = (strcmp (i_moduleName, "*") == 0);
-    
-    for (u32 i = 0; i < io_module->numFunctions; ++i)
-    {
-        IM3Function f = & io_module->functions [i];
 
-        if (f->import.moduleUtf8 and f->import.fieldUtf8)
+    u32 cursor = 0;
+    IM3Function f;
+
+    while ((f = Module_FindNextFunction (io_module, true, i_functionName, & cursor)))
+    {
+        if (wildcardModule or strcmp (f->import.moduleUtf8, i_moduleName) == 0)
         {
-            if (strcmp (f->import.fieldUtf8, i_functionName) == 0 and
-               (wildcardModule or strcmp (f->import.moduleUtf8, i_moduleName) == 0))
-            {
-                result = i_linker (io_module, f, i_signature, i_function);
-                if (result) return result;
-            }
+            result = i_linker (io_module, f, i_signature, i_function);
+            if (result) return result;
         }
     }
 
@@ -147,3 +144,24 @@ M3Result  m3_LinkRawFunction  (IM3Module            io_module,
 {
     return FindAndLinkFunction (io_module, i_moduleName, i_functionName, i_signature, (voidptr_t)i_function, LinkRawFunction);
 }
+
+
+M3Result  m3_LinkRawFunctions  (IM3Module                   io_module,
+                                const M3RawFunctionLink *   i_links,
+                                uint32_t                    i_numLinks)
+{
+    M3Result result = m3Err_none;
+
+    for (u32 i = 0; i < i_numLinks and not result; ++i)
+    {
+        const M3RawFunctionLink * link = & i_links [i];
+
+        result = FindAndLinkFunction (io_module, link->moduleName, link->functionName, link->signature, (voidptr_t) link->function, LinkRawFunction);
+
+        // host functions the module doesn't import are skipped
+        if (result == m3Err_functionLookupFailed)
+            result = m3Err_none;
+    }
+
+    return result;
+}
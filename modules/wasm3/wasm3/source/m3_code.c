@@ -7,24 +7,102 @@
 
 #include "m3_code.h"
 
-IM3CodePage  NewCodePage  (u32 i_minNumLines)
+// freed pages are kept here, shared by all runtimes, so loading another module doesn't go back to the allocator
+static IM3CodePage      s_codePagePool          = NULL;
+static u32              s_codePagePoolBytes     = 0;
+
+
+static u32  CodePageBytes  (IM3CodePage i_page)
 {
-    static u32 s_sequence = 0;
+    return sizeof (M3CodePageHeader) + sizeof (code_t) * i_page->info.numLines;
+}
+
+
+// takes the smallest pooled page with between i_minNumLines and i_maxNumLines lines
+static IM3CodePage  TakePooledCodePage  (u32 i_minNumLines, u32 i_maxNumLines)
+{
+    IM3CodePage page = NULL;
+
+    m3_HeapLock ();
 
-    IM3CodePage page;
+    IM3CodePage * best = NULL;
+    IM3CodePage * link = & s_codePagePool;
 
-    u32 pageSize = sizeof (M3CodePageHeader) + sizeof (code_t) * i_minNumLines;
+    while (* link)
+    {
+        u32 numLines = (* link)->info.numLines;
+
+        if (numLines >= i_minNumLines and numLines <= i_maxNumLines)
+        {
+            if (not best or numLines < (* best)->info.numLines)
+                best = link;
+        }
+
+        link = & (* link)->info.next;
+    }
 
-    pageSize = (pageSize + (d_m3CodePageAlignSize-1)) & ~(d_m3CodePageAlignSize-1); // align
-    m3Malloc ((void **) & page, pageSize);
+    if (best)
+    {
+        page = PopCodePage (best);
+        s_codePagePoolBytes -= CodePageBytes (page);
+    }
+
+    m3_HeapUnlock ();
+
+    return page;
+}
+
+
+static void  FreeCodePage  (IM3CodePage i_page)
+{
+#if d_m3EnableCompiledImage
+    m3Free (i_page->info.pointerMap);
+#endif
+    m3Free (i_page);
+}
+
+
+// a page of i_numLines lines, or a pooled page that holds at least i_minNumLines and isn't much bigger
+IM3CodePage  NewCodePage  (u32 i_minNumLines, u32 i_numLines)
+{
+    static u32 s_sequence = 0;
+
+    i_numLines = M3_MAX (i_numLines, i_minNumLines);
+
+    IM3CodePage page = TakePooledCodePage (i_minNumLines, i_numLines + i_numLines / 4);
 
     if (page)
     {
-        page->info.sequence = ++s_sequence;
-        page->info.numLines = (pageSize - sizeof (M3CodePageHeader)) / sizeof (code_t);
+        page->info.lineIndex = 0;
+        page->info.usageCount = 0;
 
-        m3log (emit, "new page: %p; seq: %d; bytes: %d; lines: %d", GetPagePC (page), page->info.sequence, pageSize, page->info.numLines);
+#if d_m3EnableCompiledImage
+        memset (page->info.pointerMap, 0, (page->info.numLines + 7) / 8);
+#endif
     }
+    else
+    {
+        m3Malloc ((void **) & page, sizeof (M3CodePageHeader) + sizeof (code_t) * i_numLines);
+
+        if (not page)
+            return NULL;
+
+        page->info.numLines = i_numLines;
+
+#if d_m3EnableCompiledImage
+        m3Malloc ((void **) & page->info.pointerMap, (page->info.numLines + 7) / 8);
+
+        if (not page->info.pointerMap)
+        {
+            m3Free (page);
+            return NULL;
+        }
+#endif
+    }
+
+    page->info.sequence = ++s_sequence;
+
+    m3log (emit, "new page: %p; seq: %d; bytes: %d; lines: %d", GetPagePC (page), page->info.sequence, CodePageBytes (page), page->info.numLines);
 
     return page;
 }
@@ -37,12 +115,46 @@ void  FreeCodePages  (IM3CodePage i_page)
         m3log (code, "free page: %d  util: %3.1f%%", i_page->info.sequence, 100. * i_page->info.lineIndex / i_page->info.numLines);
 
         IM3CodePage next = i_page->info.next;
-        m3Free (i_page);
+        u32 bytes = CodePageBytes (i_page);
+
+        m3_HeapLock ();
+
+        bool pooled = (s_codePagePoolBytes + bytes <= d_m3CodePagePoolSize);
+        if (pooled)
+        {
+            PushCodePage (& s_codePagePool, i_page);
+            s_codePagePoolBytes += bytes;
+        }
+
+        m3_HeapUnlock ();
+
+        if (not pooled)
+            FreeCodePage (i_page);
+
         i_page = next;
     }
 }
 
 
+void  m3_ReleaseCodePagePool  (void)
+{
+    m3_HeapLock ();
+
+    IM3CodePage page = s_codePagePool;
+    s_codePagePool = NULL;
+    s_codePagePoolBytes = 0;
+
+    m3_HeapUnlock ();
+
+    while (page)
+    {
+        IM3CodePage next = page->info.next;
+        FreeCodePage (page);
+        page = next;
+    }
+}
+
+
 u32  NumFreeLines  (IM3CodePage i_page)
 {
     d_m3Assert (i_page->info.lineIndex <= i_page->info.numLines);
@@ -63,6 +175,24 @@ void  EmitWord64_impl  (IM3CodePage i_page, const u64 i_word)
 }
 
 
+#if d_m3EnableCompiledImage
+
+// flags the next emitted line as a pointer that must be relocated when the page is serialized
+void  MarkPagePointer  (IM3CodePage i_page)
+{
+    u32 line = i_page->info.lineIndex;
+    i_page->info.pointerMap [line / 8] |= (u8) (1 << (line % 8));
+}
+
+
+bool  IsPagePointer  (IM3CodePage i_page, u32 i_lineIndex)
+{
+    return (i_page->info.pointerMap [i_lineIndex / 8] >> (i_lineIndex % 8)) & 1;
+}
+
+#endif
+
+
 pc_t  GetPageStartPC  (IM3CodePage i_page)
 {
     return & i_page->code [0];
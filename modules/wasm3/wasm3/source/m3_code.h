@@ -24,7 +24,10 @@ M3CodePage;
 typedef M3CodePage *    IM3CodePage;
 
 
-IM3CodePage             NewCodePage             (u32 i_minNumLines);
+#define c_m3CodePageMinLines    ((d_m3CodePageMinSize - sizeof (M3CodePageHeader)) / sizeof (code_t))
+#define c_m3CodePageMaxLines    ((d_m3CodePageAlignSize - sizeof (M3CodePageHeader)) / sizeof (code_t))
+
+IM3CodePage             NewCodePage             (u32 i_minNumLines, u32 i_numLines);
 
 void                    FreeCodePages           (IM3CodePage i_page);
 u32                     NumFreeLines            (IM3CodePage i_page);
@@ -33,6 +36,13 @@ pc_t                    GetPagePC               (IM3CodePage i_page);
 void                    EmitWord64_impl         (IM3CodePage i_page, u64 i_word);
 void                    EmitWord_impl           (IM3CodePage i_page, void* i_word);
 
+#if d_m3EnableCompiledImage
+void                    MarkPagePointer         (IM3CodePage i_page);
+bool                    IsPagePointer           (IM3CodePage i_page, u32 i_lineIndex);
+#else
+#   define              MarkPagePointer(page)
+#endif
+
 void                    PushCodePage            (IM3CodePage * i_list, IM3CodePage i_codePage);
 IM3CodePage             PopCodePage             (IM3CodePage * i_list);
 
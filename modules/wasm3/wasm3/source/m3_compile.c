@@ -1227,12 +1227,12 @@ _   (ReadLEB_i7 (& reserved, & o->wasm, o->wasmEnd));
     if (typeIndex < o->module->numFuncTypes)
     {
         u16 execTop;
-        IM3FuncType type = & o->module->funcTypes [typeIndex];
+        IM3FuncType type = o->module->funcTypes [typeIndex];
 _       (CompileCallArgsReturn (o, & execTop, type, true));
 
 _       (EmitOp     (o, op_CallIndirect));
         EmitPointer (o, o->module);
-        EmitPointer (o, type);              // TODO: unify all types in M3Environment
+        EmitPointer (o, type);
         EmitSlotOffset  (o, execTop);
     }
     else _throw ("function type index out of range");
@@ -1274,6 +1274,98 @@ _   (PushRegister (o, c_m3Type_i32));
 }
 
 
+M3Result  Compile_Memory_CopyFill  (IM3Compilation o, u8 i_opcode)
+{
+    M3Result result;
+
+    // memory.copy has destination and source memory indices, memory.fill just the destination
+    u32 numMemoryIndices = (i_opcode == 0x0a) ? 2 : 1;
+
+    while (numMemoryIndices--)
+    {
+        i8 reserved;
+_       (ReadLEB_i7 (& reserved, & o->wasm, o->wasmEnd));
+    }
+
+_   (PreserveRegisterIfOccupied (o, c_m3Type_i32));     // all three operands are read from slots
+
+_   (EmitOp (o, c_operationsFC [i_opcode].operations [0]));
+_   (EmitTopSlotAndPop (o));
+_   (EmitTopSlotAndPop (o));
+_   (EmitTopSlotAndPop (o));
+
+    _catch: return result;
+}
+
+
+M3Result  Compile_Memory_Init  (IM3Compilation o, u8 i_opcode)
+{
+    M3Result result;
+
+    u32 segmentIndex;
+_   (ReadLEB_u32 (& segmentIndex, & o->wasm, o->wasmEnd));
+
+    i8 reserved;
+_   (ReadLEB_i7 (& reserved, & o->wasm, o->wasmEnd));
+
+    if (segmentIndex >= o->module->numDataSegments)
+        _throw ("data segment index out of bounds");
+
+_   (PreserveRegisterIfOccupied (o, c_m3Type_i32));
+
+    // op, module, segment and three slots exceed the lines EmitOp keeps free (d_m3CodePageFreeLinesThreshold)
+_   (EnsureCodePageNumLines (o, 6));
+
+_   (EmitOp (o, op_MemInit));
+    EmitPointer (o, o->module);
+    EmitConstant (o, segmentIndex);
+_   (EmitTopSlotAndPop (o));
+_   (EmitTopSlotAndPop (o));
+_   (EmitTopSlotAndPop (o));
+
+    _catch: return result;
+}
+
+
+M3Result  Compile_Data_Drop  (IM3Compilation o, u8 i_opcode)
+{
+    M3Result result;
+
+    u32 segmentIndex;
+_   (ReadLEB_u32 (& segmentIndex, & o->wasm, o->wasmEnd));
+
+    if (segmentIndex >= o->module->numDataSegments)
+        _throw ("data segment index out of bounds");
+
+_   (EmitOp (o, op_DataDrop));
+    EmitPointer (o, o->module);
+    EmitConstant (o, segmentIndex);
+
+    _catch: return result;
+}
+
+
+// 0xfc prefixed opcodes are LEB encoded and compiled from c_operationsFC
+M3Result  Compile_ExtendedOpcode  (IM3Compilation o, u8 i_opcode)
+{
+    M3Result result;
+
+    M3Compiler compiler = NULL;
+
+    u32 opcode;
+_   (ReadLEB_u32 (& opcode, & o->wasm, o->wasmEnd));                     m3log (compile, d_indent "%s (extended: 0x%02x)", get_indention_string (o), opcode);
+
+    if (opcode <= 0x0b)
+        compiler = c_operationsFC [opcode].compiler;
+
+    if (compiler)
+_       ((* compiler) (o, (u8) opcode))
+    else _throw (m3Err_unknownOpcode);
+
+    _catch: return result;
+}
+
+
 M3Result  ReadBlockType  (IM3Compilation o, u8 * o_blockType)
 {
     M3Result result;                                                        d_m3Assert (o_blockType);
@@ -1295,10 +1387,11 @@ M3Result  PreserveArgsAndLocals  (IM3Compilation o)
 {
     M3Result result = m3Err_none;
 
-    if (o->stackIndex > o->firstSlotIndex)
+    u32 numArgsAndLocals = GetFunctionNumArgsAndLocals (o->function);
+
+    // firstSlotIndex also counts the reserved constant slots, so isn't the stack depth of the locals
+    if (o->stackIndex > numArgsAndLocals)
     {
-        u32 numArgsAndLocals = GetFunctionNumArgsAndLocals (o->function);
-        
         for (u32 i = 0; i < numArgsAndLocals; ++i)
         {
             u16 preservedSlotIndex;
@@ -1518,6 +1611,13 @@ M3Result  Compile_Operator  (IM3Compilation o, u8 i_opcode)
 
     IM3Operation operation;
 
+# if d_m3EnableSuperInstructions
+    bool fused;
+_   (CompileSuperInstruction (o, i_opcode, & fused));
+    if (fused)
+        return result;
+# endif
+
     // This preserve is for for FP compare operations.
     // either need additional slot destination operations or the
     // easy fix, move _r0 out of the way.
@@ -1627,12 +1727,20 @@ _   (ReadLEB_u32 (& memoryOffset, & o->wasm, o->wasmEnd));
                                                                         m3log (compile, d_indent "%s (offset = %d)", get_indention_string (o), memoryOffset);
     const M3OpInfo * op = & c_operations [i_opcode];
 
-    if (IsFpType (op->type)) // loading a float?
-_       (PreserveRegisterIfOccupied (o, c_m3Type_f64));
+    bool fused = false;
+# if d_m3EnableSuperInstructions
+_   (CompileLoadSuperInstruction (o, i_opcode, memoryOffset, & fused));
+# endif
+
+    if (not fused)
+    {
+        if (IsFpType (op->type)) // loading a float?
+_           (PreserveRegisterIfOccupied (o, c_m3Type_f64));
 
-_   (Compile_Operator (o, i_opcode));
+_       (Compile_Operator (o, i_opcode));
 
-    EmitConstant (o, memoryOffset);
+        EmitConstant (o, memoryOffset);
+    }
 }
     _catch: return result;
 }
@@ -1897,12 +2005,26 @@ const M3OpInfo c_operations [] =
     
     d_m3DebugTypedOp (SetRegister), d_m3DebugTypedOp (SetSlot),     d_m3DebugTypedOp (PreserveSetSlot),
 
+    d_m3DebugOp (MemCopy),          d_m3DebugOp (MemFill),          d_m3DebugOp (MemInit),          d_m3DebugOp (DataDrop),
+
     M3OP( "termination for find_operation_info ()", 0, c_m3Type_void )
     
 # endif
 };
 
 
+const M3OpInfo c_operationsFC [] =
+{
+    M3OP_RESERVED, M3OP_RESERVED, M3OP_RESERVED, M3OP_RESERVED,                                         // 0x00 - 0x03 saturating truncation (unsupported)
+    M3OP_RESERVED, M3OP_RESERVED, M3OP_RESERVED, M3OP_RESERVED,                                         // 0x04 - 0x07
+
+    M3OP( "memory.init",        -3, none,   d_singleOp (MemInit),               Compile_Memory_Init ),      // 0x08
+    M3OP( "data.drop",           0, none,   d_singleOp (DataDrop),              Compile_Data_Drop ),        // 0x09
+    M3OP( "memory.copy",        -3, none,   d_singleOp (MemCopy),               Compile_Memory_CopyFill ),  // 0x0a
+    M3OP( "memory.fill",        -3, none,   d_singleOp (MemFill),               Compile_Memory_CopyFill ),  // 0x0b
+};
+
+
 M3Result  Compile_BlockStatements  (IM3Compilation o)
 {
     M3Result result = m3Err_none;
@@ -1910,12 +2032,16 @@ M3Result  Compile_BlockStatements  (IM3Compilation o)
     while (o->wasm < o->wasmEnd)
     {                                                                   emit_stack_dump (o);
         u8 opcode = * (o->wasm++);                                      log_opcode (o, opcode);
-        const M3OpInfo * op = & c_operations [opcode];
 
-        M3Compiler compiler = op->compiler;
+        M3Compiler compiler = Compile_ExtendedOpcode;
+
+        if (opcode != c_waOp_extended)
+        {
+            compiler = c_operations [opcode].compiler;
 
-        if (not compiler)
-            compiler = Compile_Operator;
+            if (not compiler)
+                compiler = Compile_Operator;
+        }
 
         result = (* compiler) (o, opcode);
 
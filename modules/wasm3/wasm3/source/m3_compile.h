@@ -29,6 +29,7 @@ enum
     c_waOp_getLocal             = 0x20,
     c_waOp_setLocal             = 0x21,
     c_waOp_teeLocal             = 0x22,
+    c_waOp_extended             = 0xfc,
 };
 
 //-----------------------------------------------------------------------------------------------------------------------------------
@@ -136,6 +137,7 @@ M3OpInfo;
 typedef const M3OpInfo *    IM3OpInfo;
 
 extern const M3OpInfo c_operations [];
+extern const M3OpInfo c_operationsFC [];        // 0xfc prefixed
 
 #ifdef DEBUG
     #define M3OP(...)       { __VA_ARGS__ }
@@ -153,11 +155,17 @@ bool        IsFpRegisterLocation        (i16 i_location);
 bool        IsIntRegisterLocation       (i16 i_location);
 
 bool        IsStackPolymorphic          (IM3Compilation o);
+bool        IsStackTopInRegister        (IM3Compilation o);
+bool        IsStackTopInSlot            (IM3Compilation o);
+bool        IsStackTopMinus1InRegister  (IM3Compilation o);
 
 M3Result    EmitOp                      (IM3Compilation o, IM3Operation i_operation);
 void        EmitConstant                (IM3Compilation o, const u64 immediate);
 M3Result    Push                        (IM3Compilation o, u8 i_waType, i16 i_location);
 void        EmitPointer                 (IM3Compilation o, const void * const i_immediate);
+M3Result    EmitTopSlotAndPop           (IM3Compilation o);
+M3Result    AcquirePatch                (IM3Compilation o, IM3BranchPatch * o_patch);
+M3Result    GetBlockScope               (IM3Compilation o, IM3CompilationScope * o_scope, i32 i_depth);
 
 M3Result    CompileBlock                (IM3Compilation io, u8 i_blockType, u8 i_blockOpcode);
 
@@ -165,6 +173,8 @@ M3Result    Compile_BlockStatements     (IM3Compilation io);
 M3Result    Compile_Function            (IM3Function io_function);
 
 bool        PeekNextOpcode              (IM3Compilation o, u8 i_opcode);
+M3Result    CompileSuperInstruction     (IM3Compilation o, u8 i_opcode, bool * o_fused);
+M3Result    CompileLoadSuperInstruction (IM3Compilation o, u8 i_opcode, u32 i_memoryOffset, bool * o_fused);
 u16         GetMaxExecSlot              (IM3Compilation o);
 
 #if defined(__cplusplus)
@@ -15,8 +15,17 @@
 # endif
 
 # ifndef d_m3CodePageAlignSize
-#   define d_m3CodePageAlignSize                4096
+#   define d_m3CodePageAlignSize                4096    // largest code page, unless a single function needs more
 # endif
+
+# ifndef d_m3CodePageMinSize
+#   define d_m3CodePageMinSize                  512     // first code page of a runtime, doubling up to d_m3CodePageAlignSize
+# endif
+
+# ifndef d_m3CodePagePoolSize
+#   define d_m3CodePagePoolSize                 (4 * d_m3CodePageAlignSize)    // bytes of freed code pages kept for reuse
+# endif
+
 # ifndef d_m3MaxFunctionStackHeight
 #   define d_m3MaxFunctionStackHeight           2000
 # endif
@@ -42,9 +51,36 @@
 #   define d_m3EnableOptimizations              0
 # endif
 
+# ifndef d_m3EnableSuperInstructions
+#   define d_m3EnableSuperInstructions          1       // fuse common opcode pairs (op + local.set, compare + br_if, load + local.set)
+# endif
+
+# ifndef d_m3EnableCompiledImage
+#   define d_m3EnableCompiledImage              0       // track pointer lines in code pages so they can be serialized
+# endif
+
+# ifndef d_m3ReserveMaxMemory
+#   define d_m3ReserveMaxMemory                 0       // allocate the declared maximum linear memory when a module is loaded, so it never moves
+# endif
+
+# ifndef d_m3CompactCodePages
+#   define d_m3CompactCodePages                 1       // move partially used pages into right-sized ones after m3_CompileModule (requires d_m3EnableCompiledImage)
+# endif
+
 // logging --------------------------------------------------------------------
 
-# define d_m3EnableOpProfiling      0
+# ifndef d_m3EnableOpProfiling
+#   define d_m3EnableOpProfiling        0       // count executed operations (slow, every op goes through a call)
+# endif
+
+# ifndef d_m3ProfilerSlotMask
+#   define d_m3ProfilerSlotMask         0x3FF   // size of the operation profiler table (power of two minus one)
+# endif
+
+# ifndef d_m3EnableFunctionProfiling
+#   define d_m3EnableFunctionProfiling  0       // accumulate per-function execution time in op_Entry
+# endif
+
 # define d_m3RuntimeStackDumps      0
 
 # define d_m3TraceExec              (1 && d_m3RuntimeStackDumps && DEBUG)
@@ -277,6 +277,9 @@ typedef int8_t          i8;
 #  ifndef d_m3CodePageAlignSize
 #    define d_m3CodePageAlignSize               1024
 #  endif
+#  ifndef d_m3CodePageMinSize
+#    define d_m3CodePageMinSize                 256
+#  endif
 # endif
 
 #endif // m3_config_platforms_h
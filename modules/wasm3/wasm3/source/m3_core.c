@@ -10,6 +10,8 @@
 
 #include "m3_core.h"
 
+#include <stddef.h>
+
 void m3Abort(const char* message) {
 #if d_m3LogOutput
     fprintf(stderr, "Error: %s\n", message);
@@ -27,36 +29,320 @@ M3Result m3_Yield ()
     return m3Err_none;
 }
 
+M3_WEAK
+void  m3_HeapLock  (void)
+{
+}
+
+M3_WEAK
+void  m3_HeapUnlock  (void)
+{
+}
+
+M3_WEAK
+void *  m3_LinearMemoryRealloc  (void * i_ptr, size_t i_newSize, size_t i_oldSize)
+{
+    return m3Realloc (i_ptr, i_newSize, i_oldSize);
+}
+
+M3_WEAK
+void  m3_LinearMemoryFree  (void * i_ptr)
+{
+    m3Free_impl (i_ptr);
+}
+
+M3_WEAK
+M3Result  m3_LinearMemoryMoving  (IM3Runtime i_runtime)
+{
+    return m3Err_none;
+}
+
+M3_WEAK
+void  m3_GetImageBuildId  (u8 o_id [32])
+{
+    memset (o_id, 0x0, 32);
+}
+
 #if d_m3FixedHeap
 
+//  The fixed heap is managed as a two level segregated fit (TLSF) allocator. Free blocks are kept in lists by
+//  size class, a first level per power of two split into c_heapSLCount linear classes, with bitmaps of the
+//  non-empty lists so allocation and free are constant time. Blocks are merged with free neighbours on free,
+//  and a block found for an allocation is always large enough, which keeps fragmentation bounded.
+
+#if d_m3FixedHeapAlign >= 8
+#   define c_heapAlign          d_m3FixedHeapAlign
+#else
+#   define c_heapAlign          8
+#endif
+
+#define HEAP_ALIGN_SIZE(S)      (((S) + (c_heapAlign - 1)) & ~ (size_t) (c_heapAlign - 1))
+
+#define c_heapSLBits            4
+#define c_heapSLCount           (1 << c_heapSLBits)
+#define c_heapFLCount           24
+
+// Sizes below this are split linearly into c_heapSLCount classes of c_heapAlign
+#define c_heapSmallSize         (c_heapSLCount * c_heapAlign)
+
+// Size flags, sizes are multiples of c_heapAlign so the low bits are free
+#define c_heapBlockFree         1
+#define c_heapPrevFree          2
+
+typedef struct M3HeapBlock
+{
+    // Size of the previous block, only valid while it is free
+    size_t                  prevSize;
+    size_t                  size;
+
+    // Overlap the payload, so only valid while the block is free
+    struct M3HeapBlock *    nextFree;
+    struct M3HeapBlock *    prevFree;
+}
+M3HeapBlock;
+
+#define c_heapHeader            HEAP_ALIGN_SIZE (offsetof (M3HeapBlock, nextFree))
+#define c_heapMinBlock          HEAP_ALIGN_SIZE (sizeof (M3HeapBlock))
+
 static u8 fixedHeap[d_m3FixedHeap];
-static u8* fixedHeapPtr = fixedHeap;
-static u8* const fixedHeapEnd = fixedHeap + d_m3FixedHeap;
-static u8* fixedHeapLast = NULL;
 
-#if d_m3FixedHeapAlign > 1
-#   define HEAP_ALIGN_PTR(P) P = (u8*)(((size_t)(P)+(d_m3FixedHeapAlign-1)) & ~ (d_m3FixedHeapAlign-1));
+static bool             heapReady       = false;
+static u32              heapFLMap;
+static u32              heapSLMap       [c_heapFLCount];
+static M3HeapBlock *    heapFree        [c_heapFLCount][c_heapSLCount];
+static M3HeapInfo       heapInfo;
+
+static inline
+u32  HeapLog2  (size_t i_value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (sizeof (size_t) * 8 - 1) - (sizeof (size_t) > 4 ? __builtin_clzll (i_value) : __builtin_clz (i_value));
+#else
+    u32 log = 0;
+    while (i_value >>= 1)
+        ++log;
+    return log;
+#endif
+}
+
+static inline
+u32  HeapLowestBit  (u32 i_bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz (i_bits);
 #else
-#   define HEAP_ALIGN_PTR(P)
+    u32 bit = 0;
+    while (not (i_bits & 1))
+    {
+        i_bits >>= 1;
+        ++bit;
+    }
+    return bit;
 #endif
+}
+
+static inline
+size_t  HeapBlockSize  (M3HeapBlock * i_block)
+{
+    return i_block->size & ~ (size_t) (c_heapBlockFree | c_heapPrevFree);
+}
+
+static inline
+M3HeapBlock *  HeapNextBlock  (M3HeapBlock * i_block)
+{
+    return (M3HeapBlock *) ((u8 *) i_block + HeapBlockSize (i_block));
+}
+
+static
+void  HeapMapping  (size_t i_size, u32 * o_fl, u32 * o_sl)
+{
+    if (i_size < c_heapSmallSize)
+    {
+        * o_fl = 0;
+        * o_sl = (u32) (i_size / c_heapAlign);
+    }
+    else
+    {
+        u32 log = HeapLog2 (i_size);
+        * o_sl = (u32) (i_size >> (log - c_heapSLBits)) - c_heapSLCount;
+        * o_fl = log - HeapLog2 (c_heapSmallSize) + 1;
+    }
+}
+
+static
+void  HeapInsert  (M3HeapBlock * i_block)
+{
+    u32 fl, sl;
+    HeapMapping (HeapBlockSize (i_block), & fl, & sl);
+
+    M3HeapBlock * head = heapFree [fl][sl];
+
+    i_block->nextFree = head;
+    i_block->prevFree = NULL;
+    if (head)
+        head->prevFree = i_block;
+
+    heapFree [fl][sl] = i_block;
+    heapFLMap |= (1u << fl);
+    heapSLMap [fl] |= (1u << sl);
+}
+
+static
+void  HeapRemove  (M3HeapBlock * i_block)
+{
+    u32 fl, sl;
+    HeapMapping (HeapBlockSize (i_block), & fl, & sl);
+
+    if (i_block->nextFree)
+        i_block->nextFree->prevFree = i_block->prevFree;
+
+    if (i_block->prevFree)
+        i_block->prevFree->nextFree = i_block->nextFree;
+    else
+    {
+        heapFree [fl][sl] = i_block->nextFree;
+
+        if (not heapFree [fl][sl])
+        {
+            heapSLMap [fl] &= ~ (1u << sl);
+            if (not heapSLMap [fl])
+                heapFLMap &= ~ (1u << fl);
+        }
+    }
+}
+
+// Find a free block of at least i_size, rounding up to the next class so any block in it fits
+static
+M3HeapBlock *  HeapFind  (size_t i_size)
+{
+    if (i_size >= c_heapSmallSize)
+        i_size += ((size_t) 1 << (HeapLog2 (i_size) - c_heapSLBits)) - 1;
+
+    u32 fl, sl;
+    HeapMapping (i_size, & fl, & sl);
+
+    if (fl >= c_heapFLCount)
+        return NULL;
+
+    u32 slMap = heapSLMap [fl] & (~ 0u << sl);
+    if (not slMap)
+    {
+        u32 flMap = (fl + 1 < c_heapFLCount) ? heapFLMap & (~ 0u << (fl + 1)) : 0;
+        if (not flMap)
+            return NULL;
+
+        fl = HeapLowestBit (flMap);
+        slMap = heapSLMap [fl];
+    }
+
+    return heapFree [fl][HeapLowestBit (slMap)];
+}
+
+// Return the end of a used block beyond i_size to the free lists
+static
+void  HeapTrim  (M3HeapBlock * io_block, size_t i_size)
+{
+    size_t size = HeapBlockSize (io_block);
+    if (size < i_size + c_heapMinBlock)
+        return;
+
+    M3HeapBlock * rest = (M3HeapBlock *) ((u8 *) io_block + i_size);
+    rest->size = (size - i_size) | c_heapBlockFree;
+
+    io_block->size = i_size | (io_block->size & c_heapPrevFree);
+
+    M3HeapBlock * next = HeapNextBlock (rest);
+    if (next->size & c_heapBlockFree)
+    {
+        HeapRemove (next);
+        rest->size += HeapBlockSize (next);
+        next = HeapNextBlock (rest);
+    }
+
+    next->prevSize = HeapBlockSize (rest);
+    next->size |= c_heapPrevFree;
+
+    HeapInsert (rest);
+}
+
+static
+void  HeapInit  ()
+{
+    u8 * start = (u8 *) HEAP_ALIGN_SIZE ((size_t) fixedHeap);
+    u8 * end = (u8 *) ((size_t) (fixedHeap + d_m3FixedHeap) & ~ (size_t) (c_heapAlign - 1));
+
+    // A used, empty block at the end means every block has a next
+    M3HeapBlock * last = (M3HeapBlock *) (end - c_heapHeader);
+    M3HeapBlock * block = (M3HeapBlock *) start;
+
+    block->size = ((u8 *) last - start) | c_heapBlockFree;
+    last->prevSize = HeapBlockSize (block);
+    last->size = c_heapPrevFree;
+
+    HeapInsert (block);
+
+    heapInfo.size = HeapBlockSize (block);
+    heapReady = true;
+}
+
+static inline
+size_t  HeapRequestSize  (size_t i_size)
+{
+    size_t size = HEAP_ALIGN_SIZE (i_size + c_heapHeader);
+    return M3_MAX (size, c_heapMinBlock);
+}
+
+static
+void  HeapUsed  (size_t i_before, size_t i_after)
+{
+    heapInfo.used = heapInfo.used - i_before + i_after;
+    heapInfo.peak = M3_MAX (heapInfo.peak, heapInfo.used);
+}
 
 M3Result  m3Malloc  (void ** o_ptr, size_t i_size)
 {
-    u8 * ptr = fixedHeapPtr;
+    M3HeapBlock * block = NULL;
+
+    m3_HeapLock ();
+
+    if (not heapReady)
+        HeapInit ();
+
+    if (i_size < d_m3FixedHeap)
+    {
+        size_t size = HeapRequestSize (i_size);
+
+        block = HeapFind (size);
+        if (block)
+        {
+            HeapRemove (block);
+
+            block->size &= ~ (size_t) c_heapBlockFree;
+            HeapNextBlock (block)->size &= ~ (size_t) c_heapPrevFree;
+
+            HeapTrim (block, size);
 
-    fixedHeapPtr += i_size;
-    HEAP_ALIGN_PTR(fixedHeapPtr);
+            HeapUsed (0, HeapBlockSize (block));
+            heapInfo.allocations++;
+        }
+    }
+
+    if (not block)
+        heapInfo.failures++;
 
-    if (fixedHeapPtr >= fixedHeapEnd)
+    m3_HeapUnlock ();
+
+    if (not block)
     {
         * o_ptr = NULL;
 
         return m3Err_mallocFailed;
     }
 
+    u8 * ptr = (u8 *) block + c_heapHeader;
+
     memset (ptr, 0x0, i_size);
     * o_ptr = ptr;
-    fixedHeapLast = ptr;
 
     //printf("== alloc %d => %p\n", i_size, ptr);
 
@@ -67,14 +353,40 @@ void        m3Free_impl             (void * o_ptr)
 {
     if (!o_ptr) return;
 
-    // Handle the last chunk
-    if (o_ptr == fixedHeapLast) {
-        fixedHeapPtr = fixedHeapLast;
-        fixedHeapLast = NULL;
-        //printf("== free %p\n", o_ptr);
-    } else {
-        //printf("== free %p [failed]\n", o_ptr);
+    //printf("== free %p\n", o_ptr);
+
+    m3_HeapLock ();
+
+    M3HeapBlock * block = (M3HeapBlock *) ((u8 *) o_ptr - c_heapHeader);
+
+    HeapUsed (HeapBlockSize (block), 0);
+    heapInfo.allocations--;
+
+    block->size |= c_heapBlockFree;
+
+    M3HeapBlock * next = HeapNextBlock (block);
+    if (next->size & c_heapBlockFree)
+    {
+        HeapRemove (next);
+        block->size += HeapBlockSize (next);
+        next = HeapNextBlock (block);
+    }
+
+    if (block->size & c_heapPrevFree)
+    {
+        M3HeapBlock * prev = (M3HeapBlock *) ((u8 *) block - block->prevSize);
+
+        HeapRemove (prev);
+        prev->size += HeapBlockSize (block);
+        block = prev;
     }
+
+    next->prevSize = HeapBlockSize (block);
+    next->size |= c_heapPrevFree;
+
+    HeapInsert (block);
+
+    m3_HeapUnlock ();
 }
 
 void *  m3Realloc  (void * i_ptr, size_t i_newSize, size_t i_oldSize)
@@ -84,23 +396,93 @@ void *  m3Realloc  (void * i_ptr, size_t i_newSize, size_t i_oldSize)
     void * ptr = i_ptr;
     if (i_newSize == i_oldSize) return ptr;
 
-    // Handle the last chunk
-    if (i_ptr && i_ptr == fixedHeapLast) {
-        fixedHeapPtr = fixedHeapLast + i_newSize;
-        HEAP_ALIGN_PTR(fixedHeapPtr);
+    if (not i_ptr)
+    {
+        m3Malloc (& ptr, i_newSize);
         return ptr;
     }
 
-    m3Malloc(&ptr, i_newSize);
-    if (!ptr) return NULL;
+    if (i_newSize >= d_m3FixedHeap)
+        return NULL;
+
+    M3HeapBlock * block = (M3HeapBlock *) ((u8 *) i_ptr - c_heapHeader);
+    size_t size = HeapRequestSize (i_newSize);
+    bool resized = false;
+
+    m3_HeapLock ();
 
-    if (i_ptr) {
-        memcpy(ptr, i_ptr, i_oldSize);
+    size_t before = HeapBlockSize (block);
+
+    if (size <= before)
+    {
+        // Shrink in place
+        HeapTrim (block, size);
+        resized = true;
+    }
+    else
+    {
+        // Grow into a free next block
+        M3HeapBlock * next = HeapNextBlock (block);
+        if ((next->size & c_heapBlockFree) and before + HeapBlockSize (next) >= size)
+        {
+            HeapRemove (next);
+            block->size += HeapBlockSize (next);
+            HeapNextBlock (block)->size &= ~ (size_t) c_heapPrevFree;
+
+            HeapTrim (block, size);
+            resized = true;
+        }
+    }
+
+    if (resized)
+        HeapUsed (before, HeapBlockSize (block));
+
+    m3_HeapUnlock ();
+
+    if (not resized)
+    {
+        // Moved, so old and new blocks are both needed for the copy
+        if (m3Malloc (& ptr, i_newSize))
+            return NULL;
+
+        memcpy (ptr, i_ptr, M3_MIN (i_oldSize, M3_MIN (i_newSize, before - c_heapHeader)));
+        m3Free_impl (i_ptr);
+    }
+    else if (i_newSize > i_oldSize)
+    {
+        memset ((u8 *) ptr + i_oldSize, 0x0, i_newSize - i_oldSize);
     }
 
     return ptr;
 }
 
+void  m3_GetHeapInfo  (M3HeapInfo * o_info)
+{
+    m3_HeapLock ();
+
+    if (not heapReady)
+        HeapInit ();
+
+    * o_info = heapInfo;
+
+    // Largest block in the highest non-empty class
+    o_info->largestFree = 0;
+
+    if (heapFLMap)
+    {
+        u32 fl = HeapLog2 (heapFLMap);
+        u32 sl = HeapLog2 (heapSLMap [fl]);
+
+        for (M3HeapBlock * block = heapFree [fl][sl]; block; block = block->nextFree)
+        {
+            size_t size = HeapBlockSize (block) - c_heapHeader;
+            o_info->largestFree = M3_MAX (o_info->largestFree, size);
+        }
+    }
+
+    m3_HeapUnlock ();
+}
+
 
 #else
 
@@ -152,6 +534,12 @@ void *  m3Realloc  (void * i_ptr, size_t i_newSize, size_t i_oldSize)
     return ptr;
 }
 
+void  m3_GetHeapInfo  (M3HeapInfo * o_info)
+{
+    // Allocations come from the system heap
+    memset (o_info, 0x0, sizeof (M3HeapInfo));
+}
+
 #endif
 
 //--------------------------------------------------------------------------------------------
@@ -140,6 +140,10 @@ typedef struct M3CodePageHeader
     u32                     numLines;
     u32                     sequence;       // this is just used for debugging; could be removed
     u32                     usageCount;
+
+#if d_m3EnableCompiledImage
+    u8 *                    pointerMap;     // one bit per line, set for lines holding a relocatable pointer
+#endif
 }
 M3CodePageHeader;
 
@@ -26,6 +26,7 @@ M3Result  EnsureCodePageNumLines  (IM3Compilation o, u32 i_numLines)
             d_m3Assert (NumFreeLines (o->page) >= 2);
 
             EmitWord (o->page, op_Branch);
+            MarkPagePointer (o->page);
             EmitWord (o->page, GetPagePC (page));
 
             ReleaseCodePage (o->runtime, o->page);
@@ -87,14 +88,17 @@ void  EmitConstant64  (IM3Compilation o, const u64 i_const)
 void  EmitSlotOffset  (IM3Compilation o, const i32 i_offset)
 {
     if (o->page)
-        EmitWord (o->page, i_offset);
+        EmitWord (o->page, (intptr_t) i_offset);
 }
 
 
 void  EmitPointer  (IM3Compilation o, const void * const i_pointer)
 {
     if (o->page)
+    {
+        MarkPagePointer (o->page);
         EmitWord (o->page, i_pointer);
+    }
 }
 
 void * ReservePointer (IM3Compilation o)
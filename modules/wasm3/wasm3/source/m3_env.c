@@ -6,6 +6,7 @@
 //
 
 #include <stdarg.h>
+#include <stddef.h>
 
 #include "m3_env.h"
 #include "m3_compile.h"
@@ -92,12 +93,60 @@ void  m3_FreeEnvironment  (IM3Environment i_environment)
 {
     if (i_environment)
     {
-//        ReleaseEnvironment (i_environment);
+        IM3FuncType ftype = i_environment->funcTypes;
+
+        while (ftype)
+        {
+            IM3FuncType next = ftype->next;
+            m3Free (ftype);
+            ftype = next;
+        }
+
         m3Free (i_environment);
     }
 }
 
 
+bool  AreFuncTypesEqual  (const IM3FuncType i_typeA, const IM3FuncType i_typeB)
+{
+    if (i_typeA == i_typeB)
+        return true;
+
+    return (i_typeA->numArgs == i_typeB->numArgs and i_typeA->returnType == i_typeB->returnType
+            and memcmp (i_typeA->argTypes, i_typeB->argTypes, i_typeA->numArgs) == 0);
+}
+
+
+// returns the environment's copy of i_funcType, adding it if this is the first module to use the type
+M3Result  Environment_AddFuncType  (IM3Environment io_environment, IM3FuncType * o_funcType, const IM3FuncType i_funcType)
+{
+    M3Result result = m3Err_none;
+
+    IM3FuncType ftype = io_environment->funcTypes;
+
+    while (ftype)
+    {
+        if (AreFuncTypesEqual (ftype, i_funcType))
+            break;
+
+        ftype = ftype->next;
+    }
+
+    if (not ftype)
+    {
+_       (m3Alloc (& ftype, M3FuncType, 1));
+
+        * ftype = * i_funcType;
+        ftype->next = io_environment->funcTypes;
+        io_environment->funcTypes = ftype;
+    }
+
+    * o_funcType = ftype;
+
+    _catch: return result;
+}
+
+
 IM3Runtime  m3_NewRuntime  (IM3Environment i_environment, u32 i_stackSizeInBytes, M3StackInfo * i_nativeStackInfo)
 {
     IM3Runtime runtime = NULL;
@@ -176,7 +225,7 @@ void  ReleaseRuntime  (IM3Runtime i_runtime)
 
     m3Free (i_runtime->stack);
 
-    m3Free (i_runtime->memory.mallocated);
+    m3_LinearMemoryFree (i_runtime->memory.mallocated);
 }
 
 
@@ -256,6 +305,46 @@ M3Result  EvaluateExpression  (IM3Module i_module, void * o_expressed, u8 i_type
 }
 
 
+static size_t  GetMemoryBytes  (IM3Runtime i_runtime, u32 i_numPages)
+{
+    size_t numPageBytes = (size_t) i_numPages * d_m3MemPageSize;
+
+    // Limit the amount of memory that gets allocated
+    if (i_runtime->memoryLimit)
+        numPageBytes = M3_MIN (numPageBytes, i_runtime->memoryLimit);
+
+    return numPageBytes;
+}
+
+
+// reallocates the memory header and pages for i_numPageBytes; the memory is unchanged on failure
+static M3Result  ReserveMemory  (IM3Runtime io_runtime, size_t i_numPageBytes)
+{
+    M3Memory * memory = & io_runtime->memory;
+
+    size_t numPreviousBytes = memory->mallocated ? memory->numReservedBytes + sizeof (M3MemoryHeader) : 0;
+
+    if (memory->mallocated)
+    {
+        M3Result result = m3_LinearMemoryMoving (io_runtime);
+        if (result)
+            return result;
+    }
+
+    M3MemoryHeader * mallocated = (M3MemoryHeader *) m3_LinearMemoryRealloc (memory->mallocated, i_numPageBytes + sizeof (M3MemoryHeader), numPreviousBytes);
+
+    if (not mallocated)
+        return m3Err_mallocFailed;
+
+    m3log (runtime, "reserved old: %p; mem: %p; bytes: %z", memory->mallocated, mallocated, i_numPageBytes);
+
+    memory->mallocated = mallocated;
+    memory->numReservedBytes = i_numPageBytes;
+
+    return m3Err_none;
+}
+
+
 M3Result  InitMemory  (IM3Runtime io_runtime, IM3Module i_module)
 {
     M3Result result = m3Err_none;                                     //d_m3Assert (not io_runtime->memory.wasmPages);
@@ -265,6 +354,13 @@ M3Result  InitMemory  (IM3Runtime io_runtime, IM3Module i_module)
         u32 maxPages = i_module->memoryInfo.maxPages;
         io_runtime->memory.maxPages = maxPages ? maxPages : 65536;
 
+#if d_m3ReserveMaxMemory
+        // with the declared maximum allocated up front memory.grow never moves or copies the memory.
+        // if it can't be had, memory is grown as needed instead
+        if (maxPages > i_module->memoryInfo.initPages)
+            ReserveMemory (io_runtime, GetMemoryBytes (io_runtime, maxPages));
+#endif
+
         result = ResizeMemory (io_runtime, i_module->memoryInfo.initPages);
     }
 
@@ -276,52 +372,27 @@ M3Result  ResizeMemory  (IM3Runtime io_runtime, u32 i_numPages)
 {
     M3Result result = m3Err_none;
 
-    u32 numPagesToAlloc = i_numPages;
-
     M3Memory * memory = & io_runtime->memory;
 
-#if 0 // Temporary fix for memory allocation
-    if (memory->mallocated) {
-        memory->numPages = i_numPages;
-        memory->mallocated->end = memory->wasmPages + (memory->numPages * c_m3MemPageSize);
-        return result;
-    }
-
-    i_numPagesToAlloc = 256;
-#endif
-
-    if (numPagesToAlloc <= memory->maxPages)
+    if (i_numPages <= memory->maxPages)
     {
-        size_t numPageBytes = numPagesToAlloc * d_m3MemPageSize;
-
-        // Limit the amount of memory that gets allocated
-        if (io_runtime->memoryLimit) {
-            numPageBytes = M3_MIN(numPageBytes, io_runtime->memoryLimit);
-        }
+        size_t numPageBytes = GetMemoryBytes (io_runtime, i_numPages);
 
-        size_t numBytes = numPageBytes + sizeof (M3MemoryHeader);
+        // pages within the reservation are already allocated and zeroed
+        if (numPageBytes > memory->numReservedBytes or not memory->mallocated)
+            result = ReserveMemory (io_runtime, numPageBytes);
 
-        size_t numPreviousBytes = memory->numPages * d_m3MemPageSize;
-        if (numPreviousBytes)
-            numPreviousBytes += sizeof (M3MemoryHeader);
-
-        memory->mallocated = (M3MemoryHeader *) m3Realloc (memory->mallocated, numBytes, numPreviousBytes);
-
-        if (memory->mallocated)
+        if (not result)
         {
-#if d_m3LogRuntime
-            u8 * oldMallocated = memory->mallocated;
-#endif
-            memory->numPages = numPagesToAlloc;
+            memory->numPages = i_numPages;
 
             memory->mallocated->length =  numPageBytes;
             memory->mallocated->runtime = io_runtime;
 
             memory->mallocated->maxStack = (m3reg_t *) io_runtime->stack + io_runtime->numStackSlots;
 
-            m3log (runtime, "resized old: %p; mem: %p; length: %z; pages: %d", oldMallocated, memory->mallocated, memory->mallocated->length, memory->numPages);
+            m3log (runtime, "resized mem: %p; length: %z; pages: %d", memory->mallocated, memory->mallocated->length, memory->numPages);
         }
-        else result = m3Err_mallocFailed;
     }
     else result = m3Err_wasmMemoryOverflow;
 
@@ -378,6 +449,12 @@ M3Result  InitDataSegments  (M3Memory * io_memory, IM3Module io_module)
     {
         M3DataSegment * segment = & io_module->dataSegments [i];
 
+        // passive segments stay available to memory.init until dropped
+        segment->isDropped = not segment->isPassive;
+
+        if (segment->isPassive)
+            continue;
+
         i32 segmentOffset;
         bytes_t start = segment->initExpr;
 _       (EvaluateExpression (io_module, & segmentOffset, c_m3Type_i32, & start, segment->initExpr + segment->initExprSize));
@@ -502,20 +579,206 @@ _       (InitStartFunc (io_module));
 }
 
 
-void *  v_FindFunction  (IM3Module i_module, const char * const i_name)
+#if d_m3EnableCompiledImage && d_m3CompactCodePages
+
+static void  RelocatePageLines  (IM3CodePage i_page, const u8 * i_start, const u8 * i_end, ptrdiff_t i_delta)
+{
+    while (i_page)
+    {
+        for (u32 i = 0; i < i_page->info.lineIndex; ++i)
+        {
+            const u8 * ptr = (const u8 *) i_page->code [i];
+
+            if (IsPagePointer (i_page, i) and ptr >= i_start and ptr < i_end)
+                i_page->code [i] = (code_t) (ptr + i_delta);
+        }
+
+        i_page = i_page->info.next;
+    }
+}
+
+
+// repoints marked lines and compiled functions from i_from to its copy i_to
+static void  RelocateCodePage  (IM3Runtime io_runtime, IM3CodePage i_pending, IM3CodePage i_from, IM3CodePage i_to)
+{
+    const u8 * start = (const u8 *) GetPageStartPC (i_from);
+    const u8 * end = (const u8 *) & i_from->code [i_from->info.numLines];
+    ptrdiff_t delta = (const u8 *) GetPageStartPC (i_to) - start;
+
+    RelocatePageLines (io_runtime->pagesOpen, start, end, delta);
+    RelocatePageLines (io_runtime->pagesFull, start, end, delta);
+    RelocatePageLines (i_pending, start, end, delta);
+
+    IM3Module module = io_runtime->modules;
+
+    while (module)
+    {
+        for (u32 i = 0; i < module->numFunctions; ++i)
+        {
+            IM3Function function = & module->functions [i];
+            const u8 * ptr = (const u8 *) function->compiled;
+
+            if (ptr >= start and ptr < end)
+                function->compiled = (pc_t) (ptr + delta);
+        }
+
+        module = module->next;
+    }
+}
+
+
+// moves partially used open pages into right-sized ones once a module is compiled. code is only
+// emitted again for modules loaded later, so the space left on open pages would mostly go unused.
+// pages are referenced by pointer from other pages and functions, so this must not run while executing.
+static void  CompactCodePages  (IM3Runtime io_runtime)
 {
-    for (u32 i = 0; i < i_module->numFunctions; ++i)
+    IM3CodePage pending = io_runtime->pagesOpen;
+    io_runtime->pagesOpen = NULL;
+
+    while (pending)
     {
-        IM3Function f = & i_module->functions [i];
+        IM3CodePage page = PopCodePage (& pending);
+        u32 numLines = page->info.lineIndex;
 
-        if (f->name)
+        if (numLines == 0)
         {
-            if (strcmp (f->name, i_name) == 0)
-                return f;
+            FreeCodePages (page);
+            io_runtime->numCodePages--;
+            continue;
         }
+
+        // not worth a copy for a few lines
+        if (NumFreeLines (page) * 8 >= page->info.numLines and NumFreeLines (page) * sizeof (code_t) >= 64)
+        {
+            IM3CodePage compact = NewCodePage (numLines, numLines);
+
+            if (compact)
+            {
+                memcpy (compact->code, page->code, numLines * sizeof (code_t));
+                memcpy (compact->info.pointerMap, page->info.pointerMap, (numLines + 7) / 8);
+                compact->info.lineIndex = numLines;
+
+                PushCodePage (& io_runtime->pagesFull, compact);
+                RelocateCodePage (io_runtime, pending, page, compact);
+
+                m3log (emit, "compact page: %d -> %d; lines: %d -> %d", page->info.sequence, compact->info.sequence, page->info.numLines, compact->info.numLines);
+
+                FreeCodePages (page);
+                continue;
+            }
+        }
+
+        ReleaseCodePageNoTrack (io_runtime, page);
     }
+}
 
-    return NULL;
+#endif
+
+
+M3Result  m3_CompileModule  (IM3Module io_module)
+{
+    M3Result result = m3Err_none;
+
+    if (not io_module->runtime)
+        _throw ("module must be loaded before compiling");
+
+    for (u32 i = 0; i < io_module->numFunctions; ++i)
+    {
+        IM3Function function = & io_module->functions [i];
+
+        // imports have no body; they are compiled (bound) by linking
+        if (function->wasm and not function->compiled)
+        {
+_           (Compile_Function (function));
+        }
+    }
+
+#if d_m3EnableCompiledImage && d_m3CompactCodePages
+    CompactCodePages (io_module->runtime);
+#endif
+
+    _catch: return result;
+}
+
+
+M3Result  m3_ResetRuntime  (IM3Runtime io_runtime)
+{
+    M3Result result = m3Err_none;
+
+    M3Memory * memory = & io_runtime->memory;
+
+    // compiled code pages and linked imports are retained; only the instance state is rebuilt
+    m3_ReleaseRuntimeMemory (io_runtime);
+    m3_ResetErrorInfo (io_runtime);
+
+    IM3Module module = io_runtime->modules;
+
+    while (module)
+    {
+_       (InitMemory (io_runtime, module));
+_       (InitGlobals (module));
+_       (InitDataSegments (memory, module));
+_       (InitElements (module));
+_       (InitStartFunc (module));
+
+        module = module->next;
+    }
+
+    _catch: return result;
+}
+
+
+void  m3_ReleaseRuntimeMemory  (IM3Runtime io_runtime)
+{
+    M3Memory * memory = & io_runtime->memory;
+
+    m3_LinearMemoryFree (memory->mallocated);
+    memory->mallocated = NULL;
+    memory->numPages = 0;
+    memory->numReservedBytes = 0;
+}
+
+
+M3Result  m3_GetFunctionProfile  (IM3Runtime i_runtime, M3ProfileCallback i_callback, void * i_context, bool i_reset)
+{
+    IM3Module module = i_runtime->modules;
+
+    while (module)
+    {
+        for (u32 i = 0; i < module->numFunctions; ++i)
+        {
+            IM3Function function = & module->functions [i];
+
+            if (function->hits)
+            {
+#               if d_m3EnableFunctionProfiling
+                    i_callback (i_context, GetFunctionName (function), function->hits, function->time);
+#               else
+                    i_callback (i_context, GetFunctionName (function), function->hits, 0);
+#               endif
+            }
+
+            if (i_reset)
+            {
+                function->hits = 0;
+#               if d_m3EnableFunctionProfiling
+                    function->time = 0;
+#               endif
+            }
+        }
+
+        module = module->next;
+    }
+
+    return m3Err_none;
+}
+
+
+void *  v_FindFunction  (IM3Module i_module, const char * const i_name)
+{
+    u32 cursor = 0;
+
+    return Module_FindNextFunction (i_module, false, i_name, & cursor);
 }
 
 
@@ -640,6 +903,39 @@ _       ((M3Result)Call (i_function->compiled, stack, runtime->memory.mallocated
     _catch: return result;
 }
 
+M3Result  m3_CallWithValues  (IM3Function i_function, uint32_t i_argc, const uint64_t * i_argv)
+{
+    M3Result result = m3Err_none;
+
+    if (i_function->compiled)
+    {
+        IM3Module module = i_function->module;
+
+        IM3Runtime runtime = module->runtime;
+        runtime->argc = 0;
+        runtime->argv = NULL;
+
+        IM3FuncType ftype = i_function->funcType;
+
+        m3stack_t stack = (m3stack_t)(runtime->stack);
+
+        if (i_argc != ftype->numArgs) {
+            _throw("arguments count mismatch");
+        }
+
+        for (u32 i = 0; i < ftype->numArgs; ++i)
+        {
+            stack [i] = i_argv [i];
+        }
+
+        m3StackCheckInit();
+_       ((M3Result)Call (i_function->compiled, stack, runtime->memory.mallocated, d_m3OpDefaultArgs));
+    }
+    else _throw (m3Err_missingCompiledCode);
+
+    _catch: return result;
+}
+
 #if 0
 M3Result  m3_CallMain  (IM3Function i_function, uint32_t i_argc, const char * const * i_argv)
 {
@@ -731,9 +1027,14 @@ IM3CodePage  AcquireCodePageWithCapacityR  (IM3Runtime i_runtime, u32 i_lineCoun
     }
     else
     {
-        page = NewCodePage (i_lineCount);
+        u32 numLines = M3_MAX (i_runtime->nextPageLines, c_m3CodePageMinLines);
+
+        page = NewCodePage (i_lineCount, numLines);
         if (page)
+        {
             i_runtime->numCodePages++;
+            i_runtime->nextPageLines = M3_MIN (numLines * 2, c_m3CodePageMaxLines);
+        }
     }
 
     return page;
@@ -872,3 +1173,15 @@ const uint8_t *  m3_GetMemory  (IM3Runtime i_runtime, uint32_t * o_memorySizeInB
 
     return memory;
 }
+
+
+void  m3_SetUserData  (IM3Runtime io_runtime, void * i_userdata)
+{
+    io_runtime->userdata = i_userdata;
+}
+
+
+void *  m3_GetUserData  (IM3Runtime i_runtime)
+{
+    return i_runtime ? i_runtime->userdata : NULL;
+}
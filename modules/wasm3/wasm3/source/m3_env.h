@@ -17,8 +17,11 @@
 extern "C" {
 #endif
 
+// function types are interned in the environment, so types are equal when their pointers are
 typedef struct M3FuncType
 {
+    struct M3FuncType *     next;
+
     u32                     numArgs;
     u8                      argTypes                [d_m3MaxNumFunctionArgs];
     u8                      returnType;
@@ -28,6 +31,7 @@ M3FuncType;
 typedef M3FuncType *        IM3FuncType;
 
 void        PrintFuncTypeSignature          (IM3FuncType i_funcType);
+bool        AreFuncTypesEqual               (const IM3FuncType i_typeA, const IM3FuncType i_typeB);
 
 
 //---------------------------------------------------------------------------------------------------------------------------------
@@ -48,6 +52,9 @@ typedef struct M3Function
     pc_t                    compiled;
 
     u32                     hits;
+# if d_m3EnableFunctionProfiling
+    u64                     time;               // inclusive of callees, see m3ProfileClock
+# endif
 
     u16                     maxStackSlots;
 
@@ -90,6 +97,8 @@ typedef struct M3Memory
 
     u32                     numPages;
     u32                     maxPages;
+
+    size_t                  numReservedBytes;   // page bytes allocated, may be more than numPages when reserved up front
 }
 M3Memory;
 
@@ -106,6 +115,9 @@ typedef struct M3DataSegment
     u32                     initExprSize;
     u32                     memoryRegion;
     u32                     size;
+
+    bool                    isPassive;      // only copied by memory.init
+    bool                    isDropped;      // data.drop, or an active segment after instantiation
 }
 M3DataSegment;
 
@@ -136,14 +148,24 @@ typedef M3Global *          IM3Global;
 
 
 //---------------------------------------------------------------------------------------------------------------------------------
+// open addressed hash of function names, built once a module is parsed
+typedef struct M3NameIndex
+{
+    u32                     mask;               // number of slots - 1
+    u32 *                   slots;              // function index + 1, zero when empty
+}
+M3NameIndex;
+
+
 typedef struct M3Module                 // TODO add env owner? also discriminates stack/heap
 {
     struct M3Runtime *      runtime;
+    struct M3Environment *  environment;
 
     cstr_t                  name;
 
     u32                     numFuncTypes;
-    M3FuncType *            funcTypes;
+    IM3FuncType *           funcTypes;          // interned in the environment
 
     u32                     numImports;
     IM3Function *           imports;            // notice: "I" prefix. imports are pointers to functions in another module.
@@ -151,6 +173,9 @@ typedef struct M3Module                 // TODO add env owner? also discriminate
     u32                     numFunctions;
     M3Function *            functions;
 
+    M3NameIndex             functionNames;      // by name, as found by m3_FindFunction
+    M3NameIndex             importNames;        // imports by field name
+
     i32                     startFunction;
 
     u32                     numDataSegments;
@@ -184,24 +209,22 @@ M3Result                    Module_AddGlobal            (IM3Module io_module, IM
 M3Result                    Module_AddFunction          (IM3Module io_module, u32 i_typeIndex, IM3ImportInfo i_importInfo /* can be null */);
 IM3Function                 Module_GetFunction          (IM3Module i_module, u32 i_functionIndex);
 
+M3Result                    Module_IndexNames           (IM3Module io_module);
+IM3Function                 Module_FindNextFunction     (IM3Module i_module, bool i_imports, cstr_t i_name, u32 * io_cursor);
+
 //---------------------------------------------------------------------------------------------------------------------------------
 typedef struct M3Environment
 {
-    u32     dummy;
-//    u32                     numCodePages;
-//    u32                     numActiveCodePages;
-
-    //  u32                     numFuncTypes;
-    //  M3FuncType *            funcTypes;
+    IM3FuncType             funcTypes;          // linked list of the unique function types of all parsed modules
 }
 M3Environment;
 
 typedef M3Environment *     IM3Environment;
 
+M3Result                    Environment_AddFuncType     (IM3Environment io_environment, IM3FuncType * o_funcType, const IM3FuncType i_funcType);
+
 //---------------------------------------------------------------------------------------------------------------------------------
 
-// OPTZ: function types need to move to the runtime structure so that all modules can share types
-// then type equality can be a simple pointer compare for indirect call checks
 typedef struct M3Runtime
 {
     M3Compilation           compilation;
@@ -213,6 +236,7 @@ typedef struct M3Runtime
 
     u32                     numCodePages;
     u32                     numActiveCodePages;
+    u32                     nextPageLines;  // size of the next new page, grows as more code is compiled
 
     IM3Module               modules;        // linked list of imported modules
 
@@ -233,6 +257,8 @@ typedef struct M3Runtime
     char                    error_message[256];
 #endif
     i32                     exit_code;
+
+    void *                  userdata;
 }
 M3Runtime;
 
@@ -252,6 +278,8 @@ void *                      v_FindFunction              (IM3Module i_module, con
 IM3CodePage                 AcquireCodePage             (IM3Runtime io_runtime);
 IM3CodePage                 AcquireCodePageWithCapacity (IM3Runtime io_runtime, u32 i_slotCount);
 void                        ReleaseCodePage             (IM3Runtime io_runtime, IM3CodePage i_codePage);
+void                        ReleaseCodePageNoTrack      (IM3Runtime io_runtime, IM3CodePage i_codePage);
+u32                         CountPages                  (IM3CodePage i_page);
 
 M3Result                    m3Error                     (M3Result i_result, IM3Runtime i_runtime, IM3Module i_module, IM3Function i_function, const char * const i_file, u32 i_lineNum, const char * const i_errorMessage, ...);
 
@@ -68,26 +68,13 @@ d_m3OpDef  (CallIndirect)
 
         if (function)
         {
-            // TODO: this can eventually be simplified. by using a shared set of unique M3FuncType objects in
-            // M3Environment, the compare can be reduced to a single pointer-compare operation
 #if !defined(d_m3SkipCallCheck)
-            if (type->numArgs != function->funcType->numArgs)
+            // types are interned, so a match is a pointer compare. the full compare only runs for a function
+            // from a module parsed in another environment, or before trapping
+            if (type != function->funcType and not AreFuncTypesEqual (type, function->funcType))
             {
                 return m3Err_trapIndirectCallTypeMismatch;
             }
-
-            if (type->returnType != function->funcType->returnType)
-            {
-                return m3Err_trapIndirectCallTypeMismatch;
-            }
-
-            for (u32 argIndex = 0; argIndex < type->numArgs; ++argIndex)
-            {
-                if (type->argTypes[argIndex] != function->funcType->argTypes[argIndex])
-                {
-                    return m3Err_trapIndirectCallTypeMismatch;
-                }
-            }
 #endif
             if (not function->compiled)
                 r = Compile_Function (function);
@@ -154,6 +141,74 @@ d_m3OpDef  (MemGrow)
 }
 
 
+// bulk memory operations take their operands from slots, with the byte count on top.
+// the whole range is bounds checked once, then handed to the native libc routine
+d_m3OpDef  (MemCopy)
+{
+    u32 size            = slot (u32);
+    u64 source          = slot (u32);
+    u64 destination     = slot (u32);
+
+    if (source + size <= _mem->length and destination + size <= _mem->length)
+    {
+        u8 * mem = m3MemData (_mem);
+        memmove (mem + destination, mem + source, size);
+
+        return nextOp ();
+    }
+    else return m3Err_trapOutOfBoundsMemoryAccess;
+}
+
+
+d_m3OpDef  (MemFill)
+{
+    u32 size            = slot (u32);
+    u32 value           = slot (u32);
+    u64 destination     = slot (u32);
+
+    if (destination + size <= _mem->length)
+    {
+        memset (m3MemData (_mem) + destination, (u8) value, size);
+
+        return nextOp ();
+    }
+    else return m3Err_trapOutOfBoundsMemoryAccess;
+}
+
+
+d_m3OpDef  (MemInit)
+{
+    IM3Module module    = immediate (IM3Module);
+    u32 segmentIndex    = immediate (u32);
+
+    u32 size            = slot (u32);
+    u64 source          = slot (u32);
+    u64 destination     = slot (u32);
+
+    M3DataSegment * segment = & module->dataSegments [segmentIndex];
+    u32 segmentSize = segment->isDropped ? 0 : segment->size;
+
+    if (source + size <= segmentSize and destination + size <= _mem->length)
+    {
+        memcpy (m3MemData (_mem) + destination, segment->data + source, size);
+
+        return nextOp ();
+    }
+    else return m3Err_trapOutOfBoundsMemoryAccess;
+}
+
+
+d_m3OpDef  (DataDrop)
+{
+    IM3Module module    = immediate (IM3Module);
+    u32 segmentIndex    = immediate (u32);
+
+    module->dataSegments [segmentIndex].isDropped = true;
+
+    return nextOp ();
+}
+
+
 // it's a debate: should the compilation be trigger be the caller or callee page.
 // it's a much easier to put it in the caller pager. if it's in the callee, either the entire page
 // has be left dangling or it's just a stub that jumps to a newly acquire page.  In Gestalt, I opted
@@ -209,7 +264,13 @@ d_m3OpDef  (Entry)
             memcpy (stack, function->constants, function->numConstants * sizeof (u64));
         }
 
-        m3ret_t r = nextOp ();
+#       if d_m3EnableFunctionProfiling
+            m3clock_t start = m3ProfileClock ();
+            m3ret_t r = nextOp ();
+            function->time += (m3clock_t) (m3ProfileClock () - start);
+#       else
+            m3ret_t r = nextOp ();
+#       endif
 
 #       if d_m3LogExec
             u8 returnType = function->funcType->returnType;
@@ -440,39 +501,68 @@ d_m3OpDef  (DumpStack)
 
 # if d_m3EnableOpProfiling
 //--------------------------------------------------------------------------------------------------------
-M3ProfilerSlot s_opProfilerCounts [c_m3ProfilerSlotMask] = {};
+M3ProfilerSlot s_opProfilerCounts [d_m3ProfilerSlotMask + 1] = {};
+u64 s_opProfilerDropped = 0;
 
 void  ProfileHit  (cstr_t i_operationName)
 {
-    u64 ptr = (u64) i_operationName;
+    // operation names are unique string constants so the pointer identifies the op
+    u32 hash = (u32) ((uintptr_t) i_operationName >> 2);
 
-    M3ProfilerSlot * slot = & s_opProfilerCounts [ptr & c_m3ProfilerSlotMask];
-
-    if (slot->opName)
+    for (u32 i = 0; i <= c_m3ProfilerSlotMask; ++i)
     {
-        if (slot->opName != i_operationName)
+        M3ProfilerSlot * slot = & s_opProfilerCounts [(hash + i) & c_m3ProfilerSlotMask];
+
+        if (slot->opName == i_operationName)
+        {
+            slot->hitCount++;
+            return;
+        }
+        else if (not slot->opName)
         {
-            m3Abort ("profiler slot collision; increase c_m3ProfilerSlotMask");
+            slot->opName = i_operationName;
+            slot->hitCount = 1;
+            return;
         }
     }
 
-    slot->opName = i_operationName;
-    slot->hitCount++;
+    s_opProfilerDropped++;
 }
 
-void  m3_PrintProfilerInfo  ()
+void  m3_GetOpProfile  (M3ProfileCallback i_callback, void * i_context, bool i_reset)
 {
     for (u32 i = 0; i <= c_m3ProfilerSlotMask; ++i)
     {
         M3ProfilerSlot * slot = & s_opProfilerCounts [i];
 
-        if (slot->opName)
-            printf ("%13llu  %s\n", slot->hitCount, slot->opName);
+        if (slot->opName and slot->hitCount)
+            i_callback (i_context, slot->opName, slot->hitCount, 0);
+
+        if (i_reset)
+            slot->hitCount = 0;
     }
+
+    if (s_opProfilerDropped)
+        i_callback (i_context, "<dropped>", s_opProfilerDropped, 0);
+
+    if (i_reset)
+        s_opProfilerDropped = 0;
+}
+
+static void  PrintProfile  (void * i_context, const char * i_name, uint64_t i_count, uint64_t i_time)
+{
+    printf ("%13llu  %s\n", (unsigned long long) i_count, i_name);
+}
+
+void  m3_PrintProfilerInfo  ()
+{
+    m3_GetOpProfile (PrintProfile, NULL, false);
 }
 
 # else
 
+void  m3_GetOpProfile  (M3ProfileCallback i_callback, void * i_context, bool i_reset) {}
+
 void  m3_PrintProfilerInfo  () {}
 
 # endif
@@ -28,6 +28,7 @@
 
 #include <math.h>
 #include <limits.h>
+#include <time.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -69,6 +70,29 @@ d_m3RetSig  profileOp  (d_m3OpSig, cstr_t i_operationName);
 
 #define jumpOp(PC)                  jumpOpDirect((pc_t)PC)
 
+# if d_m3EnableFunctionProfiling
+// CPU cycles on Xtensa (32-bit, wraps so only differences are meaningful), nanoseconds elsewhere
+#   if defined (__XTENSA__)
+typedef u32 m3clock_t;
+
+static inline m3clock_t  m3ProfileClock  (void)
+{
+    u32 ccount;
+    __asm__ __volatile__ ("rsr %0, ccount" : "=a" (ccount));
+    return ccount;
+}
+#   else
+typedef u64 m3clock_t;
+
+static inline m3clock_t  m3ProfileClock  (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, & ts);
+    return (u64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#   endif
+# endif
+
 d_m3RetSig  Call  (d_m3OpSig)
 {
     m3ret_t possible_trap = m3_Yield ();
@@ -607,6 +631,10 @@ d_m3OpDecl  (Entry)
 
 d_m3OpDecl  (MemCurrent)
 d_m3OpDecl  (MemGrow)
+d_m3OpDecl  (MemCopy)
+d_m3OpDecl  (MemFill)
+d_m3OpDecl  (MemInit)
+d_m3OpDecl  (DataDrop)
 
 
 d_m3Op  (Const)
@@ -766,6 +794,57 @@ d_m3Load_i (i64, i32);
 d_m3Load_i (i64, u32);
 d_m3Load_i (i64, i64);
 
+# if d_m3EnableSuperInstructions
+// load; local.set fused: the value is written straight to the local's slot
+#define d_m3LoadToSlot(DEST_TYPE, SRC_TYPE)             \
+d_m3Op(DEST_TYPE##_Load_##SRC_TYPE##_r_s)               \
+{                                                       \
+    u32 offset = immediate (u32);                       \
+    u64 operand = (u32) _r0;                            \
+    operand += offset;                                  \
+                                                        \
+    if (m3MemCheck(                                     \
+        operand + sizeof (SRC_TYPE) <= _mem->length     \
+    )) {                                                \
+        u8* src8 = m3MemData(_mem) + operand;           \
+        SRC_TYPE value;                                 \
+        memcpy(&value, src8, sizeof(value));            \
+        slot (DEST_TYPE) = (DEST_TYPE)value;            \
+        return nextOp ();                               \
+    } else d_outOfBounds;                               \
+}                                                       \
+d_m3Op(DEST_TYPE##_Load_##SRC_TYPE##_s_s)               \
+{                                                       \
+    u64 operand = slot (u32);                           \
+    u32 offset = immediate (u32);                       \
+    operand += offset;                                  \
+                                                        \
+    if (m3MemCheck(                                     \
+        operand + sizeof (SRC_TYPE) <= _mem->length     \
+    )) {                                                \
+        u8* src8 = m3MemData(_mem) + operand;           \
+        SRC_TYPE value;                                 \
+        memcpy(&value, src8, sizeof(value));            \
+        slot (DEST_TYPE) = (DEST_TYPE)value;            \
+        return nextOp ();                               \
+    } else d_outOfBounds;                               \
+}
+
+d_m3LoadToSlot (i32, i8);
+d_m3LoadToSlot (i32, u8);
+d_m3LoadToSlot (i32, i16);
+d_m3LoadToSlot (i32, u16);
+d_m3LoadToSlot (i32, i32);
+
+d_m3LoadToSlot (i64, i8);
+d_m3LoadToSlot (i64, u8);
+d_m3LoadToSlot (i64, i16);
+d_m3LoadToSlot (i64, u16);
+d_m3LoadToSlot (i64, i32);
+d_m3LoadToSlot (i64, u32);
+d_m3LoadToSlot (i64, i64);
+# endif
+
 #define d_m3Store(REG, SRC_TYPE, DEST_TYPE)             \
 d_m3Op  (SRC_TYPE##_Store_##DEST_TYPE##_rs)             \
 {                                                       \
@@ -875,6 +954,139 @@ d_m3Store_i (i64, i64)
 # endif
 
 
+//---------------------------------------------------------------------------------------------------------------------
+# if d_m3EnableSuperInstructions
+//---------------------------------------------------------------------------------------------------------------------
+// Fused operations for common opcode pairs, see m3_optimize.c. Operand order matches the
+// unfused operations: the top of the stack is the last operand and slots are read top first.
+
+// op; local.set -- the result is written to a slot instead of _r0
+#define d_m3SetSlotOpMacro(TYPE, NAME, OP, ...)         \
+d_m3Op(TYPE##_##NAME##_rs_s)                            \
+{                                                       \
+    TYPE operand = slot (TYPE);                         \
+    TYPE result;                                        \
+    OP(result, operand, ((TYPE) _r0), ##__VA_ARGS__);   \
+    slot (TYPE) = result;                               \
+    return nextOp ();                                   \
+}                                                       \
+d_m3Op(TYPE##_##NAME##_ss_s)                            \
+{                                                       \
+    TYPE operand2 = slot (TYPE);                        \
+    TYPE operand1 = slot (TYPE);                        \
+    TYPE result;                                        \
+    OP(result, operand1, operand2, ##__VA_ARGS__);      \
+    slot (TYPE) = result;                               \
+    return nextOp ();                                   \
+}
+
+d_m3SetSlotOpMacro (i32, Add,           M3_OPER, +)     d_m3SetSlotOpMacro (i64, Add,           M3_OPER, +)
+d_m3SetSlotOpMacro (i32, Subtract,      M3_OPER, -)     d_m3SetSlotOpMacro (i64, Subtract,      M3_OPER, -)
+d_m3SetSlotOpMacro (i32, Multiply,      M3_OPER, *)     d_m3SetSlotOpMacro (i64, Multiply,      M3_OPER, *)
+d_m3SetSlotOpMacro (u32, And,           M3_OPER, &)     d_m3SetSlotOpMacro (u64, And,           M3_OPER, &)
+d_m3SetSlotOpMacro (u32, Or,            M3_OPER, |)     d_m3SetSlotOpMacro (u64, Or,            M3_OPER, |)
+d_m3SetSlotOpMacro (u32, Xor,           M3_OPER, ^)     d_m3SetSlotOpMacro (u64, Xor,           M3_OPER, ^)
+d_m3SetSlotOpMacro (u32, ShiftLeft,     M3_FUNC, OP_SHL_32)     d_m3SetSlotOpMacro (u64, ShiftLeft,     M3_FUNC, OP_SHL_64)
+d_m3SetSlotOpMacro (i32, ShiftRight,    M3_FUNC, OP_SHR_32)     d_m3SetSlotOpMacro (i64, ShiftRight,    M3_FUNC, OP_SHR_64)
+d_m3SetSlotOpMacro (u32, ShiftRight,    M3_FUNC, OP_SHR_32)     d_m3SetSlotOpMacro (u64, ShiftRight,    M3_FUNC, OP_SHR_64)
+
+
+// compare; br_if -- BranchIf jumps forward to a block end, ContinueLoopIf re-enters a loop
+#define d_m3CompareBranchOp(TYPE, NAME, OP)             \
+d_m3Op(TYPE##_##NAME##_BranchIf_rs)                     \
+{                                                       \
+    TYPE operand = slot (TYPE);                         \
+    pc_t branch = immediate (pc_t);                     \
+                                                        \
+    if (operand OP ((TYPE) _r0))                        \
+        return jumpOp (branch);                         \
+    else return nextOp ();                              \
+}                                                       \
+d_m3Op(TYPE##_##NAME##_BranchIf_ss)                     \
+{                                                       \
+    TYPE operand2 = slot (TYPE);                        \
+    TYPE operand1 = slot (TYPE);                        \
+    pc_t branch = immediate (pc_t);                     \
+                                                        \
+    if (operand1 OP operand2)                           \
+        return jumpOp (branch);                         \
+    else return nextOp ();                              \
+}                                                       \
+d_m3Op(TYPE##_##NAME##_ContinueLoopIf_rs)               \
+{                                                       \
+    TYPE operand = slot (TYPE);                         \
+    void * loopId = immediate (void *);                 \
+                                                        \
+    if (operand OP ((TYPE) _r0))                        \
+        return loopId;                                  \
+    else return nextOp ();                              \
+}                                                       \
+d_m3Op(TYPE##_##NAME##_ContinueLoopIf_ss)               \
+{                                                       \
+    TYPE operand2 = slot (TYPE);                        \
+    TYPE operand1 = slot (TYPE);                        \
+    void * loopId = immediate (void *);                 \
+                                                        \
+    if (operand1 OP operand2)                           \
+        return loopId;                                  \
+    else return nextOp ();                              \
+}
+
+// i64 compares are rare in applet loops and are left unfused to save IRAM
+d_m3CompareBranchOp (i32, Equal,                ==)
+d_m3CompareBranchOp (i32, NotEqual,             !=)
+d_m3CompareBranchOp (i32, LessThan,             < )     d_m3CompareBranchOp (u32, LessThan,             < )
+d_m3CompareBranchOp (i32, GreaterThan,          > )     d_m3CompareBranchOp (u32, GreaterThan,          > )
+d_m3CompareBranchOp (i32, LessThanOrEqual,      <=)     d_m3CompareBranchOp (u32, LessThanOrEqual,      <=)
+d_m3CompareBranchOp (i32, GreaterThanOrEqual,   >=)     d_m3CompareBranchOp (u32, GreaterThanOrEqual,   >=)
+
+
+// eqz; br_if
+#define d_m3BranchIfZeroOp(TYPE)                        \
+d_m3Op(TYPE##_BranchIfZero_r)                           \
+{                                                       \
+    TYPE operand = (TYPE) _r0;                          \
+    pc_t branch = immediate (pc_t);                     \
+                                                        \
+    if (operand == 0)                                   \
+        return jumpOp (branch);                         \
+    else return nextOp ();                              \
+}                                                       \
+d_m3Op(TYPE##_BranchIfZero_s)                           \
+{                                                       \
+    TYPE operand = slot (TYPE);                         \
+    pc_t branch = immediate (pc_t);                     \
+                                                        \
+    if (operand == 0)                                   \
+        return jumpOp (branch);                         \
+    else return nextOp ();                              \
+}                                                       \
+d_m3Op(TYPE##_ContinueLoopIfZero_r)                     \
+{                                                       \
+    TYPE operand = (TYPE) _r0;                          \
+    void * loopId = immediate (void *);                 \
+                                                        \
+    if (operand == 0)                                   \
+        return loopId;                                  \
+    else return nextOp ();                              \
+}                                                       \
+d_m3Op(TYPE##_ContinueLoopIfZero_s)                     \
+{                                                       \
+    TYPE operand = slot (TYPE);                         \
+    void * loopId = immediate (void *);                 \
+                                                        \
+    if (operand == 0)                                   \
+        return loopId;                                  \
+    else return nextOp ();                              \
+}
+
+d_m3BranchIfZeroOp (i32)
+d_m3BranchIfZeroOp (i64)
+
+//---------------------------------------------------------------------------------------------------------------------
+# endif
+
+
 //---------------------------------------------------------------------------------------------------------------------
 // debug/profiling
 //---------------------------------------------------------------------------------------------------------------------
@@ -898,7 +1110,7 @@ d_m3OpDecl  (DumpStack)
 # endif
 
 # if d_m3EnableOpProfiling
-static const u32 c_m3ProfilerSlotMask = 0xFFFF;
+static const u32 c_m3ProfilerSlotMask = d_m3ProfilerSlotMask;
 
 typedef struct M3ProfilerSlot
 {
@@ -0,0 +1,509 @@
+//
+//  m3_image.c
+//
+//  Serialization of compiled code pages, so a module can skip compilation on subsequent loads.
+//
+//  An image holds the used lines of every code page in the runtime, plus a relocation for each line
+//  that was emitted as a pointer (see MarkPagePointer). Operations are stored as-is, so an image is
+//  only valid for the build that produced it; the header holds op_Entry and the embedder's build id
+//  (m3_GetImageBuildId) as a fingerprint of that. Calls into imports are stored against the import,
+//  which must be linked again before the image is restored.
+//
+
+#include "m3_env.h"
+#include "m3_exception.h"
+
+#define d_m3ImageMagic          0x4943334D      // "M3CI"
+#define d_m3ImageVersion        2
+
+typedef struct M3ImageHeader
+{
+    u32                     magic;
+    u32                     version;
+    u32                     pointerSize;
+    u32                     numPages;
+    u64                     opReference;
+    u8                      buildId [32];
+
+    u32                     numFunctions;
+    u32                     numGlobals;
+    u32                     numFuncTypes;
+    u32                     codeSize;           // sum of wasm function body sizes
+}
+M3ImageHeader;
+
+enum
+{
+    c_m3RelocCode           = 1,                // index: page; offset: line
+    c_m3RelocFunction       = 2,                // index: function
+    c_m3RelocModule         = 3,
+    c_m3RelocGlobal         = 4,                // offset: bytes into globals
+    c_m3RelocFuncType       = 5,                // index: function type
+    c_m3RelocImport         = 6                 // index: function
+};
+
+typedef struct M3ImageRelocation
+{
+    u32                     line;
+    u32                     kind;
+    u32                     index;
+    u32                     offset;
+}
+M3ImageRelocation;
+
+typedef struct M3ImageFunction
+{
+    u32                     page;               // c_m3ImageNotCompiled if the function has no code
+    u32                     line;
+    u16                     maxStackSlots;
+    u16                     numConstants;
+}
+M3ImageFunction;
+
+static const u32 c_m3ImageNotCompiled = 0xFFFFFFFF;
+
+
+static u32  GetModuleCodeSize  (IM3Module i_module)
+{
+    u32 size = 0;
+
+    for (u32 i = 0; i < i_module->numFunctions; ++i)
+    {
+        IM3Function function = & i_module->functions [i];
+
+        if (function->wasm)
+            size += (u32) (function->wasmEnd - function->wasm);
+    }
+
+    return size;
+}
+
+
+static void  InitImageHeader  (M3ImageHeader * o_header, IM3Module i_module, u32 i_numPages)
+{
+    memset (o_header, 0x0, sizeof (M3ImageHeader));
+
+    o_header->magic         = d_m3ImageMagic;
+    o_header->version       = d_m3ImageVersion;
+    o_header->pointerSize   = sizeof (void *);
+    o_header->numPages      = i_numPages;
+    o_header->opReference   = (u64) (size_t) op_Entry;
+    m3_GetImageBuildId (o_header->buildId);
+    o_header->numFunctions  = i_module->numFunctions;
+    o_header->numGlobals    = i_module->numGlobals;
+    o_header->numFuncTypes  = i_module->numFuncTypes;
+    o_header->codeSize      = GetModuleCodeSize (i_module);
+}
+
+
+#if d_m3EnableCompiledImage
+
+// collects the runtime code pages into an array, so pages can be referenced by index
+static M3Result  GatherCodePages  (IM3CodePage ** o_pages, u32 * o_numPages, IM3Runtime i_runtime)
+{
+    M3Result result = m3Err_none;
+
+    u32 numPages = CountPages (i_runtime->pagesOpen) + CountPages (i_runtime->pagesFull);
+
+    IM3CodePage * pages = NULL;
+_   (m3Alloc (& pages, IM3CodePage, numPages ? numPages : 1));
+
+    u32 i = 0;
+    IM3CodePage lists [2] = { i_runtime->pagesFull, i_runtime->pagesOpen };
+
+    for (u32 l = 0; l < 2; ++l)
+    {
+        IM3CodePage page = lists [l];
+
+        while (page)
+        {
+            pages [i++] = page;
+            page = page->info.next;
+        }
+    }
+
+    * o_pages = pages;
+    * o_numPages = numPages;
+
+    _catch: return result;
+}
+
+
+static bool  FindCodeLine  (u32 * o_page, u32 * o_line, IM3CodePage * i_pages, u32 i_numPages, const void * i_pointer)
+{
+    for (u32 p = 0; p < i_numPages; ++p)
+    {
+        const code_t * start = & i_pages [p]->code [0];
+        const code_t * end = start + i_pages [p]->info.numLines;
+
+        if ((const code_t *) i_pointer >= start and (const code_t *) i_pointer < end)
+        {
+            * o_page = p;
+            * o_line = (u32) ((const code_t *) i_pointer - start);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static M3Result  RelocatePointer  (M3ImageRelocation * io_reloc, IM3Module i_module, IM3CodePage * i_pages, u32 i_numPages, const void * i_pointer)
+{
+    M3Result result = m3Err_none;
+
+    const u8 * ptr = (const u8 *) i_pointer;
+
+    const u8 * functions = (const u8 *) i_module->functions;
+    const u8 * globals = (const u8 *) i_module->globals;
+
+    // a call into an import targets the host link, which is made again on restore
+    for (u32 i = 0; i < i_module->numFunctions; ++i)
+    {
+        IM3Function function = & i_module->functions [i];
+
+        if (function->import.moduleUtf8 and function->compiled == i_pointer)
+        {
+            io_reloc->kind = c_m3RelocImport;
+            io_reloc->index = i;
+            return result;
+        }
+    }
+
+    if (FindCodeLine (& io_reloc->index, & io_reloc->offset, i_pages, i_numPages, i_pointer))
+    {
+        io_reloc->kind = c_m3RelocCode;
+    }
+    else if (ptr >= functions and ptr < functions + i_module->numFunctions * sizeof (M3Function)
+             and (ptr - functions) % sizeof (M3Function) == 0)
+    {
+        io_reloc->kind = c_m3RelocFunction;
+        io_reloc->index = (u32) ((ptr - functions) / sizeof (M3Function));
+    }
+    else if (ptr == (const u8 *) i_module)
+    {
+        io_reloc->kind = c_m3RelocModule;
+    }
+    else if (ptr >= globals and ptr < globals + i_module->numGlobals * sizeof (M3Global))
+    {
+        io_reloc->kind = c_m3RelocGlobal;
+        io_reloc->offset = (u32) (ptr - globals);
+    }
+    else
+    {
+        result = m3Err_imageUnrelocatable;
+
+        // types are shared through the environment, so are stored by the index of the first module type using them
+        for (u32 i = 0; i < i_module->numFuncTypes; ++i)
+        {
+            if (ptr == (const u8 *) i_module->funcTypes [i])
+            {
+                io_reloc->kind = c_m3RelocFuncType;
+                io_reloc->index = i;
+                result = m3Err_none;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+M3Result  m3_SaveCompiledImage  (IM3Module i_module, M3ImageWriter i_writer, void * i_context)
+{
+    M3Result result = m3Err_none;
+
+    IM3CodePage * pages = NULL;
+    u32 numPages = 0;
+
+    IM3Runtime runtime = i_module->runtime;
+
+    if (not runtime or runtime->modules != i_module or i_module->next)
+        _throw ("compiled images require a runtime with a single loaded module");
+
+_   (GatherCodePages (& pages, & numPages, runtime));
+
+    M3ImageHeader header;
+    InitImageHeader (& header, i_module, numPages);
+
+_   (i_writer (i_context, & header, sizeof (header)));
+
+    for (u32 p = 0; p < numPages; ++p)
+    {
+        IM3CodePage page = pages [p];
+
+        u32 numLines = page->info.lineIndex;
+        u32 numRelocs = 0;
+
+        for (u32 l = 0; l < numLines; ++l)
+            numRelocs += IsPagePointer (page, l);
+
+_       (i_writer (i_context, & numLines, sizeof (u32)));
+_       (i_writer (i_context, & numRelocs, sizeof (u32)));
+_       (i_writer (i_context, & page->code [0], numLines * sizeof (code_t)));
+
+        for (u32 l = 0; l < numLines; ++l)
+        {
+            if (IsPagePointer (page, l))
+            {
+                M3ImageRelocation reloc = { l, 0, 0, 0 };
+
+                result = RelocatePointer (& reloc, i_module, pages, numPages, page->code [l]);
+
+                if (result)
+                    _throw (ErrorModule (result, i_module, "page: %d; line: %d; pointer: %p", p, l, page->code [l]));
+
+_               (i_writer (i_context, & reloc, sizeof (reloc)));
+            }
+        }
+    }
+
+    for (u32 i = 0; i < i_module->numFunctions; ++i)
+    {
+        IM3Function function = & i_module->functions [i];
+
+        M3ImageFunction info = { c_m3ImageNotCompiled, 0, function->maxStackSlots, function->numConstants };
+
+        if (function->compiled and not function->import.moduleUtf8)
+        {
+            if (not FindCodeLine (& info.page, & info.line, pages, numPages, function->compiled))
+                _throw (m3Err_imageUnrelocatable);
+        }
+
+_       (i_writer (i_context, & info, sizeof (info)));
+
+        if (info.numConstants)
+        {
+_           (i_writer (i_context, function->constants, info.numConstants * sizeof (u64)));
+        }
+    }
+
+    _catch:
+
+    m3Free (pages);
+
+    return result;
+}
+
+#else
+
+M3Result  m3_SaveCompiledImage  (IM3Module i_module, M3ImageWriter i_writer, void * i_context)
+{
+    return m3Err_imageNotSupported;
+}
+
+#endif // d_m3EnableCompiledImage
+
+
+static M3Result  ReadImage  (void * o_data, size_t i_size, bytes_t * io_bytes, cbytes_t i_end)
+{
+    M3Result result = m3Err_none;
+
+    if (* io_bytes + i_size <= i_end)
+    {
+        memcpy (o_data, * io_bytes, i_size);
+        * io_bytes += i_size;
+    }
+    else result = m3Err_imageMalformed;
+
+    return result;
+}
+
+
+static M3Result  ApplyRelocation  (IM3CodePage i_page, const M3ImageRelocation * i_reloc, IM3Module io_module, IM3CodePage * i_pages, u32 i_numPages)
+{
+    M3Result result = m3Err_none;
+
+    void * pointer = NULL;
+
+    if (i_reloc->line >= i_page->info.lineIndex)
+        _throw (m3Err_imageMalformed);
+
+    switch (i_reloc->kind)
+    {
+        case c_m3RelocCode:
+            if (i_reloc->index >= i_numPages or i_reloc->offset >= i_pages [i_reloc->index]->info.numLines)
+                _throw (m3Err_imageMalformed);
+
+            pointer = & i_pages [i_reloc->index]->code [i_reloc->offset];
+            break;
+
+        case c_m3RelocFunction:
+            if (i_reloc->index >= io_module->numFunctions)
+                _throw (m3Err_imageMalformed);
+
+            pointer = & io_module->functions [i_reloc->index];
+            break;
+
+        case c_m3RelocModule:
+            pointer = io_module;
+            break;
+
+        case c_m3RelocGlobal:
+            if (i_reloc->offset >= io_module->numGlobals * sizeof (M3Global))
+                _throw (m3Err_imageMalformed);
+
+            pointer = (u8 *) io_module->globals + i_reloc->offset;
+            break;
+
+        case c_m3RelocFuncType:
+            if (i_reloc->index >= io_module->numFuncTypes)
+                _throw (m3Err_imageMalformed);
+
+            pointer = io_module->funcTypes [i_reloc->index];
+            break;
+
+        case c_m3RelocImport:
+            if (i_reloc->index >= io_module->numFunctions or not io_module->functions [i_reloc->index].import.moduleUtf8)
+                _throw (m3Err_imageMalformed);
+
+            pointer = (void *) io_module->functions [i_reloc->index].compiled;
+
+            if (not pointer)
+                _throw (m3Err_functionImportMissing);
+            break;
+
+        default:
+            _throw (m3Err_imageMalformed);
+    }
+
+    i_page->code [i_reloc->line] = pointer;
+
+    _catch: return result;
+}
+
+
+M3Result  m3_LoadCompiledImage  (IM3Module io_module, const uint8_t * const i_image, uint32_t i_imageSize)
+{
+    M3Result result = m3Err_none;
+
+    IM3CodePage * pages = NULL;
+    IM3CodePage pageList = NULL;
+    u32 numPages = 0;
+
+    bytes_t bytes = i_image;
+    cbytes_t end = i_image + i_imageSize;
+
+    IM3Runtime runtime = io_module->runtime;
+
+    if (not runtime)
+        _throw ("module must be loaded before restoring a compiled image");
+
+    M3ImageHeader expected, header;
+    InitImageHeader (& expected, io_module, 0);
+
+_   (ReadImage (& header, sizeof (header), & bytes, end));
+
+    expected.numPages = header.numPages;
+
+    if (memcmp (& header, & expected, sizeof (header)) != 0)
+        _throw (m3Err_imageMismatch);
+
+    numPages = header.numPages;
+_   (m3Alloc (& pages, IM3CodePage, numPages ? numPages : 1));
+
+    // pages are restored first, as relocations can refer to any page
+    bytes_t pageStart = bytes;
+
+    for (u32 p = 0; p < numPages; ++p)
+    {
+        u32 numLines = 0, numRelocs = 0;
+_       (ReadImage (& numLines, sizeof (u32), & bytes, end));
+_       (ReadImage (& numRelocs, sizeof (u32), & bytes, end));
+
+        IM3CodePage page = NewCodePage (numLines, numLines);
+
+        if (not page)
+            _throw (m3Err_mallocFailedCodePage);
+
+        PushCodePage (& pageList, page);
+        pages [p] = page;
+
+_       (ReadImage (& page->code [0], numLines * sizeof (code_t), & bytes, end));
+        page->info.lineIndex = numLines;
+
+        if (numRelocs > (size_t) (end - bytes) / sizeof (M3ImageRelocation))
+            _throw (m3Err_imageMalformed);
+
+        bytes += numRelocs * sizeof (M3ImageRelocation);
+    }
+
+    bytes = pageStart;
+
+    for (u32 p = 0; p < numPages; ++p)
+    {
+        u32 numLines = 0, numRelocs = 0;
+_       (ReadImage (& numLines, sizeof (u32), & bytes, end));
+_       (ReadImage (& numRelocs, sizeof (u32), & bytes, end));
+
+        bytes += numLines * sizeof (code_t);
+
+        for (u32 r = 0; r < numRelocs; ++r)
+        {
+            M3ImageRelocation reloc = { 0, 0, 0, 0 };
+_           (ReadImage (& reloc, sizeof (reloc), & bytes, end));
+_           (ApplyRelocation (pages [p], & reloc, io_module, pages, numPages));
+        }
+    }
+
+    // validate the function table before anything is bound to the restored pages
+    bytes_t functionStart = bytes;
+
+    for (u32 i = 0; i < io_module->numFunctions; ++i)
+    {
+        M3ImageFunction info;
+_       (ReadImage (& info, sizeof (info), & bytes, end));
+
+        if (info.page != c_m3ImageNotCompiled and (info.page >= numPages or info.line >= pages [info.page]->info.lineIndex))
+            _throw (m3Err_imageMalformed);
+
+        // imports keep their own link
+        if (info.page != c_m3ImageNotCompiled and io_module->functions [i].import.moduleUtf8)
+            _throw (m3Err_imageMalformed);
+
+        if (info.numConstants > (size_t) (end - bytes) / sizeof (u64))
+            _throw (m3Err_imageMalformed);
+
+        bytes += info.numConstants * sizeof (u64);
+    }
+
+    // hand the restored pages over to the runtime
+    while (pageList)
+        PushCodePage (& runtime->pagesFull, PopCodePage (& pageList));
+
+    bytes = functionStart;
+
+    for (u32 i = 0; i < io_module->numFunctions; ++i)
+    {
+        IM3Function function = & io_module->functions [i];
+
+        M3ImageFunction info;
+_       (ReadImage (& info, sizeof (info), & bytes, end));
+
+        if (info.page == c_m3ImageNotCompiled)
+            continue;
+
+        u64 * constants = NULL;
+
+        if (info.numConstants)
+        {
+_           (m3Alloc (& constants, u64, info.numConstants));
+            ReadImage (constants, info.numConstants * sizeof (u64), & bytes, end);
+        }
+
+        m3Free (function->constants);
+
+        function->compiled = & pages [info.page]->code [info.line];
+        function->maxStackSlots = info.maxStackSlots;
+        function->numConstants = info.numConstants;
+        function->constants = constants;
+    }
+
+    _catch:
+
+    FreeCodePages (pageList);
+    m3Free (pages);
+
+    return result;
+}
@@ -399,7 +399,8 @@ void  log_opcode  (IM3Compilation o, u8 i_opcode)
         o->block.depth--;
 
 #   ifdef DEBUG
-        m3log (compile, "%4d | 0x%02x  %s %s", o->numOpcodes++, i_opcode, GetOpcodeIndentionString (o), c_operations [i_opcode].name);
+        cstr_t name = (i_opcode == c_waOp_extended) ? "(extended)" : c_operations [i_opcode].name;
+        m3log (compile, "%4d | 0x%02x  %s %s", o->numOpcodes++, i_opcode, GetOpcodeIndentionString (o), name);
 #   else
         m3log (compile, "%4d | 0x%02x  %s", o->numOpcodes++, i_opcode, GetOpcodeIndentionString (o));
 #   endif
@@ -7,6 +7,7 @@
 
 
 #include "m3_env.h"
+#include "m3_exception.h"
 
 static void Module_FreeFunctions(IM3Module i_module);
 
@@ -20,6 +21,8 @@ void  m3_FreeModule  (IM3Module i_module)
         Module_FreeFunctions (i_module);
 
         m3Free (i_module->functions);
+        m3Free (i_module->functionNames.slots);
+        m3Free (i_module->importNames.slots);
         m3Free (i_module->imports);
         m3Free (i_module->funcTypes);
         m3Free (i_module->dataSegments);
@@ -82,7 +85,7 @@ M3Result  Module_AddFunction  (IM3Module io_module, u32 i_typeIndex, IM3ImportIn
     {
         if (i_typeIndex < io_module->numFuncTypes)
         {
-            IM3FuncType ft = & io_module->funcTypes [i_typeIndex];
+            IM3FuncType ft = io_module->funcTypes [i_typeIndex];
 
             IM3Function func = Module_GetFunction (io_module, index);
             func->funcType = ft;
@@ -112,3 +115,113 @@ IM3Function  Module_GetFunction  (IM3Module i_module, u32 i_functionIndex)
 
     return func;
 }
+
+
+static u32  HashName  (cstr_t i_name)
+{
+    u32 hash = 2166136261u;
+
+    while (* i_name)
+    {
+        hash ^= (u8) * i_name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+static cstr_t  GetIndexedName  (IM3Function i_function, bool i_imports)
+{
+    if (i_imports)
+        return i_function->import.moduleUtf8 ? i_function->import.fieldUtf8 : NULL;
+    else
+        return i_function->name;
+}
+
+
+static M3Result  BuildNameIndex  (M3NameIndex * o_index, IM3Module i_module, bool i_imports)
+{
+    M3Result result = m3Err_none;
+
+    u32 numNames = 0;
+
+    for (u32 i = 0; i < i_module->numFunctions; ++i)
+    {
+        if (GetIndexedName (& i_module->functions [i], i_imports))
+            ++numNames;
+    }
+
+    if (numNames)
+    {
+        // at most half full, so probe sequences stay short
+        u32 numSlots = 4;
+        while (numSlots < numNames * 2)
+            numSlots *= 2;
+
+_       (m3Alloc (& o_index->slots, u32, numSlots));
+        o_index->mask = numSlots - 1;
+
+        // functions are added in order, so the first match when probing is the lowest index
+        for (u32 i = 0; i < i_module->numFunctions; ++i)
+        {
+            cstr_t name = GetIndexedName (& i_module->functions [i], i_imports);
+
+            if (name)
+            {
+                u32 slot = HashName (name) & o_index->mask;
+
+                while (o_index->slots [slot])
+                    slot = (slot + 1) & o_index->mask;
+
+                o_index->slots [slot] = i + 1;
+            }
+        }
+    }
+
+    _catch: return result;
+}
+
+
+M3Result  Module_IndexNames  (IM3Module io_module)
+{
+    M3Result result = m3Err_none;
+
+_   (BuildNameIndex (& io_module->functionNames, io_module, false));
+_   (BuildNameIndex (& io_module->importNames, io_module, true));
+
+    _catch: return result;
+}
+
+
+// returns the functions named i_name (or importing a field named i_name) one per call, lowest index first.
+// *io_cursor must be zero for the first call
+IM3Function  Module_FindNextFunction  (IM3Module i_module, bool i_imports, cstr_t i_name, u32 * io_cursor)
+{
+    M3NameIndex * index = i_imports ? & i_module->importNames : & i_module->functionNames;
+
+    if (index->slots)
+    {
+        u32 hash = HashName (i_name);
+
+        for (u32 n = * io_cursor; n <= index->mask; ++n)
+        {
+            u32 slot = index->slots [(hash + n) & index->mask];
+
+            if (not slot)
+                break;
+
+            IM3Function function = & i_module->functions [slot - 1];
+
+            if (strcmp (GetIndexedName (function, i_imports), i_name) == 0)
+            {
+                * io_cursor = n + 1;
+                return function;
+            }
+        }
+    }
+
+    * io_cursor = index->mask + 1;
+
+    return NULL;
+}
@@ -6,7 +6,10 @@
 //
 
 #include "m3_compile.h"
+#include "m3_emit.h"
+#include "m3_env.h"
 #include "m3_exec.h"
+#include "m3_exception.h"
 
 
 // not currently used
@@ -27,3 +30,296 @@ bool  PeekNextOpcode  (IM3Compilation o, u8 i_opcode)
 
     return found;
 }
+
+
+# if d_m3EnableSuperInstructions
+
+// Superinstructions: an opcode and the one following it are compiled to a single operation,
+// saving a dispatch and the _r0 round trip. Fusions are only taken when the stack state is
+// simple; otherwise the opcode is compiled normally and the following one is left alone.
+
+#define d_fusedBinOp(TYPE, NAME)        { op_##TYPE##_##NAME##_rs_s,  op_##TYPE##_##NAME##_ss_s }
+#define d_fusedCompareOp(TYPE, NAME)    { op_##TYPE##_##NAME##_BranchIf_rs, op_##TYPE##_##NAME##_BranchIf_ss, \
+                                          op_##TYPE##_##NAME##_ContinueLoopIf_rs, op_##TYPE##_##NAME##_ContinueLoopIf_ss }
+#define d_fusedLoadOp(TYPE, SRC)        { op_##TYPE##_Load_##SRC##_r_s, op_##TYPE##_Load_##SRC##_s_s }
+
+// [opcode - 0x6a] i32.add .. i32.shr_u, [opcode - 0x7c] i64.add .. i64.shr_u. div/rem can trap and aren't fused
+static const IM3Operation c_setSlotOps [2][13][2] =
+{
+    {
+        d_fusedBinOp (i32, Add),    d_fusedBinOp (i32, Subtract),   d_fusedBinOp (i32, Multiply),
+        { NULL }, { NULL }, { NULL }, { NULL },
+        d_fusedBinOp (u32, And),    d_fusedBinOp (u32, Or),         d_fusedBinOp (u32, Xor),
+        d_fusedBinOp (u32, ShiftLeft), d_fusedBinOp (i32, ShiftRight), d_fusedBinOp (u32, ShiftRight)
+    },
+    {
+        d_fusedBinOp (i64, Add),    d_fusedBinOp (i64, Subtract),   d_fusedBinOp (i64, Multiply),
+        { NULL }, { NULL }, { NULL }, { NULL },
+        d_fusedBinOp (u64, And),    d_fusedBinOp (u64, Or),         d_fusedBinOp (u64, Xor),
+        d_fusedBinOp (u64, ShiftLeft), d_fusedBinOp (i64, ShiftRight), d_fusedBinOp (u64, ShiftRight)
+    }
+};
+
+// add, mul, and, or, xor
+static const bool c_setSlotCommutative [13] = { true, false, true, false, false, false, false, true, true, true, false, false, false };
+
+// [opcode - 0x46] i32.eq .. i32.ge_u
+static const IM3Operation c_compareBranchOps [10][4] =
+{
+    d_fusedCompareOp (i32, Equal),              d_fusedCompareOp (i32, NotEqual),
+    d_fusedCompareOp (i32, LessThan),           d_fusedCompareOp (u32, LessThan),
+    d_fusedCompareOp (i32, GreaterThan),        d_fusedCompareOp (u32, GreaterThan),
+    d_fusedCompareOp (i32, LessThanOrEqual),    d_fusedCompareOp (u32, LessThanOrEqual),
+    d_fusedCompareOp (i32, GreaterThanOrEqual), d_fusedCompareOp (u32, GreaterThanOrEqual)
+};
+
+// the compare with its operands swapped: a < b == b > a
+static const u8 c_compareMirror [10] = { 0, 1, 4, 5, 2, 3, 8, 9, 6, 7 };
+
+// [opcode - 0x28] i32.load .. i64.load32_u, float loads excluded
+static const IM3Operation c_loadToSlotOps [14][2] =
+{
+    d_fusedLoadOp (i32, i32),   d_fusedLoadOp (i64, i64),   { NULL },   { NULL },
+    d_fusedLoadOp (i32, i8),    d_fusedLoadOp (i32, u8),    d_fusedLoadOp (i32, i16),   d_fusedLoadOp (i32, u16),
+    d_fusedLoadOp (i64, i8),    d_fusedLoadOp (i64, u8),    d_fusedLoadOp (i64, i16),   d_fusedLoadOp (i64, u16),
+    d_fusedLoadOp (i64, i32),   d_fusedLoadOp (i64, u32)
+};
+
+
+// reads the immediate of the following opcode without consuming it
+static bool  PeekNextOpcodeImmediate  (IM3Compilation o, u8 i_opcode, u32 * o_immediate, bytes_t * o_next)
+{
+    bytes_t wasm = o->wasm;
+
+    if (wasm < o->wasmEnd and * wasm == i_opcode)
+    {
+        ++wasm;
+        if (ReadLEB_u32 (o_immediate, & wasm, o->wasmEnd) == m3Err_none)
+        {
+            * o_next = wasm;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static bool  HasOperands  (IM3Compilation o, u16 i_numOperands)
+{
+    return not IsStackPolymorphic (o) and o->stackIndex >= o->block.initStackIndex + i_numOperands;
+}
+
+
+// a local can be written directly when the top i_numOperands (consumed by the fused op
+// before the write) are the only stack entries referencing it. See FindReferencedLocalWithinCurrentBlock
+static bool  IsLocalWritable  (IM3Compilation o, u32 i_localIndex, u8 i_type, u16 i_numOperands)
+{
+    if (i_localIndex >= GetFunctionNumArgsAndLocals (o->function) or o->typeStack [i_localIndex] != i_type)
+        return false;
+
+    IM3CompilationScope scope = & o->block;
+    i16 startIndex = scope->initStackIndex;
+
+    while (scope->opcode == c_waOp_block)
+    {
+        scope = scope->outer;
+        if (not scope)
+            break;
+
+        startIndex = scope->initStackIndex;
+    }
+
+    for (i32 i = startIndex; i < o->stackIndex - i_numOperands; ++i)
+    {
+        if (o->wasmStack [i] == i_localIndex)
+            return false;
+    }
+
+    return true;
+}
+
+
+// op; local.set
+static M3Result  FuseSetLocal  (IM3Compilation o, u8 i_opcode, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    u32 typeIndex = (i_opcode >= 0x7c);
+    u32 index = i_opcode - (typeIndex ? 0x7c : 0x6a);
+    const IM3Operation * ops = c_setSlotOps [typeIndex][index];
+
+    u32 localIndex; bytes_t next;
+
+    if (ops [0] and HasOperands (o, 2) and PeekNextOpcodeImmediate (o, c_waOp_setLocal, & localIndex, & next)
+        and IsLocalWritable (o, localIndex, c_operations [i_opcode].type, 2))
+    {
+        IM3Operation op = NULL;
+
+        if (IsStackTopInRegister (o))
+            op = ops [0];
+        else if (not IsStackTopMinus1InRegister (o))
+            op = ops [1];
+        else if (c_setSlotCommutative [index])
+            op = ops [0];
+
+        if (op)
+        {
+_           (EmitOp (o, op));
+_           (EmitTopSlotAndPop (o));
+_           (EmitTopSlotAndPop (o));
+            EmitSlotOffset (o, localIndex);
+
+            o->wasm = next;
+            * o_fused = true;
+        }
+    }
+
+    _catch: return result;
+}
+
+
+// emits the branch target of a fused br_if, as Compile_Branch
+static M3Result  EmitBranchTarget  (IM3Compilation o, IM3CompilationScope i_scope)
+{
+    M3Result result = m3Err_none;
+
+    if (i_scope->opcode == c_waOp_loop)
+    {
+        EmitPointer (o, i_scope->pc);
+    }
+    else
+    {
+        IM3BranchPatch patch;
+_       (AcquirePatch (o, & patch));
+
+        patch->location = (pc_t *) ReservePointer (o);
+        patch->next = i_scope->patches;
+        i_scope->patches = patch;
+    }
+
+    _catch: return result;
+}
+
+
+// finds the br_if target, only loops and blocks without results are fused
+static bool  PeekBranchIf  (IM3Compilation o, IM3CompilationScope * o_scope, bytes_t * o_next)
+{
+    u32 depth;
+
+    if (PeekNextOpcodeImmediate (o, c_waOp_branchIf, & depth, o_next))
+    {
+        if (GetBlockScope (o, o_scope, depth) == m3Err_none)
+            return ((* o_scope)->opcode == c_waOp_loop or (* o_scope)->type == c_m3Type_none);
+    }
+
+    return false;
+}
+
+
+// compare; br_if
+static M3Result  FuseCompareBranch  (IM3Compilation o, u8 i_opcode, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    u32 index = i_opcode - 0x46;
+    IM3CompilationScope scope; bytes_t next;
+
+    if (HasOperands (o, 2) and PeekBranchIf (o, & scope, & next))
+    {
+        u32 loop = (scope->opcode == c_waOp_loop) ? 2 : 0;
+        IM3Operation op;
+
+        if (IsStackTopInRegister (o))
+            op = c_compareBranchOps [index][loop + 0];
+        else if (IsStackTopMinus1InRegister (o))
+            op = c_compareBranchOps [c_compareMirror [index]][loop + 0];
+        else
+            op = c_compareBranchOps [index][loop + 1];
+
+_       (EmitOp (o, op));
+_       (EmitTopSlotAndPop (o));
+_       (EmitTopSlotAndPop (o));
+_       (EmitBranchTarget (o, scope));
+
+        o->wasm = next;
+        * o_fused = true;
+    }
+
+    _catch: return result;
+}
+
+
+// eqz; br_if
+static M3Result  FuseBranchIfZero  (IM3Compilation o, u8 i_opcode, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    IM3CompilationScope scope; bytes_t next;
+
+    if (HasOperands (o, 1) and PeekBranchIf (o, & scope, & next))
+    {
+        const IM3Operation ops [2][2][2] =
+        {
+            { { op_i32_BranchIfZero_r, op_i32_BranchIfZero_s }, { op_i32_ContinueLoopIfZero_r, op_i32_ContinueLoopIfZero_s } },
+            { { op_i64_BranchIfZero_r, op_i64_BranchIfZero_s }, { op_i64_ContinueLoopIfZero_r, op_i64_ContinueLoopIfZero_s } }
+        };
+
+        IM3Operation op = ops [i_opcode == 0x50][scope->opcode == c_waOp_loop][IsStackTopInSlot (o)];
+
+_       (EmitOp (o, op));
+_       (EmitTopSlotAndPop (o));
+_       (EmitBranchTarget (o, scope));
+
+        o->wasm = next;
+        * o_fused = true;
+    }
+
+    _catch: return result;
+}
+
+
+M3Result  CompileSuperInstruction  (IM3Compilation o, u8 i_opcode, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    * o_fused = false;
+
+    if ((i_opcode >= 0x6a and i_opcode <= 0x76) or (i_opcode >= 0x7c and i_opcode <= 0x88))
+        result = FuseSetLocal (o, i_opcode, o_fused);
+    else if (i_opcode >= 0x46 and i_opcode <= 0x4f)
+        result = FuseCompareBranch (o, i_opcode, o_fused);
+    else if (i_opcode == 0x45 or i_opcode == 0x50)
+        result = FuseBranchIfZero (o, i_opcode, o_fused);
+
+    return result;
+}
+
+
+// load; local.set. the memory offset has already been read by Compile_Load_Store
+M3Result  CompileLoadSuperInstruction  (IM3Compilation o, u8 i_opcode, u32 i_memoryOffset, bool * o_fused)
+{
+    M3Result result = m3Err_none;
+
+    * o_fused = false;
+
+    u32 index = i_opcode - 0x28;
+    u32 localIndex; bytes_t next;
+
+    if (index < 14 and c_loadToSlotOps [index][0] and HasOperands (o, 1)
+        and PeekNextOpcodeImmediate (o, c_waOp_setLocal, & localIndex, & next)
+        and IsLocalWritable (o, localIndex, c_operations [i_opcode].type, 1))
+    {
+_       (EmitOp (o, c_loadToSlotOps [index][IsStackTopInSlot (o)]));
+_       (EmitTopSlotAndPop (o));
+        EmitConstant (o, i_memoryOffset);
+        EmitSlotOffset (o, localIndex);
+
+        o->wasm = next;
+        * o_fused = true;
+    }
+
+    _catch: return result;
+}
+
+# endif
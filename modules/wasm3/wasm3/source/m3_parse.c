@@ -45,16 +45,17 @@ _   (ReadLEB_u32 (& numTypes, & i_bytes, i_end));
 
     if (numTypes)
     {
-        // FIX: these need to be instead added to a set in the runtime struct to facilitate IndirectCall
-
-_       (m3Alloc (& io_module->funcTypes, M3FuncType, numTypes));
+_       (m3Alloc (& io_module->funcTypes, IM3FuncType, numTypes));
 
         io_module->numFuncTypes = numTypes;
 
-        IM3FuncType ft = io_module->funcTypes;
-
-        while (numTypes--)
+        for (u32 t = 0; t < numTypes; ++t)
         {
+            M3FuncType type;
+            M3_INIT (type);
+
+            IM3FuncType ft = & type;
+
             i8 form;
 _           (ReadLEB_i7 (& form, & i_bytes, i_end));
 
@@ -85,7 +86,7 @@ _               (ReadLEB_i7 (& returnType, & i_bytes, i_end));
 _               (NormalizeType (& ft->returnType, returnType));
             }                                                                       m3logif (parse, PrintFuncTypeSignature (ft))
 
-            ++ft;
+_           (Environment_AddFuncType (io_module->environment, & io_module->funcTypes [t], ft));
         }
     }
 
@@ -363,14 +364,26 @@ _   (m3Alloc (& io_module->dataSegments, M3DataSegment, numDataSegments));
     {
         M3DataSegment * segment = & io_module->dataSegments [i];
 
-_       (ReadLEB_u32 (& segment->memoryRegion, & i_bytes, i_end));
+        // bulk memory: 0 = active, 1 = passive, 2 = active with an explicit memory index
+        u32 flags;
+_       (ReadLEB_u32 (& flags, & i_bytes, i_end));
 
-        segment->initExpr = i_bytes;
-_       (Parse_InitExpr (io_module, & i_bytes, i_end));
-        segment->initExprSize = (u32) (i_bytes - segment->initExpr);
+        segment->isPassive = (flags == 1);
 
-        if (segment->initExprSize <= 1)
-            _throw (m3Err_wasmMissingInitExpr);
+        if (flags == 2)
+_           (ReadLEB_u32 (& segment->memoryRegion, & i_bytes, i_end))
+        else if (flags > 2)
+            _throw (m3Err_wasmMalformed);
+
+        if (not segment->isPassive)
+        {
+            segment->initExpr = i_bytes;
+_           (Parse_InitExpr (io_module, & i_bytes, i_end));
+            segment->initExprSize = (u32) (i_bytes - segment->initExpr);
+
+            if (segment->initExprSize <= 1)
+                _throw (m3Err_wasmMissingInitExpr);
+        }
 
 _       (ReadLEB_u32 (& segment->size, & i_bytes, i_end));
 
@@ -531,6 +544,16 @@ M3Result  ParseModuleSection  (M3Module * o_module, u8 i_sectionType, bytes_t i_
 }
 
 
+// from the spec: sections must appear in order
+static bool  IsSectionInOrder  (u8 i_sectionCode, u8 i_previousSection)
+{
+    return (i_sectionCode > i_previousSection or
+            i_sectionCode == 0 or
+            (i_sectionCode == 12 and i_previousSection == 9) or   // if present, DataCount goes after Element
+            (i_sectionCode == 10 and i_previousSection == 12));   // and before Code
+}
+
+
 M3Result  m3_ParseModule  (IM3Environment i_environment, IM3Module * o_module, cbytes_t i_bytes, u32 i_numBytes)
 {
     M3Result result;
@@ -540,6 +563,7 @@ _try {
 _   (m3Alloc (& module, M3Module, 1));
 //  Module_Init (module);
 
+    module->environment = i_environment;
     module->name = ".unnamed";                                                      m3log (parse, "load module: %d bytes", i_numBytes);
     module->startFunction = -1;
 
@@ -563,11 +587,8 @@ _       (Read_u32 (&version, & pos, end));
                 u8 sectionCode;
 _               (ReadLEB_u7 (& sectionCode, & pos, end));
 
-                if (sectionCode > previousSection or  // from the spec: sections must appear in order
-                    sectionCode == 0 or
-                    (sectionCode == 12 and previousSection == 9) or  // if present, DataCount goes after Element
-                    (sectionCode == 10 and previousSection == 12)    // and before Code
-                ) {
+                if (IsSectionInOrder (sectionCode, previousSection))
+                {
                     u32 sectionLength;
 _                   (ReadLEB_u32 (& sectionLength, & pos, end));
 _                   (ParseModuleSection (module, sectionCode, pos, sectionLength));
@@ -584,6 +605,8 @@ _                   (ParseModuleSection (module, sectionCode, pos, sectionLength
     }
     else _throw (m3Err_wasmMalformed);
 
+_   (Module_IndexNames (module));
+
     } _catch:
 
     if (result)
@@ -596,3 +619,212 @@ _                   (ParseModuleSection (module, sectionCode, pos, sectionLength
 
     return result;
 }
+
+
+//-------------------------------------------------------------------------------------------------------------------------------
+//  streaming validation
+//-------------------------------------------------------------------------------------------------------------------------------
+
+enum
+{
+    c_streamHeader,
+    c_streamSectionCode,
+    c_streamSectionLength,
+    c_streamSectionBody
+};
+
+typedef struct M3StreamValidator
+{
+    u32                     state;
+
+    u8                      header          [8];
+    u32                     headerBytes;
+
+    u8                      sectionCode;
+    u8                      previousSection;
+    u32                     sectionLength;
+    u32                     lengthShift;
+    u32                     sectionRemaining;
+
+    // sections that fit are buffered and parsed into a scratch module
+    M3Module *              module;
+    M3Environment *         environment;        // holds the scratch module's types
+    u8 *                    buffer;
+    u32                     bufferSize;
+    bool                    buffering;
+    bool                    skipped;            // a section the scratch module needs was skipped, so stop parsing
+}
+M3StreamValidator;
+
+
+IM3StreamValidator  m3_NewStreamValidator  (u32 i_maxSectionBytes)
+{
+    IM3StreamValidator validator = NULL;
+    m3Alloc (& validator, M3StreamValidator, 1);
+
+    if (validator)
+    {
+        m3Alloc (& validator->module, M3Module, 1);
+        m3Alloc (& validator->environment, M3Environment, 1);
+
+        if (i_maxSectionBytes)
+            m3Malloc ((void **) & validator->buffer, i_maxSectionBytes);
+
+        if (validator->module and validator->environment and (validator->buffer or not i_maxSectionBytes))
+        {
+            validator->module->environment = validator->environment;
+            validator->module->name = ".unnamed";
+            validator->module->startFunction = -1;
+            validator->bufferSize = i_maxSectionBytes;
+        }
+        else
+        {
+            m3Free (validator->module);
+            m3Free (validator->environment);
+            m3Free (validator->buffer);
+            m3Free (validator);
+        }
+    }
+
+    return validator;
+}
+
+
+static M3Result  ValidateSectionStart  (IM3StreamValidator io_validator)
+{
+    M3Result result = m3Err_none;
+
+    IM3StreamValidator v = io_validator;
+
+    v->sectionRemaining = v->sectionLength;
+    v->buffering = (not v->skipped and v->sectionLength <= v->bufferSize);
+
+    // custom sections aren't referred to by others, anything else leaves the scratch module incomplete
+    if (not v->buffering and v->sectionCode)
+        v->skipped = true;
+
+    m3log (parse, "stream section: %d; length: %d; %s", (u32) v->sectionCode, v->sectionLength, v->buffering ? "parsing" : "skipping");
+
+    if (v->sectionCode)
+        v->previousSection = v->sectionCode;
+
+    return result;
+}
+
+
+static M3Result  ValidateSectionEnd  (IM3StreamValidator io_validator)
+{
+    M3Result result = m3Err_none;
+
+    IM3StreamValidator v = io_validator;
+
+    if (v->buffering)
+        result = ParseModuleSection (v->module, v->sectionCode, v->buffer, v->sectionLength);
+
+    v->state = c_streamSectionCode;
+
+    return result;
+}
+
+
+M3Result  m3_ValidateStream  (IM3StreamValidator io_validator, const u8 * const i_bytes, u32 i_numBytes)
+{
+    M3Result result = m3Err_none;
+
+    IM3StreamValidator v = io_validator;
+
+    bytes_t pos = i_bytes;
+    cbytes_t end = i_bytes + i_numBytes;
+
+    while (pos < end)
+    {
+        if (v->state == c_streamHeader)
+        {
+            v->header [v->headerBytes++] = * pos++;
+
+            if (v->headerBytes == sizeof (v->header))
+            {
+                bytes_t header = v->header;
+                u32 magic, version;
+_               (Read_u32 (& magic, & header, header + 4));
+_               (Read_u32 (& version, & header, header + 8));
+
+                if (magic != 0x6d736100)
+                    _throw (m3Err_wasmMalformed);
+
+                if (version != 1)
+                    _throw (m3Err_incompatibleWasmVersion);
+
+                v->state = c_streamSectionCode;
+            }
+        }
+        else if (v->state == c_streamSectionCode)
+        {
+            u8 sectionCode = * pos++;
+
+            if (sectionCode & 0x80)
+                _throw (m3Err_wasmMalformed);
+
+            if (not IsSectionInOrder (sectionCode, v->previousSection))
+                _throw (m3Err_misorderedWasmSection);
+
+            v->sectionCode = sectionCode;
+            v->sectionLength = 0;
+            v->lengthShift = 0;
+            v->state = c_streamSectionLength;
+        }
+        else if (v->state == c_streamSectionLength)
+        {
+            u8 byte = * pos++;
+
+            if (v->lengthShift >= 32 or (v->lengthShift == 28 and (byte & 0x70)))
+                _throw (m3Err_lebOverflow);
+
+            v->sectionLength |= (u32) (byte & 0x7f) << v->lengthShift;
+            v->lengthShift += 7;
+
+            if ((byte & 0x80) == 0)
+            {
+_               (ValidateSectionStart (v));
+
+                v->state = c_streamSectionBody;
+
+                if (v->sectionLength == 0)
+_                   (ValidateSectionEnd (v));
+            }
+        }
+        else // c_streamSectionBody
+        {
+            u32 numBytes = M3_MIN ((u32) (end - pos), v->sectionRemaining);
+
+            if (v->buffering)
+                memcpy (v->buffer + (v->sectionLength - v->sectionRemaining), pos, numBytes);
+
+            pos += numBytes;
+            v->sectionRemaining -= numBytes;
+
+            if (v->sectionRemaining == 0)
+_               (ValidateSectionEnd (v));
+        }
+    }
+
+    _catch: return result;
+}
+
+
+M3Result  m3_FinishStreamValidator  (IM3StreamValidator i_validator)
+{
+    M3Result result = m3Err_none;
+
+    if (i_validator->state == c_streamHeader)
+        result = m3Err_wasmMalformed;
+    else if (i_validator->state != c_streamSectionCode)
+        result = m3Err_wasmUnderrun;
+
+    m3_FreeModule (i_validator->module);
+    m3_FreeEnvironment (i_validator->environment);
+    m3Free (i_validator->buffer);
+    m3Free (i_validator);
+
+    return result;
+}
@@ -15,6 +15,7 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <inttypes.h>
 
 #if defined(__cplusplus)
@@ -27,6 +28,7 @@ struct M3Environment;   typedef struct M3Environment *  IM3Environment;
 struct M3Runtime;       typedef struct M3Runtime *      IM3Runtime;
 struct M3Module;        typedef struct M3Module *       IM3Module;
 struct M3Function;      typedef struct M3Function *     IM3Function;
+struct M3StreamValidator;   typedef struct M3StreamValidator *  IM3StreamValidator;
 
 
 typedef struct M3ErrorInfo
@@ -129,6 +131,12 @@ d_m3ErrorConst  (mallocFailedCodePage,          "memory allocation failed when a
 d_m3ErrorConst  (settingImmutableGlobal,        "attempting to set an immutable global")
 d_m3ErrorConst  (optimizerFailed,               "optimizer failed") // not a fatal error. a result,
 
+// compiled image errors
+d_m3ErrorConst  (imageNotSupported,             "compiled images require d_m3EnableCompiledImage")
+d_m3ErrorConst  (imageMismatch,                 "compiled image does not match this build or module")
+d_m3ErrorConst  (imageMalformed,                "malformed compiled image")
+d_m3ErrorConst  (imageUnrelocatable,            "compiled code holds a pointer that can't be relocated")
+
 // runtime errors
 d_m3ErrorConst  (missingCompiledCode,           "function is missing compiled m3 code")
 d_m3ErrorConst  (wasmMemoryOverflow,            "runtime ran out of memory")
@@ -178,6 +186,11 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
                                                      M3StackInfo *          i_nativeStackInfo);     // i_nativeStackInfo can be NULL
 
     void                m3_FreeRuntime              (IM3Runtime             i_runtime);
+
+    void                m3_SetUserData              (IM3Runtime             io_runtime,
+                                                     void *                 i_userdata);
+    void *              m3_GetUserData              (IM3Runtime             i_runtime);
+    //  UserData is an opaque pointer kept with the runtime, for host functions to find their context
     
     const uint8_t *     m3_GetMemory                (IM3Runtime             i_runtime,
                                                      uint32_t *             o_memorySizeInBytes,
@@ -197,9 +210,46 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
     void                m3_FreeModule               (IM3Module i_module);
     //  Only unloaded modules need to be freed
 
+    IM3StreamValidator  m3_NewStreamValidator       (uint32_t               i_maxSectionBytes);
+    M3Result            m3_ValidateStream           (IM3StreamValidator     io_validator,
+                                                     const uint8_t * const  i_bytes,
+                                                     uint32_t               i_numBytes);
+    M3Result            m3_FinishStreamValidator    (IM3StreamValidator     i_validator);
+    //  StreamValidator checks a Wasm binary as it arrives in chunks, without holding the whole binary in memory.
+    //  The header and section framing and ordering are always checked; sections no larger than i_maxSectionBytes
+    //  are also buffered and parsed, until a larger (non-custom) section is skipped as later sections refer to it.
+    //  FinishStreamValidator checks the binary ended cleanly and frees the validator
+
     M3Result            m3_LoadModule               (IM3Runtime io_runtime,  IM3Module io_module);
     //  LoadModule transfers ownership of a module to the runtime. Do not free modules once successfully imported into the runtime
 
+    M3Result            m3_CompileModule            (IM3Module io_module);
+    //  CompileModule compiles every function of a loaded module up front rather than on first call.
+    //  Imports should be linked first, as calls to unlinked imports fail to compile
+
+    typedef M3Result (* M3ImageWriter) (void * i_context, const void * i_data, uint32_t i_size);
+
+    M3Result            m3_SaveCompiledImage        (IM3Module              i_module,
+                                                     M3ImageWriter          i_writer,
+                                                     void *                 i_context);
+    //  SaveCompiledImage serializes the compiled code of a module's runtime, with pointers into the module and
+    //  code pages stored as relocations. Requires d_m3EnableCompiledImage. The image is only valid for the same build,
+    //  as identified by m3_GetImageBuildId
+
+    M3Result            m3_LoadCompiledImage        (IM3Module              io_module,
+                                                     const uint8_t * const  i_image,
+                                                     uint32_t               i_imageSize);
+    //  LoadCompiledImage restores compiled code saved by SaveCompiledImage into a freshly loaded module. Imports must
+    //  be linked first, calls into them are bound to the current links. The image data is copied and may be released
+    //  once this returns
+
+    M3Result            m3_ResetRuntime             (IM3Runtime io_runtime);
+    //  ResetRuntime re-initializes linear memory, globals and tables of the loaded modules and re-runs their start functions.
+    //  Parsed modules, linked imports and compiled code are kept, so a runtime can be reused without re-parsing or re-compiling
+
+    void                m3_ReleaseRuntimeMemory     (IM3Runtime io_runtime);
+    //  ReleaseRuntimeMemory frees the linear memory of an idle runtime. It is reallocated by m3_ResetRuntime
+
     typedef const void * (* M3RawCall) (IM3Runtime runtime, uint64_t * _sp, void * _mem);
 
     M3Result            m3_LinkRawFunction          (IM3Module              io_module,
@@ -208,6 +258,21 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
                                                      const char * const     i_signature,
                                                      M3RawCall              i_function);
 
+    typedef struct M3RawFunctionLink
+    {
+        const char *        moduleName;
+        const char *        functionName;
+        const char *        signature;
+        M3RawCall           function;
+    }
+    M3RawFunctionLink;
+
+    M3Result            m3_LinkRawFunctions         (IM3Module                  io_module,
+                                                     const M3RawFunctionLink *  i_links,
+                                                     uint32_t                   i_numLinks);
+    //  LinkRawFunctions links a table of host functions. Imports are looked up by a name index built when the module
+    //  was parsed, host functions the module doesn't import are skipped. Stops at the first other error (e.g. a signature mismatch)
+
 //-------------------------------------------------------------------------------------------------------------------------------
 //  functions
 //-------------------------------------------------------------------------------------------------------------------------------
@@ -219,6 +284,8 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
 
     M3Result            m3_Call                     (IM3Function i_function);
     M3Result            m3_CallWithArgs             (IM3Function i_function, uint32_t i_argc, const char * const * i_argv);
+    M3Result            m3_CallWithValues           (IM3Function i_function, uint32_t i_argc, const uint64_t * i_argv);
+    //  CallWithValues passes arguments as raw stack values (i32 / f32 in the low 32 bits) rather than strings
 
     // IM3Functions are valid during the lifetime of the originating runtime
 
@@ -233,6 +300,57 @@ d_m3ErrorConst  (trapStackOverflow,             "[trap] stack overflow")
     void                m3_PrintM3Info              (void);
     void                m3_PrintProfilerInfo        (void);
 
+//-------------------------------------------------------------------------------------------------------------------------------
+//  profiling
+//-------------------------------------------------------------------------------------------------------------------------------
+
+    // i_time is zero for operations, and for functions unless built with d_m3EnableFunctionProfiling
+    typedef void (* M3ProfileCallback)                  (void * i_context, const char * i_name, uint64_t i_count, uint64_t i_time);
+
+    // reports called functions of all modules loaded into the runtime
+    M3Result            m3_GetFunctionProfile       (IM3Runtime i_runtime, M3ProfileCallback i_callback, void * i_context, bool i_reset);
+
+    // reports executed operations of all runtimes (requires d_m3EnableOpProfiling)
+    void                m3_GetOpProfile             (M3ProfileCallback i_callback, void * i_context, bool i_reset);
+
+//-------------------------------------------------------------------------------------------------------------------------------
+//  heap
+//-------------------------------------------------------------------------------------------------------------------------------
+
+    typedef struct M3HeapInfo
+    {
+        size_t      size;               // bytes available for allocation
+        size_t      used;               // bytes allocated, including block headers
+        size_t      peak;               // most bytes allocated at once
+        size_t      largestFree;        // largest allocation that would currently succeed
+        uint32_t    allocations;        // live allocations
+        uint32_t    failures;           // allocations that failed
+    }
+    M3HeapInfo;
+
+    // reports usage of the d_m3FixedHeap region (all zero when allocating from the system heap)
+    void                m3_GetHeapInfo              (M3HeapInfo * o_info);
+
+    // serialize fixed heap allocation and the shared code page pool, weak no-ops to be overridden when runtimes are used from several threads
+    void                m3_HeapLock                 (void);
+    void                m3_HeapUnlock               (void);
+
+    // allocate and resize linear memory, weak defaults use the wasm3 heap. override to place linear memory elsewhere
+    // (e.g. external RAM); contents must be kept when resizing and any growth zeroed
+    void *              m3_LinearMemoryRealloc      (void * i_ptr, size_t i_newSize, size_t i_oldSize);
+    void                m3_LinearMemoryFree         (void * i_ptr);
+
+    // called before a resize moves existing linear memory (e.g. to let the host drain DMA into it), an error fails the
+    // resize so memory.grow returns -1. weak default allows it
+    M3Result            m3_LinearMemoryMoving       (IM3Runtime i_runtime);
+
+    // identifies the build in compiled images, which are rejected by any other build. weak default is all zeros, so
+    // override (e.g. with the firmware ELF hash) where saved images can outlive the build
+    void                m3_GetImageBuildId          (uint8_t o_id [32]);
+
+    // frees the code pages kept for reuse by runtimes compiled later
+    void                m3_ReleaseCodePagePool      (void);
+
 #if defined(__cplusplus)
 }
 #endif